@@ -15,6 +15,8 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
+
 #include "ppsspp_config.h"
 #include "Common/Data/Convert/ColorConv.h"
 #include "Common/Data/Convert/SmallDataConvert.h"
@@ -642,3 +644,165 @@ void ConvertBGRA5551ToABGR1555(u16 *dst, const u16 *src, u32 numPixels) {
 		dst[i] = (c >> 15) | (c << 1);
 	}
 }
+
+// YUV420 to RGB, for limited range BT.601 (MPEG) video. Fixed point with 6 fractional bits, chosen so that
+// all the intermediates fit in 16 bits, which means the SIMD paths give exactly the same results as this.
+static inline void YUVToRGB(int y, int u, int v, int &r, int &g, int &b) {
+	y -= 16;
+	u -= 128;
+	v -= 128;
+	const int yt = y * 74 + (y >> 1) + 32;
+	r = std::clamp((yt + v * 102) >> 6, 0, 255);
+	g = std::clamp((yt - u * 25 - v * 52) >> 6, 0, 255);
+	b = std::clamp((yt + u * 129) >> 6, 0, 255);
+}
+
+enum class YUVOutput {
+	RGBA8888,
+	RGB565,
+	RGBA5551,
+	RGBA4444,
+};
+
+template <YUVOutput format>
+static inline void WriteYUVOutputPixel(void *dst, u32 i, int r, int g, int b) {
+	switch (format) {
+	case YUVOutput::RGBA8888: ((u32 *)dst)[i] = r | (g << 8) | (b << 16); break;
+	case YUVOutput::RGB565: ((u16 *)dst)[i] = (r >> 3) | ((g >> 2) << 5) | ((b >> 3) << 11); break;
+	case YUVOutput::RGBA5551: ((u16 *)dst)[i] = (r >> 3) | ((g >> 3) << 5) | ((b >> 3) << 10); break;
+	case YUVOutput::RGBA4444: ((u16 *)dst)[i] = (r >> 4) | ((g >> 4) << 4) | ((b >> 4) << 8); break;
+	}
+}
+
+#if PPSSPP_ARCH(SSE2)
+// Converts 16 pixels, returning 16 bit lanes (low and high 8 pixels) already clamped to 0-255.
+static inline void YUVToRGB_SSE2(const u8 *y, const u8 *u, const u8 *v, __m128i r[2], __m128i g[2], __m128i b[2]) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c128 = _mm_set1_epi16(128);
+	const __m128i c255 = _mm_set1_epi16(255);
+	__m128i u16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)u), zero), c128);
+	__m128i v16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)v), zero), c128);
+	__m128i rc = _mm_mullo_epi16(v16, _mm_set1_epi16(102));
+	__m128i gc = _mm_add_epi16(_mm_mullo_epi16(u16, _mm_set1_epi16(25)), _mm_mullo_epi16(v16, _mm_set1_epi16(52)));
+	__m128i bc = _mm_mullo_epi16(u16, _mm_set1_epi16(129));
+
+	__m128i y8 = _mm_loadu_si128((const __m128i *)y);
+	for (int half = 0; half < 2; half++) {
+		__m128i y16 = half == 0 ? _mm_unpacklo_epi8(y8, zero) : _mm_unpackhi_epi8(y8, zero);
+		y16 = _mm_sub_epi16(y16, _mm_set1_epi16(16));
+		__m128i yt = _mm_add_epi16(_mm_mullo_epi16(y16, _mm_set1_epi16(74)), _mm_add_epi16(_mm_srai_epi16(y16, 1), _mm_set1_epi16(32)));
+		// Each chroma sample covers two pixels.
+		__m128i rh = half == 0 ? _mm_unpacklo_epi16(rc, rc) : _mm_unpackhi_epi16(rc, rc);
+		__m128i gh = half == 0 ? _mm_unpacklo_epi16(gc, gc) : _mm_unpackhi_epi16(gc, gc);
+		__m128i bh = half == 0 ? _mm_unpacklo_epi16(bc, bc) : _mm_unpackhi_epi16(bc, bc);
+		// Only blue can exceed 16 bits, and saturating it still clamps to 255.
+		r[half] = _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(_mm_adds_epi16(yt, rh), 6), zero), c255);
+		g[half] = _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(_mm_subs_epi16(yt, gh), 6), zero), c255);
+		b[half] = _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(_mm_adds_epi16(yt, bh), 6), zero), c255);
+	}
+}
+#elif PPSSPP_ARCH(ARM_NEON)
+// Converts 16 pixels to 8-bit channels.
+static inline void YUVToRGB_NEON(const u8 *y, const u8 *u, const u8 *v, uint8x16_t &r, uint8x16_t &g, uint8x16_t &b) {
+	int16x8_t u16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u))), vdupq_n_s16(128));
+	int16x8_t v16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v))), vdupq_n_s16(128));
+	int16x8x2_t rc = vzipq_s16(vmulq_n_s16(v16, 102), vmulq_n_s16(v16, 102));
+	int16x8_t gcs = vaddq_s16(vmulq_n_s16(u16, 25), vmulq_n_s16(v16, 52));
+	int16x8x2_t gc = vzipq_s16(gcs, gcs);
+	int16x8x2_t bc = vzipq_s16(vmulq_n_s16(u16, 129), vmulq_n_s16(u16, 129));
+
+	uint8x16_t y8 = vld1q_u8(y);
+	uint8x8_t rh[2], gh[2], bh[2];
+	for (int half = 0; half < 2; half++) {
+		int16x8_t y16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(half == 0 ? vget_low_u8(y8) : vget_high_u8(y8))), vdupq_n_s16(16));
+		int16x8_t yt = vaddq_s16(vmulq_n_s16(y16, 74), vaddq_s16(vshrq_n_s16(y16, 1), vdupq_n_s16(32)));
+		rh[half] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(yt, rc.val[half]), 6));
+		gh[half] = vqmovun_s16(vshrq_n_s16(vqsubq_s16(yt, gc.val[half]), 6));
+		bh[half] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(yt, bc.val[half]), 6));
+	}
+	r = vcombine_u8(rh[0], rh[1]);
+	g = vcombine_u8(gh[0], gh[1]);
+	b = vcombine_u8(bh[0], bh[1]);
+}
+#endif
+
+template <YUVOutput format>
+static void ConvertYUV420Row(void *dst, const u8 *y, const u8 *u, const u8 *v, u32 numPixels) {
+	u32 i = 0;
+#if PPSSPP_ARCH(SSE2)
+	for (; i + 16 <= numPixels; i += 16) {
+		__m128i r[2], g[2], b[2];
+		YUVToRGB_SSE2(y + i, u + i / 2, v + i / 2, r, g, b);
+		for (int half = 0; half < 2; half++) {
+			if (format == YUVOutput::RGBA8888) {
+				// Alpha stays 0.
+				__m128i rg = _mm_or_si128(r[half], _mm_slli_epi16(g[half], 8));
+				__m128i *d = (__m128i *)((u32 *)dst + i + half * 8);
+				_mm_storeu_si128(d, _mm_unpacklo_epi16(rg, b[half]));
+				_mm_storeu_si128(d + 1, _mm_unpackhi_epi16(rg, b[half]));
+			} else {
+				__m128i px;
+				if (format == YUVOutput::RGB565) {
+					px = _mm_or_si128(_mm_srli_epi16(r[half], 3), _mm_slli_epi16(_mm_srli_epi16(g[half], 2), 5));
+					px = _mm_or_si128(px, _mm_slli_epi16(_mm_srli_epi16(b[half], 3), 11));
+				} else if (format == YUVOutput::RGBA5551) {
+					px = _mm_or_si128(_mm_srli_epi16(r[half], 3), _mm_slli_epi16(_mm_srli_epi16(g[half], 3), 5));
+					px = _mm_or_si128(px, _mm_slli_epi16(_mm_srli_epi16(b[half], 3), 10));
+				} else {
+					px = _mm_or_si128(_mm_srli_epi16(r[half], 4), _mm_slli_epi16(_mm_srli_epi16(g[half], 4), 4));
+					px = _mm_or_si128(px, _mm_slli_epi16(_mm_srli_epi16(b[half], 4), 8));
+				}
+				_mm_storeu_si128((__m128i *)((u16 *)dst + i + half * 8), px);
+			}
+		}
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	for (; i + 16 <= numPixels; i += 16) {
+		uint8x16_t r, g, b;
+		YUVToRGB_NEON(y + i, u + i / 2, v + i / 2, r, g, b);
+		if (format == YUVOutput::RGBA8888) {
+			uint8x16x4_t px = { { r, g, b, vdupq_n_u8(0) } };
+			vst4q_u8((u8 *)((u32 *)dst + i), px);
+		} else {
+			for (int half = 0; half < 2; half++) {
+				uint8x8_t rh = half == 0 ? vget_low_u8(r) : vget_high_u8(r);
+				uint8x8_t gh = half == 0 ? vget_low_u8(g) : vget_high_u8(g);
+				uint8x8_t bh = half == 0 ? vget_low_u8(b) : vget_high_u8(b);
+				uint16x8_t px;
+				if (format == YUVOutput::RGB565) {
+					px = vorrq_u16(vmovl_u8(vshr_n_u8(rh, 3)), vshlq_n_u16(vmovl_u8(vshr_n_u8(gh, 2)), 5));
+					px = vorrq_u16(px, vshlq_n_u16(vmovl_u8(vshr_n_u8(bh, 3)), 11));
+				} else if (format == YUVOutput::RGBA5551) {
+					px = vorrq_u16(vmovl_u8(vshr_n_u8(rh, 3)), vshlq_n_u16(vmovl_u8(vshr_n_u8(gh, 3)), 5));
+					px = vorrq_u16(px, vshlq_n_u16(vmovl_u8(vshr_n_u8(bh, 3)), 10));
+				} else {
+					px = vorrq_u16(vmovl_u8(vshr_n_u8(rh, 4)), vshlq_n_u16(vmovl_u8(vshr_n_u8(gh, 4)), 4));
+					px = vorrq_u16(px, vshlq_n_u16(vmovl_u8(vshr_n_u8(bh, 4)), 8));
+				}
+				vst1q_u16((u16 *)dst + i + half * 8, px);
+			}
+		}
+	}
+#endif
+	for (; i < numPixels; i++) {
+		int r, g, b;
+		YUVToRGB(y[i], u[i / 2], v[i / 2], r, g, b);
+		WriteYUVOutputPixel<format>(dst, i, r, g, b);
+	}
+}
+
+void ConvertYUV420ToRGBA8888(u32 *dst, const u8 *y, const u8 *u, const u8 *v, u32 numPixels) {
+	ConvertYUV420Row<YUVOutput::RGBA8888>(dst, y, u, v, numPixels);
+}
+
+void ConvertYUV420ToRGB565(u16 *dst, const u8 *y, const u8 *u, const u8 *v, u32 numPixels) {
+	ConvertYUV420Row<YUVOutput::RGB565>(dst, y, u, v, numPixels);
+}
+
+void ConvertYUV420ToRGBA5551(u16 *dst, const u8 *y, const u8 *u, const u8 *v, u32 numPixels) {
+	ConvertYUV420Row<YUVOutput::RGBA5551>(dst, y, u, v, numPixels);
+}
+
+void ConvertYUV420ToRGBA4444(u16 *dst, const u8 *y, const u8 *u, const u8 *v, u32 numPixels) {
+	ConvertYUV420Row<YUVOutput::RGBA4444>(dst, y, u, v, numPixels);
+}
@@ -166,3 +166,10 @@ void ConvertRGBA4444ToABGR4444(u16 *dst, const u16 *src, u32 numPixels);
 void ConvertRGBA5551ToABGR1555(u16 *dst, const u16 *src, u32 numPixels);
 void ConvertRGB565ToBGR565(u16 *dst, const u16 *src, u32 numPixels);
 void ConvertBGRA5551ToABGR1555(u16 *dst, const u16 *src, u32 numPixels);
+
+// One row of a YUV420 (limited range BT.601) image, with u and v at half the width. Alpha is left at 0,
+// like the PSP's video decoder does. Meant for video frames, so the output isn't as exact as swscale's.
+void ConvertYUV420ToRGBA8888(u32 *dst, const u8 *y, const u8 *u, const u8 *v, u32 numPixels);
+void ConvertYUV420ToRGB565(u16 *dst, const u8 *y, const u8 *u, const u8 *v, u32 numPixels);
+void ConvertYUV420ToRGBA5551(u16 *dst, const u8 *y, const u8 *u, const u8 *v, u32 numPixels);
+void ConvertYUV420ToRGBA4444(u16 *dst, const u8 *y, const u8 *u, const u8 *v, u32 numPixels);
@@ -0,0 +1,102 @@
+#include "ppsspp_config.h"
+
+#include <atomic>
+
+#include "Common/CPUDetect.h"
+#include "Common/Data/Hash/WideHash.h"
+
+#include "ext/xxhash.h"
+
+namespace hash {
+
+#if PPSSPP_ARCH(AMD64) || PPSSPP_ARCH(X86)
+// In WideHashAVX2.cpp.
+uint64_t WideHash64_AVX2(const void *data, size_t len);
+#endif
+
+static uint64_t WideHash64_Default(const void *data, size_t len) {
+	return XXH3_64bits(data, len);
+}
+
+typedef uint64_t (*WideHash64Func)(const void *data, size_t len);
+
+bool WideHashBackendSupported(WideHashBackend backend) {
+	switch (backend) {
+	case WideHashBackend::AUTO:
+	case WideHashBackend::DEFAULT:
+		return true;
+	case WideHashBackend::AVX2:
+#if PPSSPP_ARCH(AMD64) || PPSSPP_ARCH(X86)
+		return cpu_info.bAVX2;
+#else
+		return false;
+#endif
+	default:
+		return false;
+	}
+}
+
+static WideHashBackend ResolveBackend(WideHashBackend backend) {
+	if (backend == WideHashBackend::AUTO)
+		return WideHashBackendSupported(WideHashBackend::AVX2) ? WideHashBackend::AVX2 : WideHashBackend::DEFAULT;
+	if (!WideHashBackendSupported(backend))
+		return WideHashBackend::DEFAULT;
+	return backend;
+}
+
+static WideHash64Func BackendFunc(WideHashBackend backend) {
+	switch (backend) {
+#if PPSSPP_ARCH(AMD64) || PPSSPP_ARCH(X86)
+	case WideHashBackend::AVX2:
+		return &WideHash64_AVX2;
+#endif
+	default:
+		return &WideHash64_Default;
+	}
+}
+
+struct WideHashSelection {
+	WideHashSelection() {
+		WideHashBackend resolved = ResolveBackend(WideHashBackend::AUTO);
+		backend = resolved;
+		func = BackendFunc(resolved);
+	}
+
+	std::atomic<WideHashBackend> backend;
+	std::atomic<WideHash64Func> func;
+};
+
+// Texture hashing runs on several threads, so this is picked on first use as a function-local static,
+// which is thread safe. Only SetWideHashBackend() (used by tests) changes it later.
+static WideHashSelection &Selection() {
+	static WideHashSelection selection;
+	return selection;
+}
+
+void SetWideHashBackend(WideHashBackend backend) {
+	WideHashBackend resolved = ResolveBackend(backend);
+	Selection().func = BackendFunc(resolved);
+	Selection().backend = resolved;
+}
+
+WideHashBackend GetWideHashBackend() {
+	return Selection().backend;
+}
+
+const char *WideHashBackendToString(WideHashBackend backend) {
+	switch (backend) {
+	case WideHashBackend::AUTO: return "auto";
+	case WideHashBackend::DEFAULT: return "default";
+	case WideHashBackend::AVX2: return "avx2";
+	default: return "N/A";
+	}
+}
+
+uint64_t WideHash64(const void *data, size_t len) {
+	// Small inputs don't touch the vector paths at all, so skip the indirection.
+	if (len <= 240)
+		return XXH3_64bits(data, len);
+	return Selection().func.load(std::memory_order_relaxed)(data, len);
+}
+
+}  // namespace hash
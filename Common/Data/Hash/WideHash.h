@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Large-buffer hashing for texture/CLUT validation and similar.
+//
+// This is XXH3-64 with the SIMD implementation picked at runtime, so that we can use AVX2
+// on CPUs that have it even though we compile for plain SSE2. XXH3 produces the same output
+// regardless of the implementation used, so results are stable across backends and machines.
+
+namespace hash {
+
+enum class WideHashBackend {
+	AUTO,
+	// Whatever xxhash was compiled with by default - SSE2 on x86, NEON on ARM64.
+	DEFAULT,
+	AVX2,
+};
+
+uint64_t WideHash64(const void *data, size_t len);
+
+// Mostly for benchmarks and tests. AUTO picks the fastest supported one.
+void SetWideHashBackend(WideHashBackend backend);
+WideHashBackend GetWideHashBackend();
+bool WideHashBackendSupported(WideHashBackend backend);
+const char *WideHashBackendToString(WideHashBackend backend);
+
+}  // namespace hash
@@ -0,0 +1,35 @@
+#include "ppsspp_config.h"
+
+#if PPSSPP_ARCH(AMD64) || PPSSPP_ARCH(X86)
+
+// Everything in this file is compiled for AVX2, and must only be called after checking cpu_info.bAVX2.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include <immintrin.h>
+#include <cstddef>
+#include <cstdint>
+
+#define XXH_INLINE_ALL
+#define XXH_VECTOR XXH_AVX2
+#include "ext/xxhash.h"
+
+namespace hash {
+
+uint64_t WideHash64_AVX2(const void *data, size_t len) {
+	return XXH_INLINE_XXH3_64bits(data, len);
+}
+
+}  // namespace hash
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
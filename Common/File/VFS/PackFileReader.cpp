@@ -0,0 +1,420 @@
+#include "ppsspp_config.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <set>
+
+#if PPSSPP_PLATFORM(WINDOWS)
+#include "Common/CommonWindows.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Common/Common.h"
+#include "Common/Log.h"
+#include "Common/File/DirListing.h"
+#include "Common/File/FileUtil.h"
+#include "Common/File/VFS/PackFileReader.h"
+#include "Common/StringUtils.h"
+
+static const char PACK_FILE_MAGIC[4] = { 'P', 'P', 'A', 'K' };
+static const uint32_t PACK_FILE_VERSION = 1;
+static const uint64_t PACK_FILE_ALIGNMENT = 16;
+
+static int CompareNoCase(std::string_view a, std::string_view b) {
+	size_t len = std::min(a.size(), b.size());
+	for (size_t i = 0; i < len; i++) {
+		int ca = tolower((unsigned char)a[i]);
+		int cb = tolower((unsigned char)b[i]);
+		if (ca != cb)
+			return ca < cb ? -1 : 1;
+	}
+	if (a.size() == b.size())
+		return 0;
+	return a.size() < b.size() ? -1 : 1;
+}
+
+class PackFileReaderFileReference : public VFSFileReference {
+public:
+	int index;
+};
+
+class PackFileReaderOpenFile : public VFSOpenFile {
+public:
+	const uint8_t *data;
+	size_t size;
+	size_t pos = 0;
+};
+
+PackFileReader *PackFileReader::Create(const Path &packFile, bool logErrors) {
+	if (!File::Exists(packFile)) {
+		return nullptr;
+	}
+
+	PackFileReader *reader = new PackFileReader(packFile);
+	if (!reader->Map() || !reader->Validate()) {
+		if (logErrors) {
+			ERROR_LOG(Log::IO, "Failed to open %s as a pack file", packFile.c_str());
+		}
+		delete reader;
+		return nullptr;
+	}
+	return reader;
+}
+
+PackFileReader::~PackFileReader() {
+#if PPSSPP_PLATFORM(WINDOWS)
+	if (mapHandle_) {
+		UnmapViewOfFile(data_);
+		CloseHandle((HANDLE)mapHandle_);
+	}
+#else
+	if (mapHandle_) {
+		munmap((void *)data_, size_);
+	}
+#endif
+	delete[] fallbackData_;
+}
+
+bool PackFileReader::Map() {
+#if PPSSPP_PLATFORM(WINDOWS) && !PPSSPP_PLATFORM(UWP)
+	if (packPath_.Type() == PathType::NATIVE) {
+		HANDLE file = CreateFileW(packPath_.ToWString().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file != INVALID_HANDLE_VALUE) {
+			LARGE_INTEGER fileSize{};
+			if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+				HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping) {
+					void *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+					if (ptr) {
+						data_ = (const uint8_t *)ptr;
+						size_ = (size_t)fileSize.QuadPart;
+						mapHandle_ = (void *)mapping;
+					} else {
+						CloseHandle(mapping);
+					}
+				}
+			}
+			CloseHandle(file);
+		}
+	}
+#elif !PPSSPP_PLATFORM(WINDOWS)
+	int fd = -1;
+	if (packPath_.Type() == PathType::CONTENT_URI) {
+		fd = File::OpenFD(packPath_, File::OPEN_READ);
+	} else if (packPath_.Type() == PathType::NATIVE) {
+		fd = open(packPath_.c_str(), O_RDONLY);
+	}
+	if (fd >= 0) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void *ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (ptr != MAP_FAILED) {
+				data_ = (const uint8_t *)ptr;
+				size_ = (size_t)st.st_size;
+				mapHandle_ = ptr;
+			}
+		}
+		// The mapping stays valid after closing.
+		if (packPath_.Type() == PathType::CONTENT_URI) {
+			File::CloseFD(fd);
+		} else {
+			close(fd);
+		}
+	}
+#endif
+
+	if (!data_) {
+		// Can't map here, read the whole thing instead. Works the same, just costs the memory.
+		WARN_LOG(Log::IO, "Couldn't map %s, reading it into memory", packPath_.c_str());
+		fallbackData_ = File::ReadLocalFile(packPath_, &size_);
+		data_ = fallbackData_;
+	}
+	return data_ != nullptr;
+}
+
+bool PackFileReader::Validate() {
+	if (size_ < sizeof(PackFileHeader)) {
+		return false;
+	}
+	const PackFileHeader *header = (const PackFileHeader *)data_;
+	if (memcmp(header->magic, PACK_FILE_MAGIC, sizeof(PACK_FILE_MAGIC)) != 0 || header->version != PACK_FILE_VERSION) {
+		return false;
+	}
+	if (header->indexOffset > size_ || (uint64_t)header->numEntries * sizeof(PackFileEntry) > size_ - header->indexOffset || header->namesOffset > size_) {
+		return false;
+	}
+
+	entries_ = (const PackFileEntry *)(data_ + header->indexOffset);
+	numEntries_ = header->numEntries;
+	const uint64_t namesSize = size_ - header->namesOffset;
+	for (uint32_t i = 0; i < numEntries_; i++) {
+		const PackFileEntry &entry = entries_[i];
+		if (entry.offset > size_ || entry.size > size_ - entry.offset || (uint64_t)entry.nameOffset + entry.nameLength > namesSize) {
+			ERROR_LOG(Log::IO, "Pack file %s: entry %d out of bounds", packPath_.c_str(), i);
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string_view PackFileReader::EntryName(const PackFileEntry &entry) const {
+	const PackFileHeader *header = (const PackFileHeader *)data_;
+	return std::string_view((const char *)data_ + header->namesOffset + entry.nameOffset, entry.nameLength);
+}
+
+int PackFileReader::FindEntry(std::string_view path) const {
+	// The index is sorted, so a binary search does it without any parsing at load time.
+	const PackFileEntry *end = entries_ + numEntries_;
+	const PackFileEntry *iter = std::lower_bound(entries_, end, path, [&](const PackFileEntry &entry, std::string_view name) {
+		return CompareNoCase(EntryName(entry), name) < 0;
+	});
+	if (iter != end && CompareNoCase(EntryName(*iter), path) == 0) {
+		return (int)(iter - entries_);
+	}
+	return -1;
+}
+
+uint8_t *PackFileReader::ReadFile(const char *path, size_t *size) {
+	int index = FindEntry(path);
+	if (index < 0) {
+		ERROR_LOG(Log::IO, "Error opening %s from pack", path);
+		return nullptr;
+	}
+
+	const PackFileEntry &entry = entries_[index];
+	uint8_t *contents = new uint8_t[entry.size + 1];
+	memcpy(contents, data_ + entry.offset, entry.size);
+	contents[entry.size] = 0;
+	*size = entry.size;
+	return contents;
+}
+
+VFSFileReference *PackFileReader::GetFile(const char *path) {
+	int index = FindEntry(path);
+	if (index < 0) {
+		return nullptr;
+	}
+	PackFileReaderFileReference *ref = new PackFileReaderFileReference();
+	ref->index = index;
+	return ref;
+}
+
+bool PackFileReader::GetFileInfo(VFSFileReference *vfsReference, File::FileInfo *fileInfo) {
+	PackFileReaderFileReference *reference = (PackFileReaderFileReference *)vfsReference;
+	const PackFileEntry &entry = entries_[reference->index];
+	*fileInfo = File::FileInfo{};
+	fileInfo->name = std::string(EntryName(entry));
+	fileInfo->fullName = Path(fileInfo->name);
+	fileInfo->size = entry.size;
+	fileInfo->exists = true;
+	return true;
+}
+
+void PackFileReader::ReleaseFile(VFSFileReference *vfsReference) {
+	delete (PackFileReaderFileReference *)vfsReference;
+}
+
+VFSOpenFile *PackFileReader::OpenFileForRead(VFSFileReference *vfsReference, size_t *size) {
+	// No locking needed, unlike zip files. All reads come straight from the mapping.
+	PackFileReaderFileReference *reference = (PackFileReaderFileReference *)vfsReference;
+	const PackFileEntry &entry = entries_[reference->index];
+	PackFileReaderOpenFile *openFile = new PackFileReaderOpenFile();
+	openFile->data = data_ + entry.offset;
+	openFile->size = entry.size;
+	*size = entry.size;
+	return openFile;
+}
+
+void PackFileReader::Rewind(VFSOpenFile *vfsOpenFile) {
+	PackFileReaderOpenFile *file = (PackFileReaderOpenFile *)vfsOpenFile;
+	_assert_(file);
+	file->pos = 0;
+}
+
+size_t PackFileReader::Read(VFSOpenFile *vfsOpenFile, void *buffer, size_t length) {
+	PackFileReaderOpenFile *file = (PackFileReaderOpenFile *)vfsOpenFile;
+	_assert_(file);
+	size_t bytes = std::min(length, file->size - file->pos);
+	memcpy(buffer, file->data + file->pos, bytes);
+	file->pos += bytes;
+	return bytes;
+}
+
+void PackFileReader::CloseFile(VFSOpenFile *vfsOpenFile) {
+	delete (PackFileReaderOpenFile *)vfsOpenFile;
+}
+
+const uint8_t *PackFileReader::GetMappedData(VFSOpenFile *vfsOpenFile) {
+	PackFileReaderOpenFile *file = (PackFileReaderOpenFile *)vfsOpenFile;
+	return file->data;
+}
+
+bool PackFileReader::GetFileListing(const char *orig_path, std::vector<File::FileInfo> *listing, const char *filter) {
+	std::string path = orig_path;
+	if (!path.empty() && path.back() != '/') {
+		path.push_back('/');
+	}
+
+	std::set<std::string> filters;
+	if (filter) {
+		std::vector<std::string_view> extensions;
+		SplitString(filter, ':', extensions);
+		for (const auto &ext : extensions) {
+			filters.emplace("." + std::string(ext));
+		}
+	}
+
+	std::set<std::string> directories;
+	bool anyPrefixMatched = false;
+	listing->clear();
+	for (uint32_t i = 0; i < numEntries_; i++) {
+		std::string_view name = EntryName(entries_[i]);
+		if (!startsWithNoCase(name, path) || name.size() == path.size()) {
+			continue;
+		}
+		anyPrefixMatched = true;
+		std::string_view rest = name.substr(path.size());
+		size_t slashPos = rest.find('/');
+		if (slashPos != std::string_view::npos) {
+			directories.emplace(rest.substr(0, slashPos));
+			continue;
+		}
+
+		File::FileInfo info;
+		info.name = std::string(rest);
+		info.fullName = Path(std::string(name));
+		info.exists = true;
+		info.size = entries_[i].size;
+		if (filter && filters.find(info.fullName.GetFileExtension()) == filters.end()) {
+			continue;
+		}
+		listing->push_back(info);
+	}
+
+	for (const auto &dir : directories) {
+		File::FileInfo info;
+		info.name = dir;
+		info.fullName = Path(path + dir);
+		info.exists = true;
+		info.isDirectory = true;
+		listing->push_back(info);
+	}
+
+	std::sort(listing->begin(), listing->end());
+	return anyPrefixMatched;
+}
+
+bool PackFileReader::GetFileInfo(const char *path, File::FileInfo *info) {
+	int index = FindEntry(path);
+	if (index < 0) {
+		info->exists = false;
+		return false;
+	}
+	PackFileReaderFileReference ref;
+	ref.index = index;
+	return GetFileInfo(&ref, info);
+}
+
+static void CollectPackFiles(const Path &directory, const std::string &prefix, std::vector<std::pair<std::string, Path>> *files) {
+	std::vector<File::FileInfo> listing;
+	File::GetFilesInDir(directory, &listing);
+	for (const auto &file : listing) {
+		if (file.name.empty() || file.name[0] == '.')
+			continue;
+		if (file.isDirectory) {
+			CollectPackFiles(file.fullName, prefix + file.name + "/", files);
+		} else {
+			files->emplace_back(prefix + file.name, file.fullName);
+		}
+	}
+}
+
+bool CreatePackFile(const Path &directory, const Path &output, std::string *error, const std::function<bool(const std::string &)> &filter, const std::function<void(size_t done, size_t total)> &progress) {
+	// An existing pack may be mapped by a running game, so never write into it, replace it instead.
+	const Path tempOutput = output.WithExtraExtension(".tmp");
+	std::vector<std::pair<std::string, Path>> files;
+	CollectPackFiles(directory, "", &files);
+	// Don't pack the output into itself, if it's in the same directory.
+	files.erase(std::remove_if(files.begin(), files.end(), [&](const std::pair<std::string, Path> &file) {
+		return file.second == output || file.second == tempOutput || (filter && !filter(file.first));
+	}), files.end());
+	std::sort(files.begin(), files.end(), [](const std::pair<std::string, Path> &a, const std::pair<std::string, Path> &b) {
+		return CompareNoCase(a.first, b.first) < 0;
+	});
+
+	PackFileHeader header{};
+	memcpy(header.magic, PACK_FILE_MAGIC, sizeof(PACK_FILE_MAGIC));
+	header.version = PACK_FILE_VERSION;
+	header.numEntries = (uint32_t)files.size();
+	header.indexOffset = sizeof(PackFileHeader);
+	header.namesOffset = header.indexOffset + files.size() * sizeof(PackFileEntry);
+
+	std::vector<PackFileEntry> entries(files.size());
+	std::string names;
+	for (size_t i = 0; i < files.size(); i++) {
+		entries[i].nameOffset = (uint32_t)names.size();
+		entries[i].nameLength = (uint32_t)files[i].first.size();
+		names += files[i].first;
+	}
+
+	uint64_t offset = (header.namesOffset + names.size() + PACK_FILE_ALIGNMENT - 1) & ~(PACK_FILE_ALIGNMENT - 1);
+	for (size_t i = 0; i < files.size(); i++) {
+		entries[i].offset = offset;
+		entries[i].size = File::GetFileSize(files[i].second);
+		offset = (offset + entries[i].size + PACK_FILE_ALIGNMENT - 1) & ~(PACK_FILE_ALIGNMENT - 1);
+	}
+
+	FILE *f = File::OpenCFile(tempOutput, "wb");
+	if (!f) {
+		*error = "Failed to open " + tempOutput.ToVisualString() + " for writing";
+		return false;
+	}
+
+	bool success = fwrite(&header, sizeof(header), 1, f) == 1;
+	success = success && (entries.empty() || fwrite(entries.data(), sizeof(PackFileEntry), entries.size(), f) == entries.size());
+	success = success && (names.empty() || fwrite(names.data(), names.size(), 1, f) == 1);
+
+	static const uint8_t padding[PACK_FILE_ALIGNMENT]{};
+	uint64_t pos = header.namesOffset + names.size();
+	for (size_t i = 0; i < files.size() && success; i++) {
+		success = fwrite(padding, 1, (size_t)(entries[i].offset - pos), f) == entries[i].offset - pos;
+		size_t size = 0;
+		uint8_t *data = File::ReadLocalFile(files[i].second, &size);
+		if (!data || size != entries[i].size) {
+			*error = "Failed to read " + files[i].second.ToVisualString();
+			delete[] data;
+			fclose(f);
+			File::Delete(tempOutput);
+			return false;
+		}
+		success = success && (size == 0 || fwrite(data, size, 1, f) == 1);
+		delete[] data;
+		pos = entries[i].offset + size;
+		if (progress)
+			progress(i + 1, files.size());
+	}
+	success = fclose(f) == 0 && success;
+
+	if (!success) {
+		*error = "Failed to write " + tempOutput.ToVisualString();
+		File::Delete(tempOutput);
+		return false;
+	}
+
+	if (!File::Rename(tempOutput, output)) {
+		// Not all platforms rename over an existing file.
+		if (!File::Delete(output) || !File::Rename(tempOutput, output)) {
+			*error = "Failed to replace " + output.ToVisualString() + ", is it in use?";
+			File::Delete(tempOutput);
+			return false;
+		}
+	}
+
+	INFO_LOG(Log::IO, "Packed %d files from %s into %s", (int)files.size(), directory.c_str(), output.c_str());
+	return true;
+}
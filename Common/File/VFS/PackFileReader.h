@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "Common/File/VFS/VFS.h"
+#include "Common/File/Path.h"
+
+// A simple read-only container: a small header and a sorted index up front, followed by the
+// uncompressed file data. The whole thing is memory mapped, so opening it only touches the
+// header and index, and file contents can be used directly from the mapping, from any thread.
+// Currently used for texture replacement packs (textures.pak), see CreatePackFile below.
+
+struct PackFileHeader {
+	char magic[4];  // PACK_FILE_MAGIC
+	uint32_t version;
+	uint32_t numEntries;
+	uint32_t reserved;
+	uint64_t indexOffset;
+	uint64_t namesOffset;
+};
+
+// The index is sorted by name, case insensitively.
+struct PackFileEntry {
+	uint64_t offset;
+	uint64_t size;
+	uint32_t nameOffset;  // Relative to namesOffset.
+	uint32_t nameLength;
+};
+
+class PackFileReader : public VFSBackend {
+public:
+	static PackFileReader *Create(const Path &packFile, bool logErrors = true);
+	~PackFileReader();
+
+	// use delete[] on the returned value.
+	uint8_t *ReadFile(const char *path, size_t *size) override;
+
+	VFSFileReference *GetFile(const char *path) override;
+	bool GetFileInfo(VFSFileReference *vfsReference, File::FileInfo *fileInfo) override;
+	void ReleaseFile(VFSFileReference *vfsReference) override;
+
+	VFSOpenFile *OpenFileForRead(VFSFileReference *vfsReference, size_t *size) override;
+	void Rewind(VFSOpenFile *vfsOpenFile) override;
+	size_t Read(VFSOpenFile *vfsOpenFile, void *buffer, size_t length) override;
+	void CloseFile(VFSOpenFile *vfsOpenFile) override;
+	const uint8_t *GetMappedData(VFSOpenFile *vfsOpenFile) override;
+
+	bool GetFileListing(const char *path, std::vector<File::FileInfo> *listing, const char *filter) override;
+	bool GetFileInfo(const char *path, File::FileInfo *info) override;
+	std::string toString() const override {
+		return packPath_.ToVisualString();
+	}
+
+private:
+	PackFileReader(const Path &packPath) : packPath_(packPath) {}
+	bool Map();
+	bool Validate();
+	std::string_view EntryName(const PackFileEntry &entry) const;
+	// Returns -1 if not found.
+	int FindEntry(std::string_view path) const;
+
+	Path packPath_;
+	const uint8_t *data_ = nullptr;
+	size_t size_ = 0;
+	const PackFileEntry *entries_ = nullptr;
+	uint32_t numEntries_ = 0;
+
+	// Platform mapping state, or a plain copy of the file where we can't map.
+	void *mapHandle_ = nullptr;
+	uint8_t *fallbackData_ = nullptr;
+};
+
+// Packs every file under directory (recursively, skipping hidden files) into a pack file.
+// If set, filter gets the path relative to directory, and can return false to leave a file out.
+// The pack is written next to output and then renamed over it, so readers never see a partial file.
+// If set, progress is called after each file with the number of files done so far and the total.
+bool CreatePackFile(const Path &directory, const Path &output, std::string *error, const std::function<bool(const std::string &)> &filter = nullptr, const std::function<void(size_t done, size_t total)> &progress = nullptr);
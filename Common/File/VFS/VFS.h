@@ -53,6 +53,9 @@ class VFSBackend : public VFSInterface {
 	virtual void Rewind(VFSOpenFile *vfsOpenFile) = 0;
 	virtual size_t Read(VFSOpenFile *vfsOpenFile, void *buffer, size_t length) = 0;
 	virtual void CloseFile(VFSOpenFile *vfsOpenFile) = 0;
+	// Backends that have the whole file in memory (like a mapped pack file) can return it here to avoid a copy.
+	// The data stays valid as long as the backend does, even after the file is closed.
+	virtual const uint8_t *GetMappedData(VFSOpenFile *vfsOpenFile) { return nullptr; }
 
 	// Filter support is optional but nice to have
 	virtual bool GetFileInfo(const char *path, File::FileInfo *info) = 0;
@@ -15,7 +15,15 @@
 #include "Common/File/VFS/ZipFileReader.h"
 #include "Common/StringUtils.h"
 
-ZipFileReader *ZipFileReader::Create(const Path &zipFile, const char *inZipPath, bool logErrors) {
+static std::string LowerCaseName(const char *name) {
+	std::string lower = name;
+	for (char &c : lower) {
+		c = (char)tolower((unsigned char)c);
+	}
+	return lower;
+}
+
+zip *ZipFileReader::OpenZip(const Path &zipFile, bool logErrors) {
 	int error = 0;
 	zip *zip_file;
 	if (zipFile.Type() == PathType::CONTENT_URI) {
@@ -37,6 +45,14 @@ ZipFileReader *ZipFileReader::Create(const Path &zipFile, const char *inZipPath,
 		}
 		return nullptr;
 	}
+	return zip_file;
+}
+
+ZipFileReader *ZipFileReader::Create(const Path &zipFile, const char *inZipPath, bool logErrors) {
+	zip *zip_file = OpenZip(zipFile, logErrors);
+	if (!zip_file) {
+		return nullptr;
+	}
 
 	// The inZipPath is supposed to be a folder, and internally in this class, we suffix
 	// folder paths with '/', matching how the zip library works.
@@ -47,33 +63,108 @@ ZipFileReader *ZipFileReader::Create(const Path &zipFile, const char *inZipPath,
 	return new ZipFileReader(zip_file, zipFile, path);
 }
 
+ZipFileReader::ZipFileReader(zip *zip_file, const Path &zipPath, const std::string &inZipPath)
+	: zip_file_(zip_file), inZipPath_(inZipPath), zipPath_(zipPath) {
+	BuildIndex();
+	freeHandles_.push_back(zip_file_);
+}
+
 ZipFileReader::~ZipFileReader() {
-	std::lock_guard<std::mutex> guard(lock_);
-	zip_close(zip_file_);
+	std::lock_guard<std::mutex> guard(handleLock_);
+	_dbg_assert_((int)freeHandles_.size() == numHandles_);
+	for (zip *handle : freeHandles_) {
+		zip_close(handle);
+	}
+}
+
+void ZipFileReader::BuildIndex() {
+	int numFiles = zip_get_num_files(zip_file_);
+	entries_.resize(numFiles < 0 ? 0 : numFiles);
+	for (int i = 0; i < numFiles; i++) {
+		zip_stat_t zstat;
+		if (zip_stat_index(zip_file_, i, 0, &zstat) != 0 || !zstat.name) {
+			entries_[i] = Entry{ 0, false };
+			continue;
+		}
+		const std::string name = zstat.name;
+		entries_[i].size = (zstat.valid & ZIP_STAT_SIZE) != 0 ? zstat.size : 0;
+		entries_[i].isDirectory = !name.empty() && name.back() == '/';
+		// Like zip_name_locate, the first one wins if names only differ in case.
+		index_.emplace(LowerCaseName(zstat.name), i);
+
+		// Every directory on the way gets the next part of the path.
+		size_t pos = 0;
+		size_t slashPos;
+		while ((slashPos = name.find('/', pos)) != std::string::npos) {
+			directories_[name.substr(0, pos)].directories.insert(name.substr(pos, slashPos - pos));
+			pos = slashPos + 1;
+		}
+		if (pos < name.size()) {
+			directories_[name.substr(0, pos)].files.insert(name.substr(pos));
+		}
+	}
+}
+
+int ZipFileReader::FindEntry(const std::string &name) const {
+	auto iter = index_.find(LowerCaseName(name.c_str()));
+	return iter != index_.end() ? iter->second : -1;
+}
+
+zip *ZipFileReader::AcquireHandle() {
+	std::unique_lock<std::mutex> guard(handleLock_);
+	while (true) {
+		if (!freeHandles_.empty()) {
+			zip *handle = freeHandles_.back();
+			freeHandles_.pop_back();
+			return handle;
+		}
+		if (numHandles_ < maxHandles_) {
+			numHandles_++;
+			guard.unlock();
+			zip *handle = OpenZip(zipPath_, false);
+			if (handle) {
+				return handle;
+			}
+			// Probably out of file descriptors. Make do with what we have.
+			guard.lock();
+			numHandles_--;
+			maxHandles_ = numHandles_;
+			continue;
+		}
+		handleCond_.wait(guard);
+	}
+}
+
+void ZipFileReader::ReleaseHandle(zip *handle) {
+	std::lock_guard<std::mutex> guard(handleLock_);
+	freeHandles_.push_back(handle);
+	handleCond_.notify_one();
 }
 
 uint8_t *ZipFileReader::ReadFile(const char *path, size_t *size) {
 	std::string temp_path = inZipPath_ + path;
 
-	std::lock_guard<std::mutex> guard(lock_);
-	// Figure out the file size first. TODO: Can this part be done without locking the mutex?
-	struct zip_stat zstat;
-	int retval = zip_stat(zip_file_, temp_path.c_str(), ZIP_FL_NOCASE | ZIP_FL_UNCHANGED, &zstat);
-	if (retval != 0) {
+	int zi = FindEntry(temp_path);
+	if (zi < 0) {
 		ERROR_LOG(Log::IO, "Error opening %s from ZIP", temp_path.c_str());
 		return 0;
 	}
-	zip_file *file = zip_fopen_index(zip_file_, zstat.index, ZIP_FL_NOCASE | ZIP_FL_UNCHANGED);
+	uint64_t fileSize = entries_[zi].size;
+
+	zip *handle = AcquireHandle();
+	zip_file *file = zip_fopen_index(handle, zi, ZIP_FL_UNCHANGED);
 	if (!file) {
+		ReleaseHandle(handle);
 		ERROR_LOG(Log::IO, "Error opening %s from ZIP", temp_path.c_str());
 		return 0;
 	}
-	uint8_t *contents = new uint8_t[zstat.size + 1];
-	zip_fread(file, contents, zstat.size);
+	uint8_t *contents = new uint8_t[fileSize + 1];
+	zip_fread(file, contents, fileSize);
 	zip_fclose(file);
-	contents[zstat.size] = 0;
+	ReleaseHandle(handle);
+	contents[fileSize] = 0;
 
-	*size = zstat.size;
+	*size = fileSize;
 	return contents;
 }
 
@@ -100,7 +191,6 @@ bool ZipFileReader::GetFileListing(const char *orig_path, std::vector<File::File
 	if (tmp.size())
 		filters.emplace("." + tmp);
 
-	// We just loop through the whole ZIP file and deduce what files are in this directory, and what subdirectories there are.
 	std::set<std::string> files;
 	std::set<std::string> directories;
 	bool success = GetZipListings(path, files, directories);
@@ -154,39 +244,17 @@ bool ZipFileReader::GetFileListing(const char *orig_path, std::vector<File::File
 bool ZipFileReader::GetZipListings(const std::string &path, std::set<std::string> &files, std::set<std::string> &directories) {
 	_dbg_assert_(path.empty() || path.back() == '/');
 
-	std::lock_guard<std::mutex> guard(lock_);
-	int numFiles = zip_get_num_files(zip_file_);
-	bool anyPrefixMatched = false;
-	for (int i = 0; i < numFiles; i++) {
-		const char* name = zip_get_name(zip_file_, i, 0);
-		if (!name)
-			continue;  // shouldn't happen, I think
-		if (startsWith(name, path)) {
-			if (strlen(name) == path.size()) {
-				// Don't want to return the same folder.
-				continue;
-			}
-			const char *slashPos = strchr(name + path.size(), '/');
-			if (slashPos != 0) {
-				anyPrefixMatched = true;
-				// A directory. Let's pick off the only part we care about.
-				size_t offset = path.size();
-				std::string dirName = std::string(name + offset, slashPos - (name + offset));
-				// We might get a lot of these if the tree is deep. The std::set deduplicates.
-				directories.insert(dirName);
-			} else {
-				anyPrefixMatched = true;
-				// It's a file.
-				const char *fn = name + path.size();
-				files.emplace(fn);
-			}
-		}
+	// Only directories with something in them are in the index.
+	auto iter = directories_.find(path);
+	if (iter == directories_.end()) {
+		return false;
 	}
-	return anyPrefixMatched;
+	files = iter->second.files;
+	directories = iter->second.directories;
+	return true;
 }
 
 bool ZipFileReader::GetFileInfo(const char *path, File::FileInfo *info) {
-	struct zip_stat zstat;
 	std::string temp_path = inZipPath_ + path;
 
 	// Clear some things to start.
@@ -194,23 +262,17 @@ bool ZipFileReader::GetFileInfo(const char *path, File::FileInfo *info) {
 	info->isWritable = false;
 	info->size = 0;
 
-	{
-		std::lock_guard<std::mutex> guard(lock_);
-		if (0 != zip_stat(zip_file_, temp_path.c_str(), ZIP_FL_NOCASE | ZIP_FL_UNCHANGED, &zstat)) {
-			// ZIP files do not have real directories, so we'll end up here if we
-			// try to stat one. For now that's fine.
-			info->exists = false;
-			return false;
-		}
+	int zi = FindEntry(temp_path);
+	if (zi < 0) {
+		// ZIP files do not have real directories, so we'll end up here if we
+		// try to stat one. For now that's fine.
+		info->exists = false;
+		return false;
 	}
 
 	// Zips usually don't contain directory entries, but they may.
-	if ((zstat.valid & ZIP_STAT_NAME) != 0 && zstat.name) {
-		info->isDirectory = zstat.name[strlen(zstat.name) - 1] == '/';
-	}
-	if ((zstat.valid & ZIP_STAT_SIZE) != 0) {
-		info->size = zstat.size;
-	}
+	info->isDirectory = entries_[zi].isDirectory;
+	info->size = entries_[zi].size;
 
 	info->fullName = Path(path);
 	info->exists = true;
@@ -229,11 +291,12 @@ class ZipFileReaderOpenFile : public VFSOpenFile {
 		_dbg_assert_(zf == nullptr);
 	}
 	ZipFileReaderFileReference *reference;
+	zip *handle = nullptr;
 	zip_file_t *zf = nullptr;
 };
 
 VFSFileReference *ZipFileReader::GetFile(const char *path) {
-	int zi = zip_name_locate(zip_file_, path, ZIP_FL_NOCASE);  // this is EXPENSIVE
+	int zi = FindEntry(path);
 	if (zi < 0) {
 		// Not found.
 		return nullptr;
@@ -245,16 +308,9 @@ VFSFileReference *ZipFileReader::GetFile(const char *path) {
 
 bool ZipFileReader::GetFileInfo(VFSFileReference *vfsReference, File::FileInfo *fileInfo) {
 	ZipFileReaderFileReference *reference = (ZipFileReaderFileReference *)vfsReference;
-	// If you crash here, you called this while having the lock held by having the file open.
-	// Don't do that, check the info before you open the file.
-	zip_stat_t zstat;
-	if (zip_stat_index(zip_file_, reference->zi, 0, &zstat) != 0)
-		return false;
 	*fileInfo = File::FileInfo{};
-	fileInfo->size = 0;
-	if (zstat.valid & ZIP_STAT_SIZE)
-		fileInfo->size = zstat.size;
-	return zstat.size;
+	fileInfo->size = entries_[reference->zi].size;
+	return fileInfo->size != 0;
 }
 
 void ZipFileReader::ReleaseFile(VFSFileReference *vfsReference) {
@@ -268,26 +324,17 @@ VFSOpenFile *ZipFileReader::OpenFileForRead(VFSFileReference *vfsReference, size
 	ZipFileReaderOpenFile *openFile = new ZipFileReaderOpenFile();
 	openFile->reference = reference;
 	*size = 0;
-	// We only allow one file to be open for read concurrently. It's possible that this can be improved,
-	// especially if we only access by index like this.
-	lock_.lock();
-	zip_stat_t zstat;
-	if (zip_stat_index(zip_file_, reference->zi, 0, &zstat) != 0) {
-		lock_.unlock();
-		delete openFile;
-		return nullptr;
-	}
-
-	openFile->zf = zip_fopen_index(zip_file_, reference->zi, 0);
+	// The handle stays with the open file until CloseFile.
+	openFile->handle = AcquireHandle();
+	openFile->zf = zip_fopen_index(openFile->handle, reference->zi, 0);
 	if (!openFile->zf) {
 		WARN_LOG(Log::G3D, "File with index %d not found in zip", reference->zi);
-		lock_.unlock();
+		ReleaseHandle(openFile->handle);
 		delete openFile;
 		return nullptr;
 	}
 
-	*size = zstat.size;
-	// Intentionally leaving the mutex locked, will be closed in CloseFile.
+	*size = entries_[reference->zi].size;
 	return openFile;
 }
 
@@ -297,7 +344,7 @@ void ZipFileReader::Rewind(VFSOpenFile *vfsOpenFile) {
 	// Unless the zip file is compressed, can't seek directly, so we re-open.
 	// This version of libzip doesn't even have zip_file_is_seekable(), should probably upgrade.
 	zip_fclose(file->zf);
-	file->zf = zip_fopen_index(zip_file_, file->reference->zi, 0);
+	file->zf = zip_fopen_index(file->handle, file->reference->zi, 0);
 	_dbg_assert_(file->zf != nullptr);
 }
 
@@ -315,7 +362,7 @@ void ZipFileReader::CloseFile(VFSOpenFile *vfsOpenFile) {
 	zip_fclose(file->zf);
 	file->zf = nullptr;
 	vfsOpenFile = nullptr;
-	lock_.unlock();
+	ReleaseHandle(file->handle);
 	delete file;
 }
 
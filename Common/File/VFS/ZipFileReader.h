@@ -6,14 +6,19 @@
 #include "ext/libzip/zip.h"
 #endif
 
+#include <condition_variable>
 #include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "Common/File/VFS/VFS.h"
 #include "Common/File/FileUtil.h"
 #include "Common/File/Path.h"
 
+// Indexes the zip's entries when created, so lookups and listings don't need to go through libzip.
+// libzip handles can't be shared between threads, so each concurrent read gets its own handle from a small pool.
 class ZipFileReader : public VFSBackend {
 public:
 	static ZipFileReader *Create(const Path &zipFile, const char *inZipPath, bool logErrors = true);
@@ -45,12 +50,41 @@ class ZipFileReader : public VFSBackend {
 	}
 
 private:
-	ZipFileReader(zip *zip_file, const Path &zipPath, const std::string &inZipPath) : zip_file_(zip_file), zipPath_(zipPath), inZipPath_(inZipPath) {}
+	ZipFileReader(zip *zip_file, const Path &zipPath, const std::string &inZipPath);
+	static zip *OpenZip(const Path &zipFile, bool logErrors);
+	void BuildIndex();
+	// Case insensitive, like ZIP_FL_NOCASE. Returns -1 if not found.
+	int FindEntry(const std::string &name) const;
 	// Path has to be either an empty string, or a string ending with a /.
 	bool GetZipListings(const std::string &path, std::set<std::string> &files, std::set<std::string> &directories);
 
-	zip *zip_file_ = nullptr;
-	std::mutex lock_;
+	zip *AcquireHandle();
+	void ReleaseHandle(zip *handle);
+
+	struct Entry {
+		uint64_t size;
+		bool isDirectory;
+	};
+	struct Directory {
+		std::set<std::string> files;
+		std::set<std::string> directories;
+	};
+
+	enum {
+		MAX_HANDLES = 4,
+	};
+
+	zip *zip_file_ = nullptr;  // The first handle, the index is built from it.
+	std::vector<Entry> entries_;
+	std::unordered_map<std::string, int> index_;  // Lowercased name -> entry.
+	std::unordered_map<std::string, Directory> directories_;  // Keyed by path ending in /, root is "".
+
+	std::mutex handleLock_;
+	std::condition_variable handleCond_;
+	std::vector<zip *> freeHandles_;
+	int numHandles_ = 1;
+	int maxHandles_ = MAX_HANDLES;
+
 	std::string inZipPath_;
 	Path zipPath_;
 };
@@ -293,6 +293,12 @@ static const ConfigSetting generalSettings[] = {
 	ConfigSetting("AutoSaveSymbolMap", &g_Config.bAutoSaveSymbolMap, false, CfgFlag::PER_GAME),
 	ConfigSetting("CompressSymbols", &g_Config.bCompressSymbols, true, CfgFlag::DEFAULT),
 	ConfigSetting("CacheFullIsoInRam", &g_Config.bCacheFullIsoInRam, false, CfgFlag::PER_GAME),
+	ConfigSetting("ScanIsoDirectoriesOnMount", &g_Config.bScanIsoDirectoriesOnMount, false, CfgFlag::PER_GAME),
+	ConfigSetting("FileReadQueueDepth", &g_Config.iFileReadQueueDepth, 1, CfgFlag::DEFAULT),
+	ConfigSetting("MemoryMapIsoFiles", &g_Config.bMemoryMapIsoFiles, false, CfgFlag::DEFAULT),
+	ConfigSetting("DiskCacheCompression", &g_Config.bDiskCacheCompression, true, CfgFlag::DEFAULT),
+	ConfigSetting("DiskCachePrefetch", &g_Config.bDiskCachePrefetch, true, CfgFlag::DEFAULT),
+	ConfigSetting("MemStickWriteBack", &g_Config.bMemStickWriteBack, false, CfgFlag::DEFAULT),
 	ConfigSetting("RemoteISOPort", &g_Config.iRemoteISOPort, 0, CfgFlag::DEFAULT),
 	ConfigSetting("LastRemoteISOServer", &g_Config.sLastRemoteISOServer, "", CfgFlag::DEFAULT),
 	ConfigSetting("LastRemoteISOPort", &g_Config.iLastRemoteISOPort, 0, CfgFlag::DEFAULT),
@@ -356,6 +362,10 @@ static bool DefaultSasThread() {
 	return cpu_info.num_cores > 1;
 }
 
+static bool DefaultVideoDecodeAhead() {
+	return cpu_info.num_cores > 1;
+}
+
 static const ConfigSetting achievementSettings[] = {
 	// Core settings
 	ConfigSetting("AchievementsEnable", &g_Config.bAchievementsEnable, false, CfgFlag::DEFAULT),
@@ -388,6 +398,7 @@ static const ConfigSetting achievementSettings[] = {
 static const ConfigSetting cpuSettings[] = {
 	ConfigSetting("CPUCore", &g_Config.iCpuCore, &DefaultCpuCore, CfgFlag::PER_GAME | CfgFlag::REPORT),
 	ConfigSetting("SeparateSASThread", &g_Config.bSeparateSASThread, &DefaultSasThread, CfgFlag::PER_GAME | CfgFlag::REPORT),
+	ConfigSetting("VideoDecodeAhead", &g_Config.bVideoDecodeAhead, &DefaultVideoDecodeAhead, CfgFlag::PER_GAME | CfgFlag::REPORT),
 	ConfigSetting("IOTimingMethod", &g_Config.iIOTimingMethod, IOTIMING_FAST, CfgFlag::PER_GAME | CfgFlag::REPORT),
 	ConfigSetting("FastMemoryAccess", &g_Config.bFastMemory, true, CfgFlag::PER_GAME),
 	ConfigSetting("FunctionReplacements", &g_Config.bFuncReplacements, true, CfgFlag::PER_GAME | CfgFlag::REPORT),
@@ -696,6 +707,7 @@ static const ConfigSetting graphicsSettings[] = {
 	ConfigSetting("MultiSampleLevel", &g_Config.iMultiSampleLevel, 0, CfgFlag::PER_GAME),  // Number of samples is 1 << iMultiSampleLevel
 
 	ConfigSetting("TextureBackoffCache", &g_Config.bTextureBackoffCache, false, CfgFlag::PER_GAME | CfgFlag::REPORT),
+	ConfigSetting("TextureWriteTracking", &g_Config.bTextureWriteTracking, false, CfgFlag::PER_GAME | CfgFlag::REPORT),
 	ConfigSetting("VertexDecJit", &g_Config.bVertexDecoderJit, &DefaultCodeGen, CfgFlag::DONT_SAVE | CfgFlag::REPORT),
 
 #ifndef MOBILE_DEVICE
@@ -729,6 +741,9 @@ static const ConfigSetting graphicsSettings[] = {
 	ConfigSetting("TexScalingType", &g_Config.iTexScalingType, 0, CfgFlag::PER_GAME | CfgFlag::REPORT),
 	ConfigSetting("TexDeposterize", &g_Config.bTexDeposterize, false, CfgFlag::PER_GAME | CfgFlag::REPORT),
 	ConfigSetting("TexHardwareScaling", &g_Config.bTexHardwareScaling, false, CfgFlag::PER_GAME | CfgFlag::REPORT),
+	ConfigSetting("TexScalingAsync", &g_Config.bTexScalingAsync, true, CfgFlag::PER_GAME | CfgFlag::REPORT),
+	ConfigSetting("TexScalingCacheSizeMB", &g_Config.iTexScalingCacheSizeMB, 64, CfgFlag::DEFAULT),
+	ConfigSetting("TextureCacheBudgetMB", &g_Config.iTextureCacheBudgetMB, 0, CfgFlag::DEFAULT),
 	ConfigSetting("VSync", &g_Config.bVSync, &DefaultVSync, CfgFlag::PER_GAME),
 	ConfigSetting("VulkanPresentMode", &g_Config.iVulkanPresentationMode, (int)PresentMode::Mailbox, CfgFlag::PER_GAME),
 	ConfigSetting("BloomHack", &g_Config.iBloomHack, 0, CfgFlag::PER_GAME | CfgFlag::REPORT),
@@ -968,6 +983,10 @@ static const ConfigSetting controlSettings[] = {
 static const ConfigSetting networkSettings[] = {
 	ConfigSetting("EnableWlan", &g_Config.bEnableWlan, false, CfgFlag::PER_GAME),
 	ConfigSetting("EnableAdhocServer", &g_Config.bEnableAdhocServer, false, CfgFlag::PER_GAME),
+	ConfigSetting("AdhocServerTickMs", &g_Config.iAdhocServerTickMs, 100, CfgFlag::DEFAULT),
+	ConfigSetting("AdhocServerStatusInterval", &g_Config.iAdhocServerStatusInterval, 5, CfgFlag::DEFAULT),
+	ConfigSetting("AdhocServerShards", &g_Config.iAdhocServerShards, 0, CfgFlag::DEFAULT),
+	ConfigSetting("AdhocLatencyLog", &g_Config.bAdhocLatencyLog, false, CfgFlag::DEFAULT),
 	ConfigSetting("proAdhocServer", &g_Config.proAdhocServer, "socom.cc", CfgFlag::PER_GAME),
 	ConfigSetting("proAdhocServerList", &g_Config.proAdhocServerList, &defaultProAdhocServerList, CfgFlag::DEFAULT),
 	ConfigSetting("PortOffset", &g_Config.iPortOffset, 10000, CfgFlag::PER_GAME),
@@ -1037,6 +1056,7 @@ static const ConfigSetting debuggerSettings[] = {
 	ConfigSetting("FuncHashMap", &g_Config.bFuncHashMap, false, CfgFlag::DEFAULT),
 	ConfigSetting("SkipFuncHashMap", &g_Config.sSkipFuncHashMap, "", CfgFlag::DEFAULT),
 	ConfigSetting("MemInfoDetailed", &g_Config.bDebugMemInfoDetailed, false, CfgFlag::DEFAULT),
+	ConfigSetting("RecordIoTrace", &g_Config.bRecordIoTrace, false, CfgFlag::DONT_SAVE),
 };
 
 static const ConfigSetting jitSettings[] = {
@@ -120,11 +120,18 @@ struct Config {
 	bool bDisableHTTPS;
 
 	bool bSeparateSASThread;
+	bool bVideoDecodeAhead;  // Decode upcoming movie frames on a separate thread.
 	int iIOTimingMethod;
 	int iLockedCPUSpeed;
 	bool bAutoSaveSymbolMap;
 	bool bCompressSymbols;
 	bool bCacheFullIsoInRam;
+	bool bScanIsoDirectoriesOnMount;  // Read the whole ISO directory tree at mount, instead of lazily.
+	int iFileReadQueueDepth;  // Max concurrent reads when a large read from a local file is split up. 1 (default) disables, more helps on network storage.
+	bool bMemoryMapIsoFiles;  // Serve plain ISO reads from a memory mapping of the file on fixed local disks. Off by default, read errors crash instead of failing.
+	bool bDiskCacheCompression;  // Compress blocks in the disk cache for remote ISOs.
+	bool bDiskCachePrefetch;  // Prefetch remote ISO blocks in the order earlier sessions read them.
+	bool bMemStickWriteBack;  // Buffer small memory stick writes, and replace rewritten savedata files atomically.
 	int iRemoteISOPort; // Also used for serving a local remote debugger.
 	std::string sLastRemoteISOServer;
 	int iLastRemoteISOPort;
@@ -222,6 +229,7 @@ struct Config {
 	float fUISaturation;
 
 	bool bTextureBackoffCache;
+	bool bTextureWriteTracking;
 	bool bVertexDecoderJit;
 	int iAppSwitchMode;
 	bool bFullScreen;
@@ -239,6 +247,9 @@ struct Config {
 	int iTexScalingType; // 0 = xBRZ, 1 = Hybrid
 	bool bTexDeposterize;
 	bool bTexHardwareScaling;
+	bool bTexScalingAsync;  // Scale on a background thread, showing the unscaled texture until done.
+	int iTexScalingCacheSizeMB;
+	int iTextureCacheBudgetMB;  // Host memory for cached textures. 0 = automatic.
 	int iFpsLimit1;
 	int iFpsLimit2;
 	int iAnalogFpsLimit;
@@ -485,6 +496,10 @@ struct Config {
 
 	// Networking
 	bool bEnableAdhocServer;
+	int iAdhocServerTickMs;  // How often the built-in adhoc server wakes up to check for timeouts.
+	int iAdhocServerStatusInterval;  // Minimum seconds between writes of the adhoc server status file.
+	int iAdhocServerShards;  // Worker threads for the adhoc server, games are spread over them by product code. 0 = single thread.
+	bool bAdhocLatencyLog;  // Log round trip times of scan/connect requests to the adhoc server.
 	std::string proAdhocServer;
 	std::vector<std::string> proAdhocServerList;
 	std::string sInfrastructureDNSServer;
@@ -564,6 +579,7 @@ struct Config {
 	bool bFuncHashMap;
 	std::string sSkipFuncHashMap;
 	bool bDebugMemInfoDetailed;
+	bool bRecordIoTrace;  // Record sceIo file accesses to the dump directory, see IoTrace.h.
 
 	// Volatile development settings
 	// Overlays
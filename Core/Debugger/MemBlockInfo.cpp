@@ -30,6 +30,7 @@
 #include "Core/CoreTiming.h"
 #include "Core/Debugger/Breakpoints.h"
 #include "Core/Debugger/MemBlockInfo.h"
+#include "Core/MemWriteTracker.h"
 #include "Core/MIPS/MIPS.h"
 #include "Common/StringUtils.h"
 
@@ -485,6 +486,9 @@ void NotifyMemInfoPC(MemBlockFlags flags, uint32_t start, uint32_t size, uint32_
 	}
 	// Clear the uncached and kernel bits.
 	start = NormalizeAddress(start);
+	if ((flags & MemBlockFlags::WRITE) && Memory::WriteTracker_Enabled()) {
+		Memory::WriteTracker_Notify(start, size);
+	}
 
 	bool needFlush = false;
 	// When the setting is off, we skip smaller info to keep things fast.
@@ -539,6 +543,8 @@ void NotifyMemInfo(MemBlockFlags flags, uint32_t start, uint32_t size, const cha
 void NotifyMemInfoCopy(uint32_t destPtr, uint32_t srcPtr, uint32_t size, const char *prefix) {
 	if (size == 0)
 		return;
+	if (Memory::WriteTracker_Enabled())
+		Memory::WriteTracker_Notify(destPtr, size);
 
 	bool needsFlush = false;
 	if (g_breakpoints.HasMemChecks()) {
@@ -20,6 +20,7 @@
 #include "Core/Debugger/WebSocket/GPUStatsSubscriber.h"
 #include "Core/HW/Display.h"
 #include "Core/System.h"
+#include "GPU/GPU.h"
 
 struct CollectedStats {
 	float vps;
@@ -29,6 +30,10 @@ struct CollectedStats {
 	std::vector<float> frameTimes;
 	std::vector<float> sleepTimes;
 	int frameTimePos;
+	int texturesCached;
+	int textureCacheKB;
+	int textureCacheBudgetKB;
+	int textureCacheEvictions;
 };
 
 struct DebuggerGPUStatsEvent {
@@ -61,6 +66,12 @@ struct DebuggerGPUStatsEvent {
 		j.pop();
 		j.writeInt("pos", s.frameTimePos);
 		j.pop();
+		j.pushDict("textureCache");
+		j.writeInt("textures", s.texturesCached);
+		j.writeInt("kb", s.textureCacheKB);
+		j.writeInt("budgetKB", s.textureCacheBudgetKB);
+		j.writeInt("evictions", s.textureCacheEvictions);
+		j.pop();
 		j.end();
 		return j.str();
 	}
@@ -133,6 +144,11 @@ void WebSocketGPUStatsState::FlipListener() {
 		memcpy(&stats.sleepTimes[0], sleepHistory, sizeof(double) * valid);
 	}
 
+	stats.texturesCached = gpuStats.numTexturesCached;
+	stats.textureCacheKB = gpuStats.textureCacheKB;
+	stats.textureCacheBudgetKB = gpuStats.textureCacheBudgetKB;
+	stats.textureCacheEvictions = gpuStats.numTextureCacheEvictions;
+
 	sendNext_ = false;
 }
 
@@ -148,6 +164,11 @@ void WebSocketGPUStatsState::FlipListener() {
 //     - frames: array of numbers, each representing the time taken for a frame.
 //     - sleep: array of numbers, each representing the delay time waiting for next frame.
 //     - pos: number, index of the current frame (not always last.)
+//  - textureCache: object with properties:
+//     - textures: number of textures currently cached.
+//     - kb: number, estimated host memory used by cached textures, in KiB.
+//     - budgetKB: number, memory budget the cache is trimmed to, in KiB.
+//     - evictions: number, total textures evicted to stay within the budget.
 //
 // Note: stats are returned after the next flip completes (paused if CPU or GPU in break.)
 // Note: info and timing may not be accurate if certain settings are disabled.
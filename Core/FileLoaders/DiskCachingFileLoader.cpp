@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <limits>
 #include <set>
 #include <mutex>
 #include <cstring>
@@ -30,9 +31,13 @@
 #include "Common/File/Path.h"
 #include "Common/Log.h"
 #include "Common/CommonWindows.h"
+#include "Common/Thread/ThreadUtil.h"
+#include "Core/Config.h"
 #include "Core/FileLoaders/DiskCachingFileLoader.h"
 #include "Core/System.h"
 
+#include <zstd.h>
+
 #if PPSSPP_PLATFORM(UWP)
 #include <fileapifromapp.h>
 #endif
@@ -46,6 +51,8 @@ static const char * const CACHEFILE_MAGIC = "ppssppDC";
 static const s64 SAFETY_FREE_DISK_SPACE = 768 * 1024 * 1024; // 768 MB
 // Aim to allow this many files cached at once.
 static const u32 CACHE_SPACE_FLEX = 4;
+// Cheap enough to not matter next to a network read.
+static const int CACHE_COMPRESSION_LEVEL = 1;
 
 Path DiskCachingFileLoaderCache::cacheDir_;
 
@@ -136,6 +143,16 @@ std::vector<Path> DiskCachingFileLoader::GetCachedPathsInUse() {
 	return files;
 }
 
+std::vector<std::pair<Path, DiskCacheStats>> DiskCachingFileLoader::GetCacheStats() {
+	std::lock_guard<std::mutex> guard(cachesMutex_);
+
+	std::vector<std::pair<Path, DiskCacheStats>> stats;
+	for (const auto &it : caches_) {
+		stats.emplace_back(it.first, it.second->GetStats());
+	}
+	return stats;
+}
+
 void DiskCachingFileLoader::InitCache() {
 	std::lock_guard<std::mutex> guard(cachesMutex_);
 
@@ -147,11 +164,13 @@ void DiskCachingFileLoader::InitCache() {
 
 	cache_ = entry;
 	cache_->AddRef();
+	cache_->StartPrefetch(backend_);
 }
 
 void DiskCachingFileLoader::ShutdownCache() {
 	std::lock_guard<std::mutex> guard(cachesMutex_);
 
+	cache_->StopPrefetch(backend_);
 	if (cache_->Release()) {
 		// If it ran out of counts, delete it.
 		delete cache_;
@@ -176,6 +195,7 @@ void DiskCachingFileLoaderCache::InitCache(const Path &filename) {
 	maxBlocks_ = MAX_BLOCKS_LOWER_BOUND;
 	flags_ = 0;
 	generation_ = 0;
+	compress_ = g_Config.bDiskCacheCompression;
 
 	const Path cacheFilePath = MakeCacheFilePath(filename);
 	bool fileLoaded = LoadCacheFile(cacheFilePath);
@@ -198,9 +218,16 @@ void DiskCachingFileLoaderCache::InitCache(const Path &filename) {
 			CloseFileHandle();
 		}
 	}
+
+	blockFlags_.assign(indexCount_, 0);
+	if (compress_) {
+		compressBuffer_.resize(ZSTD_compressBound(blockSize_));
+	}
 }
 
 void DiskCachingFileLoaderCache::ShutdownCache() {
+	StopPrefetch(nullptr);
+
 	if (f_) {
 		bool failed = false;
 		if (fseek(f_, sizeof(FileHeader), SEEK_SET) != 0) {
@@ -210,6 +237,10 @@ void DiskCachingFileLoaderCache::ShutdownCache() {
 		} else if (fflush(f_) != 0) {
 			failed = true;
 		}
+		if (!failed) {
+			WriteHistory();
+			failed = f_ == nullptr;
+		}
 		if (failed) {
 			// Leave it locked, it's broken.
 			ERROR_LOG(Log::Loader, "Unable to flush disk cache.");
@@ -219,15 +250,24 @@ void DiskCachingFileLoaderCache::ShutdownCache() {
 		CloseFileHandle();
 	}
 
+	if (stats_.blocksRead != 0) {
+		INFO_LOG(Log::Loader, "Disk cache for %s: %d/%d blocks from cache, %d prefetched (%d used)", origPath_.c_str(),
+			(int)stats_.blocksFromCache, (int)stats_.blocksRead, (int)stats_.blocksPrefetched, (int)stats_.prefetchedUsed);
+	}
+
 	index_.clear();
 	blockIndexLookup_.clear();
+	blockFlags_.clear();
+	history_.clear();
+	historyPos_.clear();
+	sessionHistory_.clear();
 	cacheSize_ = 0;
 }
 
 size_t DiskCachingFileLoaderCache::ReadFromCache(s64 pos, size_t bytes, void *data) {
 	std::lock_guard<std::mutex> guard(lock_);
 
-	if (!f_) {
+	if (!f_ || bytes == 0) {
 		return 0;
 	}
 
@@ -251,6 +291,7 @@ size_t DiskCachingFileLoaderCache::ReadFromCache(s64 pos, size_t bytes, void *da
 		if (!ReadBlockData(p + readSize, info, offset, toRead)) {
 			return readSize;
 		}
+		NoteAccess((u32)i, true);
 		readSize += toRead;
 
 		// Don't need an offset after the first read.
@@ -285,50 +326,30 @@ size_t DiskCachingFileLoaderCache::SaveIntoCache(FileLoader *backend, s64 pos, s
 		}
 	}
 
-	if (!MakeCacheSpaceFor(blocksToRead) || blocksToRead == 0) {
+	if (!MakeCacheSpaceFor(blocksToRead * UNITS_PER_BLOCK) || blocksToRead == 0) {
 		return 0;
 	}
 
-	if (blocksToRead == 1) {
-		auto &info = index_[cacheStartPos];
-
-		u8 *buf = new u8[blockSize_];
-		size_t readBytes = backend->ReadAt(cacheStartPos * (u64)blockSize_, blockSize_, buf, flags);
+	// Zeroed so that a short last block is stored the same way each time.
+	std::vector<u8> wholeRead(blocksToRead * blockSize_);
+	size_t readBytes = backend->ReadAt(cacheStartPos * (u64)blockSize_, blocksToRead * blockSize_, wholeRead.data(), flags);
 
+	for (size_t i = 0; i < blocksToRead; ++i) {
+		auto &info = index_[cacheStartPos + i];
 		// Check if it was written while we were busy.  Might happen if we thread.
 		if (info.block == INVALID_BLOCK && readBytes != 0) {
-			info.block = AllocateBlock((u32)cacheStartPos);
-			WriteBlockData(info, buf);
-			WriteIndexData((u32)cacheStartPos, info);
+			const u8 *stored;
+			u32 storedSize = CompressBlock(&wholeRead[i * blockSize_], compressBuffer_, &stored);
+			StoreBlock((u32)(cacheStartPos + i), stored, storedSize);
 		}
+		NoteAccess((u32)(cacheStartPos + i), false);
 
 		size_t toRead = std::min(bytes - readSize, (size_t)blockSize_ - offset);
-		memcpy(p + readSize, buf + offset, toRead);
+		memcpy(p + readSize, &wholeRead[i * blockSize_] + offset, toRead);
 		readSize += toRead;
-
-		delete [] buf;
-	} else {
-		u8 *wholeRead = new u8[blocksToRead * blockSize_];
-		size_t readBytes = backend->ReadAt(cacheStartPos * (u64)blockSize_, blocksToRead * blockSize_, wholeRead, flags);
-
-		for (size_t i = 0; i < blocksToRead; ++i) {
-			auto &info = index_[cacheStartPos + i];
-			// Check if it was written while we were busy.  Might happen if we thread.
-			if (info.block == INVALID_BLOCK && readBytes != 0) {
-				info.block = AllocateBlock((u32)cacheStartPos + (u32)i);
-				WriteBlockData(info, wholeRead + (i * blockSize_));
-				// TODO: Doing each index together would probably be better.
-				WriteIndexData((u32)cacheStartPos + (u32)i, info);
-			}
-
-			size_t toRead = std::min(bytes - readSize, (size_t)blockSize_ - offset);
-			memcpy(p + readSize, wholeRead + (i * blockSize_) + offset, toRead);
-			readSize += toRead;
-		}
-		delete[] wholeRead;
+		offset = 0;
 	}
 
-	cacheSize_ += blocksToRead;
 	++generation_;
 
 	if (generation_ == std::numeric_limits<u16>::max()) {
@@ -338,8 +359,133 @@ size_t DiskCachingFileLoaderCache::SaveIntoCache(FileLoader *backend, s64 pos, s
 	return readSize;
 }
 
-bool DiskCachingFileLoaderCache::MakeCacheSpaceFor(size_t blocks) {
-	size_t goal = (size_t)maxBlocks_ - blocks;
+void DiskCachingFileLoaderCache::NoteAccess(u32 indexPos, bool fromCache) {
+	stats_.blocksRead++;
+	if (fromCache) {
+		stats_.blocksFromCache++;
+	}
+
+	u8 &flags = blockFlags_[indexPos];
+	if (flags & BLOCK_PREFETCHED) {
+		stats_.prefetchedUsed++;
+		flags &= ~BLOCK_PREFETCHED;
+	}
+	if (flags & BLOCK_SEEN) {
+		return;
+	}
+	flags |= BLOCK_SEEN;
+	if (sessionHistory_.size() < MAX_HISTORY) {
+		sessionHistory_.push_back(indexPos);
+	}
+
+	// Keep prefetching a bit ahead of wherever the game is in the previous order.
+	u32 historyPos = historyPos_.empty() ? INVALID_INDEX : historyPos_[indexPos];
+	if (historyPos != INVALID_INDEX && historyPos + PREFETCH_AHEAD_BLOCKS > prefetchTarget_) {
+		prefetchTarget_ = historyPos + PREFETCH_AHEAD_BLOCKS;
+		prefetchCursor_ = std::max(prefetchCursor_, (size_t)historyPos + 1);
+		prefetchCond_.notify_one();
+	}
+}
+
+void DiskCachingFileLoaderCache::StartPrefetch(FileLoader *backend) {
+	std::lock_guard<std::mutex> guard(lock_);
+	if (!f_ || history_.empty() || prefetchBackend_ || !g_Config.bDiskCachePrefetch) {
+		return;
+	}
+
+	prefetchBackend_ = backend;
+	prefetchStop_ = false;
+	if (prefetchThread_.joinable())
+		prefetchThread_.join();
+	prefetchThread_ = std::thread([this] {
+		SetCurrentThreadName("DiskCachePrefetch");
+
+		AndroidJNIThreadContext jniContext;
+
+		PrefetchLoop();
+	});
+}
+
+void DiskCachingFileLoaderCache::StopPrefetch(FileLoader *backend) {
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		if (backend && prefetchBackend_ != backend) {
+			return;
+		}
+		prefetchStop_ = true;
+		prefetchCond_.notify_all();
+	}
+
+	// The backend might be about to go away, so we have to wait.
+	if (prefetchThread_.joinable())
+		prefetchThread_.join();
+
+	std::lock_guard<std::mutex> guard(lock_);
+	prefetchBackend_ = nullptr;
+}
+
+void DiskCachingFileLoaderCache::PrefetchLoop() {
+	std::vector<u8> buffer(blockSize_);
+	// Our own, compressBuffer_ is used under the lock.
+	std::vector<u8> compressed(compress_ ? ZSTD_compressBound(blockSize_) : 0);
+
+	std::unique_lock<std::mutex> guard(lock_);
+	// Right away, get what the game will probably read while it boots.
+	prefetchTarget_ = std::max(prefetchTarget_, (size_t)PREFETCH_AHEAD_BLOCKS);
+	while (!prefetchStop_ && f_) {
+		u32 indexPos = INVALID_INDEX;
+		while (prefetchCursor_ < prefetchTarget_ && prefetchCursor_ < history_.size()) {
+			u32 next = history_[prefetchCursor_++];
+			if (index_[next].block == INVALID_BLOCK) {
+				indexPos = next;
+				break;
+			}
+		}
+		if (indexPos == INVALID_INDEX) {
+			if (prefetchCursor_ >= history_.size()) {
+				// Nothing left to predict.
+				break;
+			}
+			prefetchCond_.wait(guard);
+			continue;
+		}
+
+		FileLoader *backend = prefetchBackend_;
+		guard.unlock();
+		memset(buffer.data(), 0, buffer.size());
+		size_t readBytes = backend->ReadAt(indexPos * (u64)blockSize_, blockSize_, buffer.data());
+		// Compression is the slow part, so the game's reads from the cache shouldn't wait for it.
+		const u8 *stored = buffer.data();
+		u32 storedSize = readBytes != 0 ? CompressBlock(buffer.data(), compressed, &stored) : 0;
+		guard.lock();
+
+		if (prefetchStop_ || !f_) {
+			break;
+		}
+		const size_t units = (storedSize + unitSize_ - 1) / unitSize_;
+		if (readBytes != 0 && index_[indexPos].block == INVALID_BLOCK && MakeCacheSpaceFor(units)) {
+			StoreBlock(indexPos, stored, storedSize);
+			if ((blockFlags_[indexPos] & BLOCK_SEEN) == 0) {
+				blockFlags_[indexPos] |= BLOCK_PREFETCHED;
+			}
+			stats_.blocksPrefetched++;
+		}
+	}
+}
+
+DiskCacheStats DiskCachingFileLoaderCache::GetStats() {
+	std::lock_guard<std::mutex> guard(lock_);
+	DiskCacheStats stats = stats_;
+	if (f_) {
+		stats.diskUsed = (u64)cacheSize_ * unitSize_;
+		stats.diskBudget = (u64)maxUnits_ * unitSize_;
+	}
+	stats.historyLength = (u32)history_.size();
+	return stats;
+}
+
+bool DiskCachingFileLoaderCache::MakeCacheSpaceFor(size_t units) {
+	size_t goal = (size_t)maxUnits_ - units;
 
 	while (cacheSize_ > goal) {
 		u16 minGeneration = generation_;
@@ -359,14 +505,7 @@ bool DiskCachingFileLoaderCache::MakeCacheSpaceFor(size_t blocks) {
 
 			// 0 means it was never used yet or was the first read (e.g. block descriptor.)
 			if (info.generation == oldestGeneration_ || info.generation == 0) {
-				info.block = INVALID_BLOCK;
-				info.generation = 0;
-				info.hits = 0;
-				--cacheSize_;
-
-				// TODO: Doing this in chunks might be a lot better.
-				WriteIndexData(blockIndexLookup_[i], info);
-				blockIndexLookup_[i] = INVALID_INDEX;
+				EvictBlock(blockIndexLookup_[i]);
 
 				// Keep going?
 				if (cacheSize_ <= goal) {
@@ -382,6 +521,22 @@ bool DiskCachingFileLoaderCache::MakeCacheSpaceFor(size_t blocks) {
 	return true;
 }
 
+void DiskCachingFileLoaderCache::EvictBlock(u32 indexPos) {
+	auto &info = index_[indexPos];
+	for (int i = 0; i < UNITS_PER_BLOCK; ++i) {
+		u32 unit = info.Unit(i);
+		if (unit != INVALID_BLOCK) {
+			blockIndexLookup_[unit] = INVALID_INDEX;
+			--cacheSize_;
+		}
+	}
+	info = BlockInfo();
+	blockFlags_[indexPos] &= ~BLOCK_PREFETCHED;
+
+	// TODO: Doing this in chunks might be a lot better.
+	WriteIndexData(indexPos, info);
+}
+
 void DiskCachingFileLoaderCache::RebalanceGenerations() {
 	// To make things easy, we will subtract oldestGeneration_ and cut in half.
 	// That should give us more space but not break anything.
@@ -402,10 +557,13 @@ void DiskCachingFileLoaderCache::RebalanceGenerations() {
 	oldestGeneration_ = 0;
 }
 
-u32 DiskCachingFileLoaderCache::AllocateBlock(u32 indexPos) {
-	for (size_t i = 0; i < blockIndexLookup_.size(); ++i) {
+u32 DiskCachingFileLoaderCache::AllocateUnit(u32 indexPos) {
+	// Start after the last one, units are mostly used up in order.
+	for (size_t n = 0; n < blockIndexLookup_.size(); ++n) {
+		size_t i = (allocHint_ + n) % blockIndexLookup_.size();
 		if (blockIndexLookup_[i] == INVALID_INDEX) {
 			blockIndexLookup_[i] = indexPos;
+			allocHint_ = (u32)(i + 1);
 			return (u32)i;
 		}
 	}
@@ -439,11 +597,11 @@ ::Path DiskCachingFileLoaderCache::MakeCacheFilePath(const Path &filename) {
 	return dir / MakeCacheFilename(filename);
 }
 
-s64 DiskCachingFileLoaderCache::GetBlockOffset(u32 block) {
-	// This is where the blocks start.
-	s64 blockOffset = (s64)sizeof(FileHeader) + (s64)indexCount_ * (s64)sizeof(BlockInfo);
-	// Now to the actual block.
-	return blockOffset + (s64)block * (s64)blockSize_;
+s64 DiskCachingFileLoaderCache::GetUnitOffset(u32 unit) {
+	// This is where the units start.
+	s64 unitOffset = (s64)sizeof(FileHeader) + (s64)indexCount_ * (s64)sizeof(BlockInfo) + (s64)MAX_HISTORY * (s64)sizeof(u32);
+	// Now to the actual unit.
+	return unitOffset + (s64)unit * (s64)unitSize_;
 }
 
 bool DiskCachingFileLoaderCache::ReadBlockData(u8 *dest, BlockInfo &info, size_t offset, size_t size) {
@@ -453,23 +611,65 @@ bool DiskCachingFileLoaderCache::ReadBlockData(u8 *dest, BlockInfo &info, size_t
 	if (size == 0) {
 		return true;
 	}
-	s64 blockOffset = GetBlockOffset(info.block);
 
 	// Before we read, make sure the buffers are flushed.
 	// We might be trying to read an area we've recently written.
 	fflush(f_);
 
+	if (info.storedSize < blockSize_) {
+		// Compressed, so we need all of it.
+		std::vector<u8> stored(info.storedSize);
+		for (u32 pos = 0, i = 0; pos < info.storedSize; pos += unitSize_, ++i) {
+			if (!ReadUnitData(info.Unit(i), 0, &stored[pos], std::min(unitSize_, info.storedSize - pos))) {
+				return false;
+			}
+		}
+		decompressBuffer_.resize(blockSize_);
+		size_t result = ZSTD_decompress(decompressBuffer_.data(), blockSize_, stored.data(), stored.size());
+		if (ZSTD_isError(result) || result != blockSize_) {
+			ERROR_LOG(Log::Loader, "Unable to decompress disk cache data entry.");
+			CloseFileHandle();
+			return false;
+		}
+		memcpy(dest, &decompressBuffer_[offset], size);
+		return true;
+	}
+
+	// Just read the units that are needed, in as few reads as possible.
+	int unitIndex = (int)(offset / unitSize_);
+	size_t unitOffset = offset % unitSize_;
+	size_t done = 0;
+	while (done < size) {
+		u32 first = info.Unit(unitIndex);
+		size_t runBytes = std::min(size - done, (size_t)unitSize_ - unitOffset);
+		while (done + runBytes < size && info.Unit(unitIndex + 1) == info.Unit(unitIndex) + 1) {
+			++unitIndex;
+			runBytes += std::min(size - done - runBytes, (size_t)unitSize_);
+		}
+		if (!ReadUnitData(first, unitOffset, dest + done, runBytes)) {
+			return false;
+		}
+		done += runBytes;
+		++unitIndex;
+		unitOffset = 0;
+	}
+	return true;
+}
+
+bool DiskCachingFileLoaderCache::ReadUnitData(u32 unit, size_t offset, u8 *dest, size_t size) {
+	s64 unitOffset = GetUnitOffset(unit) + (s64)offset;
+
 	bool failed = false;
 #ifdef __ANDROID__
-	if (lseek64(fd_, blockOffset, SEEK_SET) != blockOffset) {
+	if (lseek64(fd_, unitOffset, SEEK_SET) != unitOffset) {
 		failed = true;
-	} else if (read(fd_, dest + offset, size) != (ssize_t)size) {
+	} else if (read(fd_, dest, size) != (ssize_t)size) {
 		failed = true;
 	}
 #else
-	if (fseeko(f_, blockOffset, SEEK_SET) != 0) {
+	if (fseeko(f_, unitOffset, SEEK_SET) != 0) {
 		failed = true;
-	} else if (fread(dest + offset, size, 1, f_) != 1) {
+	} else if (fread(dest, size, 1, f_) != 1) {
 		failed = true;
 	}
 #endif
@@ -481,23 +681,23 @@ bool DiskCachingFileLoaderCache::ReadBlockData(u8 *dest, BlockInfo &info, size_t
 	return !failed;
 }
 
-void DiskCachingFileLoaderCache::WriteBlockData(BlockInfo &info, const u8 *src) {
+void DiskCachingFileLoaderCache::WriteUnitData(u32 unit, const u8 *src, size_t size) {
 	if (!f_) {
 		return;
 	}
-	s64 blockOffset = GetBlockOffset(info.block);
+	s64 unitOffset = GetUnitOffset(unit);
 
 	bool failed = false;
 #ifdef __ANDROID__
-	if (lseek64(fd_, blockOffset, SEEK_SET) != blockOffset) {
+	if (lseek64(fd_, unitOffset, SEEK_SET) != unitOffset) {
 		failed = true;
-	} else if (write(fd_, src, blockSize_) != (ssize_t)blockSize_) {
+	} else if (write(fd_, src, size) != (ssize_t)size) {
 		failed = true;
 	}
 #else
-	if (fseeko(f_, blockOffset, SEEK_SET) != 0) {
+	if (fseeko(f_, unitOffset, SEEK_SET) != 0) {
 		failed = true;
-	} else if (fwrite(src, blockSize_, 1, f_) != 1) {
+	} else if (fwrite(src, size, 1, f_) != 1) {
 		failed = true;
 	}
 #endif
@@ -508,6 +708,37 @@ void DiskCachingFileLoaderCache::WriteBlockData(BlockInfo &info, const u8 *src)
 	}
 }
 
+u32 DiskCachingFileLoaderCache::CompressBlock(const u8 *src, std::vector<u8> &buffer, const u8 **data) const {
+	*data = src;
+	if (!compress_) {
+		return blockSize_;
+	}
+
+	size_t result = ZSTD_compress(buffer.data(), buffer.size(), src, blockSize_, CACHE_COMPRESSION_LEVEL);
+	// Only worth it if it saves at least a unit.
+	if (ZSTD_isError(result) || result > blockSize_ - unitSize_) {
+		return blockSize_;
+	}
+	*data = buffer.data();
+	return (u32)result;
+}
+
+void DiskCachingFileLoaderCache::StoreBlock(u32 indexPos, const u8 *data, u32 storedSize) {
+	auto &info = index_[indexPos];
+
+	info.storedSize = storedSize;
+	for (u32 pos = 0, i = 0; pos < storedSize; pos += unitSize_, ++i) {
+		u32 unit = AllocateUnit(indexPos);
+		info.Unit(i) = unit;
+		++cacheSize_;
+		WriteUnitData(unit, data + pos, std::min(unitSize_, storedSize - pos));
+	}
+	WriteIndexData(indexPos, info);
+
+	stats_.bytesUncompressed += blockSize_;
+	stats_.bytesStored += storedSize;
+}
+
 void DiskCachingFileLoaderCache::WriteIndexData(u32 indexPos, BlockInfo &info) {
 	if (!f_) {
 		return;
@@ -528,6 +759,44 @@ void DiskCachingFileLoaderCache::WriteIndexData(u32 indexPos, BlockInfo &info) {
 	}
 }
 
+void DiskCachingFileLoaderCache::WriteHistory() {
+	if (!f_ || sessionHistory_.empty()) {
+		return;
+	}
+
+	// This session's order first, then whatever else earlier ones read.
+	std::vector<u32> merged = sessionHistory_;
+	for (u32 indexPos : history_) {
+		if (merged.size() >= MAX_HISTORY) {
+			break;
+		}
+		if ((blockFlags_[indexPos] & BLOCK_SEEN) == 0) {
+			merged.push_back(indexPos);
+		}
+	}
+
+	u32 offset = (u32)sizeof(FileHeader) + (u32)indexCount_ * (u32)sizeof(BlockInfo);
+	u32_le count = (u32)merged.size();
+
+	bool failed = false;
+	if (fseek(f_, offset, SEEK_SET) != 0) {
+		failed = true;
+	} else if (fwrite(&merged[0], sizeof(u32), merged.size(), f_) != merged.size()) {
+		failed = true;
+	} else if (fseek(f_, offsetof(FileHeader, historyCount), SEEK_SET) != 0) {
+		failed = true;
+	} else if (fwrite(&count, sizeof(count), 1, f_) != 1) {
+		failed = true;
+	} else if (fflush(f_) != 0) {
+		failed = true;
+	}
+
+	if (failed) {
+		ERROR_LOG(Log::Loader, "Unable to write disk cache access history.");
+		CloseFileHandle();
+	}
+}
+
 bool DiskCachingFileLoaderCache::LoadCacheFile(const Path &path) {
 	FILE *fp = File::OpenCFile(path, "rb+");
 	if (!fp) {
@@ -547,6 +816,8 @@ bool DiskCachingFileLoaderCache::LoadCacheFile(const Path &path) {
 	} else if (header.maxBlocks < MAX_BLOCKS_LOWER_BOUND || header.maxBlocks > MAX_BLOCKS_UPPER_BOUND) {
 		// This means it's not in our safety bounds, reject.
 		valid = false;
+	} else if (header.blockSize == 0 || header.blockSize % UNITS_PER_BLOCK != 0 || header.historyCount > MAX_HISTORY) {
+		valid = false;
 	}
 
 	// If it's valid, retain the file pointer.
@@ -560,9 +831,14 @@ bool DiskCachingFileLoaderCache::LoadCacheFile(const Path &path) {
 
 		// Now let's load the index.
 		blockSize_ = header.blockSize;
+		unitSize_ = blockSize_ / UNITS_PER_BLOCK;
 		maxBlocks_ = header.maxBlocks;
+		maxUnits_ = maxBlocks_ * UNITS_PER_BLOCK;
 		flags_ = header.flags;
 		LoadCacheIndex();
+		if (f_) {
+			LoadHistory(header.historyCount);
+		}
 	} else {
 		ERROR_LOG(Log::Loader, "Disk cache file header did not match, recreating cache file");
 		fclose(fp);
@@ -579,8 +855,8 @@ void DiskCachingFileLoaderCache::LoadCacheIndex() {
 
 	indexCount_ = (size_t)((filesize_ + blockSize_ - 1) / blockSize_);
 	index_.resize(indexCount_);
-	blockIndexLookup_.resize(maxBlocks_);
-	memset(&blockIndexLookup_[0], INVALID_INDEX, maxBlocks_ * sizeof(blockIndexLookup_[0]));
+	blockIndexLookup_.resize(maxUnits_);
+	memset(&blockIndexLookup_[0], INVALID_INDEX, maxUnits_ * sizeof(blockIndexLookup_[0]));
 
 	if (fread(&index_[0], sizeof(BlockInfo), indexCount_, f_) != indexCount_) {
 		CloseFileHandle();
@@ -593,23 +869,59 @@ void DiskCachingFileLoaderCache::LoadCacheIndex() {
 	cacheSize_ = 0;
 
 	for (size_t i = 0; i < index_.size(); ++i) {
-		if (index_[i].block > maxBlocks_) {
-			index_[i].block = INVALID_BLOCK;
+		auto &info = index_[i];
+		if (info.block == INVALID_BLOCK) {
+			continue;
 		}
-		if (index_[i].block == INVALID_BLOCK) {
+
+		// Drop anything that doesn't add up, rather than trust it.
+		bool valid = info.storedSize != 0 && info.storedSize <= blockSize_;
+		const int units = valid ? (int)((info.storedSize + unitSize_ - 1) / unitSize_) : 0;
+		for (int u = 0; u < units && valid; ++u) {
+			valid = info.Unit(u) < maxUnits_ && blockIndexLookup_[info.Unit(u)] == INVALID_INDEX;
+			if (valid) {
+				blockIndexLookup_[info.Unit(u)] = (u32)i;
+			}
+		}
+		if (!valid) {
+			for (int u = 0; u < UNITS_PER_BLOCK; ++u) {
+				if (info.Unit(u) < maxUnits_ && blockIndexLookup_[info.Unit(u)] == (u32)i) {
+					blockIndexLookup_[info.Unit(u)] = INVALID_INDEX;
+				}
+			}
+			info = BlockInfo();
 			continue;
 		}
 
-		if (index_[i].generation < oldestGeneration_) {
-			oldestGeneration_ = index_[i].generation;
+		if (info.generation < oldestGeneration_) {
+			oldestGeneration_ = info.generation;
 		}
-		if (index_[i].generation > generation_) {
-			generation_ = index_[i].generation;
+		if (info.generation > generation_) {
+			generation_ = info.generation;
 		}
-		++cacheSize_;
+		cacheSize_ += units;
+	}
+}
 
-		blockIndexLookup_[index_[i].block] = (u32)i;
+void DiskCachingFileLoaderCache::LoadHistory(u32 count) {
+	u32 offset = (u32)sizeof(FileHeader) + (u32)indexCount_ * (u32)sizeof(BlockInfo);
+	history_.resize(count);
+	if (count != 0 && (fseek(f_, offset, SEEK_SET) != 0 || fread(&history_[0], sizeof(u32), count, f_) != count)) {
+		// Not fatal, just nothing to prefetch.
+		WARN_LOG(Log::Loader, "Unable to read disk cache access history.");
+		history_.clear();
 	}
+
+	historyPos_.assign(indexCount_, INVALID_INDEX);
+	size_t valid = 0;
+	for (size_t i = 0; i < history_.size(); ++i) {
+		u32 indexPos = history_[i];
+		if (indexPos < indexCount_ && historyPos_[indexPos] == INVALID_INDEX) {
+			historyPos_[indexPos] = (u32)valid;
+			history_[valid++] = indexPos;
+		}
+	}
+	history_.resize(valid);
 }
 
 void DiskCachingFileLoaderCache::CreateCacheFile(const Path &path) {
@@ -624,6 +936,7 @@ void DiskCachingFileLoaderCache::CreateCacheFile(const Path &path) {
 		ERROR_LOG(Log::Loader, "Not enough free space; disabling disk cache");
 		return;
 	}
+	maxUnits_ = maxBlocks_ * UNITS_PER_BLOCK;
 	flags_ = 0;
 
 	f_ = File::OpenCFile(path, "wb+");
@@ -637,6 +950,7 @@ void DiskCachingFileLoaderCache::CreateCacheFile(const Path &path) {
 #endif
 
 	blockSize_ = DEFAULT_BLOCK_SIZE;
+	unitSize_ = blockSize_ / UNITS_PER_BLOCK;
 
 	FileHeader header;
 	memcpy(header.magic, CACHEFILE_MAGIC, sizeof(header.magic));
@@ -645,6 +959,8 @@ void DiskCachingFileLoaderCache::CreateCacheFile(const Path &path) {
 	header.filesize = filesize_;
 	header.maxBlocks = maxBlocks_;
 	header.flags = flags_;
+	header.historyCount = 0;
+	header.reserved = 0;
 
 	if (fwrite(&header, sizeof(header), 1, f_) != 1) {
 		CloseFileHandle();
@@ -654,13 +970,19 @@ void DiskCachingFileLoaderCache::CreateCacheFile(const Path &path) {
 	indexCount_ = (size_t)((filesize_ + blockSize_ - 1) / blockSize_);
 	index_.clear();
 	index_.resize(indexCount_);
-	blockIndexLookup_.resize(maxBlocks_);
-	memset(&blockIndexLookup_[0], INVALID_INDEX, maxBlocks_ * sizeof(blockIndexLookup_[0]));
+	blockIndexLookup_.resize(maxUnits_);
+	memset(&blockIndexLookup_[0], INVALID_INDEX, maxUnits_ * sizeof(blockIndexLookup_[0]));
 
 	if (fwrite(&index_[0], sizeof(BlockInfo), indexCount_, f_) != indexCount_) {
 		CloseFileHandle();
 		return;
 	}
+	// Reserve the history, so the units after it don't start out past the end of the file.
+	std::vector<u32> emptyHistory(MAX_HISTORY, INVALID_INDEX);
+	if (fwrite(&emptyHistory[0], sizeof(u32), MAX_HISTORY, f_) != MAX_HISTORY) {
+		CloseFileHandle();
+		return;
+	}
 	if (fflush(f_) != 0) {
 		CloseFileHandle();
 		return;
@@ -17,9 +17,12 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <vector>
 #include <map>
 #include <mutex>
+#include <thread>
+#include <utility>
 
 #include "Common/CommonTypes.h"
 #include "Common/File/Path.h"
@@ -28,6 +31,18 @@
 
 class DiskCachingFileLoaderCache;
 
+struct DiskCacheStats {
+	u64 blocksRead = 0;  // Blocks the game asked for.
+	u64 blocksFromCache = 0;
+	u64 blocksPrefetched = 0;
+	u64 prefetchedUsed = 0;  // Prefetched blocks the game then asked for.
+	u64 bytesUncompressed = 0;  // Blocks stored this session, before and after compression.
+	u64 bytesStored = 0;
+	u64 diskUsed = 0;
+	u64 diskBudget = 0;
+	u32 historyLength = 0;  // Blocks in the access order kept from previous sessions.
+};
+
 class DiskCachingFileLoader : public ProxiedFileLoader {
 public:
 	DiskCachingFileLoader(FileLoader *backend);
@@ -43,6 +58,7 @@ class DiskCachingFileLoader : public ProxiedFileLoader {
 	size_t ReadAt(s64 absolutePos, size_t bytes, void *data, Flags flags = Flags::NONE) override;
 
 	static std::vector<Path> GetCachedPathsInUse();
+	static std::vector<std::pair<Path, DiskCacheStats>> GetCacheStats();
 
 private:
 	void Prepare();
@@ -85,24 +101,40 @@ class DiskCachingFileLoaderCache {
 	size_t SaveIntoCache(FileLoader *backend, s64 pos, size_t bytes, void *data, FileLoader::Flags flags);
 
 	bool HasData() const;
+	DiskCacheStats GetStats();
+
+	// Fetches blocks in the order previous sessions first used them, a bit ahead of the game.
+	// Only one backend prefetches at a time, and it must be stopped before the backend goes away.
+	void StartPrefetch(FileLoader *backend);
+	// Pass nullptr to stop regardless of backend.
+	void StopPrefetch(FileLoader *backend);
 
 private:
 	void InitCache(const Path &path);
 	void ShutdownCache();
-	bool MakeCacheSpaceFor(size_t blocks);
+	bool MakeCacheSpaceFor(size_t units);
 	void RebalanceGenerations();
-	u32 AllocateBlock(u32 indexPos);
+	u32 AllocateUnit(u32 indexPos);
+	void EvictBlock(u32 indexPos);
 
 	struct BlockInfo;
 	bool ReadBlockData(u8 *dest, BlockInfo &info, size_t offset, size_t size);
-	void WriteBlockData(BlockInfo &info, const u8 *src);
+	bool ReadUnitData(u32 unit, size_t offset, u8 *dest, size_t size);
+	void WriteUnitData(u32 unit, const u8 *src, size_t size);
+	// Doesn't touch the cache, so it's safe without the lock. Points data at src or the compressed copy in buffer.
+	u32 CompressBlock(const u8 *src, std::vector<u8> &buffer, const u8 **data) const;
+	void StoreBlock(u32 indexPos, const u8 *data, u32 storedSize);
 	void WriteIndexData(u32 indexPos, BlockInfo &info);
-	s64 GetBlockOffset(u32 block);
+	void WriteHistory();
+	s64 GetUnitOffset(u32 unit);
+	void NoteAccess(u32 indexPos, bool fromCache);
+	void PrefetchLoop();
 
 	Path MakeCacheFilePath(const Path &filename);
 	std::string MakeCacheFilename(const Path &path);
 	bool LoadCacheFile(const Path &path);
 	void LoadCacheIndex();
+	void LoadHistory(u32 count);
 	void CreateCacheFile(const Path &path);
 	bool LockCacheFile(bool lockStatus);
 	bool RemoveCacheFile(const Path &path);
@@ -120,19 +152,29 @@ class DiskCachingFileLoaderCache {
 	// 64 filesize
 	// 32 maxBlocks
 	// 32 flags
-	// index[filesize / blockSize] <-- ~500 KB for 4GB
-	//   32 (fileoffset - headersize) / blockSize -> -1=not present
+	// 32 historyCount
+	// 32 reserved
+	// index[filesize / blockSize] <-- ~1.5 MB for 4GB
+	//   32 * UNITS_PER_BLOCK units holding the block, first one -1=not present
+	//   32 stored size, less than blockSize if compressed
 	//   16 generation?
 	//   16 hits?
-	// blocks[up to maxBlocks]
-	//   8 * blockSize
+	// history[MAX_HISTORY]
+	//   32 index of a block, in the order they were first read
+	// units[maxBlocks * UNITS_PER_BLOCK]
+	//   8 * blockSize / UNITS_PER_BLOCK
 
 	enum {
-		CACHE_VERSION = 3,
+		CACHE_VERSION = 4,
 		DEFAULT_BLOCK_SIZE = 65536,
+		// Blocks are stored in smaller units, so compressed blocks take less space.
+		UNITS_PER_BLOCK = 4,
 		MAX_BLOCKS_PER_READ = 16,
 		MAX_BLOCKS_LOWER_BOUND = 256, // 16 MB
 		MAX_BLOCKS_UPPER_BOUND = 8192, // 512 MB
+		MAX_HISTORY = 16384,
+		// How far to prefetch past the game's position in the history.
+		PREFETCH_AHEAD_BLOCKS = 64,
 		INVALID_BLOCK = 0xFFFFFFFF,
 		INVALID_INDEX = 0xFFFFFFFF,
 	};
@@ -140,12 +182,15 @@ class DiskCachingFileLoaderCache {
 	int refCount_ = 0;
 	s64 filesize_;
 	u32 blockSize_;
+	u32 unitSize_;
 	u16 generation_;
 	u16 oldestGeneration_;
 	u32 maxBlocks_;
+	u32 maxUnits_;
 	u32 flags_;
-	size_t cacheSize_;
+	size_t cacheSize_;  // In units.
 	size_t indexCount_;
+	u32 allocHint_ = 0;
 	std::mutex lock_;
 	Path origPath_;
 
@@ -156,6 +201,8 @@ class DiskCachingFileLoaderCache {
 		s64_le filesize;
 		u32_le maxBlocks;
 		u32_le flags;
+		u32_le historyCount;
+		u32_le reserved;
 	};
 
 	enum FileFlags {
@@ -163,16 +210,51 @@ class DiskCachingFileLoaderCache {
 	};
 
 	struct BlockInfo {
-		u32 block;
+		u32 block;  // The first unit.
+		u32 moreUnits[UNITS_PER_BLOCK - 1];
+		u32 storedSize;
 		u16 generation;
 		u16 hits;
 
-		BlockInfo() : block(-1), generation(0), hits(0) {
+		BlockInfo() : block(-1), storedSize(0), generation(0), hits(0) {
+			for (u32 &unit : moreUnits)
+				unit = -1;
+		}
+
+		u32 Unit(int i) const {
+			return i == 0 ? block : moreUnits[i - 1];
+		}
+		u32 &Unit(int i) {
+			return i == 0 ? block : moreUnits[i - 1];
 		}
 	};
 
+	enum BlockFlags : u8 {
+		BLOCK_SEEN = 1 << 0,  // Read by the game this session.
+		BLOCK_PREFETCHED = 1 << 1,  // Prefetched, and not read by the game yet.
+	};
+
 	std::vector<BlockInfo> index_;
+	// From unit to index position.
 	std::vector<u32> blockIndexLookup_;
+	std::vector<u8> blockFlags_;
+	std::vector<u8> compressBuffer_;
+	std::vector<u8> decompressBuffer_;
+	bool compress_ = false;
+
+	// Access order from previous sessions, and where each block is in it.
+	std::vector<u32> history_;
+	std::vector<u32> historyPos_;
+	std::vector<u32> sessionHistory_;
+
+	std::thread prefetchThread_;
+	std::condition_variable prefetchCond_;
+	FileLoader *prefetchBackend_ = nullptr;
+	bool prefetchStop_ = false;
+	size_t prefetchCursor_ = 0;
+	size_t prefetchTarget_ = 0;
+
+	DiskCacheStats stats_;
 
 	FILE *f_ = nullptr;
 	int fd_ = 0;
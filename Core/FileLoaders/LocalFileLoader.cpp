@@ -18,9 +18,22 @@
 
 #include "ppsspp_config.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "Common/Log.h"
 #include "Common/File/FileUtil.h"
 #include "Common/File/DirListing.h"
+#include "Common/SysError.h"
+#include "Common/Thread/Promise.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Core/Config.h"
 #include "Core/FileLoaders/LocalFileLoader.h"
 
 #if PPSSPP_PLATFORM(ANDROID)
@@ -34,12 +47,89 @@
 #endif
 #else
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if PPSSPP_PLATFORM(LINUX)
+#include <sys/statfs.h>
+#include <sys/sysmacros.h>
+#elif PPSSPP_PLATFORM(MAC)
+#include <sys/param.h>
+#include <sys/mount.h>
+#endif
 #endif
 
 #ifdef HAVE_LIBRETRO_VFS
 #include <streams/file_stream.h>
 #endif
 
+// pread doesn't touch the file offset, so reads can overlap. Elsewhere they'd just be serialized.
+#if !defined(_WIN32) && !defined(HAVE_LIBRETRO_VFS) && !PPSSPP_PLATFORM(SWITCH)
+#define LOCAL_FILE_CONCURRENT_READS
+#endif
+
+// Mapping a whole disc image needs the address space of a 64-bit process.
+#if PPSSPP_ARCH(64BIT) && !defined(HAVE_LIBRETRO_VFS) && !defined(NO_MMAP) && !PPSSPP_PLATFORM(SWITCH) && !PPSSPP_PLATFORM(UWP)
+#define LOCAL_FILE_MMAP
+#endif
+
+// Large reads are split up into this many bytes or more per request, so that the latency of
+// network file systems overlaps. Below that, the overhead of waking threads isn't worth it.
+static const size_t SPLIT_READ_MIN_CHUNK = 128 * 1024;
+
+#ifdef LOCAL_FILE_MMAP
+// A read error inside a mapping is a SIGBUS (or an exception on Windows) instead of a failed read,
+// so only map files on local disks that can't be unplugged or drop off the network.
+#ifdef _WIN32
+static bool IsOnFixedLocalDisk(const Path &filename) {
+	wchar_t volume[MAX_PATH];
+	if (!GetVolumePathNameW(filename.ToWString().c_str(), volume, MAX_PATH))
+		return false;
+	return GetDriveTypeW(volume) == DRIVE_FIXED;
+}
+#else
+static bool IsOnFixedLocalDisk(int fd) {
+#if PPSSPP_PLATFORM(LINUX)
+	struct statfs fs;
+	if (fstatfs(fd, &fs) != 0)
+		return false;
+	switch ((uint32_t)fs.f_type) {
+	case 0x6969:      // NFS
+	case 0x517B:      // SMB
+	case 0xFF534D42:  // CIFS
+	case 0xFE534D42:  // SMB2
+	case 0x65735546:  // FUSE (also Android's shared storage, which may be an SD card)
+	case 0x01021997:  // 9P
+	case 0x5346414F:  // AFS
+		return false;
+	default:
+		break;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		return false;
+	// For partitions, the flag lives on the parent disk.
+	char sysPath[128];
+	std::string removable;
+	snprintf(sysPath, sizeof(sysPath), "/sys/dev/block/%u:%u/removable", major(st.st_dev), minor(st.st_dev));
+	if (!File::ReadSysTextFileToString(Path(sysPath), &removable)) {
+		snprintf(sysPath, sizeof(sysPath), "/sys/dev/block/%u:%u/../removable", major(st.st_dev), minor(st.st_dev));
+		File::ReadSysTextFileToString(Path(sysPath), &removable);
+	}
+	return removable.empty() || removable[0] != '1';
+#elif PPSSPP_PLATFORM(MAC)
+	struct statfs fs;
+	if (fstatfs(fd, &fs) != 0)
+		return false;
+	return (fs.f_flags & MNT_LOCAL) != 0 && (fs.f_flags & MNT_REMOVABLE) == 0;
+#else
+	// No way to tell, don't risk it.
+	return false;
+#endif
+}
+#endif
+#endif
+
 #if !defined(_WIN32) && !defined(HAVE_LIBRETRO_VFS)
 
 void LocalFileLoader::DetectSizeFd() {
@@ -122,6 +212,7 @@ LocalFileLoader::LocalFileLoader(const Path &filename)
 }
 
 LocalFileLoader::~LocalFileLoader() {
+	Unmap();
 #if defined(HAVE_LIBRETRO_VFS)
     filestream_close(handle_);
 #elif !defined(_WIN32)
@@ -177,6 +268,91 @@ size_t LocalFileLoader::ReadAt(s64 absolutePos, size_t bytes, size_t count, void
 		return 0;
 	}
 
+#ifdef LOCAL_FILE_CONCURRENT_READS
+	const size_t total = bytes * count;
+	const size_t queueDepth = (size_t)std::max(1, g_Config.iFileReadQueueDepth);
+	if (queueDepth > 1 && total >= SPLIT_READ_MIN_CHUNK * 2) {
+		size_t chunkSize = std::max(SPLIT_READ_MIN_CHUNK, (total + queueDepth - 1) / queueDepth);
+		// Keep the chunks sector aligned, the file systems below like that.
+		chunkSize = (chunkSize + 2047) & ~(size_t)2047;
+
+		std::vector<ReadRequest> requests;
+		for (size_t offset = 0; offset < total; offset += chunkSize) {
+			requests.push_back({ absolutePos + (s64)offset, std::min(chunkSize, total - offset), (u8 *)data + offset, 0 });
+		}
+		ReadAtBatch(requests.data(), requests.size(), flags);
+
+		// Only what was read contiguously from the start counts, same as a single short read.
+		size_t readBytes = 0;
+		for (const ReadRequest &req : requests) {
+			if (req.result > req.bytes)
+				break;
+			readBytes += req.result;
+			if (req.result != req.bytes)
+				break;
+		}
+		return readBytes / bytes;
+	}
+#endif
+
+	return ReadDirect(absolutePos, bytes, count, data);
+}
+
+void LocalFileLoader::ReadAtBatch(ReadRequest *requests, size_t count, Flags flags) {
+#ifdef LOCAL_FILE_CONCURRENT_READS
+	const size_t queueDepth = std::min(count, (size_t)std::max(1, g_Config.iFileReadQueueDepth));
+	if (queueDepth > 1 && g_threadManager.IsInitialized()) {
+		struct BatchState {
+			std::function<void(size_t)> read;
+			size_t count = 0;
+			std::atomic<size_t> next{};
+			std::mutex mutex;
+			std::condition_variable cond;
+			size_t finished = 0;
+
+			// Claims requests until none are left. Helpers that start late find nothing to do.
+			void Work() {
+				size_t done = 0;
+				for (size_t i = next++; i < count; i = next++) {
+					read(i);
+					done++;
+				}
+				if (done != 0) {
+					std::lock_guard<std::mutex> guard(mutex);
+					finished += done;
+					if (finished == count)
+						cond.notify_all();
+				}
+			}
+		};
+
+		auto state = std::make_shared<BatchState>();
+		state->read = [this, requests](size_t i) {
+			requests[i].result = ReadDirect(requests[i].absolutePos, 1, requests[i].bytes, requests[i].data);
+		};
+		state->count = count;
+
+		// The caller reads too, and then only waits for requests that are already being read.
+		// So this can't deadlock even when called from an I/O thread while the others are busy.
+		for (size_t i = 1; i < queueDepth; ++i) {
+			g_threadManager.EnqueueTask(new IndependentTask(TaskType::IO_BLOCKING, TaskPriority::HIGH, [state]() {
+				state->Work();
+			}));
+		}
+		state->Work();
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->cond.wait(lock, [&] { return state->finished == state->count; });
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < count; ++i) {
+		requests[i].result = ReadDirect(requests[i].absolutePos, 1, requests[i].bytes, requests[i].data);
+	}
+}
+
+size_t LocalFileLoader::ReadDirect(s64 absolutePos, size_t bytes, size_t count, void *data) {
 #if defined(HAVE_LIBRETRO_VFS)
     std::lock_guard<std::mutex> guard(readLock_);
 	filestream_seek(handle_, absolutePos, RETRO_VFS_SEEK_POSITION_START);
@@ -215,3 +391,57 @@ size_t LocalFileLoader::ReadAt(s64 absolutePos, size_t bytes, size_t count, void
 	return result == TRUE ? (size_t)read / bytes : -1;
 #endif
 }
+
+const u8 *LocalFileLoader::MapReadOnly() {
+	std::lock_guard<std::mutex> guard(mapLock_);
+	if (triedMap_)
+		return mapped_;
+	triedMap_ = true;
+	if (filesize_ == 0 || filesize_ > (u64)SIZE_MAX)
+		return nullptr;
+
+#if defined(LOCAL_FILE_MMAP) && !defined(_WIN32)
+	if (fd_ != -1 && !isOpenedByFd_ && !IsOnFixedLocalDisk(fd_)) {
+		INFO_LOG(Log::FileSystem, "Not mapping %s, it's not on a fixed local disk", filename_.c_str());
+	} else if (fd_ != -1 && !isOpenedByFd_) {
+		void *ptr = mmap(nullptr, (size_t)filesize_, PROT_READ, MAP_SHARED, fd_, 0);
+		if (ptr != MAP_FAILED) {
+			mapped_ = (const u8 *)ptr;
+		} else {
+			WARN_LOG(Log::FileSystem, "Couldn't map %s: %s", filename_.c_str(), GetLastErrorMsg().c_str());
+		}
+	}
+#elif defined(LOCAL_FILE_MMAP)
+	if (handle_ != INVALID_HANDLE_VALUE && handle_ != nullptr && !IsOnFixedLocalDisk(filename_)) {
+		INFO_LOG(Log::FileSystem, "Not mapping %s, it's not on a fixed local disk", filename_.c_str());
+	} else if (handle_ != INVALID_HANDLE_VALUE && handle_ != nullptr) {
+		HANDLE mapping = CreateFileMapping(handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping) {
+			void *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (ptr) {
+				mapped_ = (const u8 *)ptr;
+				mapHandle_ = (void *)mapping;
+			} else {
+				CloseHandle(mapping);
+			}
+		}
+		if (!mapped_) {
+			WARN_LOG(Log::FileSystem, "Couldn't map %s: %s", filename_.c_str(), GetLastErrorMsg().c_str());
+		}
+	}
+#endif
+	return mapped_;
+}
+
+void LocalFileLoader::Unmap() {
+	if (!mapped_)
+		return;
+#if defined(LOCAL_FILE_MMAP) && !defined(_WIN32)
+	munmap((void *)mapped_, (size_t)filesize_);
+#elif defined(LOCAL_FILE_MMAP)
+	UnmapViewOfFile(mapped_);
+	CloseHandle((HANDLE)mapHandle_);
+	mapHandle_ = nullptr;
+#endif
+	mapped_ = nullptr;
+}
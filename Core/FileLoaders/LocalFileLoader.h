@@ -45,8 +45,12 @@ class LocalFileLoader : public FileLoader {
 		return filename_;
 	}
 	size_t ReadAt(s64 absolutePos, size_t bytes, size_t count, void *data, Flags flags = Flags::NONE) override;
+	void ReadAtBatch(ReadRequest *requests, size_t count, Flags flags = Flags::NONE) override;
+	const u8 *MapReadOnly() override;
 
 private:
+	size_t ReadDirect(s64 absolutePos, size_t bytes, size_t count, void *data);
+	void Unmap();
 #if !defined(_WIN32) && !defined(HAVE_LIBRETRO_VFS)
 	void DetectSizeFd();
 	int fd_ = -1;
@@ -57,4 +61,9 @@ class LocalFileLoader : public FileLoader {
 	Path filename_;
 	std::mutex readLock_;
 	bool isOpenedByFd_ = false;
+
+	std::mutex mapLock_;
+	const u8 *mapped_ = nullptr;
+	bool triedMap_ = false;
+	void *mapHandle_ = nullptr;  // The file mapping object, on Windows.
 };
@@ -4,6 +4,11 @@
 #include "ext/libzip/zip.h"
 #endif
 
+#include <algorithm>
+#include <cstring>
+
+#include "zlib.h"
+
 #include "Core/FileLoaders/LocalFileLoader.h"
 #include "Core/FileLoaders/ZipFileLoader.h"
 
@@ -31,19 +36,20 @@ ZipFileLoader::ZipFileLoader(FileLoader *sourceLoader)
 }
 
 ZipFileLoader::~ZipFileLoader() {
+	if (zstream_) {
+		inflateEnd(zstream_);
+		delete zstream_;
+	}
 	if (dataFile_) {
 		zip_fclose(dataFile_);
 	}
 	if (zipArchive_) {
 		zip_discard(zipArchive_);
 	}
-	if (data_) {
-		free(data_);
-	}
 }
 
 bool ZipFileLoader::Initialize(int fileIndex) {
-	_dbg_assert_(!data_);
+	_dbg_assert_(!dataFile_);
 
 	struct zip_stat zstat;
 	int retval = zip_stat_index(zipArchive_, fileIndex, ZIP_FL_NOCASE | ZIP_FL_UNCHANGED, &zstat);
@@ -54,36 +60,228 @@ bool ZipFileLoader::Initialize(int fileIndex) {
 	fileExtension_ = KeepIncludingLast(name, '.');
 
 	_dbg_assert_(zstat.index == fileIndex);
+	fileIndex_ = fileIndex;
 	dataFileSize_ = zstat.size;
-	dataFile_ = zip_fopen_index(zipArchive_, zstat.index, ZIP_FL_UNCHANGED);
-	data_ = (u8 *)malloc(dataFileSize_);
-	return data_ != nullptr;
+
+	const bool encrypted = (zstat.valid & ZIP_STAT_ENCRYPTION_METHOD) != 0 && zstat.encryption_method != ZIP_EM_NONE;
+	mode_ = DataMode::STREAM;
+	if (!encrypted && (zstat.valid & ZIP_STAT_COMP_METHOD) != 0) {
+		if (zstat.comp_method == ZIP_CM_STORE) {
+			mode_ = DataMode::STORED;
+		} else if (zstat.comp_method == ZIP_CM_DEFLATE) {
+			mode_ = DataMode::INFLATE;
+		}
+	}
+
+	if (mode_ == DataMode::INFLATE) {
+		// Take the raw deflate stream, and inflate it ourselves.
+		dataFile_ = zip_fopen_index(zipArchive_, zstat.index, ZIP_FL_UNCHANGED | ZIP_FL_COMPRESSED);
+		if (dataFile_) {
+			zstream_ = new z_stream{};
+			if (inflateInit2(zstream_, -MAX_WBITS) != Z_OK) {
+				delete zstream_;
+				zstream_ = nullptr;
+				zip_fclose(dataFile_);
+				dataFile_ = nullptr;
+			} else {
+				inBuffer_.resize(BLOCK_SIZE);
+			}
+		}
+		if (!dataFile_) {
+			mode_ = DataMode::STREAM;
+		}
+	}
+	if (!dataFile_) {
+		dataFile_ = zip_fopen_index(zipArchive_, zstat.index, ZIP_FL_UNCHANGED);
+	}
+	if (dataFile_ && mode_ == DataMode::STORED && zip_fseek(dataFile_, 0, SEEK_SET) != 0) {
+		// Shouldn't happen since our source can seek, but just in case.
+		mode_ = DataMode::STREAM;
+	}
+	return dataFile_ != nullptr;
 }
 
 size_t ZipFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, Flags flags) {
+	std::lock_guard<std::mutex> guard(lock_);
 	if (!dataFile_ || absolutePos < 0 || absolutePos >= dataFileSize_) {
 		return 0;
 	}
 
 	if (absolutePos + (s64)bytes > dataFileSize_) {
-		// TODO: This could go negative..
-		bytes = dataFileSize_ - absolutePos;
+		bytes = (size_t)(dataFileSize_ - absolutePos);
+	}
+
+	if (mode_ == DataMode::STORED) {
+		return ReadStored(absolutePos, bytes, data);
 	}
 
-	// Decompress until the requested point, filling up data_ as we go. TODO: Do on thread.
-	while (dataReadPos_ < absolutePos + (s64)bytes) {
-		int remaining = BLOCK_SIZE;
-		if (dataReadPos_ + remaining > dataFileSize_) {
-			remaining = (int)(dataFileSize_ - dataReadPos_);
+	u8 *out = (u8 *)data;
+	size_t done = 0;
+	while (done < bytes) {
+		s64 pos = absolutePos + (s64)done;
+		if (pos >= bufferStart_ && pos < dataReadPos_) {
+			size_t chunk = (size_t)std::min((s64)(bytes - done), dataReadPos_ - pos);
+			memcpy(out + done, &buffer_[(size_t)(pos - bufferStart_)], chunk);
+			done += chunk;
+			continue;
 		}
-		zip_int64_t retval = zip_fread(dataFile_, data_ + dataReadPos_, remaining);
-		_dbg_assert_(retval == remaining);
-		dataReadPos_ += retval;
+		if (!RestartAt(pos) || !DecompressMore()) {
+			ERROR_LOG(Log::IO, "Failed to decompress %s at %lld", fileExtension_.c_str(), (long long)pos);
+			break;
+		}
+	}
+	return done;
+}
+
+size_t ZipFileLoader::ReadStored(s64 absolutePos, size_t bytes, void *data) {
+	if (zip_fseek(dataFile_, absolutePos, SEEK_SET) != 0) {
+		return 0;
+	}
+	zip_int64_t retval = zip_fread(dataFile_, data, bytes);
+	return retval < 0 ? 0 : (size_t)retval;
+}
+
+bool ZipFileLoader::RestartAt(s64 pos) {
+	// Going on from where we are is fine if it's not too far.
+	if (pos >= dataReadPos_ && pos < dataReadPos_ + CHECKPOINT_SPAN) {
+		return true;
+	}
+
+	// Find the last checkpoint at or before pos.
+	auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), pos, [](s64 p, const Checkpoint &cp) {
+		return p < cp.out;
+	});
+	if (it == checkpoints_.begin()) {
+		// Before the first checkpoint, only the start will do.
+		if (pos >= dataReadPos_) {
+			return true;
+		}
+		return RestartFromStart();
+	}
+	const Checkpoint &cp = *(it - 1);
+	if (pos >= dataReadPos_ && dataReadPos_ >= cp.out) {
+		// We're already past it.
+		return true;
+	}
+
+	_dbg_assert_(mode_ == DataMode::INFLATE);
+	inflateReset(zstream_);
+	s64 in = cp.in - (cp.bits ? 1 : 0);
+	if (zip_fseek(dataFile_, in, SEEK_SET) != 0) {
+		return false;
+	}
+	compressedPos_ = in;
+	zstream_->avail_in = 0;
+	if (cp.bits) {
+		u8 c;
+		if (zip_fread(dataFile_, &c, 1) != 1) {
+			return false;
+		}
+		compressedPos_++;
+		inflatePrime(zstream_, cp.bits, c >> (8 - cp.bits));
+	}
+	if (!cp.window.empty()) {
+		inflateSetDictionary(zstream_, cp.window.data(), (uInt)cp.window.size());
+	}
+	buffer_ = cp.window;
+	bufferStart_ = cp.out - (s64)cp.window.size();
+	dataReadPos_ = cp.out;
+	return true;
+}
+
+bool ZipFileLoader::RestartFromStart() {
+	if (mode_ == DataMode::INFLATE) {
+		inflateReset(zstream_);
+		if (zip_fseek(dataFile_, 0, SEEK_SET) != 0) {
+			return false;
+		}
+		zstream_->avail_in = 0;
+		compressedPos_ = 0;
+	} else {
+		// No way to seek in what libzip decompresses, so open it again.
+		zip_fclose(dataFile_);
+		dataFile_ = zip_fopen_index(zipArchive_, fileIndex_, ZIP_FL_UNCHANGED);
+		if (!dataFile_) {
+			return false;
+		}
+	}
+	buffer_.clear();
+	bufferStart_ = 0;
+	dataReadPos_ = 0;
+	return true;
+}
+
+bool ZipFileLoader::DecompressMore() {
+	if (dataReadPos_ >= dataFileSize_) {
+		return false;
+	}
+
+	// Throw away old data, but keep enough to make a checkpoint with.
+	if (buffer_.size() >= MAX_BUFFER_SIZE) {
+		size_t drop = buffer_.size() - MAX_BUFFER_SIZE / 2;
+		buffer_.erase(buffer_.begin(), buffer_.begin() + drop);
+		bufferStart_ += (s64)drop;
+	}
+
+	const size_t oldSize = buffer_.size();
+	buffer_.resize(oldSize + BLOCK_SIZE);
+	size_t produced = 0;
+
+	if (mode_ == DataMode::STREAM) {
+		zip_int64_t retval = zip_fread(dataFile_, &buffer_[oldSize], BLOCK_SIZE);
+		produced = retval < 0 ? 0 : (size_t)retval;
+	} else {
+		zstream_->next_out = &buffer_[oldSize];
+		zstream_->avail_out = BLOCK_SIZE;
+		while (zstream_->avail_out != 0) {
+			if (zstream_->avail_in == 0) {
+				zip_int64_t retval = zip_fread(dataFile_, inBuffer_.data(), inBuffer_.size());
+				if (retval <= 0) {
+					break;
+				}
+				compressedPos_ += retval;
+				zstream_->next_in = inBuffer_.data();
+				zstream_->avail_in = (uInt)retval;
+			}
+			int ret = inflate(zstream_, Z_BLOCK);
+			if (ret == Z_STREAM_END) {
+				break;
+			} else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+				ERROR_LOG(Log::IO, "Inflate failed in zip: %d", ret);
+				break;
+			}
+			// Between deflate blocks (but not after the last one), decompression can be picked up again later.
+			if ((zstream_->data_type & 128) != 0 && (zstream_->data_type & 64) == 0) {
+				s64 out = dataReadPos_ + (s64)(BLOCK_SIZE - zstream_->avail_out);
+				AddCheckpoint(out, zstream_->data_type & 7);
+			}
+		}
+		produced = BLOCK_SIZE - zstream_->avail_out;
+	}
+
+	buffer_.resize(oldSize + produced);
+	dataReadPos_ += (s64)produced;
+	return produced != 0;
+}
+
+void ZipFileLoader::AddCheckpoint(s64 out, int bits) {
+	s64 last = checkpoints_.empty() ? 0 : checkpoints_.back().out;
+	if (out < last + CHECKPOINT_SPAN) {
+		return;
+	}
+	// Need the window right before out.
+	size_t end = (size_t)(out - bufferStart_);
+	if (bufferStart_ != 0 && end < WINDOW_SIZE) {
+		return;
 	}
+	size_t start = end > WINDOW_SIZE ? end - WINDOW_SIZE : 0;
 
-	// Perform the read.
-	memcpy(data, data_ + absolutePos, bytes);
-	return bytes;
+	Checkpoint cp;
+	cp.out = out;
+	cp.in = compressedPos_ - zstream_->avail_in;
+	cp.bits = bits;
+	cp.window.assign(buffer_.begin() + start, buffer_.begin() + end);
+	checkpoints_.push_back(std::move(cp));
 }
 
 zip_int64_t ZipFileLoader::ZipSourceCallback(void *data, zip_uint64_t len, zip_source_cmd_t cmd) {
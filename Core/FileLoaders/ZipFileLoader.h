@@ -1,6 +1,7 @@
 #pragma once
 
 #include <mutex>
+#include <vector>
 
 #ifdef SHARED_LIBZIP
 #include <zip.h>
@@ -14,8 +15,12 @@
 #include "Common/StringUtils.h"
 #include "Core/Loaders.h"
 
+struct z_stream_s;
+
 // Exposes a single (chosen) file from a zip file as another file loader.
 // Useful in a bunch of possible chains.
+// Stored files are read directly. Deflated files are inflated here rather than by libzip, so that
+// checkpoints can be left along the way, allowing random reads to restart close to where they are.
 class ZipFileLoader : public ProxiedFileLoader {
 public:
 	ZipFileLoader(FileLoader *sourceLoader);
@@ -55,15 +60,55 @@ class ZipFileLoader : public ProxiedFileLoader {
 private:
 	zip_int64_t ZipSourceCallback(void* data, zip_uint64_t len, zip_source_cmd_t cmd);
 
+	size_t ReadStored(s64 absolutePos, size_t bytes, void *data);
+	// Restarts decompression from the closest point before pos, if that's better than going on.
+	bool RestartAt(s64 pos);
+	bool RestartFromStart();
+	// Decompresses the next BLOCK_SIZE bytes or so into buffer_.
+	bool DecompressMore();
+	void AddCheckpoint(s64 out, int bits);
+
 	enum {
 		BLOCK_SIZE = 65536,
+		// Roughly how far apart checkpoints are, in uncompressed bytes. Also the most we'll decompress
+		// and throw away to get to a read, rather than restarting.
+		CHECKPOINT_SPAN = 2 * 1024 * 1024,
+		// Deflate refers back up to this far, so a checkpoint needs this much history to restart.
+		WINDOW_SIZE = 32768,
+		// Recently decompressed data kept around, for reads that go back a little.
+		MAX_BUFFER_SIZE = 2 * 1024 * 1024,
+	};
+
+	enum class DataMode {
+		STORED,
+		INFLATE,
+		// Anything else libzip can decompress. Can only read forward, so seeking back starts over.
+		STREAM,
+	};
+
+	struct Checkpoint {
+		s64 out;  // Uncompressed position.
+		s64 in;  // Compressed position after the last whole byte used.
+		int bits;  // Bits of the byte before in that are still unused.
+		std::vector<u8> window;  // The WINDOW_SIZE bytes before out (or everything, near the start.)
 	};
+
 	zip_t *zipArchive_ = nullptr;
 	s64 zipReadPos_ = 0;
 
-	zip_file_t *dataFile_ = nullptr;
-	uint8_t *data_ = nullptr;  // malloc/free
-	s64 dataReadPos_ = 0;
+	std::mutex lock_;
+	int fileIndex_ = -1;
+	DataMode mode_ = DataMode::STREAM;
+	zip_file_t *dataFile_ = nullptr;  // Raw deflate data in INFLATE mode.
 	s64 dataFileSize_ = 0;
 	std::string fileExtension_;
+
+	z_stream_s *zstream_ = nullptr;
+	std::vector<u8> inBuffer_;
+	s64 compressedPos_ = 0;  // How far into dataFile_ we've read, in INFLATE mode.
+	// Decompressed data, covering [bufferStart_, dataReadPos_).
+	std::vector<u8> buffer_;
+	s64 bufferStart_ = 0;
+	s64 dataReadPos_ = 0;
+	std::vector<Checkpoint> checkpoints_;
 };
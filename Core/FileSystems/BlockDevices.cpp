@@ -15,9 +15,15 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include "ppsspp_config.h"
+
 #include <algorithm>
 #include <cstring>
 
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
 #include "Common/Data/Text/I18n.h"
 #include "Common/System/OSD.h"
 #include "Common/Log.h"
@@ -25,9 +31,14 @@
 #include "Common/File/FileUtil.h"
 #include "Common/File/DirListing.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ParallelLoop.h"
+#include "Common/TimeUtil.h"
+#include "Core/Config.h"
 #include "Core/Loaders.h"
+#include "Core/FileLoaders/LocalFileLoader.h"
 #include "Core/FileSystems/BlockDevices.h"
 #include "libchdr/chd.h"
+#include "ext/xxhash.h"
 
 extern "C"
 {
@@ -92,14 +103,51 @@ void BlockDevice::NotifyReadError() {
 	}
 }
 
+// When reads stream through the file, ask the OS to fetch this much further ahead of the mapping.
+static const u64 MAPPED_READAHEAD_BYTES = 1024 * 1024;
+
 FileBlockDevice::FileBlockDevice(FileLoader *fileLoader)
 	: BlockDevice(fileLoader) {
 	filesize_ = fileLoader->FileSize();
+	if (g_Config.bMemoryMapIsoFiles) {
+		mapped_ = fileLoader->MapReadOnly();
+		if (mapped_)
+			INFO_LOG(Log::FileSystem, "Reading %s through a memory mapping", fileLoader->GetPath().c_str());
+	}
 }
 
 FileBlockDevice::~FileBlockDevice() {}
 
+const u8 *FileBlockDevice::GetBlockPointer(u32 minBlock, int count) {
+	if (!mapped_ || count < 0 || (u64)minBlock + (u64)count > (u64)GetNumBlocks())
+		return nullptr;
+	return mapped_ + (u64)minBlock * (u64)GetBlockSize();
+}
+
+void FileBlockDevice::HintSequential(u32 minBlock, int count) {
+	u32 prevNext = nextBlock_.exchange(minBlock + count, std::memory_order_relaxed);
+	if (prevNext != minBlock)
+		return;
+
+#if !defined(_WIN32) && defined(MADV_WILLNEED)
+	// Only page aligned ranges can be advised. The mapping itself starts on a page.
+	const u64 align = 64 * 1024;
+	u64 start = ((u64)(minBlock + count) * (u64)GetBlockSize()) & ~(align - 1);
+	u64 end = std::min(start + MAPPED_READAHEAD_BYTES, filesize_);
+	if (end > start)
+		madvise((void *)(mapped_ + start), (size_t)(end - start), MADV_WILLNEED);
+#endif
+}
+
 bool FileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr, bool uncached) {
+	if (blockNumber >= 0) {
+		const u8 *src = GetBlockPointer((u32)blockNumber, 1);
+		if (src) {
+			memcpy(outPtr, src, 2048);
+			return true;
+		}
+	}
+
 	FileLoader::Flags flags = uncached ? FileLoader::Flags::HINT_UNCACHED : FileLoader::Flags::NONE;
 	size_t retval = fileLoader_->ReadAt((u64)blockNumber * (u64)GetBlockSize(), 1, 2048, outPtr, flags);
 	if (retval != 2048) {
@@ -110,6 +158,13 @@ bool FileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr, bool uncached) {
 }
 
 bool FileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr) {
+	const u8 *src = GetBlockPointer(minBlock, count);
+	if (src) {
+		HintSequential(minBlock, count);
+		memcpy(outPtr, src, (size_t)count * 2048);
+		return true;
+	}
+
 	size_t retval = fileLoader_->ReadAt((u64)minBlock * (u64)GetBlockSize(), 2048, count, outPtr);
 	if (retval != (size_t)count) {
 		ERROR_LOG(Log::FileSystem, "Could not read %d blocks, at block offset %d. Only got %d blocks", count, minBlock, (int)retval);
@@ -400,6 +455,170 @@ bool CISOFileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr) {
 	return true;
 }
 
+// How much is read and compressed at a time.
+static const u32 CSO_WRITE_BATCH_SIZE = 4 * 1024 * 1024;
+
+static bool VerifyCISOFile(const Path &filename, u32 numBlocks, u32 blocksPerBatch, const std::vector<u64> &hashes, std::string *errorString) {
+	LocalFileLoader loader(filename);
+	CISOFileBlockDevice device(&loader);
+	if (!device.IsOK()) {
+		*errorString = "Written CSO can't be opened: " + device.ErrorString();
+		return false;
+	}
+	if (device.GetNumBlocks() != numBlocks) {
+		*errorString = StringFromFormat("Written CSO has %d blocks, expected %d", device.GetNumBlocks(), numBlocks);
+		return false;
+	}
+
+	std::vector<u8> buffer((size_t)blocksPerBatch * device.GetBlockSize());
+	for (size_t i = 0; i < hashes.size(); i++) {
+		const u32 firstBlock = (u32)i * blocksPerBatch;
+		const u32 blocks = std::min(blocksPerBatch, numBlocks - firstBlock);
+		if (!device.ReadBlocks(firstBlock, (int)blocks, buffer.data()) || XXH3_64bits(buffer.data(), (size_t)blocks * device.GetBlockSize()) != hashes[i]) {
+			*errorString = StringFromFormat("Written CSO differs from the source around block %d", firstBlock);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool WriteCISOFile(BlockDevice *source, const Path &filename, const CISOWriteOptions &options, CISOWriteStats *stats, std::string *errorString) {
+	const double startTime = time_now_d();
+	const u32 frameSize = options.frameSize;
+	const u32 blockSize = (u32)source->GetBlockSize();
+	if ((frameSize & (frameSize - 1)) != 0 || frameSize < blockSize || frameSize > CSO_WRITE_BATCH_SIZE) {
+		*errorString = StringFromFormat("CSO block size %d unsupported", frameSize);
+		return false;
+	}
+	// deflateInit2 would just fail, and every frame would silently be stored uncompressed.
+	if (options.level < 1 || options.level > 9) {
+		*errorString = StringFromFormat("CSO compression level %d unsupported, must be 1-9", options.level);
+		return false;
+	}
+
+	const u32 numBlocks = source->GetNumBlocks();
+	const u32 blocksPerFrame = frameSize / blockSize;
+	const u64 totalBytes = (u64)numBlocks * blockSize;
+	const u32 numFrames = (u32)((totalBytes + frameSize - 1) / frameSize);
+	const u64 dataStart = sizeof(CISO_H) + ((u64)numFrames + 1) * sizeof(u32);
+
+	// Index positions only have 31 bits, so large images need aligned frames. Assume nothing compresses.
+	u8 align = 0;
+	while (((dataStart + (u64)numFrames * (frameSize + (1ULL << align))) >> align) >= 0x80000000ULL)
+		align++;
+	const u64 alignMask = (1ULL << align) - 1;
+
+	FILE *out = File::OpenCFile(filename, "wb");
+	if (!out) {
+		*errorString = "Could not create " + filename.ToVisualString();
+		return false;
+	}
+
+	CISO_H hdr{};
+	memcpy(hdr.magic, "CISO", 4);
+	hdr.header_size = sizeof(CISO_H);
+	hdr.total_bytes = totalBytes;
+	hdr.block_size = frameSize;
+	hdr.ver = 1;
+	hdr.align = align;
+
+	// The index goes in once all the frames are written.
+	std::vector<u32_le> index(numFrames + 1);
+	bool success = fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+	success = success && fwrite(index.data(), sizeof(u32_le), index.size(), out) == index.size();
+
+	const u32 framesPerBatch = CSO_WRITE_BATCH_SIZE / frameSize;
+	const u32 blocksPerBatch = framesPerBatch * blocksPerFrame;
+	std::vector<u8> input((size_t)framesPerBatch * frameSize);
+	std::vector<std::vector<u8>> compressed(framesPerBatch);
+	std::vector<u64> hashes;
+	const u8 padding[16]{};
+	u64 pos = dataStart;
+
+	for (u32 frame = 0; frame < numFrames && success; frame += framesPerBatch) {
+		const u32 count = std::min(framesPerBatch, numFrames - frame);
+		const u32 firstBlock = frame * blocksPerFrame;
+		const u32 blocks = std::min(count * blocksPerFrame, numBlocks - firstBlock);
+
+		double readStart = time_now_d();
+		// The last frame is padded with zeroes, inflate always expects a whole frame.
+		memset(input.data() + (size_t)blocks * blockSize, 0, input.size() - (size_t)blocks * blockSize);
+		if (!source->ReadBlocks(firstBlock, (int)blocks, input.data())) {
+			*errorString = StringFromFormat("Could not read block %d of the source", firstBlock);
+			success = false;
+			break;
+		}
+		hashes.push_back(XXH3_64bits(input.data(), (size_t)blocks * blockSize));
+		stats->readSeconds += time_now_d() - readStart;
+
+		double compressStart = time_now_d();
+		ParallelRangeLoop(&g_threadManager, [&](int lower, int upper) {
+			z_stream z{};
+			bool ready = deflateInit2(&z, options.level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+			for (int i = lower; i < upper; i++) {
+				std::vector<u8> &buf = compressed[i];
+				// Empty means it's stored as is.
+				buf.clear();
+				if (!ready)
+					continue;
+				buf.resize(deflateBound(&z, frameSize));
+				z.next_in = input.data() + (size_t)i * frameSize;
+				z.avail_in = frameSize;
+				z.next_out = buf.data();
+				z.avail_out = (uInt)buf.size();
+				if (deflate(&z, Z_FINISH) == Z_STREAM_END && z.total_out < frameSize)
+					buf.resize(z.total_out);
+				else
+					buf.clear();
+				deflateReset(&z);
+			}
+			if (ready)
+				deflateEnd(&z);
+		}, 0, (int)count, 16);
+		stats->compressSeconds += time_now_d() - compressStart;
+
+		for (u32 i = 0; i < count && success; i++) {
+			const bool plain = compressed[i].empty();
+			const u8 *data = plain ? input.data() + (size_t)i * frameSize : compressed[i].data();
+			const size_t size = plain ? frameSize : compressed[i].size();
+			index[frame + i] = (u32)(pos >> align) | (plain ? 0x80000000 : 0);
+			success = fwrite(data, 1, size, out) == size;
+			pos += size;
+			while (success && (pos & alignMask) != 0) {
+				size_t padSize = (size_t)std::min((u64)sizeof(padding), alignMask + 1 - (pos & alignMask));
+				success = fwrite(padding, 1, padSize, out) == padSize;
+				pos += padSize;
+			}
+			if (plain)
+				stats->plainFrames++;
+		}
+	}
+	index[numFrames] = (u32)(pos >> align);
+
+	success = success && fseek(out, sizeof(hdr), SEEK_SET) == 0;
+	success = success && fwrite(index.data(), sizeof(u32_le), index.size(), out) == index.size();
+	success = fclose(out) == 0 && success;
+	if (!success) {
+		if (errorString->empty())
+			*errorString = "Failed writing " + filename.ToVisualString();
+		File::Delete(filename);
+		return false;
+	}
+
+	stats->inputBytes = totalBytes;
+	stats->outputBytes = pos;
+	stats->frames = numFrames;
+
+	if (options.verify) {
+		double verifyStart = time_now_d();
+		if (!VerifyCISOFile(filename, numBlocks, blocksPerBatch, hashes, errorString))
+			return false;
+		stats->verifySeconds = time_now_d() - verifyStart;
+	}
+	stats->totalSeconds = time_now_d() - startTime;
+	return true;
+}
+
 NPDRMDemoBlockDevice::NPDRMDemoBlockDevice(FileLoader *fileLoader)
 	: BlockDevice(fileLoader)
 {
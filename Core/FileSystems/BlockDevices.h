@@ -23,6 +23,7 @@
 // The ISOFileSystemReader reads from a BlockDevice, so it automatically works
 // with CISO images.
 
+#include <atomic>
 #include <mutex>
 #include <memory>
 
@@ -52,6 +53,11 @@ class BlockDevice {
 		return (u64)GetNumBlocks() * (u64)GetBlockSize();
 	}
 	virtual bool IsDisc() const = 0;
+	// Points straight at count blocks, if the device can do that without a copy, otherwise nullptr.
+	// Valid for as long as the device.
+	virtual const u8 *GetBlockPointer(u32 minBlock, int count) {
+		return nullptr;
+	}
 
 	void NotifyReadError();
 
@@ -88,6 +94,7 @@ class CISOFileBlockDevice : public BlockDevice {
 };
 
 
+// Plain ISOs. If the file loader can map the file, reads are served from the mapping.
 class FileBlockDevice : public BlockDevice {
 public:
 	FileBlockDevice(FileLoader *fileLoader);
@@ -99,8 +106,15 @@ class FileBlockDevice : public BlockDevice {
 	u64 GetUncompressedSize() const override {
 		return filesize_;
 	}
+	const u8 *GetBlockPointer(u32 minBlock, int count) override;
+
 private:
+	void HintSequential(u32 minBlock, int count);
+
 	u64 filesize_;
+	const u8 *mapped_ = nullptr;
+	// Where the last ReadBlocks ended, to spot streaming reads.
+	std::atomic<u32> nextBlock_{ 0 };
 };
 
 
@@ -169,3 +183,27 @@ class CHDFileBlockDevice : public BlockDevice {
 };
 
 BlockDevice *ConstructBlockDevice(FileLoader *fileLoader, std::string *errorString);
+
+class Path;
+
+struct CISOWriteOptions {
+	// Uncompressed bytes per frame, a power of two of at least one sector.
+	u32 frameSize = 0x800;
+	int level = 9;
+	// Read the result back through CISOFileBlockDevice and compare.
+	bool verify = true;
+};
+
+struct CISOWriteStats {
+	u64 inputBytes = 0;
+	u64 outputBytes = 0;
+	u32 frames = 0;
+	u32 plainFrames = 0;
+	double readSeconds = 0.0;
+	double compressSeconds = 0.0;
+	double verifySeconds = 0.0;
+	double totalSeconds = 0.0;
+};
+
+// Writes all of source out as a CSO (v1, raw deflate frames). Frames are compressed on the thread manager.
+bool WriteCISOFile(BlockDevice *source, const Path &filename, const CISOWriteOptions &options, CISOWriteStats *stats, std::string *errorString);
@@ -31,6 +31,8 @@
 #include "Common/File/DiskFree.h"
 #include "Common/File/VFS/VFS.h"
 #include "Common/SysError.h"
+#include "Common/TimeUtil.h"
+#include "Core/Config.h"
 #include "Core/FileSystems/DirectoryFileSystem.h"
 #include "Core/HLE/sceKernel.h"
 #include "Core/HW/MemoryStick.h"
@@ -42,6 +44,7 @@
 
 #ifdef _WIN32
 #include "Common/CommonWindows.h"
+#include <io.h>
 #include <sys/stat.h>
 #if PPSSPP_PLATFORM(UWP)
 #include <fileapifromapp.h>
@@ -62,6 +65,14 @@
 #include <fcntl.h>
 #endif
 
+// With write-back enabled, writes up to this size are collected, up to a buffer of this size per file.
+static const s64 WRITE_BACK_MAX_WRITE = 64 * 1024;
+static const size_t WRITE_BACK_BUFFER_SIZE = 256 * 1024;
+// Buffered writes older than this (in seconds) get written out at the next check.
+static const double WRITE_BACK_TIMEOUT = 1.0;
+// Larger savedata files are just written in place.
+static const s64 ATOMIC_MAX_FILE_SIZE = 16 * 1024 * 1024;
+
 DirectoryFileSystem::DirectoryFileSystem(IHandleAllocator *_hAlloc, const Path & _basePath, FileSystemFlags _flags) : basePath(_basePath), flags(_flags) {
 	File::CreateFullPath(basePath);
 
@@ -134,6 +145,16 @@ bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, File
 		return false;
 	}
 
+	// Handles can be reused, so nothing buffered from before should carry over.
+	writeBuffer_.clear();
+	writeBufferPos_ = 0;
+	writeBufferTime_ = 0.0;
+	atomicPath_.clear();
+	atomicSeekPos_ = 0;
+	atomicDirty_ = false;
+	// Appends always go to the end of the file, wherever the write buffer thinks it is.
+	append_ = (access & FILEACCESS_APPEND) != 0;
+
 	if (fileSystemFlags_ & FileSystemFlags::CASE_SENSITIVE) {
 		if (access & (FILEACCESS_APPEND | FILEACCESS_CREATE | FILEACCESS_WRITE)) {
 			DEBUG_LOG(Log::FileSystem, "Checking case for path %s", fileName.c_str());
@@ -319,12 +340,27 @@ bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, File
 		MemoryStick_NotifyWrite();
 	}
 
+	// Savedata that's being rewritten (not read) is kept in memory and replaced in one go.
+	if (success && writeBack_ && !append_ && (access & FILEACCESS_WRITE) && (access & FILEACCESS_TRUNCATE) && !(access & FILEACCESS_READ) && fullName.Type() == PathType::NATIVE) {
+		std::string guestPath = fileName;
+		if (!guestPath.empty() && guestPath[0] == '/')
+			guestPath.erase(0, 1);
+		if (startsWithNoCase(guestPath, "PSP/SAVEDATA/")) {
+			OpenAtomic(fullName);
+		}
+	}
+
 	return success;
 }
 
 size_t DirectoryFileHandle::Read(u8* pointer, s64 size)
 {
 	size_t bytesRead = 0;
+	if (!atomicPath_.empty()) {
+		// Only write-only files are kept in memory, so there's nothing to read.
+		return replay_ ? ReplayApplyDiskRead(pointer, 0, (uint32_t)size, inGameDir_, CoreTiming::GetGlobalTimeUs()) : 0;
+	}
+	FlushWrites();
 	if (needsTrunc_ != -1) {
 		// If the file was marked to be truncated, pretend there's nothing.
 		// On a PSP. it actually is truncated, but the data wasn't erased.
@@ -346,25 +382,80 @@ size_t DirectoryFileHandle::Read(u8* pointer, s64 size)
 	return replay_ ? ReplayApplyDiskRead(pointer, (uint32_t)bytesRead, (uint32_t)size, inGameDir_, CoreTiming::GetGlobalTimeUs()) : bytesRead;
 }
 
-size_t DirectoryFileHandle::Write(const u8* pointer, s64 size)
-{
-	size_t bytesWritten = 0;
+bool DirectoryFileHandle::WriteHandle(const u8 *pointer, s64 size, size_t *bytesWritten) {
 	bool diskFull = false;
-
 #ifdef _WIN32
-	BOOL success = ::WriteFile(hFile, (LPVOID)pointer, (DWORD)size, (LPDWORD)&bytesWritten, 0);
+	DWORD written = 0;
+	BOOL success = ::WriteFile(hFile, (LPVOID)pointer, (DWORD)size, &written, 0);
+	*bytesWritten = written;
 	if (success == FALSE) {
 		DWORD err = GetLastError();
 		diskFull = err == ERROR_DISK_FULL || err == ERROR_NOT_ENOUGH_QUOTA;
 	}
 #else
-	bytesWritten = write(hFile, pointer, size);
-	if (bytesWritten == (size_t)-1) {
+	*bytesWritten = write(hFile, pointer, size);
+	if (*bytesWritten == (size_t)-1) {
 		diskFull = errno == ENOSPC;
 	}
 #endif
+	if (writeStats_) {
+		writeStats_->hostWrites++;
+	}
+	return !diskFull;
+}
+
+size_t DirectoryFileHandle::Write(const u8* pointer, s64 size)
+{
+	size_t bytesWritten = 0;
+	bool diskFull = false;
+
+	if (writeStats_) {
+		writeStats_->writes++;
+	}
+
+	if (!atomicPath_.empty() && size >= 0 && atomicSeekPos_ + size > ATOMIC_MAX_FILE_SIZE) {
+		// Too big to keep in memory, write it in place from here on.
+		EndAtomic();
+	}
+	if (!atomicPath_.empty() && size >= 0) {
+		if (atomicSeekPos_ + size > (s64)writeBuffer_.size()) {
+			writeBuffer_.resize((size_t)(atomicSeekPos_ + size));
+		}
+		memcpy(&writeBuffer_[(size_t)atomicSeekPos_], pointer, (size_t)size);
+		atomicSeekPos_ += size;
+		bytesWritten = (size_t)size;
+		atomicDirty_ = true;
+		if (writeStats_) {
+			writeStats_->writesBuffered++;
+		}
+	} else if (writeBack_ && !append_ && atomicPath_.empty() && size >= 0 && size <= WRITE_BACK_MAX_WRITE) {
+		if (writeBuffer_.size() + size > WRITE_BACK_BUFFER_SIZE) {
+			FlushWrites();
+		}
+		if (writeBuffer_.empty()) {
+			writeBufferPos_ = SeekHandle(0, FILEMOVE_CURRENT);
+			writeBufferTime_ = time_now_d();
+		}
+		writeBuffer_.insert(writeBuffer_.end(), pointer, pointer + size);
+		bytesWritten = (size_t)size;
+		if (writeStats_) {
+			writeStats_->writesBuffered++;
+		}
+	} else {
+		// Keep the order of writes.
+		FlushWrites();
+		diskFull = !WriteHandle(pointer, size, &bytesWritten);
+	}
+
 	if (needsTrunc_ != -1) {
-		off_t off = (off_t)Seek(0, FILEMOVE_CURRENT);
+		off_t off;
+		if (!atomicPath_.empty()) {
+			off = (off_t)atomicSeekPos_;
+		} else if (!writeBuffer_.empty()) {
+			off = (off_t)(writeBufferPos_ + writeBuffer_.size());
+		} else {
+			off = (off_t)Seek(0, FILEMOVE_CURRENT);
+		}
 		if (needsTrunc_ < off) {
 			needsTrunc_ = off;
 		}
@@ -394,18 +485,7 @@ size_t DirectoryFileHandle::Write(const u8* pointer, s64 size)
 	return bytesWritten;
 }
 
-size_t DirectoryFileHandle::Seek(s32 position, FileMove type)
-{
-	if (needsTrunc_ != -1) {
-		// If the file is "currently truncated" move to the end based on that position.
-		// The actual, underlying file hasn't been truncated (yet.)
-		if (type == FILEMOVE_END) {
-			type = FILEMOVE_BEGIN;
-			position = (s32)(needsTrunc_ + position);
-		}
-	}
-
-	size_t result;
+s64 DirectoryFileHandle::SeekHandle(s64 position, FileMove type) {
 #ifdef _WIN32
 	DWORD moveMethod = 0;
 	switch (type) {
@@ -418,7 +498,7 @@ size_t DirectoryFileHandle::Seek(s32 position, FileMove type)
 	distance.QuadPart = position;
 	LARGE_INTEGER cursor;
 	SetFilePointerEx(hFile, distance, &cursor, moveMethod);
-	result = (size_t)cursor.QuadPart;
+	return (s64)cursor.QuadPart;
 #else
 	int moveMethod = 0;
 	switch (type) {
@@ -426,13 +506,209 @@ size_t DirectoryFileHandle::Seek(s32 position, FileMove type)
 	case FILEMOVE_CURRENT:  moveMethod = SEEK_CUR;  break;
 	case FILEMOVE_END:      moveMethod = SEEK_END;  break;
 	}
-	result = lseek(hFile, position, moveMethod);
+	return (s64)lseek(hFile, (off_t)position, moveMethod);
 #endif
+}
+
+size_t DirectoryFileHandle::Seek(s32 position, FileMove type)
+{
+	if (needsTrunc_ != -1) {
+		// If the file is "currently truncated" move to the end based on that position.
+		// The actual, underlying file hasn't been truncated (yet.)
+		if (type == FILEMOVE_END) {
+			type = FILEMOVE_BEGIN;
+			position = (s32)(needsTrunc_ + position);
+		}
+	}
+
+	size_t result;
+	if (!atomicPath_.empty()) {
+		s64 newPos = position;
+		if (type == FILEMOVE_CURRENT) {
+			newPos += atomicSeekPos_;
+		} else if (type == FILEMOVE_END) {
+			newPos += (s64)writeBuffer_.size();
+		}
+		if (newPos > ATOMIC_MAX_FILE_SIZE) {
+			// Writing there would need a huge buffer, so go back to the file itself. It's at atomicSeekPos_ after this.
+			EndAtomic();
+		} else if (newPos >= 0) {
+			atomicSeekPos_ = newPos;
+			result = (size_t)newPos;
+		} else {
+			result = (size_t)-1;
+		}
+	}
+	if (atomicPath_.empty()) {
+		FlushWrites();
+		result = (size_t)SeekHandle(position, type);
+	}
 
 	return replay_ ? (size_t)ReplayApplyDisk64(ReplayAction::FILE_SEEK, result, CoreTiming::GetGlobalTimeUs()) : result;
 }
 
+bool DirectoryFileHandle::HasPendingWrites() const {
+	return atomicPath_.empty() ? !writeBuffer_.empty() : atomicDirty_;
+}
+
+bool DirectoryFileHandle::FlushWrites() {
+	if (!HasPendingWrites()) {
+		return true;
+	}
+	if (!atomicPath_.empty()) {
+		return CommitAtomic();
+	}
+
+	// The host file position was left at writeBufferPos_.
+	bool success = true;
+	size_t done = 0;
+	while (done < writeBuffer_.size()) {
+		size_t bytesWritten = 0;
+		bool diskFull = !WriteHandle(writeBuffer_.data() + done, (s64)(writeBuffer_.size() - done), &bytesWritten);
+		if (diskFull || bytesWritten == 0 || bytesWritten == (size_t)-1) {
+			ERROR_LOG(Log::FileSystem, "Failed to write back %d buffered bytes", (int)(writeBuffer_.size() - done));
+			if (diskFull) {
+				auto err = GetI18NCategory(I18NCat::ERRORS);
+				g_OSD.Show(OSDType::MESSAGE_ERROR, err->T("Disk full while writing data"), 0.0f, "diskfull");
+			}
+			// Keep the position where the game expects it.
+			SeekHandle(writeBufferPos_ + writeBuffer_.size(), FILEMOVE_BEGIN);
+			success = false;
+			break;
+		}
+		done += bytesWritten;
+	}
+	writeBuffer_.clear();
+	writeBufferTime_ = 0.0;
+	return success;
+}
+
+bool DirectoryFileHandle::OpenAtomic(const Path &fullName) {
+	// The old contents show through if the game seeks past what it wrote, as on the PSP.
+	const s64 size = SeekHandle(0, FILEMOVE_END);
+	SeekHandle(0, FILEMOVE_BEGIN);
+	if (size < 0 || size > ATOMIC_MAX_FILE_SIZE) {
+		return false;
+	}
+	std::string data;
+	if (size > 0 && !File::ReadBinaryFileToString(fullName, &data)) {
+		return false;
+	}
+
+	// The file is replaced on flush, which can't be done while it's open on some platforms.
+#ifdef _WIN32
+	CloseHandle(hFile);
+	hFile = (HANDLE)-1;
+#else
+	close(hFile);
+	hFile = -1;
+#endif
+	writeBuffer_.assign(data.begin(), data.end());
+	atomicPath_ = fullName;
+	atomicSeekPos_ = 0;
+	// Even without writes, the truncation needs to happen.
+	atomicDirty_ = true;
+	writeBufferTime_ = 0.0;
+	return true;
+}
+
+// Moves src over dest, which may or may not exist.
+static bool ReplaceHostFile(const Path &src, const Path &dest) {
+#if PPSSPP_PLATFORM(UWP)
+	// Can't replace in one go here, so there's a moment without the file.
+	if (File::Rename(src, dest))
+		return true;
+	File::Delete(dest);
+	return File::Rename(src, dest);
+#elif defined(_WIN32)
+	// _wrename (used by File::Rename) fails if dest exists.
+	if (MoveFileExW(src.ToWString().c_str(), dest.ToWString().c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+		return true;
+	ERROR_LOG(Log::FileSystem, "Failed to move %s over %s: %s", src.c_str(), dest.c_str(), GetLastErrorMsg().c_str());
+	return false;
+#else
+	return File::Rename(src, dest);
+#endif
+}
+
+bool DirectoryFileHandle::CommitAtomic() {
+	size_t size = writeBuffer_.size();
+	if (needsTrunc_ != -1 && (size_t)needsTrunc_ < size) {
+		size = (size_t)needsTrunc_;
+	}
+
+	// Either the old or the new file survives a crash, never half of one.
+	const Path tempPath = atomicPath_.WithExtraExtension(".ppssppwrite");
+	FILE *f = File::OpenCFile(tempPath, "wb");
+	bool success = f != nullptr;
+	if (f) {
+		success = fwrite(writeBuffer_.data(), 1, size, f) == size;
+		// The data has to be on disk before the rename is, or a crash could still leave an empty file.
+		success = success && fflush(f) == 0;
+#ifdef _WIN32
+		success = success && _commit(_fileno(f)) == 0;
+#else
+		success = success && fsync(fileno(f)) == 0;
+#endif
+		success = fclose(f) == 0 && success;
+	}
+	if (success) {
+		success = ReplaceHostFile(tempPath, atomicPath_);
+	}
+	if (writeStats_) {
+		writeStats_->hostWrites++;
+		if (success)
+			writeStats_->atomicReplaces++;
+	}
+	if (!success) {
+		ERROR_LOG(Log::FileSystem, "Failed to replace %s", atomicPath_.c_str());
+		File::Delete(tempPath);
+		auto err = GetI18NCategory(I18NCat::ERRORS);
+		g_OSD.Show(OSDType::MESSAGE_ERROR, err->T("Disk full while writing data"), 0.0f, "diskfull");
+	}
+	atomicDirty_ = false;
+	writeBufferTime_ = 0.0;
+	return success;
+}
+
+void DirectoryFileHandle::EndAtomic() {
+	if (atomicPath_.empty()) {
+		return;
+	}
+	FlushWrites();
+
+	// Truncation was part of the replace, so this just continues where the game is.
+#if PPSSPP_PLATFORM(UWP)
+	hFile = CreateFile2FromAppW(atomicPath_.ToWString().c_str(), GENERIC_WRITE, FILE_SHARE_WRITE | FILE_SHARE_READ, OPEN_ALWAYS, nullptr);
+	const bool success = hFile != INVALID_HANDLE_VALUE;
+#elif defined(_WIN32)
+	hFile = CreateFile(atomicPath_.ToWString().c_str(), GENERIC_WRITE, FILE_SHARE_WRITE | FILE_SHARE_READ, 0, OPEN_ALWAYS, 0, 0);
+	const bool success = hFile != INVALID_HANDLE_VALUE;
+#else
+	hFile = open(atomicPath_.c_str(), O_WRONLY | O_CREAT, 0666);
+	const bool success = hFile != -1;
+#endif
+	if (success) {
+		SeekHandle(atomicSeekPos_, FILEMOVE_BEGIN);
+	} else {
+		ERROR_LOG(Log::FileSystem, "Failed to reopen %s", atomicPath_.c_str());
+	}
+	writeBuffer_.clear();
+	atomicPath_.clear();
+	atomicSeekPos_ = 0;
+	atomicDirty_ = false;
+}
+
 void DirectoryFileHandle::Close() {
+	if (!atomicPath_.empty()) {
+		// Truncation is part of the replace, and the file was closed at open.
+		FlushWrites();
+		writeBuffer_.clear();
+		atomicPath_.clear();
+		return;
+	}
+	FlushWrites();
+
 	if (needsTrunc_ != -1) {
 #ifdef _WIN32
 		Seek((s32)needsTrunc_, FILEMOVE_BEGIN);
@@ -506,6 +782,7 @@ bool DirectoryFileSystem::RmDir(const std::string &dirname) {
 }
 
 int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &to) {
+	FlushWrites(false);
 	std::string fullTo = to;
 
 	// Rename ignores the path (even if specified) on to.
@@ -553,6 +830,7 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 }
 
 bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
+	FlushWrites(false);
 	Path localPath = GetLocalPath(filename);
 
 	bool retValue = File::Delete(localPath);
@@ -573,9 +851,80 @@ bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 	return ReplayApplyDisk(ReplayAction::FILE_REMOVE, retValue, CoreTiming::GetGlobalTimeUs()) != 0;
 }
 
+static bool SameLocalPath(const Path &a, const Path &b) {
+	// Erring on the side of a match only costs a flush.
+	return equalsNoCase(a.ToString(), b.ToString());
+}
+
+void DirectoryFileSystem::PrepareHandle(DirectoryFileHandle &hFile, const std::string &filename) {
+	hFile.fileSystemFlags_ = flags;
+	hFile.writeBack_ = g_Config.bMemStickWriteBack && (flags & FileSystemFlags::CARD);
+	hFile.writeStats_ = &writeStats_;
+	if (!hFile.writeBack_) {
+		return;
+	}
+
+	// Each handle buffers on its own. If the file is already open, the new handle doesn't buffer,
+	// the others write out what they have, and stop keeping it in memory (since the file can't be
+	// replaced while the new handle has it open.) FlushOtherHandles() takes care of later writes.
+	const Path localPath = GetLocalPath(filename);
+	for (auto &iter : entries) {
+		if (SameLocalPath(GetLocalPath(iter.second.guestFilename), localPath)) {
+			iter.second.hFile.EndAtomic();
+			iter.second.hFile.FlushWrites();
+			hFile.writeBack_ = false;
+		}
+	}
+}
+
+// Before using a handle, makes sure it sees what was written through others to the same file.
+void DirectoryFileSystem::FlushOtherHandles(u32 handle) {
+	auto self = entries.find(handle);
+	if (self == entries.end()) {
+		return;
+	}
+	Path localPath;
+	for (auto &iter : entries) {
+		if (iter.first == handle || !iter.second.hFile.HasPendingWrites())
+			continue;
+		if (localPath.empty())
+			localPath = GetLocalPath(self->second.guestFilename);
+		if (SameLocalPath(GetLocalPath(iter.second.guestFilename), localPath))
+			iter.second.hFile.FlushWrites();
+	}
+}
+
+void DirectoryFileSystem::FlushBufferedWrites(const Path &localPath, bool inDirectory) {
+	for (auto &iter : entries) {
+		DirectoryFileHandle &hFile = iter.second.hFile;
+		// Savedata kept in memory is only replaced on close or sync, or it wouldn't be atomic anymore.
+		if (!hFile.HasPendingWrites() || !hFile.atomicPath_.empty())
+			continue;
+		Path handlePath = GetLocalPath(iter.second.guestFilename);
+		if (inDirectory)
+			handlePath = handlePath.NavigateUp();
+		if (SameLocalPath(handlePath, localPath))
+			hFile.FlushWrites();
+	}
+}
+
+void DirectoryFileSystem::FlushWrites(bool onlyExpired) {
+	const double now = time_now_d();
+	for (auto &iter : entries) {
+		DirectoryFileHandle &hFile = iter.second.hFile;
+		if (!hFile.HasPendingWrites())
+			continue;
+		// Savedata kept in memory has no timestamp, it's only replaced on close or sync.
+		if (onlyExpired && (hFile.writeBufferTime_ == 0.0 || now - hFile.writeBufferTime_ < WRITE_BACK_TIMEOUT))
+			continue;
+		hFile.FlushWrites();
+	}
+}
+
 int DirectoryFileSystem::OpenFile(std::string filename, FileAccess access, const char *devicename) {
 	OpenFileEntry entry;
-	entry.hFile.fileSystemFlags_ = flags;
+	// This also writes out anything buffered for the same file, so the new handle sees it.
+	PrepareHandle(entry.hFile, filename);
 	u32 err = 0;
 	bool success = entry.hFile.Open(basePath, filename, (FileAccess)(access & FILEACCESS_PSP_FLAGS), err);
 	if (err == 0 && !success) {
@@ -653,6 +1002,7 @@ size_t DirectoryFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &use
 			return 0;
 		}
 
+		FlushOtherHandles(handle);
 		size_t bytesRead = iter->second.hFile.Read(pointer,size);
 		return bytesRead;
 	} else {
@@ -670,6 +1020,8 @@ size_t DirectoryFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size) {
 size_t DirectoryFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size, int &usec) {
 	EntryMap::iterator iter = entries.find(handle);
 	if (iter != entries.end()) {
+		// Otherwise older buffered data could later land on top of this.
+		FlushOtherHandles(handle);
 		size_t bytesWritten = iter->second.hFile.Write(pointer,size);
 		return bytesWritten;
 	} else {
@@ -682,6 +1034,9 @@ size_t DirectoryFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size, i
 size_t DirectoryFileSystem::SeekFile(u32 handle, s32 position, FileMove type) {
 	EntryMap::iterator iter = entries.find(handle);
 	if (iter != entries.end()) {
+		// The end depends on what was written through other handles.
+		if (type == FILEMOVE_END)
+			FlushOtherHandles(handle);
 		return iter->second.hFile.Seek(position,type);
 	} else {
 		//This shouldn't happen...
@@ -696,6 +1051,8 @@ PSPFileInfo DirectoryFileSystem::GetFileInfo(std::string filename) {
 
 	File::FileInfo info;
 	Path fullName = GetLocalPath(filename);
+	// Sizes and times should include anything still buffered.
+	FlushBufferedWrites(fullName, false);
 	if (!File::GetFileInfo(fullName, &info)) {
 		if (flags & FileSystemFlags::CASE_SENSITIVE) {
 			if (!FixPathCase(basePath, filename, FPC_FILE_MUST_EXIST))
@@ -822,6 +1179,7 @@ std::vector<PSPFileInfo> DirectoryFileSystem::GetDirListing(const std::string &p
 
 	std::vector<File::FileInfo> files;
 	Path localPath = GetLocalPath(path);
+	FlushBufferedWrites(localPath, true);
 	const int flags = File::GETFILES_GETHIDDEN | File::GETFILES_GET_NAVIGATION_ENTRIES;
 	bool success = File::GetFilesInDir(localPath, &files, nullptr, flags);
 
@@ -942,18 +1300,23 @@ void DirectoryFileSystem::DoState(PointerWrap &p) {
 	//     u32               seek position
 	//     s64               current truncate position (v2+ only)
 
+	// Files are reopened by name on load, so everything has to be on disk.
+	if (p.mode != p.MODE_READ) {
+		FlushWrites(false);
+	}
+
 	u32 num = (u32) entries.size();
 	Do(p, num);
 
 	if (p.mode == p.MODE_READ) {
 		CloseAll();
 		u32 key;
-		OpenFileEntry entry;
-		entry.hFile.fileSystemFlags_ = flags;
 		for (u32 i = 0; i < num; i++) {
+			OpenFileEntry entry;
 			Do(p, key);
 			Do(p, entry.guestFilename);
 			Do(p, entry.access);
+			PrepareHandle(entry.hFile, entry.guestFilename);
 			u32 err;
 			bool brokenFile = false;
 			if (!entry.hFile.Open(basePath,entry.guestFilename,entry.access, err)) {
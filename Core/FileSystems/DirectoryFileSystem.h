@@ -20,6 +20,7 @@
 // TODO: Remove the Windows-specific code, FILE is fine there too.
 
 #include <map>
+#include <vector>
 
 #include "Common/File/Path.h"
 #include "Core/FileSystems/FileSystem.h"
@@ -44,6 +45,21 @@ struct DirectoryFileHandle {
 	bool inGameDir_ = false;
 	FileSystemFlags fileSystemFlags_ = (FileSystemFlags)0;
 
+	// Write-back buffering, only used for the memory stick. Small writes collect in writeBuffer_,
+	// which starts at writeBufferPos_ in the file. The host file position stays there until flushed.
+	// writeBack_ is set up before Open(), everything else is reset by it.
+	bool writeBack_ = false;
+	bool append_ = false;
+	std::vector<u8> writeBuffer_;
+	s64 writeBufferPos_ = 0;
+	double writeBufferTime_ = 0.0;
+	// Savedata being rewritten is instead kept whole in writeBuffer_ (with hFile closed),
+	// and replaces atomicPath_ through a temporary file when flushed.
+	Path atomicPath_;
+	s64 atomicSeekPos_ = 0;
+	bool atomicDirty_ = false;
+	FileSystemWriteStats *writeStats_ = nullptr;
+
 	DirectoryFileHandle() {}
 
 	DirectoryFileHandle(Flags flags, FileSystemFlags fileSystemFlags)
@@ -55,6 +71,17 @@ struct DirectoryFileHandle {
 	size_t Write(const u8* pointer, s64 size);
 	size_t Seek(s32 position, FileMove type);
 	void Close();
+
+	bool HasPendingWrites() const;
+	bool FlushWrites();
+	// Writes out savedata kept in memory, and goes back to writing the file directly.
+	void EndAtomic();
+
+private:
+	s64 SeekHandle(s64 position, FileMove type);
+	bool WriteHandle(const u8 *pointer, s64 size, size_t *bytesWritten);
+	bool OpenAtomic(const Path &fullName);
+	bool CommitAtomic();
 };
 
 class DirectoryFileSystem : public IFileSystem {
@@ -88,6 +115,8 @@ class DirectoryFileSystem : public IFileSystem {
 
 	bool ComputeRecursiveDirSizeIfFast(const std::string &path, int64_t *size) override;
 	void Describe(char *buf, size_t size) const override { snprintf(buf, size, "Dir: %s", basePath.c_str()); }
+	const FileSystemWriteStats *WriteStats() const override { return &writeStats_; }
+	void FlushWrites(bool onlyExpired) override;
 
 private:
 	struct OpenFileEntry {
@@ -101,8 +130,13 @@ class DirectoryFileSystem : public IFileSystem {
 	Path basePath;
 	IHandleAllocator *hAlloc;
 	FileSystemFlags flags;
+	FileSystemWriteStats writeStats_;
 
 	Path GetLocalPath(std::string internalPath) const;
+	void PrepareHandle(DirectoryFileHandle &hFile, const std::string &filename);
+	void FlushOtherHandles(u32 handle);
+	// Writes out what's buffered for one file, or for the files in one directory.
+	void FlushBufferedWrites(const Path &localPath, bool inDirectory);
 };
 
 // VFSFileSystem: Ability to map in Android APK paths as well! Does not support all features, only meant for fonts.
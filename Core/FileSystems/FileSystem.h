@@ -128,6 +128,34 @@ struct PSPFileInfo {
 	u32 sectorSize = 0;
 };
 
+// Path lookup counters, for the debugger.
+struct FileSystemLookupStats {
+	u64 lookups = 0;
+	u64 indexHits = 0;
+	// Lookups that had to go through the tree, component by component.
+	u64 treeWalks = 0;
+	u64 notFound = 0;
+	int directoriesRead = 0;
+	int indexedPaths = 0;
+	double scanSeconds = 0.0;
+};
+
+struct FileSystemReadStats {
+	u64 reads = 0;
+	u64 bytesRead = 0;
+	// Bytes that went through a temporary sector buffer on the way to the destination.
+	u64 bytesCopied = 0;
+};
+
+struct FileSystemWriteStats {
+	// Writes from the game, and how many of those were held back to be combined.
+	u64 writes = 0;
+	u64 writesBuffered = 0;
+	// Writes actually made to the host file system.
+	u64 hostWrites = 0;
+	// Savedata files replaced in one go through a temporary file.
+	u64 atomicReplaces = 0;
+};
 
 class IFileSystem {
 public:
@@ -155,6 +183,11 @@ class IFileSystem {
 	virtual u64      FreeDiskSpace(const std::string &path) = 0;
 	virtual bool     ComputeRecursiveDirSizeIfFast(const std::string &path, int64_t *size) = 0;
 	virtual void     Describe(char *buf, size_t size) const = 0;
+	virtual const FileSystemLookupStats *LookupStats() const { return nullptr; }
+	virtual const FileSystemReadStats *ReadStats() const { return nullptr; }
+	virtual const FileSystemWriteStats *WriteStats() const { return nullptr; }
+	// Writes out buffered data. If onlyExpired, only what has been waiting for a while.
+	virtual void FlushWrites(bool onlyExpired) {}
 };
 
 
@@ -18,10 +18,13 @@
 #include <algorithm>
 #include <cstring>
 #include <cstdio>
+#include <set>
 
 #include "Common/CommonTypes.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/Serialize/SerializeFuncs.h"
+#include "Common/Thread/ParallelLoop.h"
+#include "Common/TimeUtil.h"
 #include "Core/FileSystems/ISOFileSystem.h"
 #include "Core/HLE/sceKernel.h"
 #include "Core/MemMap.h"
@@ -185,74 +188,198 @@ std::string ISOFileSystem::TreeEntry::BuildPath() {
 }
 
 void ISOFileSystem::ReadDirectory(TreeEntry *root) {
+	stats_.directoriesRead++;
 	for (u32 secnum = root->startsector, endsector = root->startsector + (root->dirsize + 2047) / 2048; secnum < endsector; ++secnum) {
-		u8 theSector[2048];
-		if (!blockDevice->ReadBlock(secnum, theSector)) {
+		u8 sectorBuffer[2048];
+		// Parse straight out of the device when it allows that.
+		const u8 *theSector = blockDevice->GetBlockPointer(secnum, 1);
+		if (!theSector && blockDevice->ReadBlock(secnum, sectorBuffer))
+			theSector = sectorBuffer;
+		if (!theSector) {
 			blockDevice->NotifyReadError();
 			ERROR_LOG(Log::FileSystem, "Error reading block for directory '%s' in sector %d - skipping", root->name.c_str(), secnum);
 			root->valid = true;  // Prevents re-reading
+			IndexChildren(root);
 			return;
 		}
 		lastReadBlock_ = secnum;  // Hm, this could affect timing... but lazy loading is probably more realistic.
 
-		for (int offset = 0; offset < 2048; ) {
-			DirectoryEntry &dir = *(DirectoryEntry *)&theSector[offset];
-			u8 sz = theSector[offset];
+		bool readError = false;
+		bool ok = ParseDirectorySector(root, theSector, &readError);
+		if (readError)
+			blockDevice->NotifyReadError();
+		if (!ok)
+			return;
+	}
+	root->valid = true;
+	IndexChildren(root);
+}
 
-			// Nothing left in this sector.  There might be more in the next one.
-			if (sz == 0)
-				break;
+// Adds the entries of one sector of a directory to root. Returns false if the rest of the directory
+// can't be trusted. Doesn't touch the block device, so it's safe to run on several threads.
+bool ISOFileSystem::ParseDirectorySector(TreeEntry *root, const u8 *theSector, bool *readError) {
+	for (int offset = 0; offset < 2048; ) {
+		const DirectoryEntry &dir = *(const DirectoryEntry *)&theSector[offset];
+		u8 sz = theSector[offset];
 
-			const int IDENTIFIER_OFFSET = 33;
-			if (offset + IDENTIFIER_OFFSET + dir.identifierLength > 2048) {
-				blockDevice->NotifyReadError();
-				ERROR_LOG(Log::FileSystem, "Directory entry crosses sectors, corrupt iso?");
-				return;
+		// Nothing left in this sector.  There might be more in the next one.
+		if (sz == 0)
+			break;
+
+		const int IDENTIFIER_OFFSET = 33;
+		if (offset + IDENTIFIER_OFFSET + dir.identifierLength > 2048) {
+			*readError = true;
+			ERROR_LOG(Log::FileSystem, "Directory entry crosses sectors, corrupt iso?");
+			return false;
+		}
+
+		offset += dir.size;
+
+		bool isFile = (dir.flags & 2) ? false : true;
+		bool relative;
+
+		TreeEntry *entry = new TreeEntry();
+		if (dir.identifierLength == 1 && (dir.firstIdChar == '\x00' || dir.firstIdChar == '.')) {
+			entry->name = ".";
+			relative = true;
+		} else if (dir.identifierLength == 1 && dir.firstIdChar == '\x01') {
+			entry->name = "..";
+			relative = true;
+		} else {
+			entry->name = std::string((const char *)&dir.firstIdChar, dir.identifierLength);
+			relative = false;
+		}
+
+		entry->size = dir.dataLength;
+		entry->startingPosition = dir.firstDataSector * 2048;
+		entry->isDirectory = !isFile;
+		entry->flags = dir.flags;
+		entry->parent = root;
+		entry->startsector = dir.firstDataSector;
+		entry->dirsize = dir.dataLength;
+		entry->valid = isFile;  // Can pre-mark as valid if file, as we don't recurse into those.
+		VERBOSE_LOG(Log::FileSystem, "%s: %s %08x %08x %d", entry->isDirectory ? "D" : "F", entry->name.c_str(), (u32)dir.firstDataSector, entry->startingPosition, entry->startingPosition);
+
+		// Round down to avoid any false reports.
+		if (isFile && dir.firstDataSector + (dir.dataLength / 2048) > blockDevice->GetNumBlocks()) {
+			*readError = true;
+			ERROR_LOG(Log::FileSystem, "File '%s' starts or ends outside ISO. firstDataSector: %d len: %d", entry->BuildPath().c_str(), (int)dir.firstDataSector, (int)dir.dataLength);
+		}
+
+		if (entry->isDirectory && !relative) {
+			if (entry->startsector == root->startsector) {
+				*readError = true;
+				ERROR_LOG(Log::FileSystem, "WARNING: Appear to have a recursive file system, breaking recursion. Probably corrupt ISO.");
 			}
+		}
+		root->children.push_back(entry);
+	}
+	return true;
+}
 
-			offset += dir.size;
+void ISOFileSystem::IndexChildren(TreeEntry *root) {
+	std::string prefix = EntryFullPath(root);
+	if (!prefix.empty())
+		prefix = prefix.substr(1) + "/";
+	for (TreeEntry *child : root->children) {
+		// If there are duplicate names, the first one wins, same as when walking the tree.
+		pathIndex_.emplace(prefix + child->name, child);
+	}
+	stats_.indexedPaths = (int)pathIndex_.size();
+}
 
-			bool isFile = (dir.flags & 2) ? false : true;
-			bool relative;
+void ISOFileSystem::ScanAllDirectories() {
+	double startTime = time_now_d();
+
+	// One level of the tree at a time. The block devices aren't thread safe, so the reads are done
+	// in order here, and only the parsing is spread out over threads.
+	// Directories that were already read lazily are skipped, but their subdirectories aren't.
+	std::vector<TreeEntry *> level;
+	std::set<u32> seenSectors;
+	std::vector<TreeEntry *> pending{ treeroot };
+	while (!pending.empty()) {
+		TreeEntry *dir = pending.back();
+		pending.pop_back();
+		if (!seenSectors.insert(dir->startsector).second)
+			continue;
+		if (!dir->valid) {
+			if (dir->dirsize != 0)
+				level.push_back(dir);
+			continue;
+		}
+		for (TreeEntry *child : dir->children) {
+			if (child->isDirectory && child->name != "." && child->name != "..")
+				pending.push_back(child);
+		}
+	}
 
-			TreeEntry *entry = new TreeEntry();
-			if (dir.identifierLength == 1 && (dir.firstIdChar == '\x00' || dir.firstIdChar == '.')) {
-				entry->name = ".";
-				relative = true;
-			} else if (dir.identifierLength == 1 && dir.firstIdChar == '\x01') {
-				entry->name = "..";
-				relative = true;
+	int scanned = 0;
+	while (!level.empty()) {
+		std::vector<std::vector<u8>> data(level.size());
+		std::vector<const u8 *> dataPtrs(level.size());
+		std::vector<size_t> dataSizes(level.size());
+		for (size_t i = 0; i < level.size(); i++) {
+			TreeEntry *dir = level[i];
+			u32 numSectors = (dir->dirsize + 2047) / 2048;
+			dataSizes[i] = numSectors * 2048;
+			dataPtrs[i] = blockDevice->GetBlockPointer(dir->startsector, numSectors);
+			if (dataPtrs[i])
+				continue;
+			data[i].resize(dataSizes[i]);
+			if (blockDevice->ReadBlocks(dir->startsector, numSectors, data[i].data())) {
+				dataPtrs[i] = data[i].data();
 			} else {
-				entry->name = std::string((const char *)&dir.firstIdChar, dir.identifierLength);
-				relative = false;
+				// Let ReadDirectory deal with it later, if it's ever needed.
+				data[i].clear();
 			}
+		}
 
-			entry->size = dir.dataLength;
-			entry->startingPosition = dir.firstDataSector * 2048;
-			entry->isDirectory = !isFile;
-			entry->flags = dir.flags;
-			entry->parent = root;
-			entry->startsector = dir.firstDataSector;
-			entry->dirsize = dir.dataLength;
-			entry->valid = isFile;  // Can pre-mark as valid if file, as we don't recurse into those.
-			VERBOSE_LOG(Log::FileSystem, "%s: %s %08x %08x %d", entry->isDirectory ? "D" : "F", entry->name.c_str(), (u32)dir.firstDataSector, entry->startingPosition, entry->startingPosition);
-
-			// Round down to avoid any false reports.
-			if (isFile && dir.firstDataSector + (dir.dataLength / 2048) > blockDevice->GetNumBlocks()) {
-				blockDevice->NotifyReadError();
-				ERROR_LOG(Log::FileSystem, "File '%s' starts or ends outside ISO. firstDataSector: %d len: %d", entry->BuildPath().c_str(), (int)dir.firstDataSector, (int)dir.dataLength);
+		std::vector<u8> readErrors(level.size());
+		ParallelRangeLoop(&g_threadManager, [&](int lower, int upper) {
+			for (int i = lower; i < upper; i++) {
+				TreeEntry *dir = level[i];
+				if (!dataPtrs[i])
+					continue;
+				bool readError = false;
+				bool ok = true;
+				for (size_t offset = 0; offset < dataSizes[i] && ok; offset += 2048) {
+					ok = ParseDirectorySector(dir, dataPtrs[i] + offset, &readError);
+				}
+				readErrors[i] = readError;
+				if (ok) {
+					dir->valid = true;
+				} else {
+					// Leave it as if it was never read.
+					for (TreeEntry *child : dir->children)
+						delete child;
+					dir->children.clear();
+				}
 			}
+		}, 0, (int)level.size(), 16, TaskPriority::HIGH);
 
-			if (entry->isDirectory && !relative) {
-				if (entry->startsector == root->startsector) {
-					blockDevice->NotifyReadError();
-					ERROR_LOG(Log::FileSystem, "WARNING: Appear to have a recursive file system, breaking recursion. Probably corrupt ISO.");
-				}
+		std::vector<TreeEntry *> nextLevel;
+		for (size_t i = 0; i < level.size(); i++) {
+			TreeEntry *dir = level[i];
+			if (readErrors[i])
+				blockDevice->NotifyReadError();
+			if (!dir->valid)
+				continue;
+			scanned++;
+			IndexChildren(dir);
+			for (TreeEntry *child : dir->children) {
+				// Skip . and .., and anything pointing back up the tree on a corrupt ISO.
+				if (!child->isDirectory || child->valid || child->name == "." || child->name == "..")
+					continue;
+				if (seenSectors.insert(child->startsector).second)
+					nextLevel.push_back(child);
 			}
-			root->children.push_back(entry);
 		}
+		level = std::move(nextLevel);
 	}
-	root->valid = true;
+
+	stats_.directoriesRead += scanned;
+	stats_.scanSeconds = time_now_d() - startTime;
+	INFO_LOG(Log::FileSystem, "Scanned %d ISO directories (%d paths) in %0.1f ms", scanned, (int)pathIndex_.size(), stats_.scanSeconds * 1000.0);
 }
 
 ISOFileSystem::TreeEntry *ISOFileSystem::GetFromPath(const std::string &path, bool catchError) {
@@ -276,6 +403,22 @@ ISOFileSystem::TreeEntry *ISOFileSystem::GetFromPath(const std::string &path, bo
 	if (pathLength <= pathIndex)
 		return treeroot;
 
+	stats_.lookups++;
+
+	// Anything in a directory that's already been read can be found directly.
+	size_t keyLength = pathLength - pathIndex;
+	if (path[pathLength - 1] == '/')
+		keyLength--;
+	auto indexed = pathIndex_.find(path.substr(pathIndex, keyLength));
+	if (indexed != pathIndex_.end()) {
+		stats_.indexHits++;
+		TreeEntry *entry = indexed->second;
+		if (!entry->valid)
+			ReadDirectory(entry);
+		return entry;
+	}
+
+	stats_.treeWalks++;
 	TreeEntry *entry = treeroot;
 	while (true) {
 		if (!entry->valid) {
@@ -314,6 +457,7 @@ ISOFileSystem::TreeEntry *ISOFileSystem::GetFromPath(const std::string &path, bo
 			if (catchError)
 				ERROR_LOG(Log::FileSystem, "File '%s' not found", path.c_str());
 
+			stats_.notFound++;
 			return 0;
 		}
 	}
@@ -485,6 +629,8 @@ size_t ISOFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) {
 		if (e.isBlockSectorMode) {
 			// Whole sectors! Shortcut to this simple code.
 			blockDevice->ReadBlocks(e.seekPos, (int)size, pointer);
+			readStats_.reads++;
+			readStats_.bytesRead += (u64)size * 2048;
 			if (abs((int)lastReadBlock_ - (int)e.seekPos) > 100) {
 				// This is an estimate, sometimes it takes 1+ seconds, but it definitely takes time.
 				usec = 100000;
@@ -536,11 +682,21 @@ size_t ISOFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) {
 			ERROR_LOG(Log::FileSystem, "Remaining size should be aligned");
 		}
 
+		// Partial sectors come straight from the device when it's mapped, otherwise through theSector.
+		auto readPartialBlock = [&](u32 block, int offset, int bytes) {
+			const u8 *src = blockDevice->GetBlockPointer(block, 1);
+			if (!src) {
+				blockDevice->ReadBlock(block, theSector);
+				src = theSector;
+				readStats_.bytesCopied += bytes;
+			}
+			memcpy(pointer, src + offset, bytes);
+			pointer += bytes;
+		};
+
 		const u8 *const start = pointer;
 		if (firstBlockSize > 0) {
-			blockDevice->ReadBlock(secNum++, theSector);
-			memcpy(pointer, theSector + firstBlockOffset, firstBlockSize);
-			pointer += firstBlockSize;
+			readPartialBlock(secNum++, firstBlockOffset, firstBlockSize);
 		}
 		if (middleSize > 0) {
 			const u32 sectors = (u32)(middleSize / 2048);
@@ -549,12 +705,12 @@ size_t ISOFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) {
 			pointer += middleSize;
 		}
 		if (lastBlockSize > 0) {
-			blockDevice->ReadBlock(secNum++, theSector);
-			memcpy(pointer, theSector, lastBlockSize);
-			pointer += lastBlockSize;
+			readPartialBlock(secNum++, 0, lastBlockSize);
 		}
 
 		size_t totalBytes = pointer - start;
+		readStats_.reads++;
+		readStats_.bytesRead += totalBytes;
 		if (abs((int)lastReadBlock_ - (int)secNum) > 100) {
 			// This is an estimate, sometimes it takes 1+ seconds, but it definitely takes time.
 			usec = 100000;
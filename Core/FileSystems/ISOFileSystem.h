@@ -19,6 +19,8 @@
 
 #include <map>
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 #include "FileSystem.h"
 
@@ -57,6 +59,11 @@ class ISOFileSystem : public IFileSystem {
 	bool ComputeRecursiveDirSizeIfFast(const std::string &path, int64_t *size) override { return false; }
 	void Describe(char *buf, size_t size) const override { snprintf(buf, size, "ISO"); }  // TODO: Ask the fileLoader about the origins
 
+	// Reads the whole directory tree right away, instead of as paths get looked up.
+	void ScanAllDirectories();
+	const FileSystemLookupStats *LookupStats() const override { return &stats_; }
+	const FileSystemReadStats *ReadStats() const override { return &readStats_; }
+
 private:
 	struct TreeEntry {
 		~TreeEntry();
@@ -97,7 +104,14 @@ class ISOFileSystem : public IFileSystem {
 
 	TreeEntry entireISO;
 
+	// Full path (without the leading slash) of everything in the directories read so far.
+	std::unordered_map<std::string, TreeEntry *> pathIndex_;
+	FileSystemLookupStats stats_;
+	FileSystemReadStats readStats_;
+
 	void ReadDirectory(TreeEntry *root);
+	bool ParseDirectorySector(TreeEntry *root, const u8 *sector, bool *readError);
+	void IndexChildren(TreeEntry *root);
 	TreeEntry *GetFromPath(const std::string &path, bool catchError = true);
 	std::string EntryFullPath(TreeEntry *e);
 };
@@ -0,0 +1,281 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+
+#include "Common/File/FileUtil.h"
+#include "Common/Log.h"
+#include "Common/StringUtils.h"
+#include "Common/TimeUtil.h"
+#include "Core/CoreTiming.h"
+#include "Core/ELF/ParamSFO.h"
+#include "Core/FileSystems/IoTrace.h"
+#include "Core/FileSystems/MetaFileSystem.h"
+#include "Core/System.h"
+
+static const char IOTRACE_MAGIC[4] = { 'P', 'I', 'O', 'T' };
+static const u32 IOTRACE_VERSION = 1;
+// Written out in chunks of about this size.
+static const size_t IOTRACE_FLUSH_SIZE = 64 * 1024;
+
+namespace IoTrace {
+
+static std::mutex traceLock;
+static std::atomic<bool> recording;
+static FILE *traceFile;
+static std::vector<u8> traceBuffer;
+static double traceStartTime;
+
+static void Flush() {
+	if (traceFile && !traceBuffer.empty()) {
+		if (fwrite(traceBuffer.data(), 1, traceBuffer.size(), traceFile) != traceBuffer.size()) {
+			ERROR_LOG(Log::sceIo, "Failed to write I/O trace, stopping");
+			fclose(traceFile);
+			traceFile = nullptr;
+			recording = false;
+		}
+	}
+	traceBuffer.clear();
+}
+
+bool Start(const Path &filename) {
+	std::lock_guard<std::mutex> guard(traceLock);
+	if (traceFile) {
+		Flush();
+		fclose(traceFile);
+	}
+
+	traceFile = File::OpenCFile(filename, "wb");
+	if (!traceFile) {
+		ERROR_LOG(Log::sceIo, "Could not create I/O trace %s", filename.c_str());
+		recording = false;
+		return false;
+	}
+
+	IoTraceHeader header{};
+	memcpy(header.magic, IOTRACE_MAGIC, sizeof(header.magic));
+	header.version = IOTRACE_VERSION;
+	header.startTime = (u64)time(nullptr);
+	traceBuffer.clear();
+	traceBuffer.insert(traceBuffer.end(), (const u8 *)&header, (const u8 *)&header + sizeof(header));
+	traceStartTime = time_now_d();
+	recording = true;
+	INFO_LOG(Log::sceIo, "Recording I/O trace to %s", filename.c_str());
+	return true;
+}
+
+void Stop() {
+	std::lock_guard<std::mutex> guard(traceLock);
+	recording = false;
+	if (traceFile) {
+		Flush();
+		fclose(traceFile);
+		traceFile = nullptr;
+	}
+}
+
+bool IsRecording() {
+	return recording;
+}
+
+Path GenerateFilename() {
+	const Path dumpDir = GetSysDirectory(DIRECTORY_DUMP);
+	File::CreateFullPath(dumpDir);
+
+	const std::string prefix = g_paramSFO.GetDiscID();
+	for (int n = 1; n < 10000; ++n) {
+		const Path path = dumpDir / StringFromFormat("%s_%04d.iotrace", prefix.c_str(), n);
+		if (!File::Exists(path)) {
+			return path;
+		}
+	}
+	return dumpDir / StringFromFormat("%s_%04d.iotrace", prefix.c_str(), 9999);
+}
+
+static void Record(IoTraceOp op, u32 handle, s64 offset, u32 size, s32 result, int whence, const std::string &path) {
+	IoTraceRecord record{};
+	record.op = (u8)op;
+	record.whence = (u8)whence;
+	record.pathLength = (u16)std::min(path.size(), (size_t)0xFFFF);
+	record.handle = handle;
+	record.offset = offset;
+	record.size = size;
+	record.result = result;
+	record.emuTimeUs = CoreTiming::GetGlobalTimeUs();
+
+	std::lock_guard<std::mutex> guard(traceLock);
+	if (!traceFile)
+		return;
+	record.hostTimeUs = (u64)((time_now_d() - traceStartTime) * 1000000.0);
+	traceBuffer.insert(traceBuffer.end(), (const u8 *)&record, (const u8 *)&record + sizeof(record));
+	traceBuffer.insert(traceBuffer.end(), path.begin(), path.begin() + record.pathLength);
+	if (traceBuffer.size() >= IOTRACE_FLUSH_SIZE)
+		Flush();
+}
+
+void RecordOpen(u32 handle, const std::string &path, int access, int result) {
+	Record(IoTraceOp::OPEN, handle, 0, (u32)access, result, 0, path);
+}
+
+void RecordRead(u32 handle, s64 offset, u32 size) {
+	Record(IoTraceOp::READ, handle, offset, size, 0, 0, "");
+}
+
+void RecordSeek(u32 handle, s64 offset, int whence, s64 result) {
+	Record(IoTraceOp::SEEK, handle, offset, 0, (s32)std::max(std::min(result, (s64)0x7FFFFFFF), (s64)-0x80000000LL), whence, "");
+}
+
+void RecordClose(u32 handle) {
+	Record(IoTraceOp::CLOSE, handle, 0, 0, 0, 0, "");
+}
+
+bool Load(const Path &filename, std::vector<Entry> *entries, std::string *error) {
+	std::string data;
+	if (!File::ReadBinaryFileToString(filename, &data)) {
+		*error = "Could not read " + filename.ToVisualString();
+		return false;
+	}
+
+	IoTraceHeader header;
+	if (data.size() < sizeof(header)) {
+		*error = "Not an I/O trace";
+		return false;
+	}
+	memcpy(&header, data.data(), sizeof(header));
+	if (memcmp(header.magic, IOTRACE_MAGIC, sizeof(header.magic)) != 0) {
+		*error = "Not an I/O trace";
+		return false;
+	}
+	if (header.version != IOTRACE_VERSION) {
+		*error = StringFromFormat("Unsupported I/O trace version %d", (int)header.version);
+		return false;
+	}
+
+	entries->clear();
+	size_t pos = sizeof(header);
+	while (pos + sizeof(IoTraceRecord) <= data.size()) {
+		Entry entry;
+		memcpy(&entry.record, data.data() + pos, sizeof(IoTraceRecord));
+		pos += sizeof(IoTraceRecord);
+		if (pos + entry.record.pathLength > data.size())
+			break;
+		entry.path.assign(data.data() + pos, entry.record.pathLength);
+		pos += entry.record.pathLength;
+		entries->push_back(std::move(entry));
+	}
+	if (pos != data.size()) {
+		// Probably cut off by a crash. Everything before that is still good.
+		WARN_LOG(Log::sceIo, "I/O trace %s has %d trailing bytes", filename.c_str(), (int)(data.size() - pos));
+	}
+	return true;
+}
+
+static void AddLatency(u64 *buckets, double seconds) {
+	u64 us = (u64)(seconds * 1000000.0);
+	int bucket = 0;
+	while (us != 0 && bucket < LATENCY_BUCKETS - 1) {
+		us >>= 1;
+		bucket++;
+	}
+	buckets[bucket]++;
+}
+
+void Replay(MetaFileSystem *fs, const std::vector<Entry> &entries, ReplayStats *stats) {
+	// From traced handles to the ones we got now.
+	std::map<u32, u32> handles;
+	std::vector<u8> buffer;
+
+	double replayStart = time_now_d();
+	for (const Entry &entry : entries) {
+		const IoTraceRecord &record = entry.record;
+		auto it = handles.find(record.handle);
+
+		switch ((IoTraceOp)record.op) {
+		case IoTraceOp::OPEN:
+		{
+			if (record.result < 0 || (record.size & FILEACCESS_READ) == 0) {
+				// Failed for the game too, or only for writing, nothing to compare.
+				break;
+			}
+			stats->opens++;
+			double start = time_now_d();
+			int h = fs->OpenFile(entry.path, FILEACCESS_READ);
+			AddLatency(stats->openLatency, time_now_d() - start);
+			if (h < 0) {
+				stats->failedOpens++;
+				DEBUG_LOG(Log::sceIo, "I/O trace replay: could not open %s", entry.path.c_str());
+			} else {
+				handles[record.handle] = (u32)h;
+			}
+			break;
+		}
+
+		case IoTraceOp::READ:
+		{
+			if (it == handles.end()) {
+				stats->skipped++;
+				break;
+			}
+			if (buffer.size() < record.size)
+				buffer.resize(record.size);
+			double start = time_now_d();
+			fs->SeekFile(it->second, (s32)record.offset, FILEMOVE_BEGIN);
+			size_t bytes = fs->ReadFile(it->second, buffer.data(), record.size);
+			double elapsed = time_now_d() - start;
+			AddLatency(stats->readLatency, elapsed);
+			stats->readSeconds += elapsed;
+			stats->bytesRead += bytes;
+			stats->reads++;
+			break;
+		}
+
+		case IoTraceOp::SEEK:
+			if (it == handles.end()) {
+				stats->skipped++;
+				break;
+			}
+			fs->SeekFile(it->second, (s32)record.offset, (FileMove)record.whence);
+			stats->seeks++;
+			break;
+
+		case IoTraceOp::CLOSE:
+			if (it == handles.end()) {
+				stats->skipped++;
+				break;
+			}
+			fs->CloseFile(it->second);
+			handles.erase(it);
+			stats->closes++;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	for (auto &it : handles) {
+		fs->CloseFile(it.second);
+	}
+	stats->totalSeconds = time_now_d() - replayStart;
+}
+
+}  // namespace IoTrace
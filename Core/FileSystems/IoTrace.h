@@ -0,0 +1,104 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+// Records the file accesses a game makes through sceIo (open, read, seek, close) to a compact
+// binary file, and replays them against a disc image to measure the file loading stack.
+// Used to tune read-ahead and caching with real access patterns.
+
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/File/Path.h"
+#include "Common/Swap.h"
+
+class MetaFileSystem;
+
+enum class IoTraceOp : u8 {
+	OPEN = 1,
+	READ = 2,
+	SEEK = 3,
+	CLOSE = 4,
+};
+
+#pragma pack(push, 1)
+struct IoTraceHeader {
+	char magic[4];  // IOTRACE_MAGIC
+	u32_le version;
+	u64_le startTime;  // Host time, seconds since the epoch.
+};
+
+// Followed by pathLength bytes of path, for OPEN.
+struct IoTraceRecord {
+	u8 op;  // IoTraceOp
+	u8 whence;  // SEEK only.
+	u16_le pathLength;
+	u32_le handle;  // The file system handle, not the PSP fd.
+	s64_le offset;  // READ: position before the read. SEEK: requested offset.
+	u32_le size;  // READ: requested bytes. OPEN: access flags.
+	s32_le result;  // OPEN: handle or error. SEEK: resulting position (clamped.)
+	u64_le emuTimeUs;
+	u64_le hostTimeUs;  // Since the trace was started.
+};
+#pragma pack(pop)
+
+namespace IoTrace {
+
+bool Start(const Path &filename);
+void Stop();
+bool IsRecording();
+
+// Picks a new file in the dump directory.
+Path GenerateFilename();
+
+void RecordOpen(u32 handle, const std::string &path, int access, int result);
+void RecordRead(u32 handle, s64 offset, u32 size);
+void RecordSeek(u32 handle, s64 offset, int whence, s64 result);
+void RecordClose(u32 handle);
+
+struct Entry {
+	IoTraceRecord record;
+	std::string path;
+};
+
+bool Load(const Path &filename, std::vector<Entry> *entries, std::string *error);
+
+// Latency buckets are powers of two in microseconds: bucket N is [2^(N-1), 2^N), bucket 0 is < 1us.
+enum {
+	LATENCY_BUCKETS = 24,
+};
+
+struct ReplayStats {
+	int opens = 0;
+	int failedOpens = 0;
+	int reads = 0;
+	int seeks = 0;
+	int closes = 0;
+	int skipped = 0;  // Operations on files that couldn't be opened during replay.
+	u64 bytesRead = 0;
+	double readSeconds = 0.0;
+	double totalSeconds = 0.0;
+	u64 openLatency[LATENCY_BUCKETS]{};
+	u64 readLatency[LATENCY_BUCKETS]{};
+};
+
+// Runs the entries against fs, as fast as possible. Only reads are replayed, writes were never traced.
+void Replay(MetaFileSystem *fs, const std::vector<Entry> &entries, ReplayStats *stats);
+
+}  // namespace IoTrace
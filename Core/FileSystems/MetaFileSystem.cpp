@@ -682,3 +682,11 @@ bool MetaFileSystem::ComputeRecursiveDirSizeIfFast(const std::string &path, int6
 	_dbg_assert_(false);
 	return false;
 }
+
+void MetaFileSystem::FlushWrites(bool onlyExpired) {
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	// The same system is often mounted more than once, but there's nothing left to flush the second time.
+	for (auto &mount : fileSystems) {
+		mount.system->FlushWrites(onlyExpired);
+	}
+}
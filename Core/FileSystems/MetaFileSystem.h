@@ -145,6 +145,7 @@ class MetaFileSystem : public IHandleAllocator, public IFileSystem {
 	int64_t ComputeRecursiveDirectorySize(const std::string &dirPath);
 
 	bool ComputeRecursiveDirSizeIfFast(const std::string &path, int64_t *size) override;
+	void FlushWrites(bool onlyExpired) override;
 
 	void Describe(char *buf, size_t size) const override { snprintf(buf, size, "Meta"); }
 
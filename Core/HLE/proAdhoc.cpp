@@ -802,6 +802,7 @@ void linkEVMessage(SceNetAdhocMatchingContext * context, ThreadMessage * message
 	// Link Message
 	message->next = context->event_stack;
 	context->event_stack = message;
+	context->eventwake->notify_all();
 
 	// Unlock Access
 	context->eventlock->unlock();
@@ -823,6 +824,7 @@ void linkIOMessage(SceNetAdhocMatchingContext * context, ThreadMessage * message
 
 	// Unlock Access
 	context->inputlock->unlock();
+	context->inputwake->Notify();
 }
 
 /**
@@ -1326,6 +1328,144 @@ int GetChatMessageCount() {
 	return chatMessageCount;
 }
 
+// Longest the friendFinder sleeps without anything happening, bounds how late timeouts get noticed.
+#define FRIENDFINDER_MAX_WAIT_US 100000
+
+bool AdhocWakeupSocket::Open(const char *owner) {
+	int fd = (int)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (fd == (int)INVALID_SOCKET)
+		return false;
+
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addrLen = sizeof(addr);
+	if (bind(fd, (sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR || getsockname(fd, (sockaddr *)&addr, &addrLen) == SOCKET_ERROR) {
+		WARN_LOG(Log::sceNet, "%s: Failed to set up wakeup socket (%i), falling back to polling", owner, socket_errno);
+		closesocket(fd);
+		return false;
+	}
+	changeBlockingMode(fd, 1);
+
+	std::lock_guard<std::mutex> guard(lock_);
+	fd_ = fd;
+	addr_ = addr;
+	return true;
+}
+
+void AdhocWakeupSocket::Close() {
+	std::lock_guard<std::mutex> guard(lock_);
+	if (fd_ != (int)INVALID_SOCKET)
+		closesocket(fd_);
+	fd_ = (int)INVALID_SOCKET;
+}
+
+void AdhocWakeupSocket::Notify() {
+	std::lock_guard<std::mutex> guard(lock_);
+	if (fd_ != (int)INVALID_SOCKET) {
+		uint8_t wake = 0;
+		sendto(fd_, (const char *)&wake, 1, 0, (sockaddr *)&addr_, sizeof(addr_));
+	}
+}
+
+void AdhocWakeupSocket::Wait(int waitfd, int timeoutUS) {
+	int wakefd = fd_;
+	fd_set readfds;
+	FD_ZERO(&readfds);
+	int maxfd = -1;
+	for (int fd : { waitfd, wakefd }) {
+#if !defined(_WIN32)
+		if (fd >= FD_SETSIZE)
+			continue;
+#endif
+		if (fd < 0)
+			continue;
+		FD_SET(fd, &readfds);
+		maxfd = std::max(maxfd, fd);
+	}
+
+	// Nothing to wait on, just poll like before.
+	if (maxfd < 0 || wakefd < 0) {
+		sleep_ms(std::min(timeoutUS / 1000, 10), "pro-adhoc-poll-2");
+		if (maxfd < 0)
+			return;
+		timeoutUS = 0;
+	}
+
+	timeval tval;
+	tval.tv_sec = timeoutUS / 1000000;
+	tval.tv_usec = timeoutUS % 1000000;
+	int ret = select(maxfd + 1, &readfds, nullptr, nullptr, &tval);
+	if (ret < 0) {
+		// Don't spin if select itself is failing.
+		sleep_ms(10, "pro-adhoc-poll-error");
+		return;
+	}
+
+	if (wakefd >= 0 && FD_ISSET(wakefd, &readfds)) {
+		uint8_t buffer[64];
+		while (recv(wakefd, (char *)buffer, sizeof(buffer), 0) > 0) {}
+	}
+}
+
+// Lets sceNetAdhocctl calls interrupt the friendFinder's wait.
+static AdhocWakeupSocket friendFinderWakeup;
+
+void wakeupFriendFinder() {
+	friendFinderWakeup.Notify();
+}
+
+// Round trip times of adhocctl requests, indexed by opcode. Only used with bAdhocLatencyLog.
+struct AdhocctlLatency {
+	double sentTime;
+	int count;
+	double totalMs;
+	double maxMs;
+};
+static std::mutex adhocctlLatencyLock;
+static AdhocctlLatency adhocctlLatency[256];
+
+void adhocctlRequestSent(uint8_t opcode) {
+	if (!g_Config.bAdhocLatencyLog)
+		return;
+	std::lock_guard<std::mutex> guard(adhocctlLatencyLock);
+	adhocctlLatency[opcode].sentTime = time_now_d();
+}
+
+void adhocctlResponseReceived(uint8_t opcode) {
+	if (!g_Config.bAdhocLatencyLog)
+		return;
+	std::lock_guard<std::mutex> guard(adhocctlLatencyLock);
+	AdhocctlLatency &latency = adhocctlLatency[opcode];
+	// Responses can also come without a request, ie. a BSSID after the host left.
+	if (latency.sentTime == 0.0)
+		return;
+
+	double ms = (time_now_d() - latency.sentTime) * 1000.0;
+	latency.sentTime = 0.0;
+	latency.count++;
+	latency.totalMs += ms;
+	latency.maxMs = std::max(latency.maxMs, ms);
+	INFO_LOG(Log::sceNet, "FriendFinder: %s round trip %0.2f ms (avg %0.2f ms, max %0.2f ms over %d)", opcode == OPCODE_SCAN ? "Scan" : "Connect", ms, latency.totalMs / latency.count, latency.maxMs, latency.count);
+}
+
+// Drops the connection to the AdhocServer, it gets re-established on demand.
+static void disconnectFromAdhocServer(int error) {
+	auto n = GetI18NCategory(I18NCat::NETWORKING);
+	g_adhocServerConnected = false;
+	shutdown((int)metasocket, SD_BOTH);
+	closesocket((int)metasocket);
+	metasocket = (int)INVALID_SOCKET;
+	std::string message(n->T("Disconnected from AdhocServer"));
+	if (error != 0)
+		message += " (" + std::string(n->T("Error")) + ": " + std::to_string(error) + ")";
+	g_OSD.Show(OSDType::MESSAGE_ERROR, message);
+	// Mark all friends as timedout since we won't be able to detects disconnected friends anymore without being connected to Adhoc Server
+	peerlock.lock();
+	timeoutFriendsRecursive(friends);
+	peerlock.unlock();
+}
+
 // TODO: We should probably change this thread into PSPThread (or merging it into the existing AdhocThread PSPThread) as there are too many global vars being used here which also being used within some HLEs
 int friendFinder() {
 	SetCurrentThreadName("FriendFinder");
@@ -1370,6 +1510,7 @@ int friendFinder() {
 	g_adhocServerIP.in.sin_port = htons(SERVER_PORT);
 
 	// Finder Loop
+	friendFinderWakeup.Open("FriendFinder");
 	friendFinderRunning = true;
 	while (friendFinderRunning) {
 		// Acquire Network Lock
@@ -1415,15 +1556,7 @@ int friendFinder() {
 					if (iResult == SOCKET_ERROR) {
 						ERROR_LOG(Log::sceNet, "FriendFinder: Socket Error (%i) when sending OPCODE_PING", error);
 						if (error != EAGAIN && error != EWOULDBLOCK) {
-							g_adhocServerConnected = false;
-							shutdown((int)metasocket, SD_BOTH);
-							closesocket((int)metasocket);
-							metasocket = (int)INVALID_SOCKET;
-							g_OSD.Show(OSDType::MESSAGE_ERROR, std::string(n->T("Disconnected from AdhocServer")) + " (" + std::string(n->T("Error")) + ": " + std::to_string(error) + ")");
-							// Mark all friends as timedout since we won't be able to detects disconnected friends anymore without being connected to Adhoc Server
-							peerlock.lock();
-							timeoutFriendsRecursive(friends);
-							peerlock.unlock();
+							disconnectFromAdhocServer(error);
 						}
 					}
 					else {
@@ -1435,8 +1568,9 @@ int friendFinder() {
 			}
 
 			// Check for Incoming Data
-			if (IsSocketReady((int)metasocket, true, false) > 0) {
+			if (g_adhocServerConnected && IsSocketReady((int)metasocket, true, false) > 0) {
 				int received = (int)recv((int)metasocket, (char*)(rx + rxpos), sizeof(rx) - rxpos, MSG_NOSIGNAL);
+				int error = socket_errno;
 
 				// Free Network Lock
 				//_freeNetworkLock();
@@ -1450,6 +1584,11 @@ int friendFinder() {
 					//printf("Received %d Bytes of Data from Server\n", received);
 					INFO_LOG(Log::sceNet, "Received %d Bytes of Data from Adhoc Server", received);
 				}
+				// Connection closed, otherwise we'd keep waking up to read nothing
+				else if (rxpos < (int)sizeof(rx) && (received == 0 || (error != EAGAIN && error != EWOULDBLOCK))) {
+					ERROR_LOG(Log::sceNet, "FriendFinder: Connection to Adhoc Server lost (%i)", received == 0 ? 0 : error);
+					disconnectFromAdhocServer(received == 0 ? 0 : error);
+				}
 			}
 
 			// Calculate EnterGameMode Timeout to prevent waiting forever for disconnected players
@@ -1458,8 +1597,10 @@ int friendFinder() {
 				notifyAdhocctlHandlers(ADHOCCTL_EVENT_ERROR, SCE_NET_ADHOC_ERROR_TIMEOUT);
 			}
 
-			// Handle Packets
-			if (rxpos > 0) {
+			// Handle Packets, all complete ones as we won't be woken up again for data that's already here
+			while (rxpos > 0) {
+				int lastrxpos = rxpos;
+
 				// BSSID Packet
 				if (rx[0] == OPCODE_CONNECT_BSSID) {
 					// Enough Data available
@@ -1495,6 +1636,7 @@ int friendFinder() {
 							//adhocctlState = ADHOCCTL_STATE_CONNECTED;
 							notifyAdhocctlHandlers(ADHOCCTL_EVENT_CONNECT, 0);
 						}
+						adhocctlResponseReceived(OPCODE_CONNECT);
 
 						// Give time a little time
 						//sceKernelDelayThread(adhocEventDelayMS * 1000);
@@ -1726,6 +1868,7 @@ int friendFinder() {
 
 					// Notify Event Handlers
 					notifyAdhocctlHandlers(ADHOCCTL_EVENT_SCAN, 0);
+					adhocctlResponseReceived(OPCODE_SCAN);
 
 					// Move RX Buffer
 					memmove(rx, rx + 1, sizeof(rx) - 1);
@@ -1733,10 +1876,23 @@ int friendFinder() {
 					// Fix RX Buffer Length
 					rxpos -= 1;
 				}
+
+				// Incomplete (or unknown) Packet
+				if (rxpos == lastrxpos)
+					break;
 			}
 		}
-		// This delay time should be 100ms when there is an event otherwise 500ms ?
-		sleep_ms(10, "pro-adhoc-poll-2"); // Using 1ms for faster response just like AdhocServer?
+
+		// Wait for Server Data, a Wakeup, or the next Ping (whichever comes first) instead of polling
+		int timeoutUS = FRIENDFINDER_MAX_WAIT_US;
+		if (g_adhocServerConnected) {
+			s64 untilPing = static_cast<s64>(lastping + PSP_ADHOCCTL_PING_TIMEOUT - (uint64_t)(time_now_d() * 1000000.0));
+			// A Ping that couldn't be sent yet gets retried soon
+			timeoutUS = untilPing > 0 ? (int)std::min<s64>(untilPing, timeoutUS) : 10000;
+		}
+		// A full RX Buffer can't take more data, don't let it keep waking us up
+		bool canReceive = g_adhocServerConnected && rxpos < (int)sizeof(rx);
+		friendFinderWakeup.Wait(canReceive ? (int)metasocket : (int)INVALID_SOCKET, timeoutUS);
 
 		// Don't do anything if it's paused, otherwise the log will be flooded
 		while (Core_IsStepping() && coreState != CORE_POWERDOWN && friendFinderRunning)
@@ -1748,6 +1904,7 @@ int friendFinder() {
 	// Prevent the games from having trouble to reInitiate Adhoc (the next NetInit -> PdpCreate after NetTerm)
 	adhocctlState = ADHOCCTL_STATE_DISCONNECTED;
 	friendFinderRunning = false;
+	friendFinderWakeup.Close();
 
 	// Log Shutdown
 	INFO_LOG(Log::sceNet, "FriendFinder: End of Friend Finder Thread");
@@ -2223,7 +2380,9 @@ int initNetwork(SceNetAdhocctlAdhocId *adhoc_id){
 			if (coreState == CORE_POWERDOWN) 
 				return iResult;
 
-			done = (IsSocketReady((int)metasocket, false, true) > 0);
+			// Block until the socket becomes writable (connected or failed), in slices so we still notice power down
+			bool ready = (IsSocketReady((int)metasocket, false, true, nullptr, FRIENDFINDER_MAX_WAIT_US) > 0);
+			done = ready;
 			struct sockaddr_in sin;
 			socklen_t sinlen = sizeof(sin);
 			memset(&sin, 0, sinlen);
@@ -2235,7 +2394,9 @@ int initNetwork(SceNetAdhocctlAdhocId *adhoc_id){
 					errorcode = ETIMEDOUT;
 				break;
 			}
-			sleep_ms(10, "pro-adhoc-socket-poll");
+			// Writable but not connected yet, don't spin on it
+			if (ready && !done)
+				sleep_ms(10, "pro-adhoc-socket-poll");
 		}
 		if (!done) {
 			ERROR_LOG(Log::sceNet, "Socket error (%i) when connecting to AdhocServer [%s/%s:%u]", errorcode, g_Config.proAdhocServer.c_str(), ip2str(g_adhocServerIP.in.sin_addr).c_str(), ntohs(g_adhocServerIP.in.sin_port));
@@ -26,6 +26,7 @@
 #endif
 
 #include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <thread>
 #include <climits>
@@ -411,6 +412,23 @@ typedef struct ThreadMessage {
   s32_le optlen;
 } ThreadMessage;
 
+// Lets other threads interrupt a select() right away: a UDP socket bound to loopback that gets a byte sent to itself.
+// Unlike a pipe, that works with select() on Windows too. Only the waiting thread should open and close it.
+class AdhocWakeupSocket {
+public:
+	bool Open(const char *owner);
+	void Close();
+	void Notify();
+	// Blocks until fd (if valid) is readable, Notify() gets called, or the timeout passes.
+	// Without a wakeup socket, falls back to sleeping (at most 10ms) and checking fd after.
+	void Wait(int fd, int timeoutUS);
+
+private:
+	std::mutex lock_;
+	int fd_ = (int)INVALID_SOCKET;
+	sockaddr_in addr_{};
+};
+
 // Established Peer
 
 // Context Information
@@ -505,10 +523,14 @@ typedef struct SceNetAdhocMatchingContext {
   // Event Caller Thread Message Stack
   std::recursive_mutex *eventlock; // s32_le event_stack_lock;
   ThreadMessage *event_stack;
+  // Signaled (with eventlock) when a message gets linked, or the thread should stop
+  std::condition_variable_any *eventwake;
 
   // IO Handler Thread Message Stack
   std::recursive_mutex *inputlock; // s32_le input_stack_lock;
   ThreadMessage *input_stack;
+  // Wakes the IO Handler Thread up from waiting for data when a message gets linked, or the thread should stop
+  AdhocWakeupSocket *inputwake;
 
   // Socket Connectivity
   //bool connected = false;
@@ -957,6 +979,18 @@ void timeoutFriendsRecursive(SceNetAdhocctlPeerInfo * node, int32_t* count = nul
  */
 int friendFinder();
 
+/**
+ * Wake the Friend Finder up from waiting for Server Data (ie. to shut down, or to log in again)
+ */
+void wakeupFriendFinder();
+
+/**
+ * Round trip measurement of Adhocctl Requests (with bAdhocLatencyLog), handy against a local AdhocServer
+ * @param opcode Request Opcode (OPCODE_SCAN or OPCODE_CONNECT)
+ */
+void adhocctlRequestSent(uint8_t opcode);
+void adhocctlResponseReceived(uint8_t opcode);
+
 /**
 * Find Free Matching ID
 * @return First unoccupied Matching ID
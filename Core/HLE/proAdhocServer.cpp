@@ -23,13 +23,32 @@
 
 #include "ppsspp_config.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <signal.h>
 
 #include <sys/types.h>
+#if PPSSPP_PLATFORM(LINUX)
+#define ADHOCSERVER_USE_EPOLL 1
+#include <sys/epoll.h>
+#elif !PPSSPP_PLATFORM(WINDOWS)
+#include <poll.h>
+#endif
 #include "Common/Net/SocketCompat.h"
+#include "Common/Data/Format/JSONWriter.h"
 #include "Common/Data/Text/I18n.h"
 #include "Common/Thread/ThreadUtil.h"
 #include "Common/System/OSD.h"
@@ -39,6 +58,7 @@
 #include "Core/Util/PortManager.h"
 #include "Core/Instance.h"
 #include "Core/Core.h"
+#include "Core/Config.h"
 #include "Core/HLE/proAdhocServer.h"
 
 #ifdef _WIN32
@@ -46,14 +66,45 @@
 #define errno WSAGetLastError()
 #endif
 
+// Every server thread has its own database: the main loop (which holds the users that haven't logged in
+// yet), and with iAdhocServerShards set, each shard worker (which owns the games whose product codes
+// hash to it.) Everything a game does stays on one thread, that way.
+
 // User Count
-uint32_t _db_user_count = 0;
+thread_local uint32_t _db_user_count = 0;
 
 // User Database
-SceNetAdhocctlUserNode * _db_user = NULL;
+thread_local SceNetAdhocctlUserNode * _db_user = NULL;
 
 // Game Database
-SceNetAdhocctlGameNode * _db_game = NULL;
+thread_local SceNetAdhocctlGameNode * _db_game = NULL;
+
+// Lookup indexes kept alongside the lists above, so that logins and joins don't have to walk every user.
+// The lists stay the owners of the nodes.
+struct AdhocServerGroupKey {
+	const SceNetAdhocctlGameNode * game;
+	uint64_t name;
+	bool operator ==(const AdhocServerGroupKey &other) const { return game == other.game && name == other.name; }
+};
+
+struct AdhocServerGroupKeyHash {
+	size_t operator ()(const AdhocServerGroupKey &key) const {
+		return std::hash<const void *>()(key.game) ^ std::hash<uint64_t>()(key.name);
+	}
+};
+
+// Duplicate MACs are allowed (with a warning), so this is a multimap.
+static thread_local std::unordered_multimap<uint64_t, SceNetAdhocctlUserNode *> _db_user_by_mac;
+static thread_local std::unordered_map<std::string, SceNetAdhocctlGameNode *> _db_game_by_product;
+static thread_local std::unordered_map<AdhocServerGroupKey, SceNetAdhocctlGroupNode *, AdhocServerGroupKeyHash> _db_group_by_name;
+
+// Shared between all server threads: IPs are unique across the whole server, and so is the user limit.
+static std::mutex _db_user_ips_lock;
+static std::unordered_set<uint32_t> _db_user_ips;
+static std::atomic<uint32_t> _db_total_user_count(0);
+
+// productids grows when unknown games log in, which can happen on any shard.
+static std::mutex productidsLock;
 
 // Server Status
 std::atomic<bool> adhocServerRunning(false);
@@ -476,6 +527,277 @@ void change_blocking_mode(int fd, int nonblocking);
 int create_listen_socket(uint16_t port);
 int server_loop(int server);
 
+// Waits for activity on the listening socket (or a shard's wake-up socket) and the user streams, so each
+// pass of a server loop only needs to look at the users that actually sent something (or dropped.)
+// Uses epoll where available, and poll() (WSAPoll on Windows) elsewhere.
+class AdhocServerPoller {
+public:
+	bool Init(int server);
+	void Shutdown();
+
+	void Add(SceNetAdhocctlUserNode * user);
+	void Remove(SceNetAdhocctlUserNode * user);
+
+	// Returns the number of ready sockets, or -1 on error. Users with pending data are put in ready.
+	int Wait(int timeoutMs, bool * serverReady, std::vector<SceNetAdhocctlUserNode *> & ready);
+
+private:
+	bool active_ = false;
+#ifdef ADHOCSERVER_USE_EPOLL
+	int epollfd_ = -1;
+	std::vector<epoll_event> events_;
+#else
+	// Index 0 is the listening socket, the rest line up with users_.
+	std::vector<pollfd> fds_;
+	std::vector<SceNetAdhocctlUserNode *> users_;
+#endif
+};
+
+static thread_local AdhocServerPoller serverPoller;
+
+// A worker thread owning part of the games. The main loop hands users over through the inbox once
+// their login packet has arrived, and pokes wakefd (a loopback UDP socket) to wake the worker up.
+struct AdhocServerShard {
+	int index = 0;
+	int wakefd = -1;
+	struct sockaddr_in wakeaddr {};
+	std::mutex inboxLock;
+	std::vector<SceNetAdhocctlUserNode *> inbox;
+	std::atomic<bool> running{ true };
+	std::promise<bool> started;
+	std::thread thread;
+};
+
+// Empty unless sharding is enabled. Shard N (1 based) is serverShards[N - 1], 0 is the main loop.
+static std::vector<std::unique_ptr<AdhocServerShard>> serverShards;
+static thread_local int currentShard = 0;
+
+static std::mutex serverStatsLock;
+static AdhocServerStats serverStats;
+
+// In-memory copy of what goes into the status file, so the server loop doesn't have to do file I/O
+// on every login and group change. Each server thread only touches its own database, and hands snapshots
+// of it over to the writer thread (and the web server) under statusLock.
+struct AdhocServerStatus {
+	struct Group {
+		std::string name;
+		uint32_t usercount = 0;
+		std::vector<std::string> users;
+	};
+	struct Game {
+		std::string name;
+		std::string productid;
+		uint32_t usercount = 0;
+		uint32_t groupless = 0;
+		std::vector<Group> groups;
+	};
+
+	uint32_t usercount = 0;
+	std::vector<Game> games;
+};
+
+// Per server thread
+static thread_local bool statusDirty;
+static thread_local double statusNextSnapshot;
+
+static std::mutex statusLock;
+static std::condition_variable statusCond;
+// One per server thread, indexed like currentShard.
+static std::vector<AdhocServerStatus> statusSnapshots;
+static uint64_t statusVersion;
+static bool statusWriterStop;
+static std::thread statusWriter;
+
+static void flush_status(bool force);
+static void status_writer_thread(uint64_t written);
+
+bool AdhocServerPoller::Init(int server)
+{
+#ifdef ADHOCSERVER_USE_EPOLL
+	epollfd_ = epoll_create1(EPOLL_CLOEXEC);
+	if (epollfd_ == -1) return false;
+
+	// The listening socket is the only one without a user.
+	epoll_event ev{};
+	ev.events = EPOLLIN;
+	ev.data.ptr = nullptr;
+	if (epoll_ctl(epollfd_, EPOLL_CTL_ADD, server, &ev) == -1) {
+		close(epollfd_);
+		epollfd_ = -1;
+		return false;
+	}
+	events_.resize(64);
+#else
+	pollfd pfd{};
+	pfd.fd = server;
+	pfd.events = POLLIN;
+	fds_.assign(1, pfd);
+	users_.clear();
+#endif
+	active_ = true;
+	return true;
+}
+
+void AdhocServerPoller::Shutdown()
+{
+	active_ = false;
+#ifdef ADHOCSERVER_USE_EPOLL
+	if (epollfd_ != -1) close(epollfd_);
+	epollfd_ = -1;
+#else
+	fds_.clear();
+	users_.clear();
+#endif
+}
+
+void AdhocServerPoller::Add(SceNetAdhocctlUserNode * user)
+{
+	if (!active_) return;
+#ifdef ADHOCSERVER_USE_EPOLL
+	epoll_event ev{};
+	ev.events = EPOLLIN;
+	ev.data.ptr = user;
+	if (epoll_ctl(epollfd_, EPOLL_CTL_ADD, user->stream, &ev) == -1) {
+		WARN_LOG(Log::sceNet, "AdhocServer: Failed to watch socket %d (error %d)", user->stream, errno);
+	}
+#else
+	pollfd pfd{};
+	pfd.fd = user->stream;
+	pfd.events = POLLIN;
+	fds_.push_back(pfd);
+	users_.push_back(user);
+#endif
+}
+
+void AdhocServerPoller::Remove(SceNetAdhocctlUserNode * user)
+{
+	if (!active_) return;
+#ifdef ADHOCSERVER_USE_EPOLL
+	epoll_ctl(epollfd_, EPOLL_CTL_DEL, user->stream, nullptr);
+#else
+	auto it = std::find(users_.begin(), users_.end(), user);
+	if (it == users_.end()) return;
+
+	// Order doesn't matter, so swap with the last one.
+	size_t index = it - users_.begin();
+	users_[index] = users_.back();
+	users_.pop_back();
+	fds_[index + 1] = fds_.back();
+	fds_.pop_back();
+#endif
+}
+
+int AdhocServerPoller::Wait(int timeoutMs, bool * serverReady, std::vector<SceNetAdhocctlUserNode *> & ready)
+{
+	ready.clear();
+	*serverReady = false;
+#ifdef ADHOCSERVER_USE_EPOLL
+	// Grow the event buffer along with the number of users, so a busy server drains everything in one go.
+	if (events_.size() < (size_t)_db_user_count + 1) events_.resize(_db_user_count + 1);
+	int count = epoll_wait(epollfd_, events_.data(), (int)events_.size(), timeoutMs);
+	if (count < 0) return errno == EINTR ? 0 : -1;
+
+	for (int i = 0; i < count; i++) {
+		if (events_[i].data.ptr == nullptr) *serverReady = true;
+		else ready.push_back((SceNetAdhocctlUserNode *)events_[i].data.ptr);
+	}
+	return count;
+#else
+#if PPSSPP_PLATFORM(WINDOWS)
+	int count = WSAPoll(fds_.data(), (ULONG)fds_.size(), timeoutMs);
+#else
+	int count = poll(fds_.data(), (nfds_t)fds_.size(), timeoutMs);
+#endif
+	if (count < 0) return socket_errno == EINTR ? 0 : -1;
+	if (count == 0) return 0;
+
+	// Errors and hangups are also reported, recv() will tell the details.
+	*serverReady = fds_[0].revents != 0;
+	for (size_t i = 1; i < fds_.size(); i++) {
+		if (fds_[i].revents != 0) ready.push_back(users_[i - 1]);
+	}
+	return count;
+#endif
+}
+
+static uint64_t mac_key(const SceNetEtherAddr & mac)
+{
+	uint64_t key = 0;
+	memcpy(&key, mac.data, sizeof(mac.data));
+	return key;
+}
+
+// Keys compare like the strncmp() they replace, so anything after a terminator is ignored.
+static std::string product_key(const SceNetAdhocctlProductCode & product)
+{
+	size_t len = 0;
+	while (len < PRODUCT_CODE_LENGTH && product.data[len] != 0) len++;
+	return std::string(product.data, len);
+}
+
+static AdhocServerGroupKey group_key(const SceNetAdhocctlGameNode * game, const SceNetAdhocctlGroupName & group)
+{
+	AdhocServerGroupKey key{ game, 0 };
+	size_t len = 0;
+	while (len < ADHOCCTL_GROUPNAME_LEN && group.data[len] != 0) len++;
+	memcpy(&key.name, group.data, len);
+	return key;
+}
+
+static void unindex_user_mac(SceNetAdhocctlUserNode * user)
+{
+	auto range = _db_user_by_mac.equal_range(mac_key(user->resolver.mac));
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second == user)
+		{
+			_db_user_by_mac.erase(it);
+			return;
+		}
+	}
+}
+
+/**
+ * Link User into this Thread's Database and start watching its Stream
+ * @param user User Node
+ */
+static void link_user(SceNetAdhocctlUserNode * user)
+{
+	// Link into User List
+	user->prev = NULL;
+	user->next = _db_user;
+	if(_db_user != NULL) _db_user->prev = user;
+	_db_user = user;
+
+	// Wake up the Server Loop when Data arrives
+	serverPoller.Add(user);
+
+	// Fix User Counter
+	_db_user_count++;
+}
+
+/**
+ * Unlink User from this Thread's Database and stop watching its Stream (which stays open)
+ * @param user User Node
+ */
+static void unlink_user(SceNetAdhocctlUserNode * user)
+{
+	// Unlink Leftside (Beginning)
+	if(user->prev == NULL) _db_user = user->next;
+
+	// Unlink Leftside (Other)
+	else user->prev->next = user->next;
+
+	// Unlink Rightside
+	if(user->next != NULL) user->next->prev = user->prev;
+
+	// Stop watching
+	serverPoller.Remove(user);
+
+	// Fix User Counter
+	_db_user_count--;
+}
+
 void __AdhocServerInit() {
 	// Database Product name will update if new game region played on my server to list possible crosslinks
 	productids = std::vector<db_productid>(default_productids, default_productids + ARRAY_SIZE(default_productids));
@@ -490,14 +812,17 @@ void __AdhocServerInit() {
 void login_user_stream(int fd, uint32_t ip)
 {
 	// Enough Space available
-	if(_db_user_count < SERVER_USER_MAXIMUM)
+	if(_db_total_user_count < SERVER_USER_MAXIMUM)
 	{
-		// Check IP Duplication
-		SceNetAdhocctlUserNode * u = _db_user;
-		while(u != NULL && u->resolver.ip != ip) u = u->next;
+		// Check IP Duplication (and reserve it)
+		bool duplicate;
+		{
+			std::lock_guard<std::mutex> guard(_db_user_ips_lock);
+			duplicate = !_db_user_ips.insert(ip).second;
+		}
 
-		if (u != NULL) { // IP Already existed
-			WARN_LOG(Log::sceNet, "AdhocServer: Already Existing IP: %s\n", ip2str(*(in_addr*)&u->resolver.ip).c_str());
+		if (duplicate) { // IP Already existed
+			WARN_LOG(Log::sceNet, "AdhocServer: Already Existing IP: %s\n", ip2str(*(in_addr*)&ip).c_str());
 		}
 
 		// Unique IP Address
@@ -518,19 +843,17 @@ void login_user_stream(int fd, uint32_t ip)
 				// Save IP
 				user->resolver.ip = ip;
 
-				// Link into User List
-				user->next = _db_user;
-				if(_db_user != NULL) _db_user->prev = user;
-				_db_user = user;
-
 				// Initialize Death Clock
 				user->last_recv = time(NULL);
 
+				// Link into User List
+				link_user(user);
+
 				// Notify User
 				INFO_LOG(Log::sceNet, "AdhocServer: New Connection from %s", ip2str(*(in_addr*)&user->resolver.ip).c_str());
 
 				// Fix User Counter
-				_db_user_count++;
+				_db_total_user_count++;
 
 				// Update Status Log
 				update_status();
@@ -538,6 +861,10 @@ void login_user_stream(int fd, uint32_t ip)
 				// Exit Function
 				return;
 			}
+
+			// Release IP Address
+			std::lock_guard<std::mutex> guard(_db_user_ips_lock);
+			_db_user_ips.erase(ip);
 		}
 	}
 
@@ -566,8 +893,8 @@ void login_user_data(SceNetAdhocctlUserNode * user, SceNetAdhocctlLoginPacketC2S
 	if(valid_product_code == 1 && memcmp(&data->mac, "\xFF\xFF\xFF\xFF\xFF\xFF", sizeof(data->mac)) != 0 && memcmp(&data->mac, "\x00\x00\x00\x00\x00\x00", sizeof(data->mac)) != 0 && data->name.data[0] != 0)
 	{
 		// Check for duplicated MAC as most games identify Players by MAC
-		SceNetAdhocctlUserNode* u = _db_user;
-		while (u != NULL && !IsMatch(u->resolver.mac, data->mac)) u = u->next;
+		auto existing = _db_user_by_mac.find(mac_key(data->mac));
+		SceNetAdhocctlUserNode* u = existing != _db_user_by_mac.end() ? existing->second : NULL;
 
 		if (u != NULL) { // MAC Already existed
 			WARN_LOG(Log::sceNet, "AdhocServer: Already Existing MAC: %s [%s]\n", mac2str(&data->mac).c_str(), ip2str(*(in_addr*)&u->resolver.ip).c_str());
@@ -577,8 +904,8 @@ void login_user_data(SceNetAdhocctlUserNode * user, SceNetAdhocctlLoginPacketC2S
 		game_product_override(&data->game);
 
 		// Find existing Game
-		SceNetAdhocctlGameNode * game = _db_game;
-		while(game != NULL && strncmp(game->game.data, data->game.data, PRODUCT_CODE_LENGTH) != 0) game = game->next;
+		auto existingGame = _db_game_by_product.find(product_key(data->game));
+		SceNetAdhocctlGameNode * game = existingGame != _db_game_by_product.end() ? existingGame->second : NULL;
 
 		// Game not found
 		if(game == NULL)
@@ -599,6 +926,7 @@ void login_user_data(SceNetAdhocctlUserNode * user, SceNetAdhocctlLoginPacketC2S
 				game->next = _db_game;
 				if(_db_game != NULL) _db_game->prev = game;
 				_db_game = game;
+				_db_game_by_product[product_key(game->game)] = game;
 			}
 		}
 
@@ -607,6 +935,7 @@ void login_user_data(SceNetAdhocctlUserNode * user, SceNetAdhocctlLoginPacketC2S
 		{
 			// Save MAC
 			user->resolver.mac = data->mac;
+			_db_user_by_mac.emplace(mac_key(user->resolver.mac), user);
 
 			// Save Nickname
 			user->resolver.name = data->name;
@@ -651,14 +980,15 @@ void logout_user(SceNetAdhocctlUserNode * user)
 	// Disconnect from Group
 	if(user->group != NULL) disconnect_user(user);
 
-	// Unlink Leftside (Beginning)
-	if(user->prev == NULL) _db_user = user->next;
-
-	// Unlink Leftside (Other)
-	else user->prev->next = user->next;
+	// Unlink from User List and stop watching
+	unlink_user(user);
 
-	// Unlink Rightside
-	if(user->next != NULL) user->next->prev = user->prev;
+	// Remove from Indexes (the MAC is only known once the Login Data arrived)
+	{
+		std::lock_guard<std::mutex> guard(_db_user_ips_lock);
+		_db_user_ips.erase(user->resolver.ip);
+	}
+	if(user->game != NULL) unindex_user_mac(user);
 
 	// Close Stream
 	closesocket(user->stream);
@@ -686,6 +1016,7 @@ void logout_user(SceNetAdhocctlUserNode * user)
 
 			// Unlink Rightside
 			if(user->game->next != NULL) user->game->next->prev = user->game->prev;
+			_db_game_by_product.erase(product_key(user->game->game));
 
 			// Free Game Node Memory
 			free(user->game);
@@ -703,7 +1034,7 @@ void logout_user(SceNetAdhocctlUserNode * user)
 	free(user);
 
 	// Fix User Counter
-	_db_user_count--;
+	_db_total_user_count--;
 
 	// Update Status Log
 	update_status();
@@ -734,6 +1065,11 @@ void free_database()
 		// Move Pointer
 		user = next;
 	}
+
+	// Should already be empty, but just in case
+	_db_user_by_mac.clear();
+	_db_game_by_product.clear();
+	_db_group_by_name.clear();
 }
 
 /**
@@ -773,8 +1109,8 @@ void connect_user(SceNetAdhocctlUserNode * user, SceNetAdhocctlGroupName * group
 		if(user->group == NULL)
 		{
 			// Find Group in Game Node
-			SceNetAdhocctlGroupNode * g = user->game->group;
-			while(g != NULL && strncmp((char *)g->group.data, (char *)group->data, ADHOCCTL_GROUPNAME_LEN) != 0) g = g->next;
+			auto existing = _db_group_by_name.find(group_key(user->game, *group));
+			SceNetAdhocctlGroupNode * g = existing != _db_group_by_name.end() ? existing->second : NULL;
 
 			// BSSID Packet
 			SceNetAdhocctlConnectBSSIDPacketS2C bssid;
@@ -807,6 +1143,7 @@ void connect_user(SceNetAdhocctlUserNode * user, SceNetAdhocctlGroupName * group
 
 					// Copy Group Name
 					g->group = *group;
+					_db_group_by_name[group_key(g->game, g->group)] = g;
 
 					// Increase Group Counter for Game
 					g->game->groupcount++;
@@ -855,13 +1192,14 @@ void connect_user(SceNetAdhocctlUserNode * user, SceNetAdhocctlGroupName * group
 					iResult = (int)send(user->stream, (const char*)&packet, sizeof(packet), MSG_NOSIGNAL);
 					if (iResult < 0) ERROR_LOG(Log::sceNet, "AdhocServer: connect_user[send user] (Socket error %d)", socket_errno);
 
-					// Set BSSID
-					if(peer->group_next == NULL) bssid.mac = peer->resolver.mac;
-
 					// Move Pointer
 					peer = peer->group_next;
 				}
 
+				// Set BSSID
+				if(g->founder != NULL) bssid.mac = g->founder->resolver.mac;
+				else g->founder = user;
+
 				// Link User to Group
 				user->group_next = g->player;
 				if(g->player != NULL) g->player->group_prev = user;
@@ -937,6 +1275,9 @@ void disconnect_user(SceNetAdhocctlUserNode * user)
 	// User is connected
 	if(user->group != NULL)
 	{
+		// The next oldest Player takes over
+		if(user->group->founder == user) user->group->founder = user->group_prev;
+
 		// Unlink Leftside (Beginning)
 		if(user->group_prev == NULL) user->group->player = user->group_next;
 
@@ -993,6 +1334,7 @@ void disconnect_user(SceNetAdhocctlUserNode * user)
 
 			// Unlink Rightside
 			if(user->group->next != NULL) user->group->next->prev = user->group->prev;
+			_db_group_by_name.erase(group_key(user->group->game, user->group->group));
 
 			// Free Group Memory
 			free(user->group);
@@ -1052,17 +1394,8 @@ void send_scan_results(SceNetAdhocctlUserNode * user)
 			// Set Group Name
 			packet.group = group->group;
 
-			// Iterate Players in Network Group
-			SceNetAdhocctlUserNode * peer = group->player;
-			for(; peer != NULL; peer = peer->group_next)
-			{
-				// Found Network Founder
-				if(peer->group_next == NULL)
-				{
-					// Set Group Host MAC
-					packet.mac = peer->resolver.mac;
-				}
-			}
+			// Set Group Host MAC
+			if(group->founder != NULL) packet.mac = group->founder->resolver.mac;
 
 			// Send Group Packet
 			int iResult = (int)send(user->stream, (const char*)&packet, sizeof(packet), MSG_NOSIGNAL);
@@ -1271,6 +1604,9 @@ void game_product_override(SceNetAdhocctlProductCode * product)
 	strncpy(productid, product->data, PRODUCT_CODE_LENGTH);
 	productid[PRODUCT_CODE_LENGTH] = 0;
 
+	// Any Shard may add to productids
+	std::lock_guard<std::mutex> guard(productidsLock);
+
 	// Database Handle
 	//sqlite3 * db = NULL;
 
@@ -1403,140 +1739,280 @@ void game_product_override(SceNetAdhocctlProductCode * product)
  */
 void update_status()
 {
-	// Open Logfile
-	FILE * log = File::OpenCFile(Path(SERVER_STATUS_XMLOUT), "w");
+	// The Server Loop takes care of the rest, rate limited
+	statusDirty = true;
+}
 
-	// Opened Logfile
-	if(log != NULL)
+/**
+ * Copy the Database into a Status Snapshot
+ * @param snapshot OUT Snapshot
+ */
+static void build_status_snapshot(AdhocServerStatus & snapshot)
+{
+	// User Count
+	snapshot.usercount = _db_user_count;
+	snapshot.games.clear();
+
+	// Iterate Games
+	SceNetAdhocctlGameNode * game = _db_game; for(; game != NULL; game = game->next)
 	{
-		// Write XML Header
-		fprintf(log, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+		AdhocServerStatus::Game status;
 
-		// Write XSL Processor Information
-		fprintf(log, "<?xml-stylesheet type=\"text/xsl\" href=\"status.xsl\"?>\n");
+		// Safe Product ID
+		char productid[PRODUCT_CODE_LENGTH + 1];
+		strncpy(productid, game->game.data, PRODUCT_CODE_LENGTH);
+		productid[PRODUCT_CODE_LENGTH] = 0;
+		status.productid = productid;
+
+		// Display Name (Product Code if we don't know the Game)
+		status.name = productid;
+		{
+			std::lock_guard<std::mutex> guard(productidsLock);
+			for (const auto &product : productids) {
+				if (IsMatch(product.id, productid)) {
+					status.name = product.name;
+					break;
+				}
+			}
+		}
 
-		// Output Root Tag + User Count
-		fprintf(log, "<prometheus usercount=\"%u\">\n", _db_user_count);
+		status.usercount = game->playercount;
 
-		// Database Handle
-		//sqlite3 * db = NULL;
+		// Activate User Count
+		uint32_t activecount = 0;
 
-		// Open Database
-		//if(sqlite3_open(SERVER_DATABASE, &db) == SQLITE_OK)
+		// Iterate Game Groups
+		SceNetAdhocctlGroupNode * group = game->group; for(; group != NULL; group = group->next)
 		{
-			// Iterate Games
-			SceNetAdhocctlGameNode * game = _db_game; for(; game != NULL; game = game->next)
+			AdhocServerStatus::Group groupStatus;
+
+			// Safe Group Name
+			char groupname[ADHOCCTL_GROUPNAME_LEN + 1];
+			strncpy(groupname, (const char *)group->group.data, ADHOCCTL_GROUPNAME_LEN);
+			groupname[ADHOCCTL_GROUPNAME_LEN] = 0;
+			groupStatus.name = groupname;
+			groupStatus.usercount = group->playercount;
+
+			// Iterate Users
+			SceNetAdhocctlUserNode * user = group->player; for(; user != NULL; user = user->group_next)
 			{
-				// Safe Product ID
-				char productid[PRODUCT_CODE_LENGTH + 1];
-				strncpy(productid, game->game.data, PRODUCT_CODE_LENGTH);
-				productid[PRODUCT_CODE_LENGTH] = 0;
+				// Safe Username
+				char username[ADHOCCTL_NICKNAME_LEN + 1];
+				strncpy(username, (const char *)user->resolver.name.data, ADHOCCTL_NICKNAME_LEN);
+				username[ADHOCCTL_NICKNAME_LEN] = 0;
+				groupStatus.users.push_back(username);
+			}
 
-				// Display Name
-				char displayname[128];
-				memset(displayname, 0, sizeof(displayname));
+			// Increase Active Game User Count
+			activecount += group->playercount;
 
-				// SQL Statement
-				//const char * sql = "SELECT name FROM productids WHERE id=?;";
+			status.groups.push_back(std::move(groupStatus));
+		}
 
-				// Prepared SQL Statement
-				//sqlite3_stmt * statement = NULL;
+		// Idle Game Users
+		status.groupless = game->playercount > activecount ? game->playercount - activecount : 0;
 
-				// Prepare SQL Statement
-				/*if(sqlite3_prepare_v2(db, sql, strlen(sql) + 1, &statement, NULL) == SQLITE_OK)
-				{
-					// Bind SQL Statement Data
-					if(sqlite3_bind_text(statement, 1, productid, strlen(productid), SQLITE_STATIC) == SQLITE_OK)
-					{
-						// Found Matching Row
-						if(sqlite3_step(statement) == SQLITE_ROW)
-						{
-							// Fetch Game Name from Database
-							const char * gamename = (const char *)sqlite3_column_text(statement, 0);
+		snapshot.games.push_back(std::move(status));
+	}
+}
 
-							// Copy Game Name
-							strcpyxml(displayname, gamename, sizeof(displayname));
-						}
+/**
+ * Take a Status Snapshot if it changed and the Interval passed
+ * @param force Ignore the Interval
+ */
+static void flush_status(bool force)
+{
+	// Nothing changed
+	if(!statusDirty) return;
 
-						// Game not in Database
-						else
-						{
-							// Use Product Code as Name
-							strcpyxml(displayname, productid, sizeof(displayname));
-						}
-					}
+	// Rate Limit
+	double now = time_now_d();
+	if(!force && now < statusNextSnapshot) return;
+	statusNextSnapshot = now + std::max(g_Config.iAdhocServerStatusInterval, 0);
+	statusDirty = false;
 
-					// Destroy Prepared SQL Statement
-					sqlite3_finalize(statement);
-				}*/
-				//db_productid *foundid = NULL;
-				bool found = false;
-				for (const auto &product : productids) {
-					if (IsMatch(product.id, productid)) {
-						// Copy Game Name
-						strcpyxml(displayname, product.name, sizeof(displayname));
-						found = true;
-						break;
-					}
-				}
+	// Build outside the Lock, the Web Server may be reading the last one
+	AdhocServerStatus snapshot;
+	build_status_snapshot(snapshot);
 
-				if (!found) {
-					// Use Product Code as Name
-					strcpyxml(displayname, productid, sizeof(displayname));
-				}
+	{
+		std::lock_guard<std::mutex> guard(statusLock);
+		if(statusSnapshots.size() <= (size_t)currentShard) statusSnapshots.resize(currentShard + 1);
+		statusSnapshots[currentShard] = std::move(snapshot);
+		statusVersion++;
+	}
+	statusCond.notify_one();
 
-				// Output Game Tag + Game Name
-				fprintf(log, "\t<game name=\"%s\" usercount=\"%u\">\n", displayname, game->playercount);
+	std::lock_guard<std::mutex> guard(serverStatsLock);
+	serverStats.statusSnapshots++;
+}
 
-				// Activate User Count
-				uint32_t activecount = 0;
+/**
+ * Combine the Snapshots of all Server Threads, statusLock must be held
+ * @return Status of the whole Server
+ */
+static AdhocServerStatus merged_status()
+{
+	AdhocServerStatus merged;
+	for (const auto &status : statusSnapshots)
+	{
+		merged.usercount += status.usercount;
+		merged.games.insert(merged.games.end(), status.games.begin(), status.games.end());
+	}
+	return merged;
+}
 
-				// Iterate Game Groups
-				SceNetAdhocctlGroupNode * group = game->group; for(; group != NULL; group = group->next)
-				{
-					// Safe Group Name
-					char groupname[ADHOCCTL_GROUPNAME_LEN + 1];
-					strncpy(groupname, (const char *)group->group.data, ADHOCCTL_GROUPNAME_LEN);
-					groupname[ADHOCCTL_GROUPNAME_LEN] = 0;
+/**
+ * Write Status Logfile
+ * @param status Snapshot to write
+ * @return true on success
+ */
+static bool write_status_file(const AdhocServerStatus & status)
+{
+	// Write next to the real file first, so readers never see a partial file
+	Path finalPath(SERVER_STATUS_XMLOUT);
+	Path tempPath(std::string(SERVER_STATUS_XMLOUT) + ".tmp");
 
-					// Output Group Tag + Group Name + User Count
-					fprintf(log, "\t\t<group name=\"%s\" usercount=\"%u\">\n", strcpyxml(displayname, groupname, sizeof(displayname)), group->playercount);
+	// Open Logfile
+	FILE * log = File::OpenCFile(tempPath, "w");
 
-					// Iterate Users
-					SceNetAdhocctlUserNode * user = group->player; for(; user != NULL; user = user->group_next)
-					{
-						// Output User Tag + Username
-						fprintf(log, "\t\t\t<user>%s</user>\n", strcpyxml(displayname, (const char *)user->resolver.name.data, sizeof(displayname)));
-					}
+	// Opened Logfile
+	if(log == NULL) return false;
 
-					// Output Closing Group Tag
-					fprintf(log, "\t\t</group>\n");
+	// Escape Buffer
+	char displayname[128];
 
-					// Increase Active Game User Count
-					activecount += group->playercount;
-				}
+	// Write XML Header
+	fprintf(log, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
 
-				// Output Idle Game Group
-				if(game->playercount > activecount)
-				{
-					// Output Group Tag + Group Name + Idle User Count
-					fprintf(log, "\t\t<group name=\"Groupless\" usercount=\"%u\" />\n", game->playercount - activecount);
-				}
+	// Write XSL Processor Information
+	fprintf(log, "<?xml-stylesheet type=\"text/xsl\" href=\"status.xsl\"?>\n");
+
+	// Output Root Tag + User Count
+	fprintf(log, "<prometheus usercount=\"%u\">\n", status.usercount);
+
+	// Iterate Games
+	for (const auto &game : status.games)
+	{
+		// Output Game Tag + Game Name
+		fprintf(log, "\t<game name=\"%s\" usercount=\"%u\">\n", strcpyxml(displayname, game.name.c_str(), sizeof(displayname)), game.usercount);
 
-				// Output Closing Game Tag
-				fprintf(log, "\t</game>\n");
+		// Iterate Game Groups
+		for (const auto &group : game.groups)
+		{
+			// Output Group Tag + Group Name + User Count
+			fprintf(log, "\t\t<group name=\"%s\" usercount=\"%u\">\n", strcpyxml(displayname, group.name.c_str(), sizeof(displayname)), group.usercount);
+
+			// Iterate Users
+			for (const auto &user : group.users)
+			{
+				// Output User Tag + Username
+				fprintf(log, "\t\t\t<user>%s</user>\n", strcpyxml(displayname, user.c_str(), sizeof(displayname)));
 			}
 
-			// Close Database
-			//sqlite3_close(db);
+			// Output Closing Group Tag
+			fprintf(log, "\t\t</group>\n");
+		}
+
+		// Output Idle Game Group
+		if(game.groupless > 0)
+		{
+			// Output Group Tag + Group Name + Idle User Count
+			fprintf(log, "\t\t<group name=\"Groupless\" usercount=\"%u\" />\n", game.groupless);
+		}
+
+		// Output Closing Game Tag
+		fprintf(log, "\t</game>\n");
+	}
+
+	// Output Closing Root Tag
+	fprintf(log, "</prometheus>");
+
+	// Close Logfile
+	bool success = ferror(log) == 0;
+	success = fclose(log) == 0 && success;
+
+	// Replace the old Logfile
+	if(!success || !File::Rename(tempPath, finalPath))
+	{
+		File::Delete(tempPath);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Status Writer Thread, writes out the newest Snapshot whenever there is one
+ * @param written Snapshot Version already on Disk
+ */
+static void status_writer_thread(uint64_t written)
+{
+	SetCurrentThreadName("AdhocStatusWriter");
+
+	std::unique_lock<std::mutex> lock(statusLock);
+	while(true)
+	{
+		// Wait for a new Snapshot (or Shutdown)
+		statusCond.wait(lock, [&] { return statusVersion != written || statusWriterStop; });
+		if(statusVersion == written) break;
+
+		// Don't hold the Lock during File I/O, intermediate Snapshots may get skipped
+		AdhocServerStatus snapshot = merged_status();
+		written = statusVersion;
+		lock.unlock();
+
+		bool success = write_status_file(snapshot);
+		if(success)
+		{
+			std::lock_guard<std::mutex> guard(serverStatsLock);
+			serverStats.statusFilesWritten++;
 		}
+		else
+		{
+			WARN_LOG(Log::sceNet, "AdhocServer: Failed to write %s", SERVER_STATUS_XMLOUT);
+		}
+
+		lock.lock();
+	}
+}
+
+std::string GetAdhocServerStatusJson()
+{
+	std::lock_guard<std::mutex> guard(statusLock);
+	if(statusVersion == 0) return "";
 
-		// Output Closing Root Tag
-		fprintf(log, "</prometheus>");
+	AdhocServerStatus status = merged_status();
 
-		// Close Logfile
-		fclose(log);
+	json::JsonWriter writer;
+	writer.begin();
+	writer.writeBool("running", adhocServerRunning);
+	writer.writeUint("usercount", status.usercount);
+	writer.pushArray("games");
+	for (const auto &game : status.games)
+	{
+		writer.pushDict();
+		writer.writeString("name", game.name);
+		writer.writeString("productid", game.productid);
+		writer.writeUint("usercount", game.usercount);
+		writer.writeUint("groupless", game.groupless);
+		writer.pushArray("groups");
+		for (const auto &group : game.groups)
+		{
+			writer.pushDict();
+			writer.writeString("name", group.name);
+			writer.writeUint("usercount", group.usercount);
+			writer.pushArray("users");
+			for (const auto &user : group.users)
+				writer.writeString(user);
+			writer.pop();
+			writer.pop();
+		}
+		writer.pop();
+		writer.pop();
 	}
+	writer.pop();
+	writer.end();
+	return writer.str();
 }
 
 /**
@@ -1853,228 +2329,553 @@ int create_listen_socket(uint16_t port)
 }
 
 /**
- * Server Main Loop
+ * Accept all pending Login Requests
  * @param server Server Listening Socket
- * @return OS Error Code
  */
-int server_loop(int server)
+static void accept_logins(int server)
 {
-	// Set Running Status
-	//_status = 1;
-	adhocServerRunning = true;
+	// Login Result
+	int loginresult = 0;
 
-	// Create Empty Status Logfile
-	update_status();
-
-	// Handling Loop
-	while (adhocServerRunning) //(_status == 1)
+	// Login Processing Loop
+	do
 	{
-		// Login Block
-		{
-			// Login Result
-			int loginresult = 0;
+		// Prepare Address Structure
+		struct sockaddr_in addr;
+		socklen_t addrlen = sizeof(addr);
+		memset(&addr, 0, sizeof(addr));
 
-			// Login Processing Loop
-			do
-			{
-				// Prepare Address Structure
-				struct sockaddr_in addr;
-				socklen_t addrlen = sizeof(addr);
-				memset(&addr, 0, sizeof(addr));
+		// Accept Login Requests
+		// loginresult = accept4(server, (struct sockaddr *)&addr, &addrlen, SOCK_NONBLOCK);
 
-				// Accept Login Requests
-				// loginresult = accept4(server, (struct sockaddr *)&addr, &addrlen, SOCK_NONBLOCK);
+		// Alternative Accept Approach (some Linux Kernel don't support the accept4 Syscall... wtf?)
+		loginresult = (int)accept(server, (struct sockaddr *)&addr, &addrlen);
+		if(loginresult != -1)
+		{
+			// Switch Socket into Non-Blocking Mode
+			change_blocking_mode(loginresult, 1);
+		}
 
-				// Alternative Accept Approach (some Linux Kernel don't support the accept4 Syscall... wtf?)
-				loginresult = accept(server, (struct sockaddr *)&addr, &addrlen);
-				if(loginresult != -1)
-				{
-					// Switch Socket into Non-Blocking Mode
-					change_blocking_mode(loginresult, 1);
-				}
+		// Login User (Stream)
+		if (loginresult != -1) {
+			u32_le sip = addr.sin_addr.s_addr;
+			/* // Replacing 127.0.0.x with Ethernet IP will cause issue with multiple-instance of localhost (127.0.0.x)
+			if (sip == 0x0100007f) { //127.0.0.1 should be replaced with LAN/WAN IP whenever available
+				char str[100];
+				gethostname(str, 100);
+				u8 *pip = (u8*)&sip;
+				if (gethostbyname(str)->h_addrtype == AF_INET && gethostbyname(str)->h_addr_list[0] != NULL) pip = (u8*)gethostbyname(str)->h_addr_list[0];
+				sip = *(u32_le*)pip;
+				WARN_LOG(Log::sceNet, "AdhocServer: Replacing IP %s with %s", inet_ntoa(addr.sin_addr), inet_ntoa(*(in_addr*)&pip));
+			}
+			*/
+			login_user_stream(loginresult, sip);
 
-				// Login User (Stream)
-				if (loginresult != -1) {
-					u32_le sip = addr.sin_addr.s_addr;
-					/* // Replacing 127.0.0.x with Ethernet IP will cause issue with multiple-instance of localhost (127.0.0.x)
-					if (sip == 0x0100007f) { //127.0.0.1 should be replaced with LAN/WAN IP whenever available
-						char str[100];
-						gethostname(str, 100);
-						u8 *pip = (u8*)&sip;
-						if (gethostbyname(str)->h_addrtype == AF_INET && gethostbyname(str)->h_addr_list[0] != NULL) pip = (u8*)gethostbyname(str)->h_addr_list[0];
-						sip = *(u32_le*)pip;
-						WARN_LOG(Log::sceNet, "AdhocServer: Replacing IP %s with %s", inet_ntoa(addr.sin_addr), inet_ntoa(*(in_addr*)&pip));
-					}
-					*/
-					login_user_stream(loginresult, sip);
-				}
-			} while(loginresult != -1);
+			std::lock_guard<std::mutex> guard(serverStatsLock);
+			serverStats.connectionsAccepted++;
 		}
+	} while(loginresult != -1);
+}
 
-		// Receive Data from Users
-		SceNetAdhocctlUserNode * user = _db_user;
-		while(user != NULL)
+/**
+ * Handle the Packet at the start of a User's RX Buffer
+ * @param user User Node (may be logged out and freed)
+ */
+static void process_user_packet(SceNetAdhocctlUserNode * user)
+{
+		// Waiting for Login Packet
+		if(get_user_state(user) == USER_STATE_WAITING)
 		{
-			// Next User (for safe delete)
-			SceNetAdhocctlUserNode * next = user->next;
+			// Valid Opcode
+			if(user->rx[0] == OPCODE_LOGIN)
+			{
+				// Enough Data available
+				if(user->rxpos >= sizeof(SceNetAdhocctlLoginPacketC2S))
+				{
+					// Clone Packet
+					SceNetAdhocctlLoginPacketC2S packet = *(SceNetAdhocctlLoginPacketC2S *)user->rx;
 
-			// Receive Data from User
-			int recvresult = (int)recv(user->stream, (char*)user->rx + user->rxpos, sizeof(user->rx) - user->rxpos, MSG_NOSIGNAL);
+					// Remove Packet from RX Buffer
+					clear_user_rxbuf(user, sizeof(SceNetAdhocctlLoginPacketC2S));
 
-			// Connection Closed or Timed Out
-			if(recvresult == 0 || (recvresult == -1 && socket_errno != EAGAIN && socket_errno != EWOULDBLOCK) || get_user_state(user) == USER_STATE_TIMED_OUT)
+					// Login User (Data)
+					login_user_data(user, &packet);
+				}
+			}
+
+			// Invalid Opcode
+			else
 			{
+				// Notify User
+				WARN_LOG(Log::sceNet, "AdhocServer: Invalid Opcode 0x%02X in Waiting State from %s", user->rx[0], ip2str(*(in_addr*)&user->resolver.ip).c_str());
+
 				// Logout User
 				logout_user(user);
 			}
+		}
+
+		// Logged-In User
+		else if(get_user_state(user) == USER_STATE_LOGGED_IN)
+		{
+			// Ping Packet
+			if(user->rx[0] == OPCODE_PING)
+			{
+				// Delete Packet from RX Buffer
+				clear_user_rxbuf(user, 1);
+			}
 
-			// Received Data (or leftovers in RX-Buffer)
-			else if(recvresult > 0 || user->rxpos > 0)
+			// Group Connect Packet
+			else if(user->rx[0] == OPCODE_CONNECT)
 			{
-				// New Incoming Data
-				if(recvresult > 0)
+				// Enough Data available
+				if(user->rxpos >= sizeof(SceNetAdhocctlConnectPacketC2S))
 				{
-					// Move RX Pointer
-					user->rxpos += recvresult;
+					// Cast Packet
+					SceNetAdhocctlConnectPacketC2S * packet = (SceNetAdhocctlConnectPacketC2S *)user->rx;
 
-					// Update Death Clock
-					user->last_recv = time(NULL);
+					// Clone Group Name
+					SceNetAdhocctlGroupName group = packet->group;
+
+					// Remove Packet from RX Buffer
+					clear_user_rxbuf(user, sizeof(SceNetAdhocctlConnectPacketC2S));
+
+					// Change Game Group
+					connect_user(user, &group);
 				}
+			}
 
-				// Waiting for Login Packet
-				if(get_user_state(user) == USER_STATE_WAITING)
-				{
-					// Valid Opcode
-					if(user->rx[0] == OPCODE_LOGIN)
-					{
-						// Enough Data available
-						if(user->rxpos >= sizeof(SceNetAdhocctlLoginPacketC2S))
-						{
-							// Clone Packet
-							SceNetAdhocctlLoginPacketC2S packet = *(SceNetAdhocctlLoginPacketC2S *)user->rx;
+			// Group Disconnect Packet
+			else if(user->rx[0] == OPCODE_DISCONNECT)
+			{
+				// Remove Packet from RX Buffer
+				clear_user_rxbuf(user, 1);
 
-							// Remove Packet from RX Buffer
-							clear_user_rxbuf(user, sizeof(SceNetAdhocctlLoginPacketC2S));
+				// Leave Game Group
+				disconnect_user(user);
+			}
 
-							// Login User (Data)
-							login_user_data(user, &packet);
-						}
-					}
+			// Network Scan Packet
+			else if(user->rx[0] == OPCODE_SCAN)
+			{
+				// Remove Packet from RX Buffer
+				clear_user_rxbuf(user, 1);
 
-					// Invalid Opcode
-					else
-					{
-						// Notify User
-						WARN_LOG(Log::sceNet, "AdhocServer: Invalid Opcode 0x%02X in Waiting State from %s", user->rx[0], ip2str(*(in_addr*)&user->resolver.ip).c_str());
+				// Send Network List
+				send_scan_results(user);
+			}
 
-						// Logout User
-						logout_user(user);
-					}
+			// Chat Text Packet
+			else if(user->rx[0] == OPCODE_CHAT)
+			{
+				// Enough Data available
+				if(user->rxpos >= sizeof(SceNetAdhocctlChatPacketC2S))
+				{
+					// Cast Packet
+					SceNetAdhocctlChatPacketC2S * packet = (SceNetAdhocctlChatPacketC2S *)user->rx;
+
+					// Clone Buffer for Message
+					char message[64];
+					memset(message, 0, sizeof(message));
+					strncpy(message, packet->message, sizeof(message) - 1);
+
+					// Remove Packet from RX Buffer
+					clear_user_rxbuf(user, sizeof(SceNetAdhocctlChatPacketC2S));
+
+					// Spread Chat Message
+					spread_message(user, message);
 				}
+			}
 
-				// Logged-In User
-				else if(get_user_state(user) == USER_STATE_LOGGED_IN)
-				{
-					// Ping Packet
-					if(user->rx[0] == OPCODE_PING)
-					{
-						// Delete Packet from RX Buffer
-						clear_user_rxbuf(user, 1);
-					}
+			// Invalid Opcode
+			else
+			{
+				// Notify User
+				WARN_LOG(Log::sceNet, "AdhocServer: Invalid Opcode 0x%02X in Logged-In State from %s (MAC: %s - IP: %s)", user->rx[0], (char *)user->resolver.name.data, mac2str(&user->resolver.mac).c_str(), ip2str(*(in_addr*)&user->resolver.ip).c_str());
 
-					// Group Connect Packet
-					else if(user->rx[0] == OPCODE_CONNECT)
-					{
-						// Enough Data available
-						if(user->rxpos >= sizeof(SceNetAdhocctlConnectPacketC2S))
-						{
-							// Cast Packet
-							SceNetAdhocctlConnectPacketC2S * packet = (SceNetAdhocctlConnectPacketC2S *)user->rx;
+				// Logout User
+				logout_user(user);
+			}
+		}
+}
 
-							// Clone Group Name
-							SceNetAdhocctlGroupName group = packet->group;
+/**
+ * Hand a User that just sent its Login Packet over to the Shard owning its Game
+ * @param user User Node (must belong to the Main Loop)
+ */
+static void handoff_user(SceNetAdhocctlUserNode * user)
+{
+	// Crosslinked Regions have to end up on the same Shard
+	SceNetAdhocctlProductCode product = ((SceNetAdhocctlLoginPacketC2S *)user->rx)->game;
+	game_product_override(&product);
+	std::string key = product_key(product);
+	AdhocServerShard * shard = serverShards[std::hash<std::string>()(key) % serverShards.size()].get();
+
+	// The Login Packet stays in the RX Buffer for the Shard to handle
+	unlink_user(user);
+	{
+		std::lock_guard<std::mutex> guard(shard->inboxLock);
+		shard->inbox.push_back(user);
+	}
 
-							// Remove Packet from RX Buffer
-							clear_user_rxbuf(user, sizeof(SceNetAdhocctlConnectPacketC2S));
+	// Wake up the Shard
+	uint8_t wake = 0;
+	sendto(shard->wakefd, (const char *)&wake, 1, 0, (struct sockaddr *)&shard->wakeaddr, sizeof(shard->wakeaddr));
 
-							// Change Game Group
-							connect_user(user, &group);
-						}
-					}
+	std::lock_guard<std::mutex> guard(serverStatsLock);
+	serverStats.handoffs++;
+}
 
-					// Group Disconnect Packet
-					else if(user->rx[0] == OPCODE_DISCONNECT)
-					{
-						// Remove Packet from RX Buffer
-						clear_user_rxbuf(user, 1);
+/**
+ * Handle every complete Packet in a User's RX Buffer
+ * @param user User Node (may be logged out, freed or handed off)
+ */
+static void process_user_rxbuf(SceNetAdhocctlUserNode * user)
+{
+	// We won't hear from the Socket again until more Data arrives
+	while(user->rxpos > 0)
+	{
+		// Complete Login Packet in the Main Loop goes to a Shard, if there are any
+		if(currentShard == 0 && !serverShards.empty() && user->game == NULL && user->rx[0] == OPCODE_LOGIN && user->rxpos >= sizeof(SceNetAdhocctlLoginPacketC2S))
+		{
+			handoff_user(user);
+			return;
+		}
 
-						// Leave Game Group
-						disconnect_user(user);
-					}
+		// Packet Handlers only ever logout the User they are handling
+		uint32_t usercount = _db_user_count;
+		uint32_t rxpos = user->rxpos;
 
-					// Network Scan Packet
-					else if(user->rx[0] == OPCODE_SCAN)
-					{
-						// Remove Packet from RX Buffer
-						clear_user_rxbuf(user, 1);
+		process_user_packet(user);
 
-						// Send Network List
-						send_scan_results(user);
-					}
+		// Logged Out
+		if(_db_user_count != usercount) return;
 
-					// Chat Text Packet
-					else if(user->rx[0] == OPCODE_CHAT)
-					{
-						// Enough Data available
-						if(user->rxpos >= sizeof(SceNetAdhocctlChatPacketC2S))
-						{
-							// Cast Packet
-							SceNetAdhocctlChatPacketC2S * packet = (SceNetAdhocctlChatPacketC2S *)user->rx;
+		// Incomplete Packet
+		if(user->rxpos == rxpos) break;
+	}
+}
 
-							// Clone Buffer for Message
-							char message[64];
-							memset(message, 0, sizeof(message));
-							strncpy(message, packet->message, sizeof(message) - 1);
+/**
+ * Receive Data from a User with pending Socket Activity
+ * @param user User Node (may be logged out and freed)
+ */
+static void service_user(SceNetAdhocctlUserNode * user)
+{
+	// Receive Data from User
+	int recvresult = (int)recv(user->stream, (char*)user->rx + user->rxpos, sizeof(user->rx) - user->rxpos, MSG_NOSIGNAL);
 
-							// Remove Packet from RX Buffer
-							clear_user_rxbuf(user, sizeof(SceNetAdhocctlChatPacketC2S));
+	// Connection Closed or Error
+	if(recvresult == 0 || (recvresult == -1 && socket_errno != EAGAIN && socket_errno != EWOULDBLOCK))
+	{
+		// Logout User
+		logout_user(user);
+		return;
+	}
 
-							// Spread Chat Message
-							spread_message(user, message);
-						}
-					}
+	// New Incoming Data
+	if(recvresult > 0)
+	{
+		// Move RX Pointer
+		user->rxpos += recvresult;
 
-					// Invalid Opcode
-					else
-					{
-						// Notify User
-						WARN_LOG(Log::sceNet, "AdhocServer: Invalid Opcode 0x%02X in Logged-In State from %s (MAC: %s - IP: %s)", user->rx[0], (char *)user->resolver.name.data, mac2str(&user->resolver.mac).c_str(), ip2str(*(in_addr*)&user->resolver.ip).c_str());
+		// Update Death Clock
+		user->last_recv = time(NULL);
+	}
 
-						// Logout User
-						logout_user(user);
-					}
-				}
-			}
+	// Handle Packets
+	process_user_rxbuf(user);
+}
 
-			// Move Pointer
-			user = next;
+/**
+ * Logout Users that haven't sent anything for a while
+ */
+static void check_user_timeouts()
+{
+	SceNetAdhocctlUserNode * user = _db_user;
+	while(user != NULL)
+	{
+		// Next User (for safe delete)
+		SceNetAdhocctlUserNode * next = user->next;
+
+		// Timed Out
+		if(get_user_state(user) == USER_STATE_TIMED_OUT) logout_user(user);
+
+		// Move Pointer
+		user = next;
+	}
+}
+
+AdhocServerStats GetAdhocServerStats()
+{
+	std::lock_guard<std::mutex> guard(serverStatsLock);
+	return serverStats;
+}
+
+/**
+ * Event Loop of a Server Thread (the Main Loop and every Shard)
+ * @param running Keep going while this is set
+ * @param onWake Handles Activity on the Socket serverPoller was initialized with
+ */
+static void event_loop(const std::atomic<bool> & running, const std::function<void()> & onWake)
+{
+	std::vector<SceNetAdhocctlUserNode *> ready;
+	double nextTick = time_now_d();
+
+	// Handling Loop
+	while (running)
+	{
+		// Wake up at least once per tick, to check for Timeouts and Shutdown
+		int tickMs = std::clamp(g_Config.iAdhocServerTickMs, 1, 1000);
+		double wakeUp = statusDirty ? std::min(nextTick, statusNextSnapshot) : nextTick;
+		int waitMs = std::clamp((int)((wakeUp - time_now_d()) * 1000.0), 0, tickMs);
+
+		// Wait for Activity
+		bool serverReady = false;
+		int events = serverPoller.Wait(waitMs, &serverReady, ready);
+		double start = time_now_d();
+
+		if (events < 0)
+		{
+			// Don't spin if polling keeps failing
+			WARN_LOG(Log::sceNet, "AdhocServer: Polling failed (Socket error %d)", socket_errno);
+			sleep_ms(tickMs, "pro-adhoc-poll-error");
+		}
+
+		// Login Requests (or Users handed over to this Shard)
+		if (serverReady) onWake();
+
+		// Receive Data from Users (only the ones with something pending)
+		for (SceNetAdhocctlUserNode *user : ready) service_user(user);
+
+		// Timeouts
+		if (start >= nextTick)
+		{
+			check_user_timeouts();
+			nextTick = start + tickMs / 1000.0;
 		}
 
-		// Prevent needless CPU Overload (1ms Sleep)
-		// !!!! COMMENT NOT REFLECTING REALITY
-		sleep_ms(10, "pro-adhoc-poll");
+		// Status Snapshot (if something changed, at most every few seconds)
+		flush_status(false);
+
+		// Update Statistics
+		if (events > 0)
+		{
+			double latencyMs = (time_now_d() - start) * 1000.0;
+			std::lock_guard<std::mutex> guard(serverStatsLock);
+			serverStats.eventsProcessed += events;
+			serverStats.busyIterations++;
+			serverStats.totalLatencyMs += latencyMs;
+			serverStats.lastLatencyMs = latencyMs;
+			serverStats.maxLatencyMs = std::max(serverStats.maxLatencyMs, latencyMs);
+		}
+		{
+			std::lock_guard<std::mutex> guard(serverStatsLock);
+			serverStats.iterations++;
+		}
 
 		// Don't do anything if it's paused, otherwise the log will be flooded
-		while (adhocServerRunning && Core_IsStepping() && coreState != CORE_POWERDOWN)
+		while (running && Core_IsStepping() && coreState != CORE_POWERDOWN)
 			sleep_ms(10, "pro-adhot-paused-poll");
 	}
+}
+
+/**
+ * Link the Users handed over by the Main Loop into a Shard's Database
+ * @param shard Shard of the calling Thread
+ */
+static void receive_handoffs(AdhocServerShard * shard)
+{
+	// Drain Wake-up Datagrams
+	uint8_t buffer[64];
+	while(recv(shard->wakefd, (char *)buffer, sizeof(buffer), 0) > 0) {}
+
+	// Grab the Inbox
+	std::vector<SceNetAdhocctlUserNode *> users;
+	{
+		std::lock_guard<std::mutex> guard(shard->inboxLock);
+		users.swap(shard->inbox);
+	}
+
+	for (SceNetAdhocctlUserNode *user : users)
+	{
+		// Link into User List
+		link_user(user);
+
+		// Handle the Login Packet (and whatever came after it)
+		process_user_rxbuf(user);
+	}
+}
+
+/**
+ * Shard Worker Thread
+ * @param shard Shard to run
+ */
+static void shard_thread(AdhocServerShard * shard)
+{
+	SetCurrentThreadName("AdhocServerShard");
+	currentShard = shard->index;
+
+	// Start watching the Wake-up Socket
+	if(!serverPoller.Init(shard->wakefd))
+	{
+		shard->started.set_value(false);
+		return;
+	}
+	shard->started.set_value(true);
+
+	// Empty Status for this Shard
+	update_status();
+	flush_status(true);
+
+	event_loop(shard->running, [shard] { receive_handoffs(shard); });
+
+	// Late Arrivals get logged out along with everyone else
+	receive_handoffs(shard);
+
+	// Free User Database Memory
+	free_database();
+
+	// Final (empty) Status for this Shard
+	update_status();
+	flush_status(true);
+
+	// Stop watching Sockets
+	serverPoller.Shutdown();
+}
+
+/**
+ * Stop all Shard Workers
+ */
+static void stop_shards()
+{
+	for (auto &shard : serverShards)
+	{
+		if(shard->thread.joinable())
+		{
+			// Wake up and stop
+			shard->running = false;
+			uint8_t wake = 0;
+			sendto(shard->wakefd, (const char *)&wake, 1, 0, (struct sockaddr *)&shard->wakeaddr, sizeof(shard->wakeaddr));
+			shard->thread.join();
+		}
+		if(shard->wakefd != -1) closesocket(shard->wakefd);
+	}
+	serverShards.clear();
+}
+
+/**
+ * Start the Shard Workers
+ * @param count Number of Shards
+ * @return true if all of them are up and running
+ */
+static bool start_shards(int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		auto shard = std::make_unique<AdhocServerShard>();
+		shard->index = i + 1;
+
+		// Wake-up Socket (UDP on Loopback, so it works with every poll implementation)
+		shard->wakefd = (int)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		shard->wakeaddr.sin_family = AF_INET;
+		shard->wakeaddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t addrlen = sizeof(shard->wakeaddr);
+		bool bound = shard->wakefd != -1 && bind(shard->wakefd, (struct sockaddr *)&shard->wakeaddr, sizeof(shard->wakeaddr)) == 0 && getsockname(shard->wakefd, (struct sockaddr *)&shard->wakeaddr, &addrlen) == 0;
+		if(shard->wakefd != -1) change_blocking_mode(shard->wakefd, 1);
+
+		AdhocServerShard * ptr = shard.get();
+		serverShards.push_back(std::move(shard));
+		if(!bound) return false;
+
+		// Wait until it's polling, so nothing gets handed to a Shard that can't take it
+		std::future<bool> started = ptr->started.get_future();
+		ptr->thread = std::thread(&shard_thread, ptr);
+		if(!started.get()) return false;
+	}
+	return true;
+}
+
+/**
+ * Server Main Loop
+ * @param server Server Listening Socket
+ * @return OS Error Code
+ */
+int server_loop(int server)
+{
+	// Set Running Status
+	//_status = 1;
+	adhocServerRunning = true;
+
+	// Reset Statistics
+	{
+		std::lock_guard<std::mutex> guard(serverStatsLock);
+		serverStats = {};
+	}
+
+	// Start watching the Listening Socket
+	if(!serverPoller.Init(server))
+	{
+		ERROR_LOG(Log::sceNet, "AdhocServer: Failed to set up socket polling (Socket error %d)", socket_errno);
+		closesocket(server);
+		return -1;
+	}
+
+	// Start the Status Writer (skipping whatever the last run left behind)
+	int shards = std::clamp(g_Config.iAdhocServerShards, 0, SERVER_SHARD_MAXIMUM);
+	{
+		std::lock_guard<std::mutex> guard(statusLock);
+		statusSnapshots.assign(shards + 1, AdhocServerStatus());
+		statusWriterStop = false;
+		statusWriter = std::thread(&status_writer_thread, statusVersion);
+	}
+
+	// Create Empty Status Logfile
+	update_status();
+	flush_status(true);
+
+	// Start the Shard Workers, or do everything on this Thread if that doesn't work out
+	if(shards > 0 && !start_shards(shards))
+	{
+		ERROR_LOG(Log::sceNet, "AdhocServer: Failed to start %d shards (Socket error %d), running on a single thread", shards, socket_errno);
+		stop_shards();
+		shards = 0;
+	}
+	{
+		std::lock_guard<std::mutex> guard(serverStatsLock);
+		serverStats.shards = shards;
+	}
+
+	// Handle Logins (and everything else without Shards)
+	event_loop(adhocServerRunning, [server] { accept_logins(server); });
 
 	// Free User Database Memory
 	free_database();
 
+	// Shards log out their Users on the way out
+	stop_shards();
+
+	// Write the final (empty) Status and stop the Writer
+	update_status();
+	flush_status(true);
+	{
+		std::lock_guard<std::mutex> guard(statusLock);
+		statusWriterStop = true;
+	}
+	statusCond.notify_one();
+	statusWriter.join();
+
+	// Stop watching Sockets
+	serverPoller.Shutdown();
+
 	// Close Server Socket
 	closesocket(server);
 
+	// Notify User
+	AdhocServerStats stats = GetAdhocServerStats();
+	INFO_LOG(Log::sceNet, "AdhocServer: %llu loop iterations, %llu events, %llu connections, latency avg %0.3f ms max %0.3f ms",
+		(unsigned long long)stats.iterations, (unsigned long long)stats.eventsProcessed, (unsigned long long)stats.connectionsAccepted,
+		stats.busyIterations ? stats.totalLatencyMs / stats.busyIterations : 0.0, stats.maxLatencyMs);
+
 	// Return Success
 	return 0;
 }
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 #include <time.h>
 #include "proAdhoc.h"
 
@@ -39,6 +40,9 @@
 // Server User Timeout (in seconds)
 #define SERVER_USER_TIMEOUT 15
 
+// Server Worker Thread Maximum (see iAdhocServerShards)
+#define SERVER_SHARD_MAXIMUM 32
+
 // Server SQLite3 Database
 #define SERVER_DATABASE "database.db"
 
@@ -262,16 +266,19 @@ struct SceNetAdhocctlGroupNode {
 
 	// Double-Linked Player List
 	SceNetAdhocctlUserNode * player;
+
+	// Group Founder (the oldest Player, at the end of the Player List)
+	SceNetAdhocctlUserNode * founder;
 };
 
-// User Count
-extern uint32_t _db_user_count;
+// User Count (of the calling server thread)
+extern thread_local uint32_t _db_user_count;
 
-// User Database
-extern SceNetAdhocctlUserNode * _db_user;
+// User Database (of the calling server thread)
+extern thread_local SceNetAdhocctlUserNode * _db_user;
 
-// Game Database
-extern SceNetAdhocctlGameNode * _db_game;
+// Game Database (of the calling server thread)
+extern thread_local SceNetAdhocctlGameNode * _db_game;
 
 void __AdhocServerInit();
 
@@ -357,9 +364,32 @@ void game_product_override(SceNetAdhocctlProductCode * product);
 
 /**
  * Update Status Logfile
+ * Only marks the status as changed, the server loop takes a snapshot at most every
+ * iAdhocServerStatusInterval seconds and a background thread writes it out.
  */
 void update_status();
 
+// Counters for the server loops (summed over all shards), reset when the server starts.
+struct AdhocServerStats {
+	uint64_t iterations;
+	uint64_t busyIterations;  // Iterations that had socket activity to handle.
+	uint64_t eventsProcessed;
+	uint64_t connectionsAccepted;
+	// Time spent handling socket activity after waking up.
+	double lastLatencyMs;
+	double maxLatencyMs;
+	double totalLatencyMs;
+	uint64_t statusSnapshots;
+	uint64_t statusFilesWritten;
+	uint32_t shards;  // Worker threads actually running, 0 when everything runs on the main loop.
+	uint64_t handoffs;  // Users passed from the main loop to a shard after logging in.
+};
+
+AdhocServerStats GetAdhocServerStats();
+
+// The latest status snapshot as JSON (same contents as the status file), empty if the server hasn't run.
+std::string GetAdhocServerStatusJson();
+
 /**
 * Server Entry Point
 * @param argc Number of Arguments
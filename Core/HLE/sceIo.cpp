@@ -57,6 +57,7 @@
 #include "Core/FileSystems/MetaFileSystem.h"
 #include "Core/FileSystems/ISOFileSystem.h"
 #include "Core/FileSystems/DirectoryFileSystem.h"
+#include "Core/FileSystems/IoTrace.h"
 
 extern "C" {
 #include "ext/libkirk/amctrl.h"
@@ -387,6 +388,9 @@ static void __IoFreeFd(int fd, u32 &error) {
 				error = SCE_KERNEL_ERROR_ASYNC_BUSY;
 				return;
 			}
+			if (IoTrace::IsRecording() && !f->isTTY) {
+				IoTrace::RecordClose(f->handle);
+			}
 
 			// Wake anyone waiting on the file before closing it.
 			for (size_t i = 0; i < f->waitingThreads.size(); ++i) {
@@ -643,6 +647,13 @@ static void __IoVblank() {
 
 	lastMemStickState = newState;
 	lastMemStickFatState = newFatState;
+
+	// Write out memstick writes that have been buffered for a while. No need to check every frame.
+	static int writeBackCounter = 0;
+	if (g_Config.bMemStickWriteBack && ++writeBackCounter >= 30) {
+		writeBackCounter = 0;
+		pspFileSystem.FlushWrites(true);
+	}
 }
 
 void __IoInit() {
@@ -700,6 +711,10 @@ void __IoInit() {
 	lastMemStickState = MemoryStick_State();
 	lastMemStickFatState = MemoryStick_FatState();
 	__DisplayListenVblank(__IoVblank);
+
+	if (g_Config.bRecordIoTrace && !IoTrace::IsRecording()) {
+		IoTrace::Start(IoTrace::GenerateFilename());
+	}
 }
 
 void __IoDoState(PointerWrap &p) {
@@ -771,6 +786,8 @@ void __IoDoState(PointerWrap &p) {
 }
 
 void __IoShutdown() {
+	IoTrace::Stop();
+
 	ioManagerThreadEnabled = false;
 	ioManager.SyncThread();
 	ioManager.FinishEventLoop();
@@ -1092,6 +1109,9 @@ static bool __IoRead(int &result, int id, u32 data_addr, int size, int &us) {
 					ioManager.SyncThread();
 				}
 			}
+			if (IoTrace::IsRecording()) {
+				IoTrace::RecordRead(f->handle, (s64)pspFileSystem.GetSeekPos(f->handle), validSize);
+			}
 			if (useThread) {
 				AsyncIOEvent ev = IO_EVENT_READ;
 				ev.handle = f->handle;
@@ -1106,7 +1126,10 @@ static bool __IoRead(int &result, int id, u32 data_addr, int size, int &us) {
 				} else {
 					result = (int)pspFileSystem.ReadFile(f->handle, data, validSize, us);
 				}
-				currentMIPS->InvalidateICache(data_addr, validSize);
+				// Like the async path, only what actually landed in memory.
+				if (result > 0) {
+					currentMIPS->InvalidateICache(data_addr, result);
+				}
 				return true;
 			}
 		} else {
@@ -1426,7 +1449,11 @@ static s64 __IoLseek(SceUID id, s64 offset, int whence) {
 
 		if (newPos < 0)
 			return newPos;
-		return pspFileSystem.SeekFile(f->handle, (s32) offset, seek);
+		s64 result = pspFileSystem.SeekFile(f->handle, (s32) offset, seek);
+		if (IoTrace::IsRecording()) {
+			IoTrace::RecordSeek(f->handle, offset, whence, result);
+		}
+		return result;
 	} else {
 		return (s32) error;
 	}
@@ -1502,6 +1529,19 @@ static u32 sceIoLseek32Async(int id, int offset, int whence) {
 	return 0;
 }
 
+// Relative paths depend on the thread's current directory, so the trace gets the full path.
+static std::string IoTraceFullPath(const char *filename) {
+	std::string outpath;
+	IFileSystem *system = nullptr;
+	if (pspFileSystem.MapFilePath(filename, outpath, &system) != 0)
+		return filename;
+	for (const auto &mount : pspFileSystem.GetMounts()) {
+		if (mount.system.get() == system)
+			return mount.prefix + outpath;
+	}
+	return filename;
+}
+
 static FileNode *__IoOpen(int &error, const char *filename, int flags, int mode) {
 	if (!filename) {
 		// To prevent crashes. Not sure about the correct value.
@@ -1535,6 +1575,9 @@ static FileNode *__IoOpen(int &error, const char *filename, int flags, int mode)
 		isTTY = true;
 	} else {
 		h = pspFileSystem.OpenFile(filename, (FileAccess)(access | (int)FileAccess::FILEACCESS_PPSSPP_QUIET));
+		if (IoTrace::IsRecording()) {
+			IoTrace::RecordOpen(h, IoTraceFullPath(filename), access, h);
+		}
 		if (h < 0) {
 			error = h;
 			return nullptr;
@@ -1646,6 +1689,8 @@ static u32 sceIoRmdir(const char *dirname) {
 }
 
 static u32 sceIoSync(const char *devicename, int flag) {
+	// Anything held back by write-back buffering goes out now.
+	pspFileSystem.FlushWrites(false);
 	return hleLogDebug(Log::sceIo, 0);
 }
 
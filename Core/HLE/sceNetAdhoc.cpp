@@ -335,6 +335,8 @@ static void __AdhocctlNotify(u64 userdata, int cyclesLate) {
 				sockerr = socket_errno;
 				// Successfully Sent or Connection has been closed or Connection failure occurred
 				if (ret >= 0 || (ret == SOCKET_ERROR && sockerr != EAGAIN && sockerr != EWOULDBLOCK)) {
+					if (ret >= 0)
+						adhocctlRequestSent(req.opcode);
 					// Prevent from sending again
 					req.opcode = 0;
 					if (ret == SOCKET_ERROR)
@@ -1242,6 +1244,7 @@ int sceNetAdhocctlInit(int stackSize, int prio, u32 productAddr) {
 	adhocctlEvents.clear();
 	netAdhocctlInited = true; //needed for cleanup during AdhocctlTerm even when it failed to connect to Adhoc Server (since it's being faked as success)
 	isAdhocctlNeedLogin = true;
+	wakeupFriendFinder();
 
 	// Create fake PSP Thread for callback
 	// TODO: Should use a separated threads for friendFinder, matchingEvent, and matchingInput and created on AdhocctlInit & AdhocMatchingStart instead of here
@@ -2218,6 +2221,7 @@ int sceNetAdhocctlScan() {
 		if (adhocctlState == ADHOCCTL_STATE_DISCONNECTED && !isAdhocctlBusy) {
 			isAdhocctlBusy = true;
 			isAdhocctlNeedLogin = true;
+			wakeupFriendFinder();
 			adhocctlState = ADHOCCTL_STATE_SCANNING;
 			adhocctlCurrentMode = ADHOCCTL_MODE_NORMAL;
 
@@ -2509,6 +2513,7 @@ int NetAdhocctl_Term() {
 
 		// Terminate Adhoc Threads
 		friendFinderRunning = false;
+		wakeupFriendFinder();
 		if (friendFinderThread.joinable()) {
 			friendFinderThread.join();
 		}
@@ -2707,6 +2712,7 @@ int NetAdhocctl_Create(const char *groupName) {
 			if (adhocctlState == ADHOCCTL_STATE_DISCONNECTED && !isAdhocctlBusy) {
 				isAdhocctlBusy = true;
 				isAdhocctlNeedLogin = true;
+				wakeupFriendFinder();
 
 				// Set Network Name
 				if (groupName) {
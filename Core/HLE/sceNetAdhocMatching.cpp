@@ -22,6 +22,8 @@
 
 #include <deque>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
 
 
 #include "Common/Thread/ThreadUtil.h"
@@ -46,6 +48,9 @@ std::deque<MatchingArgs> matchingEvents;
 bool netAdhocMatchingInited;
 int adhocMatchingEventDelay = 30000; //30000
 
+// Longest the matching threads wait without anything happening, bounds how late timeouts get noticed.
+#define MATCHING_MAX_WAIT_US 100000
+
 static bool savedNetAdhocMatchingInited; // the storage to use during the savestating routine in sceNetAdhoc.cpp
 
 void DoNetAdhocMatchingInited(PointerWrap &p) {
@@ -1211,12 +1216,20 @@ int matchingEventThread(int matchingId) {
 				context->eventlock->unlock();
 			}
 
-			// Share CPU Time
-			sleep_ms(10, "pro-adhoc-poll-3"); //1 //sceKernelDelayThread(10000);
+			// Wait for the next event (linkEVMessage signals it) or for being stopped, instead of polling
+			if (context != NULL) {
+				std::unique_lock<std::recursive_mutex> guard(*context->eventlock);
+				context->eventwake->wait_for(guard, std::chrono::microseconds(MATCHING_MAX_WAIT_US), [&] {
+					return context->event_stack != NULL || !context->eventRunning;
+				});
+			}
 
-			// Don't do anything if it's paused, otherwise the log will be flooded
-			while (Core_IsStepping() && coreState != CORE_POWERDOWN && contexts != NULL && context->eventRunning)
-				sleep_ms(10, "pro-adhoc-event-poll-3");
+			// Don't do anything if it's paused, otherwise the log will be flooded.
+			// Nothing tells us when the debugger resumes, so this still checks periodically (but stops right away.)
+			while (Core_IsStepping() && coreState != CORE_POWERDOWN && contexts != NULL && context->eventRunning) {
+				std::unique_lock<std::recursive_mutex> guard(*context->eventlock);
+				context->eventwake->wait_for(guard, std::chrono::milliseconds(10), [&] { return !context->eventRunning; });
+			}
 		}
 
 		// Process Last Messages
@@ -1267,6 +1280,24 @@ int matchingEventThread(int matchingId) {
 	return 0;
 }
 
+static void waitMatchingInput(SceNetAdhocMatchingContext *context, u64 lasthello, u64 lastping, bool waitForData) {
+	u64 now = CoreTiming::GetGlobalTimeUsScaled();
+	s64 timeoutUS = MATCHING_MAX_WAIT_US;
+	if (context->hello_int > 0 && (context->mode == PSP_ADHOC_MATCHING_MODE_PARENT || context->mode == PSP_ADHOC_MATCHING_MODE_P2P))
+		timeoutUS = std::min(timeoutUS, static_cast<s64>(lasthello + context->hello_int - now));
+	if (context->keepalive_int > 0)
+		timeoutUS = std::min(timeoutUS, static_cast<s64>(lastping + context->keepalive_int - now));
+
+	// The host socket behind the PDP socket, to wake up as soon as there's data.
+	int hostfd = (int)INVALID_SOCKET;
+	context->socketlock->lock();
+	if (waitForData && context->socket > 0 && context->socket <= MAX_SOCKET && adhocSockets[context->socket - 1] != NULL)
+		hostfd = adhocSockets[context->socket - 1]->data.pdp.id;
+	context->socketlock->unlock();
+
+	context->inputwake->Wait(hostfd, (int)std::max<s64>(timeoutUS, 0));
+}
+
 /**
 * Matching IO Handler Thread
 * @param args sizeof(SceNetAdhocMatchingContext *)
@@ -1300,6 +1331,8 @@ int matchingInputThread(int matchingId) { // TODO: The MatchingInput thread is u
 
 	// Run while needed...
 	if (context != NULL) {
+		AdhocWakeupSocket *inputwake = context->inputwake;
+		inputwake->Open("InputLoop");
 		while (contexts != NULL && context->inputRunning) {
 			// Multithreading Lock
 			peerlock.lock();
@@ -1308,6 +1341,7 @@ int matchingInputThread(int matchingId) { // TODO: The MatchingInput thread is u
 			// Multithreading Unlock
 			peerlock.unlock();
 
+			bool waitForData = true;
 			while (context != NULL && context->inputRunning && !Core_IsStepping()) {
 				now = CoreTiming::GetGlobalTimeUsScaled(); //time_now_d()*1000000.0;
 
@@ -1469,15 +1503,21 @@ int matchingInputThread(int matchingId) { // TODO: The MatchingInput thread is u
 
 					// Ignore Incoming Trash Data
 				}
-				else
+				else {
+					// Data that can't be received (ie. too large for rxbuf) would keep waking us up, just wait for the timers then.
+					waitForData = recvresult == SCE_NET_ADHOC_ERROR_WOULD_BLOCK;
 					break;
+				}
 			}
-			// Share CPU Time
-			sleep_ms(10, "pro-adhoc-4"); //1 //sceKernelDelayThread(10000);
 
-			// Don't do anything if it's paused, otherwise the log will be flooded
+			// Wait for data, a message from the game (linkIOMessage), or the next Hello/Ping to be due, instead of polling
+			if (context != NULL && context->inputRunning)
+				waitMatchingInput(context, lasthello, lastping, waitForData);
+
+			// Don't do anything if it's paused, otherwise the log will be flooded.
+			// Nothing tells us when the debugger resumes, so this still checks periodically (but stops right away.)
 			while (Core_IsStepping() && coreState != CORE_POWERDOWN && contexts != NULL && context->inputRunning)
-				sleep_ms(10, "pro-adhoc-input-4");
+				context->inputwake->Wait((int)INVALID_SOCKET, 10000);
 		}
 
 		if (contexts != NULL) {
@@ -1541,6 +1581,7 @@ int matchingInputThread(int matchingId) { // TODO: The MatchingInput thread is u
 			// Delete Pointer Reference (and notify caller about finished cleanup)
 			//context->inputThread = NULL;
 		}
+		inputwake->Close();
 	}
 
 	// Log Shutdown
@@ -1572,11 +1613,15 @@ int NetAdhocMatching_Stop(int matchingId) {
 	NetAdhoc_SetSocketAlert(item->socket, ADHOC_F_ALERTRECV);
 
 	item->inputRunning = false;
+	item->inputwake->Notify();
 	if (item->inputThread.joinable()) {
 		item->inputThread.join();
 	}
 
+	item->eventlock->lock();
 	item->eventRunning = false;
+	item->eventwake->notify_all();
+	item->eventlock->unlock();
 	if (item->eventThread.joinable()) {
 		item->eventThread.join();
 	}
@@ -1660,6 +1705,8 @@ int NetAdhocMatching_Delete(int matchingId) {
 			item->socketlock->lock(); // Make sure it's not locked when being deleted
 			item->socketlock->unlock();
 			delete item->socketlock;
+			delete item->eventwake;
+			delete item->inputwake;
 			// Free item context memory
 			free(item);
 			item = NULL;
@@ -1817,6 +1864,8 @@ static int sceNetAdhocMatchingCreate(int mode, int maxnum, int port, int rxbufle
 			context->socketlock = new std::recursive_mutex;
 			context->eventlock = new std::recursive_mutex;
 			context->inputlock = new std::recursive_mutex;
+			context->eventwake = new std::condition_variable_any;
+			context->inputwake = new AdhocWakeupSocket;
 
 			// Multithreading Lock
 			peerlock.lock(); //contextlock.lock();
@@ -125,6 +125,24 @@ struct BufferQueue {
 		return bytesgot;
 	}
 
+	// Like get_front, but skipping offset bytes first.
+	int peek(unsigned char *buf, int offset, int wantedsize) {
+		if (wantedsize <= 0 || offset >= getQueueSize())
+			return 0;
+		int bytesgot = getQueueSize() - offset;
+		if (wantedsize < bytesgot)
+			bytesgot = wantedsize;
+		int pos = (start + offset) % bufQueueSize;
+		int firstSize = bufQueueSize - pos;
+		if (bytesgot <= firstSize) {
+			memcpy(buf, bufQueue + pos, bytesgot);
+		} else {
+			memcpy(buf, bufQueue + pos, firstSize);
+			memcpy(buf + firstSize, bufQueue, bytesgot - firstSize);
+		}
+		return bytesgot;
+	}
+
 	void DoState(PointerWrap &p);
 
 private:
@@ -0,0 +1,176 @@
+// Copyright (c) 2026- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "Common/Log.h"
+#include "Common/Thread/ThreadUtil.h"
+
+// Runs a producer on its own thread, keeping up to maxDepth items ready for the consumer, in order.
+//
+// The producer shouldn't act on input that may still grow (like a short read) until the consumer
+// actually wants the item, so that the result is the same as producing it on demand. WaitForInput()
+// handles that: it waits until the input is ready, or until the item is demanded.
+//
+// Items are always queued, even when stopped in the middle, since they may own resources.
+// After Stop(), drain them with TryTake().
+template <typename T>
+class DecodeAheadQueue {
+public:
+	~DecodeAheadQueue() {
+		_dbg_assert_(!thread_.joinable());
+	}
+
+	void Start(const char *threadName, std::function<void(T *item)> produce, int maxDepth) {
+		_dbg_assert_(!thread_.joinable());
+		quit_ = false;
+		finish_ = false;
+		demand_ = false;
+		maxDepthSeen_ = 0;
+		running_ = true;
+		thread_ = std::thread([this, threadName, produce, maxDepth] {
+			SetCurrentThreadName(threadName);
+			ProduceLoop(produce, maxDepth);
+		});
+	}
+
+	// With finish, the item being produced is completed as if it was demanded, and everything produced
+	// stays queued for Take(). Otherwise, the producer is interrupted (WaitForInput() returns false).
+	void Stop(bool finish) {
+		if (!running_)
+			return;
+		{
+			std::lock_guard<std::mutex> guard(lock_);
+			if (finish)
+				finish_ = true;
+			else
+				quit_ = true;
+			cond_.notify_all();
+		}
+		thread_.join();
+		running_ = false;
+	}
+
+	// Only changes on the consumer's thread, so it doesn't need the lock.
+	bool IsRunning() const {
+		return running_;
+	}
+
+	bool Empty() {
+		std::lock_guard<std::mutex> guard(lock_);
+		return items_.empty();
+	}
+
+	int Size() {
+		std::lock_guard<std::mutex> guard(lock_);
+		return (int)items_.size();
+	}
+
+	// Takes the next item, waiting for the producer if it's running. Returns false if there's nothing left.
+	// stalled is set if it had to wait.
+	bool Take(T *item, bool *stalled) {
+		std::unique_lock<std::mutex> guard(lock_);
+		*stalled = false;
+		if (items_.empty()) {
+			if (!running_)
+				return false;
+			*stalled = true;
+			demand_ = true;
+			cond_.notify_all();
+			cond_.wait(guard, [&] { return !items_.empty(); });
+		}
+		*item = std::move(items_.front());
+		items_.pop_front();
+		cond_.notify_all();
+		return true;
+	}
+
+	// Doesn't wait, for draining after Stop().
+	bool TryTake(T *item) {
+		std::lock_guard<std::mutex> guard(lock_);
+		if (items_.empty())
+			return false;
+		*item = std::move(items_.front());
+		items_.pop_front();
+		return true;
+	}
+
+	// The lock protects the producer's input too, so it can be checked and consumed consistently.
+	std::unique_lock<std::mutex> Lock() {
+		return std::unique_lock<std::mutex>(lock_);
+	}
+
+	// Call with the lock held, after adding input.
+	void NotifyInput() {
+		cond_.notify_all();
+	}
+
+	// For the producer, with the lock held. Waits until ready() is true, or the consumer demands the item,
+	// in which case it has to make do with the input there is. Returns false when interrupted.
+	template <typename F>
+	bool WaitForInput(std::unique_lock<std::mutex> &guard, F ready) {
+		cond_.wait(guard, [&] {
+			return quit_ || demand_ || finish_ || ready();
+		});
+		return !quit_;
+	}
+
+	// Max items that were queued at once.
+	int MaxDepthSeen() {
+		std::lock_guard<std::mutex> guard(lock_);
+		return maxDepthSeen_;
+	}
+
+private:
+	void ProduceLoop(const std::function<void(T *item)> &produce, int maxDepth) {
+		std::unique_lock<std::mutex> guard(lock_);
+		while (!quit_ && !finish_) {
+			if ((int)items_.size() >= maxDepth) {
+				cond_.wait(guard);
+				continue;
+			}
+
+			guard.unlock();
+			T item{};
+			produce(&item);
+			guard.lock();
+
+			items_.push_back(std::move(item));
+			if ((int)items_.size() > maxDepthSeen_)
+				maxDepthSeen_ = (int)items_.size();
+			// The demand was for this item, the next one starts over.
+			demand_ = false;
+			cond_.notify_all();
+		}
+	}
+
+	std::thread thread_;
+	std::mutex lock_;
+	std::condition_variable cond_;
+	std::deque<T> items_;
+	bool running_ = false;
+	bool quit_ = false;
+	bool finish_ = false;
+	bool demand_ = false;
+	int maxDepthSeen_ = 0;
+};
@@ -16,8 +16,12 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include "Common/Serialize/SerializeFuncs.h"
+#include "Common/Data/Convert/ColorConv.h"
 #include "Common/Math/SIMDHeaders.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ThreadUtil.h"
+#include "Common/TimeUtil.h"
+#include "Core/Config.h"
 #include "Core/System.h"
 #include "Core/Debugger/MemBlockInfo.h"
 #include "Core/HW/MediaEngine.h"
@@ -151,6 +155,12 @@ void MediaEngine::DoState(PointerWrap &p) {
 	if (!s)
 		return;
 
+#ifdef USE_FFMPEG
+	// Saving is fine while decoding ahead, since that doesn't change any state until stepVideo.
+	if (p.mode == p.MODE_READ)
+		stopDecodeAhead(false);
+#endif
+
 	Do(p, m_videoStream);
 	Do(p, m_audioStream);
 
@@ -223,6 +233,10 @@ int MediaEngine::MpegReadbuffer(void *opaque, uint8_t *buf, int buf_size) {
 		size = std::min(buf_size, mpeg->m_mpegheaderSize - mpeg->m_mpegheaderReadPos);
 		memcpy(buf, mpeg->m_mpegheader + mpeg->m_mpegheaderReadPos, size);
 		mpeg->m_mpegheaderReadPos += size;
+#ifdef USE_FFMPEG
+	} else if (mpeg->m_decodeAhead.IsRunning()) {
+		size = mpeg->readAhead(buf, buf_size);
+#endif
 	} else {
 		size = mpeg->m_pdata->pop_front(buf, buf_size);
 		if (size > 0)
@@ -276,6 +290,7 @@ bool MediaEngine::openContext(bool keepReadPos) {
 		m_mpegheaderReadPos = 0;
 	}
 	m_decodingsize = 0;
+	m_decodeStats = MediaDecodeAheadStats();
 
 	m_bufSize = std::max(m_bufSize, m_mpegheaderSize);
 	u8 *tempbuf = (u8*)av_malloc(m_bufSize);
@@ -345,12 +360,22 @@ bool MediaEngine::openContext(bool keepReadPos) {
 
 void MediaEngine::closeContext() {
 #ifdef USE_FFMPEG
+	stopDecodeAhead(false);
+	const MediaDecodeAheadStats &stats = m_decodeStats;
+	if (stats.framesDecoded > 0) {
+		INFO_LOG(Log::ME, "Video decode-ahead: %d frames, %d dropped, %d stalls (%0.1f ms), queue depth avg %0.2f max %d",
+			stats.framesDecoded, stats.framesDropped, stats.stalls, stats.stallSeconds * 1000.0,
+			stats.queueDepthSamples ? (double)stats.queueDepthSum / stats.queueDepthSamples : 0.0, stats.maxQueueDepth);
+	}
 	if (m_buffer)
 		av_free(m_buffer);
 	if (m_pFrameRGB)
 		av_frame_free(&m_pFrameRGB);
 	if (m_pFrame)
 		av_frame_free(&m_pFrame);
+	if (m_pFrameYUV)
+		av_frame_free(&m_pFrameYUV);
+	m_yuvFramePending = false;
 	if (m_pIOContext && m_pIOContext->buffer)
 		av_free(m_pIOContext->buffer);
 	if (m_pIOContext)
@@ -406,6 +431,9 @@ bool MediaEngine::addVideoStream(int streamNum, int streamId) {
 		// no need to add an existing stream.
 		if ((u32)streamNum < m_pFormatCtx->nb_streams)
 			return true;
+		// We're about to have more than one video stream, and will change the format context.
+		// What was already decoded is still what the current stream would show next.
+		stopDecodeAhead(true);
 		AVCodec *h264_codec = avcodec_find_decoder(AV_CODEC_ID_H264);
 		if (!h264_codec)
 			return false;
@@ -448,8 +476,16 @@ bool MediaEngine::addVideoStream(int streamNum, int streamId) {
 int MediaEngine::addStreamData(const u8 *buffer, int addSize) {
 	int size = addSize;
 	if (size > 0 && m_pdata) {
+#ifdef USE_FFMPEG
+		// The decode thread might be reading ahead, or waiting for this data.
+		std::unique_lock<std::mutex> guard = m_decodeAhead.Lock();
+#endif
 		if (!m_pdata->push(buffer, size)) 
 			size  = 0;
+#ifdef USE_FFMPEG
+		m_decodeAhead.NotifyInput();
+		guard.unlock();
+#endif
 		if (m_demux) {
 			m_demux->addStreamData(buffer, addSize);
 		}
@@ -509,6 +545,9 @@ bool MediaEngine::setVideoStream(int streamNum, bool force) {
 	}
 
 #ifdef USE_FFMPEG
+	// The decode thread only reads the current stream. Frames it already decoded get skipped by stepVideo
+	// after the switch, and the packets it passed over for other streams get decoded again.
+	stopDecodeAhead(true);
 	if (m_pFormatCtx && m_pCodecCtxs.find(streamNum) == m_pCodecCtxs.end()) {
 		// Get a pointer to the codec context for the video stream
 		if ((u32)streamNum >= m_pFormatCtx->nb_streams) {
@@ -562,13 +601,12 @@ bool MediaEngine::setVideoDim(int width, int height)
 	auto codecIter = m_pCodecCtxs.find(m_videoStream);
 	if (codecIter == m_pCodecCtxs.end())
 		return false;
-	AVCodecContext *m_pCodecCtx = codecIter->second;
 
 	if (width == 0 && height == 0)
 	{
 		// use the orignal video size
-		m_desWidth = m_pCodecCtx->width;
-		m_desHeight = m_pCodecCtx->height;
+		int pixFmt;
+		getVideoFormat(&m_desWidth, &m_desHeight, &pixFmt);
 	}
 	else
 	{
@@ -584,6 +622,7 @@ bool MediaEngine::setVideoDim(int width, int height)
 	sws_freeContext(m_sws_ctx);
 	m_sws_ctx = nullptr;
 	m_sws_fmt = -1;
+	m_yuvFramePending = false;
 
 	if (m_desWidth == 0 || m_desHeight == 0) {
 		// Can't setup SWS yet, so stop for now.
@@ -618,13 +657,15 @@ void MediaEngine::updateSwsFormat(int videoPixelMode) {
 
 	AVPixelFormat swsDesired = getSwsFormat(videoPixelMode);
 	if (swsDesired != m_sws_fmt && m_pCodecCtx != 0) {
+		int srcWidth, srcHeight, srcPixFmt;
+		getVideoFormat(&srcWidth, &srcHeight, &srcPixFmt);
 		m_sws_fmt = swsDesired;
 		m_sws_ctx = sws_getCachedContext
 			(
 				m_sws_ctx,
-				m_pCodecCtx->width,
-				m_pCodecCtx->height,
-				m_pCodecCtx->pix_fmt,
+				srcWidth,
+				srcHeight,
+				(AVPixelFormat)srcPixFmt,
 				m_desWidth,
 				m_desHeight,
 				(AVPixelFormat)m_sws_fmt,
@@ -648,27 +689,73 @@ void MediaEngine::updateSwsFormat(int videoPixelMode) {
 #endif
 }
 
-bool MediaEngine::stepVideo(int videoPixelMode, bool skipFrame) {
+bool MediaEngine::canConvertYUVDirectly() const {
 #ifdef USE_FFMPEG
-	auto codecIter = m_pCodecCtxs.find(m_videoStream);
-	AVCodecContext *m_pCodecCtx = codecIter == m_pCodecCtxs.end() ? 0 : codecIter->second;
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 48, 101)
+	// Only with the send/receive API, where decoded frames are always reference counted.
+	return m_pFrame->format == AV_PIX_FMT_YUV420P && m_pFrame->width == m_desWidth && m_pFrame->height == m_desHeight;
+#endif
+#endif
+	return false;
+}
 
-	if (!m_pFormatCtx)
-		return false;
-	if (!m_pCodecCtx)
-		return false;
-	if (!m_pFrame)
-		return false;
+#ifdef USE_FFMPEG
+static void convertVideoLineYUV(void *destp, const AVFrame *frame, int y, int width, int videoPixelMode) {
+	const u8 *ySrc = frame->data[0] + frame->linesize[0] * y;
+	const u8 *uSrc = frame->data[1] + frame->linesize[1] * (y / 2);
+	const u8 *vSrc = frame->data[2] + frame->linesize[2] * (y / 2);
+	switch (videoPixelMode) {
+	case GE_CMODE_32BIT_ABGR8888: ConvertYUV420ToRGBA8888((u32 *)destp, ySrc, uSrc, vSrc, width); break;
+	case GE_CMODE_16BIT_BGR5650: ConvertYUV420ToRGB565((u16 *)destp, ySrc, uSrc, vSrc, width); break;
+	case GE_CMODE_16BIT_ABGR5551: ConvertYUV420ToRGBA5551((u16 *)destp, ySrc, uSrc, vSrc, width); break;
+	case GE_CMODE_16BIT_ABGR4444: ConvertYUV420ToRGBA4444((u16 *)destp, ySrc, uSrc, vSrc, width); break;
+	}
+}
+#endif
+
+// Fills m_pFrameRGB, like sws_scale would have, for the users that want the whole frame.
+void MediaEngine::convertPendingYUVFrame() {
+#ifdef USE_FFMPEG
+	if (!m_yuvFramePending)
+		return;
+	m_yuvFramePending = false;
+	if (!m_pFrameRGB)
+		return;
 
+	const int lineSize = getPixelFormatBytes(m_yuvFramePixelMode) * m_desWidth;
+	m_pFrameRGB->linesize[0] = lineSize;
+	for (int y = 0; y < m_desHeight; y++) {
+		convertVideoLineYUV(m_pFrameRGB->data[0] + lineSize * y, m_pFrameYUV, y, m_desWidth, m_yuvFramePixelMode);
+	}
+#endif
+}
+
+#ifdef USE_FFMPEG
+// Enough to smooth out slow frames, without reading too far ahead of the game.
+static const int MAX_DECODE_AHEAD_FRAMES = 3;
+
+// Reads and decodes packets until a frame comes out, or the data runs out.
+// This runs on the decode-ahead thread while that's active.
+void MediaEngine::decodeVideoFrame(AVCodecContext *codecCtx, int streamNum, AVFrame *frame, DecodedVideoFrame *decoded, bool onDecodeThread) {
 	AVPacket packet;
 	av_init_packet(&packet);
 	int frameFinished;
-	bool bGetFrame = false;
-	while (!bGetFrame) {
-		bool dataEnd = av_read_frame(m_pFormatCtx, &packet) < 0;
+	decoded->streamNum = streamNum;
+	while (!decoded->gotFrame) {
+		bool dataEnd;
+		if (!onDecodeThread && !m_replayPackets.empty()) {
+			// These were already read by the decode thread, before a stream switch.
+			AVPacket *replay = m_replayPackets.front();
+			m_replayPackets.pop_front();
+			av_packet_move_ref(&packet, replay);
+			av_packet_free(&replay);
+			dataEnd = false;
+		} else {
+			dataEnd = av_read_frame(m_pFormatCtx, &packet) < 0;
+		}
 		// Even if we've read all frames, some may have been re-ordered frames at the end.
 		// Still need to decode those, so keep calling avcodec_decode_video2() / avcodec_receive_frame().
-		if (dataEnd || packet.stream_index == m_videoStream) {
+		if (dataEnd || packet.stream_index == streamNum) {
 			// avcodec_decode_video2() / avcodec_send_packet() gives us the re-ordered frames with a NULL packet.
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 12, 100)
 			if (dataEnd)
@@ -680,10 +767,10 @@ bool MediaEngine::stepVideo(int videoPixelMode, bool skipFrame) {
 
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 48, 101)
 			if (packet.size != 0)
-				avcodec_send_packet(m_pCodecCtx, &packet);
-			int result = avcodec_receive_frame(m_pCodecCtx, m_pFrame);
+				avcodec_send_packet(codecCtx, &packet);
+			int result = avcodec_receive_frame(codecCtx, frame);
 			if (result == 0) {
-				result = m_pFrame->pkt_size;
+				result = frame->pkt_size;
 				frameFinished = 1;
 			} else if (result == AVERROR(EAGAIN)) {
 				result = 0;
@@ -692,65 +779,142 @@ bool MediaEngine::stepVideo(int videoPixelMode, bool skipFrame) {
 				frameFinished = 0;
 			}
 #else
-			int result = avcodec_decode_video2(m_pCodecCtx, m_pFrame, &frameFinished, &packet);
+			int result = avcodec_decode_video2(codecCtx, frame, &frameFinished, &packet);
 #endif
 			if (frameFinished) {
-				if (!m_pFrameRGB) {
-					setVideoDim();
-				}
-				if (m_pFrameRGB && !skipFrame) {
-					updateSwsFormat(videoPixelMode);
-					// TODO: Technically we could set this to frameWidth instead of m_desWidth for better perf.
-					// Update the linesize for the new format too.  We started with the largest size, so it should fit.
-					m_pFrameRGB->linesize[0] = getPixelFormatBytes(videoPixelMode) * m_desWidth;
-
-					sws_scale(m_sws_ctx, m_pFrame->data, m_pFrame->linesize, 0,
-						m_pCodecCtx->height, m_pFrameRGB->data, m_pFrameRGB->linesize);
-				}
-
-#if LIBAVUTIL_VERSION_MAJOR >= 59
-				int64_t bestPts = m_pFrame->best_effort_timestamp;
-				int64_t ptsDuration = m_pFrame->duration;
-#elif LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(55, 58, 100)
-				int64_t bestPts = m_pFrame->best_effort_timestamp;
-				int64_t ptsDuration = m_pFrame->pkt_duration;
-#else
-				int64_t bestPts = av_frame_get_best_effort_timestamp(m_pFrame);
-				int64_t ptsDuration = av_frame_get_pkt_duration(m_pFrame);
-#endif
-				if (ptsDuration == 0) {
-					if (m_lastPts == bestPts - m_firstTimeStamp || bestPts == AV_NOPTS_VALUE) {
-						// TODO: Assuming 29.97 if missing.
-						m_videopts += 3003;
-					} else {
-						m_videopts = bestPts - m_firstTimeStamp;
-						m_lastPts = m_videopts;
-					}
-				} else if (bestPts != AV_NOPTS_VALUE) {
-					m_videopts = bestPts + ptsDuration - m_firstTimeStamp;
-					m_lastPts = m_videopts;
-				} else {
-					m_videopts += ptsDuration;
-					m_lastPts = m_videopts;
-				}
-				bGetFrame = true;
+				decoded->gotFrame = true;
 			}
 			if (result <= 0 && dataEnd) {
-				// Sometimes, m_readSize is less than m_streamSize at the end, but not by much.
-				// This is kinda a hack, but the ringbuffer would have to be prematurely empty too.
-				m_isVideoEnd = !bGetFrame && (m_pdata->getQueueSize() == 0);
-				if (m_isVideoEnd)
-					m_decodingsize = 0;
+				decoded->reachedEnd = true;
 				break;
 			}
 		}
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 48, 101)
+		else if (onDecodeThread && m_pFormatCtx->streams[packet.stream_index]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+			// Synchronously, this would be skipped too, unless the game switches to that stream before taking this frame.
+			AVPacket *other = av_packet_alloc();
+			if (other && av_packet_ref(other, &packet) == 0)
+				decoded->otherPackets.push_back(other);
+			else
+				av_packet_free(&other);
+		}
+#endif
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 12, 100)
 		av_packet_unref(&packet);
 #else
 		av_free_packet(&packet);
 #endif
 	}
-	return bGetFrame;
+}
+
+// The size and format of the video. While decoding ahead, the decode thread owns the codec context,
+// so this comes from the last frame stepVideo took, which is also what actually gets converted.
+void MediaEngine::getVideoFormat(int *width, int *height, int *pixFmt) const {
+	if (m_pFrame && m_pFrame->width > 0 && m_pFrame->height > 0) {
+		*width = m_pFrame->width;
+		*height = m_pFrame->height;
+		*pixFmt = m_pFrame->format;
+		return;
+	}
+
+	auto codecIter = m_pCodecCtxs.find(m_videoStream);
+	if (codecIter == m_pCodecCtxs.end() || m_decodeAhead.IsRunning()) {
+		*width = 0;
+		*height = 0;
+		*pixFmt = AV_PIX_FMT_NONE;
+		return;
+	}
+	*width = codecIter->second->width;
+	*height = codecIter->second->height;
+	*pixFmt = codecIter->second->pix_fmt;
+}
+#endif // USE_FFMPEG
+
+bool MediaEngine::stepVideo(int videoPixelMode, bool skipFrame) {
+#ifdef USE_FFMPEG
+	auto codecIter = m_pCodecCtxs.find(m_videoStream);
+	AVCodecContext *m_pCodecCtx = codecIter == m_pCodecCtxs.end() ? 0 : codecIter->second;
+
+	if (!m_pFormatCtx)
+		return false;
+	if (!m_pCodecCtx)
+		return false;
+	if (!m_pFrame)
+		return false;
+
+	// Frames that were decoded ahead come first, even if decode-ahead has stopped since.
+	DecodedVideoFrame decoded;
+	if (!takeDecodedFrame(&decoded)) {
+		decodeVideoFrame(m_pCodecCtx, m_videoStream, m_pFrame, &decoded, false);
+	}
+
+	if (decoded.gotFrame) {
+		if (!m_pFrameRGB) {
+			setVideoDim();
+		}
+		if (m_pFrameRGB && !skipFrame) {
+			// TODO: Technically we could set this to frameWidth instead of m_desWidth for better perf.
+			// Update the linesize for the new format too.  We started with the largest size, so it should fit.
+			m_pFrameRGB->linesize[0] = getPixelFormatBytes(videoPixelMode) * m_desWidth;
+
+			if (canConvertYUVDirectly()) {
+				// Keep our own reference, the decoder reuses m_pFrame for the next frame.
+				if (!m_pFrameYUV)
+					m_pFrameYUV = av_frame_alloc();
+				av_frame_unref(m_pFrameYUV);
+				m_yuvFramePending = m_pFrameYUV && av_frame_ref(m_pFrameYUV, m_pFrame) == 0;
+				m_yuvFramePixelMode = videoPixelMode;
+			} else {
+				m_yuvFramePending = false;
+			}
+
+			if (!m_yuvFramePending) {
+				updateSwsFormat(videoPixelMode);
+				// The frame's own height, the codec context may already be on a later frame.
+				sws_scale(m_sws_ctx, m_pFrame->data, m_pFrame->linesize, 0,
+					m_pFrame->height, m_pFrameRGB->data, m_pFrameRGB->linesize);
+			}
+		}
+
+#if LIBAVUTIL_VERSION_MAJOR >= 59
+		int64_t bestPts = m_pFrame->best_effort_timestamp;
+		int64_t ptsDuration = m_pFrame->duration;
+#elif LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(55, 58, 100)
+		int64_t bestPts = m_pFrame->best_effort_timestamp;
+		int64_t ptsDuration = m_pFrame->pkt_duration;
+#else
+		int64_t bestPts = av_frame_get_best_effort_timestamp(m_pFrame);
+		int64_t ptsDuration = av_frame_get_pkt_duration(m_pFrame);
+#endif
+		if (ptsDuration == 0) {
+			if (m_lastPts == bestPts - m_firstTimeStamp || bestPts == AV_NOPTS_VALUE) {
+				// TODO: Assuming 29.97 if missing.
+				m_videopts += 3003;
+			} else {
+				m_videopts = bestPts - m_firstTimeStamp;
+				m_lastPts = m_videopts;
+			}
+		} else if (bestPts != AV_NOPTS_VALUE) {
+			m_videopts = bestPts + ptsDuration - m_firstTimeStamp;
+			m_lastPts = m_videopts;
+		} else {
+			m_videopts += ptsDuration;
+			m_lastPts = m_videopts;
+		}
+	}
+	if (decoded.reachedEnd) {
+		// Sometimes, m_readSize is less than m_streamSize at the end, but not by much.
+		// This is kinda a hack, but the ringbuffer would have to be prematurely empty too.
+		m_isVideoEnd = !decoded.gotFrame && (m_pdata->getQueueSize() == 0);
+		if (m_isVideoEnd)
+			m_decodingsize = 0;
+	}
+
+	// Only once everything read ahead earlier has been used up, since it'd start reading where that ended.
+	if (!m_decodeAhead.IsRunning() && m_decodeAhead.Empty() && m_replayPackets.empty() && canDecodeAhead()) {
+		startDecodeAhead(m_pCodecCtx);
+	}
+	return decoded.gotFrame;
 #else
 	// If video engine is not available, just add to the timestamp at least.
 	m_videopts += 3003;
@@ -758,6 +922,140 @@ bool MediaEngine::stepVideo(int videoPixelMode, bool skipFrame) {
 #endif // USE_FFMPEG
 }
 
+#ifdef USE_FFMPEG
+bool MediaEngine::canDecodeAhead() const {
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 48, 101)
+	// Needs reference counted frames to queue them up, and only one video stream, since the
+	// decode thread would otherwise skip packets of a stream the game might switch to.
+	// The header must also be fully read, since only m_pdata is read ahead.
+	return g_Config.bVideoDecodeAhead && m_expectedVideoStreams <= 1 && m_mpegheaderReadPos >= m_mpegheaderSize;
+#else
+	return false;
+#endif
+}
+
+void MediaEngine::startDecodeAhead(AVCodecContext *codecCtx) {
+	m_decodeReadOffset = 0;
+	const int streamNum = m_videoStream;
+	m_decodeAhead.Start("VideoDecode", [this, codecCtx, streamNum](DecodedVideoFrame *decoded) {
+		m_decodeFrameBytes = 0;
+		m_decodeFrameLastRead = 0;
+		AVFrame *frame = av_frame_alloc();
+		decodeVideoFrame(codecCtx, streamNum, frame, decoded, true);
+		decoded->bytesRead = m_decodeFrameBytes;
+		decoded->lastReadSize = m_decodeFrameLastRead;
+		if (decoded->gotFrame) {
+			decoded->frame = frame;
+		} else {
+			av_frame_free(&frame);
+		}
+	}, MAX_DECODE_AHEAD_FRAMES);
+}
+
+// With keepFrames, the frame being decoded is finished with the data there is (as if stepVideo had asked
+// for it now), and everything decoded stays queued for stepVideo. Otherwise, it's all thrown away.
+void MediaEngine::stopDecodeAhead(bool keepFrames) {
+	if (m_decodeAhead.IsRunning()) {
+		m_decodeAhead.Stop(keepFrames);
+		m_decodeStats.maxQueueDepth = std::max(m_decodeStats.maxQueueDepth, m_decodeAhead.MaxDepthSeen());
+	}
+	if (keepFrames)
+		return;
+
+	// FFmpeg already consumed what was read ahead, so skip past it, as if those frames were dropped.
+	DecodedVideoFrame decoded;
+	while (m_decodeAhead.TryTake(&decoded)) {
+		if (decoded.gotFrame)
+			m_decodeStats.framesDropped++;
+		freeDecodedFrame(&decoded);
+	}
+	if (m_pdata && m_decodeReadOffset > 0) {
+		m_pdata->pop_front(nullptr, m_decodeReadOffset);
+	}
+	m_decodeReadOffset = 0;
+	clearReplayPackets();
+}
+
+void MediaEngine::freeDecodedFrame(DecodedVideoFrame *decoded) {
+	av_frame_free(&decoded->frame);
+	for (AVPacket *&packet : decoded->otherPackets)
+		av_packet_free(&packet);
+	decoded->otherPackets.clear();
+}
+
+void MediaEngine::clearReplayPackets() {
+	for (AVPacket *&packet : m_replayPackets)
+		av_packet_free(&packet);
+	m_replayPackets.clear();
+}
+
+// Takes the next frame that was decoded ahead, if any, into m_pFrame.
+bool MediaEngine::takeDecodedFrame(DecodedVideoFrame *decoded) {
+	while (true) {
+		const bool running = m_decodeAhead.IsRunning();
+		const int depth = running ? m_decodeAhead.Size() : 0;
+		bool stalled = false;
+		double start = time_now_d();
+		if (!m_decodeAhead.Take(decoded, &stalled))
+			return false;
+		if (running) {
+			m_decodeStats.queueDepthSum += depth;
+			m_decodeStats.queueDepthSamples++;
+			if (stalled) {
+				m_decodeStats.stalls++;
+				m_decodeStats.stallSeconds += time_now_d() - start;
+			}
+		}
+
+		{
+			// Now it's actually consumed, like MpegReadbuffer would have done.
+			std::unique_lock<std::mutex> guard = m_decodeAhead.Lock();
+			m_pdata->pop_front(nullptr, decoded->bytesRead);
+			m_decodeReadOffset -= decoded->bytesRead;
+		}
+		if (decoded->lastReadSize > 0)
+			m_decodingsize = decoded->lastReadSize;
+
+		if (decoded->streamNum != m_videoStream) {
+			// The game switched streams, so decoding now would've skipped this one, but not the packets
+			// of other streams read on the way.
+			if (decoded->gotFrame)
+				m_decodeStats.framesDropped++;
+			m_replayPackets.insert(m_replayPackets.end(), decoded->otherPackets.begin(), decoded->otherPackets.end());
+			decoded->otherPackets.clear();
+			freeDecodedFrame(decoded);
+			*decoded = DecodedVideoFrame();
+			continue;
+		}
+
+		m_decodeStats.framesDecoded++;
+		av_frame_unref(m_pFrame);
+		if (decoded->frame)
+			av_frame_move_ref(m_pFrame, decoded->frame);
+		freeDecodedFrame(decoded);
+		return true;
+	}
+}
+
+int MediaEngine::readAhead(uint8_t *buf, int buf_size) {
+	std::unique_lock<std::mutex> guard = m_decodeAhead.Lock();
+	// A full read gets the same bytes no matter when it happens, but a short one depends on how much
+	// data the game has added so far. So for those, wait until stepVideo actually wants the frame.
+	bool ok = m_decodeAhead.WaitForInput(guard, [&] {
+		return m_pdata->getQueueSize() - m_decodeReadOffset >= buf_size;
+	});
+	if (!ok)
+		return 0;
+
+	int size = m_pdata->peek(buf, m_decodeReadOffset, buf_size);
+	m_decodeReadOffset += size;
+	m_decodeFrameBytes += size;
+	if (size > 0)
+		m_decodeFrameLastRead = size;
+	return size;
+}
+#endif // USE_FFMPEG
+
 // Helpers that null out alpha (which seems to be the case on the PSP.)
 // Some games depend on this, for example Sword Art Online (doesn't clear A's from buffer.)
 inline void writeVideoLineRGBA(void *destp, const void *srcp, int width) {
@@ -801,26 +1099,34 @@ inline void writeVideoLineABGR5650(void *destp, const void *srcp, int width) {
 	memcpy(destp, srcp, width * sizeof(u16));
 }
 
-inline void writeVideoLineABGR5551(void *destp, const void *srcp, int width) {
-	// TODO: Use SSE/NEON.
+inline void writeVideoLineMasked16(void *destp, const void *srcp, int width, u16 mask) {
 	u16_le *dest = (u16_le *)destp;
 	const u16_le *src = (u16_le *)srcp;
 
-	const u16 mask = 0x7FFF;
-	for (int i = 0; i < width; ++i) {
+	int i = 0;
+#if PPSSPP_ARCH(SSE2)
+	__m128i mask16 = _mm_set1_epi16(mask);
+	for (; i + 8 <= width; i += 8) {
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + i)), mask16));
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	uint16x8_t mask16 = vdupq_n_u16(mask);
+	for (; i + 8 <= width; i += 8) {
+		vst1q_u16((u16 *)dest + i, vandq_u16(vld1q_u16((const u16 *)src + i), mask16));
+	}
+#endif
+	DO_NOT_VECTORIZE_LOOP
+	for (; i < width; ++i) {
 		dest[i] = src[i] & mask;
 	}
 }
 
-inline void writeVideoLineABGR4444(void *destp, const void *srcp, int width) {
-	// TODO: Use SSE/NEON.
-	u16_le *dest = (u16_le *)destp;
-	const u16_le *src = (u16_le *)srcp;
+inline void writeVideoLineABGR5551(void *destp, const void *srcp, int width) {
+	writeVideoLineMasked16(destp, srcp, width, 0x7FFF);
+}
 
-	const u16 mask = 0x0FFF;
-	for (int i = 0; i < width; ++i) {
-		dest[i] = src[i] & mask;
-	}
+inline void writeVideoLineABGR4444(void *destp, const void *srcp, int width) {
+	writeVideoLineMasked16(destp, srcp, width, 0x0FFF);
 }
 
 int MediaEngine::writeVideoImage(u32 bufferPtr, int frameWidth, int videoPixelMode) {
@@ -861,38 +1167,47 @@ int MediaEngine::writeVideoImage(u32 bufferPtr, int frameWidth, int videoPixelMo
 		imgbuf = new u8[videoImageSize];
 	}
 
-	switch (videoPixelMode) {
-	case GE_CMODE_32BIT_ABGR8888:
+	if (m_yuvFramePending && videoLineSize != 0) {
+		// Straight from the decoded frame, no need for the intermediate copy.
 		for (int y = 0; y < height; y++) {
-			writeVideoLineRGBA(imgbuf + videoLineSize * y, data, width);
-			data += width * sizeof(u32);
+			convertVideoLineYUV(imgbuf + videoLineSize * y, m_pFrameYUV, y, width, videoPixelMode);
 		}
-		break;
+	} else {
+		// The frame may not have been converted yet, for example with an unusual pixel mode.
+		convertPendingYUVFrame();
+		switch (videoPixelMode) {
+		case GE_CMODE_32BIT_ABGR8888:
+			for (int y = 0; y < height; y++) {
+				writeVideoLineRGBA(imgbuf + videoLineSize * y, data, width);
+				data += width * sizeof(u32);
+			}
+			break;
 
-	case GE_CMODE_16BIT_BGR5650:
-		for (int y = 0; y < height; y++) {
-			writeVideoLineABGR5650(imgbuf + videoLineSize * y, data, width);
-			data += width * sizeof(u16);
-		}
-		break;
+		case GE_CMODE_16BIT_BGR5650:
+			for (int y = 0; y < height; y++) {
+				writeVideoLineABGR5650(imgbuf + videoLineSize * y, data, width);
+				data += width * sizeof(u16);
+			}
+			break;
 
-	case GE_CMODE_16BIT_ABGR5551:
-		for (int y = 0; y < height; y++) {
-			writeVideoLineABGR5551(imgbuf + videoLineSize * y, data, width);
-			data += width * sizeof(u16);
-		}
-		break;
+		case GE_CMODE_16BIT_ABGR5551:
+			for (int y = 0; y < height; y++) {
+				writeVideoLineABGR5551(imgbuf + videoLineSize * y, data, width);
+				data += width * sizeof(u16);
+			}
+			break;
 
-	case GE_CMODE_16BIT_ABGR4444:
-		for (int y = 0; y < height; y++) {
-			writeVideoLineABGR4444(imgbuf + videoLineSize * y, data, width);
-			data += width * sizeof(u16);
-		}
-		break;
+		case GE_CMODE_16BIT_ABGR4444:
+			for (int y = 0; y < height; y++) {
+				writeVideoLineABGR4444(imgbuf + videoLineSize * y, data, width);
+				data += width * sizeof(u16);
+			}
+			break;
 
-	default:
-		ERROR_LOG_REPORT(Log::ME, "Unsupported video pixel format %d", videoPixelMode);
-		break;
+		default:
+			ERROR_LOG_REPORT(Log::ME, "Unsupported video pixel format %d", videoPixelMode);
+			break;
+		}
 	}
 
 	if (swizzle) {
@@ -941,6 +1256,7 @@ int MediaEngine::writeVideoImageWithRange(u32 bufferPtr, int frameWidth, int vid
 
 	// lock the image size
 	u8 *imgbuf = buffer;
+	convertPendingYUVFrame();
 	const u8 *data = m_pFrameRGB->data[0];
 
 	bool swizzle = Memory::IsVRAMAddress(bufferPtr) && (bufferPtr & 0x00200000) == 0x00200000;
@@ -1015,6 +1331,7 @@ int MediaEngine::writeVideoImageWithRange(u32 bufferPtr, int frameWidth, int vid
 
 u8 *MediaEngine::getFrameImage() {
 #ifdef USE_FFMPEG
+	convertPendingYUVFrame();
 	return m_pFrameRGB->data[0];
 #else
 	return nullptr;
@@ -24,9 +24,13 @@
 
 // An approximation of what the interface will look like. Similar to JPCSP's.
 
+#include <deque>
 #include <map>
+#include <vector>
+
 #include "Common/CommonTypes.h"
 #include "Core/HLE/sceMpeg.h"
+#include "Core/HW/DecodeAheadQueue.h"
 #include "Core/HW/MpegDemux.h"
 #include "Core/HW/SimpleAudioDec.h"
 
@@ -39,6 +43,7 @@ struct AVFrame;
 struct AVIOContext;
 struct AVFormatContext;
 struct AVCodecContext;
+struct AVPacket;
 #endif
 
 inline s64 getMpegTimeStamp(const u8 *buf) {
@@ -50,6 +55,19 @@ inline s64 getMpegTimeStamp(const u8 *buf) {
 bool InitFFmpeg();
 #endif
 
+struct MediaDecodeAheadStats {
+	int framesDecoded = 0;
+	// Frames thrown away when decode-ahead had to stop early, like on a stream switch.
+	int framesDropped = 0;
+	// Times stepVideo had to wait for the decode thread, and for how long in total.
+	int stalls = 0;
+	double stallSeconds = 0.0;
+	int maxQueueDepth = 0;
+	// Queue depth seen by stepVideo, summed up so the average can be computed.
+	s64 queueDepthSum = 0;
+	int queueDepthSamples = 0;
+};
+
 class MediaEngine {
 public:
 	MediaEngine();
@@ -97,6 +115,33 @@ class MediaEngine {
 	bool SetupStreams();
 	bool setVideoDim(int width = 0, int height = 0);
 	void updateSwsFormat(int videoPixelMode);
+	bool canConvertYUVDirectly() const;
+	void convertPendingYUVFrame();
+
+#ifdef USE_FFMPEG
+	struct DecodedVideoFrame {
+		AVFrame *frame = nullptr;
+		// The stream it was decoded for. Only frames of the current stream are shown.
+		int streamNum = -1;
+		bool gotFrame = false;
+		// Ran out of data, which is when stepVideo decides whether the video has ended.
+		bool reachedEnd = false;
+		// Only tracked on the decode-ahead thread, since it doesn't consume from m_pdata.
+		int bytesRead = 0;
+		int lastReadSize = 0;
+		// Packets of other video streams read on the way, in case the game switches to one of them.
+		std::vector<AVPacket *> otherPackets;
+	};
+	void decodeVideoFrame(AVCodecContext *codecCtx, int streamNum, AVFrame *frame, DecodedVideoFrame *decoded, bool onDecodeThread);
+	void getVideoFormat(int *width, int *height, int *pixFmt) const;
+	bool canDecodeAhead() const;
+	void startDecodeAhead(AVCodecContext *codecCtx);
+	void stopDecodeAhead(bool keepFrames);
+	bool takeDecodedFrame(DecodedVideoFrame *decoded);
+	void freeDecodedFrame(DecodedVideoFrame *decoded);
+	void clearReplayPackets();
+	int readAhead(uint8_t *buf, int buf_size);
+#endif
 	int getNextAudioFrame(u8 **buf, int *headerCode1, int *headerCode2);
 
 	static int MpegReadbuffer(void *opaque, uint8_t *buf, int buf_size);
@@ -128,6 +173,27 @@ class MediaEngine {
 	std::vector<AVCodecContext *> m_codecsToClose;
 	AVIOContext *m_pIOContext = nullptr;
 	SwsContext *m_sws_ctx = nullptr;
+	// Plain YUV420 frames at the output size skip swscale, and get converted straight into the
+	// destination by writeVideoImage. Until then, m_pFrameRGB doesn't have the frame yet.
+	AVFrame *m_pFrameYUV = nullptr;
+	bool m_yuvFramePending = false;
+	int m_yuvFramePixelMode = 0;
+
+	// Decode-ahead: a thread decodes the next few frames from the data already queued in m_pdata.
+	// It only peeks at m_pdata, the bytes are popped by stepVideo when it takes the frame, and it
+	// waits for stepVideo before any short read, so the game sees exactly the same state as when
+	// decoding synchronously. This includes savestates.
+	// While it runs, the codec context and format context belong to the decode thread.
+	// The lock of m_decodeAhead also protects m_pdata and m_decodeReadOffset.
+	DecodeAheadQueue<DecodedVideoFrame> m_decodeAhead;
+	// Bytes past the front of m_pdata that were already read by the decode thread.
+	int m_decodeReadOffset = 0;
+	// Only used on the decode thread, for the frame in progress.
+	int m_decodeFrameBytes = 0;
+	int m_decodeFrameLastRead = 0;
+	// Packets of another stream that the decode thread read past, to go through before reading more.
+	std::deque<AVPacket *> m_replayPackets;
+	MediaDecodeAheadStats m_decodeStats;
 #endif
 
 	int m_sws_fmt = 0;
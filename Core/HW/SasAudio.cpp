@@ -18,6 +18,9 @@
 #include <algorithm>
 
 #include "Common/Profiler/Profiler.h"
+#include "Common/Math/SIMDHeaders.h"
+#include "Common/Thread/ParallelLoop.h"
+#include "Common/CPUDetect.h"
 
 #include "Common/Serialize/SerializeFuncs.h"
 #include "Core/MemMapHelpers.h"
@@ -28,6 +31,9 @@
 #include "Core/System.h"
 #include "SasAudio.h"
 
+// With fewer voices playing than this, decoding them on other threads costs more than it saves.
+static const int SAS_PARALLEL_MIN_VOICES = 8;
+
 static const u8 f[16][2] = {
 	{   0,   0 },
 	{  60,   0 },
@@ -63,7 +69,45 @@ void VagDecoder::Start(u32 data, u32 vagSize, bool loopEnabled) {
 	s_2 = 0;
 }
 
-void VagDecoder::DecodeBlock(const u8 *&read_pointer) {
+// Unpacks the 28 nibbles of a block (starting at byte 2) into samples, before prediction.
+// out needs room for 32 samples, the last 4 are garbage.
+static void UnpackVagNibbles(const u8 *block, int shift_factor, s16 *out) {
+#if PPSSPP_ARCH(SSE2)
+	// Load the whole block rather than reading past its end, and drop the two header bytes.
+	__m128i data = _mm_srli_si128(_mm_loadu_si128((const __m128i *)block), 2);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i highMask = _mm_set1_epi16((short)0xF000);
+	const __m128i shift = _mm_cvtsi32_si128(shift_factor);
+	for (int half = 0; half < 2; half++) {
+		__m128i bytes = half == 0 ? _mm_unpacklo_epi8(data, zero) : _mm_unpackhi_epi8(data, zero);
+		// Low nibble first, each placed in the top bits so the arithmetic shift sign extends it.
+		__m128i lowNibbles = _mm_sra_epi16(_mm_slli_epi16(bytes, 12), shift);
+		__m128i highNibbles = _mm_sra_epi16(_mm_and_si128(_mm_slli_epi16(bytes, 8), highMask), shift);
+		_mm_storeu_si128((__m128i *)(out + half * 16), _mm_unpacklo_epi16(lowNibbles, highNibbles));
+		_mm_storeu_si128((__m128i *)(out + half * 16 + 8), _mm_unpackhi_epi16(lowNibbles, highNibbles));
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	uint8x16_t data = vextq_u8(vld1q_u8(block), vdupq_n_u8(0), 2);
+	const int16x8_t shift = vdupq_n_s16(-shift_factor);
+	for (int half = 0; half < 2; half++) {
+		int16x8_t bytes = vreinterpretq_s16_u16(vmovl_u8(half == 0 ? vget_low_u8(data) : vget_high_u8(data)));
+		int16x8_t lowNibbles = vshlq_s16(vshlq_n_s16(bytes, 12), shift);
+		int16x8_t highNibbles = vshlq_s16(vandq_s16(vshlq_n_s16(bytes, 8), vdupq_n_s16((short)0xF000)), shift);
+		int16x8x2_t zipped = vzipq_s16(lowNibbles, highNibbles);
+		vst1q_s16(out + half * 16, zipped.val[0]);
+		vst1q_s16(out + half * 16 + 8, zipped.val[1]);
+	}
+#else
+	const u8 *readp = block + 2;
+	for (int i = 0; i < 28; i += 2) {
+		u8 d = *readp++;
+		out[i] = (short)((d & 0xf) << 12) >> shift_factor;
+		out[i + 1] = (short)((d & 0xf0) << 8) >> shift_factor;
+	}
+#endif
+}
+
+void VagDecoder::DecodeBlock(const u8 *&read_pointer, s16 *outSamples) {
 	if (curBlock_ == numBlocks_ - 1) {
 		end_ = true;
 		return;
@@ -72,10 +116,10 @@ void VagDecoder::DecodeBlock(const u8 *&read_pointer) {
 	_dbg_assert_(curBlock_ < numBlocks_);
 
 	const u8 *readp = read_pointer;
-	int predict_nr = *readp++;
+	int predict_nr = readp[0];
 	int shift_factor = predict_nr & 0xf;
 	predict_nr >>= 4;
-	int flags = *readp++;
+	int flags = readp[1];
 	if (flags == 7) {
 		VERBOSE_LOG(Log::SasMix, "VAG ending block at %d", curBlock_);
 		end_ = true;
@@ -90,33 +134,49 @@ void VagDecoder::DecodeBlock(const u8 *&read_pointer) {
 		}
 	}
 
-	// Keep state in locals to avoid bouncing to memory.
-	int s1 = s_1;
-	int s2 = s_2;
+	s16 unpacked[32];
+	UnpackVagNibbles(readp, shift_factor, unpacked);
 
-	int coef1 = f[predict_nr][0];
-	int coef2 = -f[predict_nr][1];
+	const int coef1 = f[predict_nr][0];
+	const int coef2 = -f[predict_nr][1];
 
-	// TODO: Unroll once more and interleave the unpacking with the decoding more?
-	for (int i = 0; i < 28; i += 2) {
-		u8 d = *readp++;
-		int sample1 = (short)((d & 0xf) << 12) >> shift_factor;
-		int sample2 = (short)((d & 0xf0) << 8) >> shift_factor;
-		s2 = clamp_s16(sample1 + ((s1 * coef1 + s2 * coef2) >> 6));
-		s1 = clamp_s16(sample2 + ((s2 * coef1 + s1 * coef2) >> 6));
-		samples[i] = s2;
-		samples[i + 1] = s1;
+	if (coef1 == 0 && coef2 == 0) {
+		// No prediction, the unpacked samples are the output.
+		memcpy(outSamples, unpacked, 28 * sizeof(s16));
+		s_1 = unpacked[27];
+		s_2 = unpacked[26];
+	} else {
+		// Keep state in locals to avoid bouncing to memory.
+		int s1 = s_1;
+		int s2 = s_2;
+		for (int i = 0; i < 28; i++) {
+			int sample = unpacked[i] + ((s1 * coef1 + s2 * coef2) >> 6);
+			// Clipping is rare, so a predictable branch beats a clamp in the dependency chain.
+			if ((u32)(sample + 32768) > 65535)
+				sample = clamp_s16(sample);
+			outSamples[i] = sample;
+			s2 = s1;
+			s1 = sample;
+		}
+		s_1 = s1;
+		s_2 = s2;
 	}
 
-	s_1 = s1;
-	s_2 = s2;
 	curSample = 0;
 	curBlock_++;
 
-	read_pointer = readp;
+	read_pointer = readp + 16;
+}
+
+template <size_t tagLen>
+static void NotifySasRead(SasReadLog *reads, u32 addr, u32 size, const char (&tag)[tagLen]) {
+	if (reads)
+		reads->reads.push_back({ addr, size, tag });
+	else
+		NotifyMemInfo(MemBlockFlags::READ, addr, size, tag, tagLen - 1);
 }
 
-void VagDecoder::GetSamples(s16 *outSamples, int numSamples) {
+void VagDecoder::GetSamples(s16 *outSamples, int numSamples, SasReadLog *reads) {
 	if (end_) {
 		memset(outSamples, 0, numSamples * sizeof(s16));
 		return;
@@ -129,7 +189,11 @@ void VagDecoder::GetSamples(s16 *outSamples, int numSamples) {
 	const u8 *readp = Memory::GetPointerUnchecked(read_);
 	const u8 *origp = readp;
 
-	for (int i = 0; i < numSamples; i++) {
+	// Whole blocks are decoded straight into the output. The last one is copied to samples at the end,
+	// as if it had been decoded there.
+	const s16 *lastDirectBlock = nullptr;
+	int i = 0;
+	while (i < numSamples) {
 		if (curSample == 28) {
 			if (loopAtNextBlock_) {
 				VERBOSE_LOG(Log::SasMix, "Looping VAG from block %d/%d to %d", curBlock_, numBlocks_, loopStartBlock_);
@@ -140,20 +204,35 @@ void VagDecoder::GetSamples(s16 *outSamples, int numSamples) {
 				curBlock_ = loopStartBlock_;
 				loopAtNextBlock_ = false;
 			}
-			DecodeBlock(readp);
+			const bool direct = numSamples - i >= 28;
+			DecodeBlock(readp, direct ? &outSamples[i] : samples);
 			if (end_) {
 				// Clear the rest of the buffer and return.
 				memset(&outSamples[i], 0, (numSamples - i) * sizeof(s16));
+				if (lastDirectBlock)
+					memcpy(samples, lastDirectBlock, sizeof(samples));
 				return;
 			}
+			if (direct) {
+				lastDirectBlock = &outSamples[i];
+				curSample = 28;
+				i += 28;
+				continue;
+			}
+			lastDirectBlock = nullptr;
 		}
 		_dbg_assert_(curSample < 28);
-		outSamples[i] = samples[curSample++];
+		int count = std::min(28 - curSample, numSamples - i);
+		memcpy(&outSamples[i], &samples[curSample], count * sizeof(s16));
+		curSample += count;
+		i += count;
 	}
+	if (lastDirectBlock)
+		memcpy(samples, lastDirectBlock, sizeof(samples));
 
 	if (readp > origp) {
 		if (MemBlockInfoDetailed())
-			NotifyMemInfo(MemBlockFlags::READ, read_, readp - origp, "SasVagDecoder");
+			NotifySasRead(reads, read_, (u32)(readp - origp), "SasVagDecoder");
 		read_ += readp - origp;
 	}
 }
@@ -467,11 +546,11 @@ int SasInstance::EstimateMixUs() {
 	return std::min(cycles, 1200);
 }
 
-void SasVoice::ReadSamples(s16 *output, int numSamples) {
+void SasVoice::ReadSamples(s16 *output, int numSamples, SasReadLog *reads) {
 	// Read N samples into the resample buffer. Could do either PCM or VAG here.
 	switch (type) {
 	case VOICETYPE_VAG:
-		vag.GetSamples(output, numSamples);
+		vag.GetSamples(output, numSamples, reads);
 		break;
 	case VOICETYPE_PCM:
 		{
@@ -483,7 +562,12 @@ void SasVoice::ReadSamples(s16 *output, int numSamples) {
 					pcmIndex = 0;
 					break;
 				}
-				Memory::Memcpy(out, pcmAddr + pcmIndex * sizeof(s16), size * sizeof(s16), "SasVoicePCM");
+				const u32 addr = pcmAddr + pcmIndex * sizeof(s16);
+				const u8 *src = Memory::GetPointerRange(addr, size * sizeof(s16));
+				if (src) {
+					memcpy(out, src, size * sizeof(s16));
+					NotifySasRead(reads, addr, size * sizeof(s16), "SasVoicePCM");
+				}
 				pcmIndex += size;
 				needed -= size;
 				out += size;
@@ -525,7 +609,192 @@ bool SasVoice::HaveSamplesEnded() const {
 	}
 }
 
-void SasInstance::MixVoice(SasVoice &voice) {
+#if PPSSPP_ARCH(SSE2)
+// Interpolates 4 samples from pairs interleaved as (s0, s1, s0, s1, ...), weights as (PITCH_MASK - f, f, ...).
+// The weights sum to less than 0x1000, so this can't overflow or go out of s16 range.
+static inline __m128i InterpolatePairsSSE2(__m128i pairs, __m128i weights) {
+	return _mm_srai_epi32(_mm_madd_epi16(pairs, weights), PSP_SAS_PITCH_BASE_SHIFT);
+}
+
+static inline __m128i InterpolationWeightsSSE2(int f) {
+	return _mm_set1_epi32((f << 16) | (PSP_SAS_PITCH_MASK - f));
+}
+#endif
+
+// All samples at the same fraction: unity pitch (stride 1) or 2x (stride 2).
+static void ResampleFixedFraction(s16 *out, const s16 *src, int f, int stride, int count) {
+	int i = 0;
+#if PPSSPP_ARCH(SSE2)
+	const __m128i weights = InterpolationWeightsSSE2(f);
+	if (stride == 1) {
+		for (; i + 8 <= count; i += 8) {
+			__m128i s0 = _mm_loadu_si128((const __m128i *)(src + i));
+			__m128i s1 = _mm_loadu_si128((const __m128i *)(src + i + 1));
+			__m128i lo = InterpolatePairsSSE2(_mm_unpacklo_epi16(s0, s1), weights);
+			__m128i hi = InterpolatePairsSSE2(_mm_unpackhi_epi16(s0, s1), weights);
+			_mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(lo, hi));
+		}
+	} else {
+		// The pairs are already next to each other in the source.
+		for (; i + 8 <= count; i += 8) {
+			__m128i lo = InterpolatePairsSSE2(_mm_loadu_si128((const __m128i *)(src + i * 2)), weights);
+			__m128i hi = InterpolatePairsSSE2(_mm_loadu_si128((const __m128i *)(src + i * 2 + 8)), weights);
+			_mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(lo, hi));
+		}
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	const int16x4_t w0 = vdup_n_s16(PSP_SAS_PITCH_MASK - f);
+	const int16x4_t w1 = vdup_n_s16(f);
+	for (; i + 8 <= count; i += 8) {
+		int16x8_t s0, s1;
+		if (stride == 1) {
+			s0 = vld1q_s16(src + i);
+			s1 = vld1q_s16(src + i + 1);
+		} else {
+			int16x8x2_t pairs = vld2q_s16(src + i * 2);
+			s0 = pairs.val[0];
+			s1 = pairs.val[1];
+		}
+		int32x4_t lo = vmlal_s16(vmull_s16(vget_low_s16(s0), w0), vget_low_s16(s1), w1);
+		int32x4_t hi = vmlal_s16(vmull_s16(vget_high_s16(s0), w0), vget_high_s16(s1), w1);
+		vst1q_s16(out + i, vcombine_s16(vshrn_n_s32(lo, PSP_SAS_PITCH_BASE_SHIFT), vshrn_n_s32(hi, PSP_SAS_PITCH_BASE_SHIFT)));
+	}
+#endif
+	for (; i < count; i++) {
+		const s16 *s = src + i * stride;
+		out[i] = (s[0] * (PSP_SAS_PITCH_MASK - f) + s[1] * f) >> PSP_SAS_PITCH_BASE_SHIFT;
+	}
+}
+
+// Half pitch: the fraction alternates between two values, and each source pair is used twice.
+static void ResampleHalf(s16 *out, const s16 *src, u32 sampleFrac, int count) {
+	const u32 oddFrac = sampleFrac + PSP_SAS_PITCH_BASE / 2;
+	const s16 *even = src + (sampleFrac >> PSP_SAS_PITCH_BASE_SHIFT);
+	const s16 *odd = src + (oddFrac >> PSP_SAS_PITCH_BASE_SHIFT);
+	const int evenF = sampleFrac & PSP_SAS_PITCH_MASK;
+	const int oddF = oddFrac & PSP_SAS_PITCH_MASK;
+
+	int i = 0;
+#if PPSSPP_ARCH(SSE2)
+	const __m128i evenWeights = InterpolationWeightsSSE2(evenF);
+	const __m128i oddWeights = InterpolationWeightsSSE2(oddF);
+	for (; i + 8 <= count; i += 8) {
+		const int k = i / 2;
+		__m128i e = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(even + k)), _mm_loadl_epi64((const __m128i *)(even + k + 1)));
+		__m128i o = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(odd + k)), _mm_loadl_epi64((const __m128i *)(odd + k + 1)));
+		e = InterpolatePairsSSE2(e, evenWeights);
+		o = InterpolatePairsSSE2(o, oddWeights);
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(_mm_unpacklo_epi32(e, o), _mm_unpackhi_epi32(e, o)));
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	for (; i + 8 <= count; i += 8) {
+		const int k = i / 2;
+		int32x4_t e = vmlal_s16(vmull_s16(vld1_s16(even + k), vdup_n_s16(PSP_SAS_PITCH_MASK - evenF)), vld1_s16(even + k + 1), vdup_n_s16(evenF));
+		int32x4_t o = vmlal_s16(vmull_s16(vld1_s16(odd + k), vdup_n_s16(PSP_SAS_PITCH_MASK - oddF)), vld1_s16(odd + k + 1), vdup_n_s16(oddF));
+		int16x4x2_t zipped = vzip_s16(vshrn_n_s32(e, PSP_SAS_PITCH_BASE_SHIFT), vshrn_n_s32(o, PSP_SAS_PITCH_BASE_SHIFT));
+		vst1q_s16(out + i, vcombine_s16(zipped.val[0], zipped.val[1]));
+	}
+#endif
+	for (; i < count; i++) {
+		const s16 *s = (i & 1) ? odd + i / 2 : even + i / 2;
+		const int f = (i & 1) ? oddF : evenF;
+		out[i] = (s[0] * (PSP_SAS_PITCH_MASK - f) + s[1] * f) >> PSP_SAS_PITCH_BASE_SHIFT;
+	}
+}
+
+u32 SasResample(s16 *out, const s16 *src, u32 sampleFrac, int pitch, int count) {
+	if (count <= 0)
+		return sampleFrac;
+
+	if (pitch == PSP_SAS_PITCH_BASE && (sampleFrac & PSP_SAS_PITCH_MASK) == 0) {
+		// No interpolation at all in this case.
+		memcpy(out, src + (sampleFrac >> PSP_SAS_PITCH_BASE_SHIFT), count * sizeof(s16));
+	} else if (pitch == PSP_SAS_PITCH_BASE || pitch == PSP_SAS_PITCH_BASE * 2) {
+		const s16 *s = src + (sampleFrac >> PSP_SAS_PITCH_BASE_SHIFT);
+		ResampleFixedFraction(out, s, sampleFrac & PSP_SAS_PITCH_MASK, pitch >> PSP_SAS_PITCH_BASE_SHIFT, count);
+	} else if (pitch == PSP_SAS_PITCH_BASE / 2) {
+		ResampleHalf(out, src, sampleFrac, count);
+	} else {
+		// Linear interpolation. Good enough. Need to make resampleHist bigger if we want more.
+		u32 frac = sampleFrac;
+		for (int i = 0; i < count; i++) {
+			const s16 *s = src + (frac >> PSP_SAS_PITCH_BASE_SHIFT);
+			int f = frac & PSP_SAS_PITCH_MASK;
+			out[i] = (s[0] * (PSP_SAS_PITCH_MASK - f) + s[1] * f) >> PSP_SAS_PITCH_BASE_SHIFT;
+			frac += pitch;
+		}
+	}
+	return sampleFrac + (u32)pitch * (u32)count;
+}
+
+void SasMixSamples(int *mixBuffer, int *sendBuffer, const s16 *samples, const int *envelope, int count, int volumeLeft, int volumeRight, int effectLeft, int effectRight) {
+	int i = 0;
+#if PPSSPP_ARCH(SSE2)
+	const __m128i rounding = _mm_set1_epi32(1 << 14);
+	const __m128i volumes = _mm_set1_epi32((volumeRight << 16) | (volumeLeft & 0xFFFF));
+	const __m128i effects = _mm_set1_epi32((effectRight << 16) | (effectLeft & 0xFFFF));
+	auto accumulate = [](int *dest, __m128i samples2, __m128i vols) {
+		// 16x16->32 bit multiply of each (sample, sample) pair by (left, right).
+		__m128i lo = _mm_mullo_epi16(samples2, vols);
+		__m128i hi = _mm_mulhi_epi16(samples2, vols);
+		__m128i d0 = _mm_loadu_si128((const __m128i *)dest);
+		__m128i d1 = _mm_loadu_si128((const __m128i *)(dest + 4));
+		d0 = _mm_add_epi32(d0, _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 12));
+		d1 = _mm_add_epi32(d1, _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 12));
+		_mm_storeu_si128((__m128i *)dest, d0);
+		_mm_storeu_si128((__m128i *)(dest + 4), d1);
+	};
+	for (; i + 8 <= count; i += 8) {
+		// The envelope can be 0x8000 which doesn't fit in s16, so split it in two halves and let madd add them up.
+		__m128i env0 = _mm_loadu_si128((const __m128i *)(envelope + i));
+		__m128i env1 = _mm_loadu_si128((const __m128i *)(envelope + i + 4));
+		__m128i envA = _mm_packs_epi32(_mm_srai_epi32(env0, 1), _mm_srai_epi32(env1, 1));
+		__m128i envB = _mm_packs_epi32(_mm_sub_epi32(env0, _mm_srai_epi32(env0, 1)), _mm_sub_epi32(env1, _mm_srai_epi32(env1, 1)));
+		__m128i s = _mm_loadu_si128((const __m128i *)(samples + i));
+		__m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(s, s), _mm_unpacklo_epi16(envA, envB));
+		__m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(s, s), _mm_unpackhi_epi16(envA, envB));
+		lo = _mm_srai_epi32(_mm_add_epi32(lo, rounding), 15);
+		hi = _mm_srai_epi32(_mm_add_epi32(hi, rounding), 15);
+		// Always within s16 range, as the envelope is at most 0x8000.
+		__m128i scaled = _mm_packs_epi32(lo, hi);
+
+		__m128i scaledLo = _mm_unpacklo_epi16(scaled, scaled);
+		__m128i scaledHi = _mm_unpackhi_epi16(scaled, scaled);
+		accumulate(mixBuffer + i * 2, scaledLo, volumes);
+		accumulate(mixBuffer + i * 2 + 8, scaledHi, volumes);
+		accumulate(sendBuffer + i * 2, scaledLo, effects);
+		accumulate(sendBuffer + i * 2 + 8, scaledHi, effects);
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	const int32x4_t rounding = vdupq_n_s32(1 << 14);
+	for (; i + 4 <= count; i += 4) {
+		int32x4_t s = vmulq_s32(vmovl_s16(vld1_s16(samples + i)), vld1q_s32(envelope + i));
+		s = vshrq_n_s32(vaddq_s32(s, rounding), 15);
+
+		int32x4x2_t mix = vzipq_s32(vshrq_n_s32(vmulq_n_s32(s, volumeLeft), 12), vshrq_n_s32(vmulq_n_s32(s, volumeRight), 12));
+		vst1q_s32(mixBuffer + i * 2, vaddq_s32(vld1q_s32(mixBuffer + i * 2), mix.val[0]));
+		vst1q_s32(mixBuffer + i * 2 + 4, vaddq_s32(vld1q_s32(mixBuffer + i * 2 + 4), mix.val[1]));
+		int32x4x2_t send = vzipq_s32(vshrq_n_s32(vmulq_n_s32(s, effectLeft), 12), vshrq_n_s32(vmulq_n_s32(s, effectRight), 12));
+		vst1q_s32(sendBuffer + i * 2, vaddq_s32(vld1q_s32(sendBuffer + i * 2), send.val[0]));
+		vst1q_s32(sendBuffer + i * 2 + 4, vaddq_s32(vld1q_s32(sendBuffer + i * 2 + 4), send.val[1]));
+	}
+#endif
+	for (; i < count; i++) {
+		// We just scale by the envelope before we scale by volumes.
+		// Again, we round up by adding (1 << 14) first (*after* multiplying.)
+		int sample = ((samples[i] * envelope[i]) + (1 << 14)) >> 15;
+
+		// We mix into this 32-bit temp buffer and clip in a second loop
+		// Ideally, the shift right should be there too but for now I'm concerned about
+		// not overflowing.
+		mixBuffer[i * 2] += (sample * volumeLeft) >> 12;
+		mixBuffer[i * 2 + 1] += (sample * volumeRight) >> 12;
+		sendBuffer[i * 2] += sample * effectLeft >> 12;
+		sendBuffer[i * 2 + 1] += sample * effectRight >> 12;
+	}
+}
+
+int SasInstance::DecodeVoice(SasVoice &voice, int16_t *mixTemp, int mixTempSize, int16_t *resampled, int *envelope, int *delayOut, SasReadLog *reads) {
 	switch (voice.type) {
 	case VOICETYPE_VAG:
 		if (voice.type == VOICETYPE_VAG && !voice.vagAddr)
@@ -550,25 +819,24 @@ void SasInstance::MixVoice(SasVoice &voice) {
 
 		// Resample to the correct pitch, writing exactly "grainSize" samples. We need a buffer that can
 		// fit 4x that, as the max pitch is 0x4000.
-		// TODO: Special case no-resample case (and 2x and 0.5x) for speed, it's not uncommon
 
 		// Two passes: First read, then resample.
-		mixTemp_[0] = voice.resampleHist[0];
-		mixTemp_[1] = voice.resampleHist[1];
+		mixTemp[0] = voice.resampleHist[0];
+		mixTemp[1] = voice.resampleHist[1];
 
 		int voicePitch = voice.pitch;
 		u32 sampleFrac = voice.sampleFrac;
 		int samplesToRead = (sampleFrac + voicePitch * std::max(0, grainSize - delay)) >> PSP_SAS_PITCH_BASE_SHIFT;
-		if (samplesToRead > ARRAY_SIZE(mixTemp_) - 2) {
+		if (samplesToRead > mixTempSize - 2) {
 			ERROR_LOG(Log::sceSas, "Too many samples to read (%d)! This shouldn't happen.", samplesToRead);
-			samplesToRead = ARRAY_SIZE(mixTemp_) - 2;
+			samplesToRead = mixTempSize - 2;
 		}
 		int readPos = 2;
 		if (voice.envelope.NeedsKeyOn()) {
 			readPos = 0;
 			samplesToRead += 2;
 		}
-		voice.ReadSamples(&mixTemp_[readPos], samplesToRead);
+		voice.ReadSamples(&mixTemp[readPos], samplesToRead, reads);
 		int tempPos = readPos + samplesToRead;
 
 		for (int i = 0; i < delay; ++i) {
@@ -577,39 +845,19 @@ void SasInstance::MixVoice(SasVoice &voice) {
 			voice.envelope.Step();
 		}
 
-		const bool needsInterp = voicePitch != PSP_SAS_PITCH_BASE || (sampleFrac & PSP_SAS_PITCH_MASK) != 0;
-		for (int i = delay; i < grainSize; i++) {
-			const int16_t *s = mixTemp_ + (sampleFrac >> PSP_SAS_PITCH_BASE_SHIFT);
-
-			// Linear interpolation. Good enough. Need to make resampleHist bigger if we want more.
-			int sample = s[0];
-			if (needsInterp) {
-				int f = sampleFrac & PSP_SAS_PITCH_MASK;
-				sample = (s[0] * (PSP_SAS_PITCH_MASK - f) + s[1] * f) >> PSP_SAS_PITCH_BASE_SHIFT;
-			}
-			sampleFrac += voicePitch;
+		// Then resample and walk the envelope, each pass over the whole grain. Scaling and accumulating is left to the caller.
+		const int count = std::max(0, grainSize - delay);
+		sampleFrac = SasResample(resampled, mixTemp, sampleFrac, voicePitch, count);
 
+		for (int i = 0; i < count; i++) {
 			// The maximum envelope height (PSP_SAS_ENVELOPE_HEIGHT_MAX) is (1 << 30) - 1.
 			// Reduce it to 14 bits, by shifting off 15.  Round up by adding (1 << 14) first.
-			int envelopeValue = voice.envelope.GetHeight();
+			envelope[i] = (voice.envelope.GetHeight() + (1 << 14)) >> 15;
 			voice.envelope.Step();
-			envelopeValue = (envelopeValue + (1 << 14)) >> 15;
-
-			// We just scale by the envelope before we scale by volumes.
-			// Again, we round up by adding (1 << 14) first (*after* multiplying.)
-			sample = ((sample * envelopeValue) + (1 << 14)) >> 15;
-
-			// We mix into this 32-bit temp buffer and clip in a second loop
-			// Ideally, the shift right should be there too but for now I'm concerned about
-			// not overflowing.
-			mixBuffer[i * 2] += (sample * voice.volumeLeft) >> 12;
-			mixBuffer[i * 2 + 1] += (sample * voice.volumeRight) >> 12;
-			sendBuffer[i * 2] += sample * voice.effectLeft >> 12;
-			sendBuffer[i * 2 + 1] += sample * voice.effectRight >> 12;
 		}
 
-		voice.resampleHist[0] = mixTemp_[tempPos - 2];
-		voice.resampleHist[1] = mixTemp_[tempPos - 1];
+		voice.resampleHist[0] = mixTemp[tempPos - 2];
+		voice.resampleHist[1] = mixTemp[tempPos - 1];
 
 		voice.sampleFrac = sampleFrac - (tempPos - 2) * PSP_SAS_PITCH_BASE;
 
@@ -620,15 +868,90 @@ void SasInstance::MixVoice(SasVoice &voice) {
 			voice.playing = false;
 			voice.on = false;
 		}
+
+		*delayOut = delay;
+		return count;
+	}
+	return 0;
+}
+
+void SasInstance::MixVoice(SasVoice &voice) {
+	int delay = 0;
+	int count = DecodeVoice(voice, mixTemp_, (int)ARRAY_SIZE(mixTemp_), resampleTemp_, envelopeTemp_, &delay, nullptr);
+	if (count > 0) {
+		SasMixSamples(mixBuffer + delay * 2, sendBuffer + delay * 2, resampleTemp_, envelopeTemp_, count, voice.volumeLeft, voice.volumeRight, voice.effectLeft, voice.effectRight);
+	}
+}
+
+void SasInstance::MixVoicesParallel(const int *voiceIndices, int numVoices) {
+	// Each voice gets its own read buffer (sized like mixTemp_ for this grain) followed by its resampled output.
+	const int mixTempSize = grainSize * 4 + 2 + 16;
+	const int sampleStride = mixTempSize + grainSize;
+	if ((int)parallelSamples_.size() < numVoices * sampleStride)
+		parallelSamples_.resize(numVoices * sampleStride);
+	if ((int)parallelEnvelope_.size() < numVoices * grainSize)
+		parallelEnvelope_.resize(numVoices * grainSize);
+
+	if ((int)parallelReads_.size() < numVoices)
+		parallelReads_.resize(numVoices);
+
+	int delays[PSP_SAS_VOICES_MAX]{};
+	int counts[PSP_SAS_VOICES_MAX]{};
+	auto decode = [&](int i) {
+		int16_t *mixTemp = &parallelSamples_[i * sampleStride];
+		parallelReads_[i].reads.clear();
+		counts[i] = DecodeVoice(voices[voiceIndices[i]], mixTemp, mixTempSize, mixTemp + mixTempSize, &parallelEnvelope_[i * grainSize], &delays[i], &parallelReads_[i]);
+	};
+
+	// ATRAC3 voices decode through their sceAtrac context, so those stay on this thread.
+	int workerVoices[PSP_SAS_VOICES_MAX];
+	int numWorkerVoices = 0;
+	for (int i = 0; i < numVoices; i++) {
+		if (voices[voiceIndices[i]].type != VOICETYPE_ATRAC3)
+			workerVoices[numWorkerVoices++] = i;
+	}
+
+	WaitableCounter *counter = ParallelRangeLoopWaitable(&g_threadManager, [&](int lower, int upper) {
+		for (int i = lower; i < upper; i++)
+			decode(workerVoices[i]);
+	}, 0, numWorkerVoices, 1, TaskPriority::HIGH);
+	for (int i = 0; i < numVoices; i++) {
+		if (voices[voiceIndices[i]].type == VOICETYPE_ATRAC3)
+			decode(i);
+	}
+	counter->WaitAndRelease();
+
+	// Memchecks may break, so only notify reads from this thread, in the same order as the serial path.
+	for (int i = 0; i < numVoices; i++) {
+		for (const SasReadLog::Read &read : parallelReads_[i].reads)
+			NotifyMemInfo(MemBlockFlags::READ, read.addr, read.size, read.tag);
+	}
+
+	// Always accumulate in voice order, so the result doesn't depend on which thread finished first.
+	for (int i = 0; i < numVoices; i++) {
+		if (counts[i] <= 0)
+			continue;
+		const SasVoice &voice = voices[voiceIndices[i]];
+		const int16_t *resampled = &parallelSamples_[i * sampleStride + mixTempSize];
+		SasMixSamples(mixBuffer + delays[i] * 2, sendBuffer + delays[i] * 2, resampled, &parallelEnvelope_[i * grainSize], counts[i], voice.volumeLeft, voice.volumeRight, voice.effectLeft, voice.effectRight);
 	}
 }
 
 void SasInstance::Mix(u32 outAddr, u32 inAddr, int leftVol, int rightVol, bool mute) {
+	int voiceIndices[PSP_SAS_VOICES_MAX];
+	int numVoices = 0;
 	for (int v = 0; v < PSP_SAS_VOICES_MAX; v++) {
 		SasVoice &voice = voices[v];
 		if (!voice.playing || voice.paused)
 			continue;
-		MixVoice(voice);
+		voiceIndices[numVoices++] = v;
+	}
+
+	if (numVoices >= SAS_PARALLEL_MIN_VOICES && cpu_info.num_cores > 1 && g_threadManager.GetNumLooperThreads() > 1) {
+		MixVoicesParallel(voiceIndices, numVoices);
+	} else {
+		for (int i = 0; i < numVoices; i++)
+			MixVoice(voices[voiceIndices[i]]);
 	}
 
 	// Apply mute if needed (note: we try to keep everything else identical to the non-muted case).
@@ -696,14 +1019,42 @@ void SasInstance::WriteMixedOutput(s16 *outp, const s16 *inp, int leftVol, int r
 	} else {
 		// These are the optimal cases.
 		if (dry && wet) {
-			for (int i = 0; i < grainSize * 2; i += 2) {
-				*outp++ = clamp_s16(mixBuffer[i + 0] + sendBufferProcessed[i + 0]);
-				*outp++ = clamp_s16(mixBuffer[i + 1] + sendBufferProcessed[i + 1]);
+			int i = 0;
+#if PPSSPP_ARCH(SSE2)
+			for (; i + 8 <= grainSize * 2; i += 8) {
+				__m128i wet16 = _mm_loadu_si128((const __m128i *)(sendBufferProcessed + i));
+				__m128i wetLo = _mm_srai_epi32(_mm_unpacklo_epi16(wet16, wet16), 16);
+				__m128i wetHi = _mm_srai_epi32(_mm_unpackhi_epi16(wet16, wet16), 16);
+				__m128i lo = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(mixBuffer + i)), wetLo);
+				__m128i hi = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(mixBuffer + i + 4)), wetHi);
+				_mm_storeu_si128((__m128i *)(outp + i), _mm_packs_epi32(lo, hi));
+			}
+#elif PPSSPP_ARCH(ARM_NEON)
+			for (; i + 8 <= grainSize * 2; i += 8) {
+				int16x8_t wet16 = vld1q_s16(sendBufferProcessed + i);
+				int32x4_t lo = vaddw_s16(vld1q_s32(mixBuffer + i), vget_low_s16(wet16));
+				int32x4_t hi = vaddw_s16(vld1q_s32(mixBuffer + i + 4), vget_high_s16(wet16));
+				vst1q_s16(outp + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+			}
+#endif
+			for (; i < grainSize * 2; i++) {
+				outp[i] = clamp_s16(mixBuffer[i] + sendBufferProcessed[i]);
 			}
 		} else if (dry) {
-			for (int i = 0; i < grainSize * 2; i += 2) {
-				*outp++ = clamp_s16(mixBuffer[i + 0]);
-				*outp++ = clamp_s16(mixBuffer[i + 1]);
+			int i = 0;
+#if PPSSPP_ARCH(SSE2)
+			for (; i + 8 <= grainSize * 2; i += 8) {
+				__m128i lo = _mm_loadu_si128((const __m128i *)(mixBuffer + i));
+				__m128i hi = _mm_loadu_si128((const __m128i *)(mixBuffer + i + 4));
+				_mm_storeu_si128((__m128i *)(outp + i), _mm_packs_epi32(lo, hi));
+			}
+#elif PPSSPP_ARCH(ARM_NEON)
+			for (; i + 8 <= grainSize * 2; i += 8) {
+				vst1q_s16(outp + i, vcombine_s16(vqmovn_s32(vld1q_s32(mixBuffer + i)), vqmovn_s32(vld1q_s32(mixBuffer + i + 4))));
+			}
+#endif
+			for (; i < grainSize * 2; i++) {
+				outp[i] = clamp_s16(mixBuffer[i]);
 			}
 		} else {
 			// This is another uncommon case, dry must be off but let's keep it for clarity.
@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "Common/CommonTypes.h"
 #include "Core/HW/BufferQueue.h"
 #include "Core/HW/SasReverb.h"
@@ -98,6 +100,17 @@ enum VoiceType {
 	VOICETYPE_ATRAC3,
 };
 
+// Guest memory read while decoding a voice on a worker thread. Reported on the calling thread afterwards,
+// since memchecks can break into the debugger.
+struct SasReadLog {
+	struct Read {
+		u32 addr;
+		u32 size;
+		const char *tag;
+	};
+	std::vector<Read> reads;
+};
+
 // VAG is a Sony ADPCM audio compression format, which goes all the way back to the PSX.
 // It compresses 28 16-bit samples into a block of 16 bytes.
 class VagDecoder {
@@ -107,9 +120,11 @@ class VagDecoder {
 	}
 	void Start(u32 dataPtr, u32 vagSize, bool loopEnabled);
 
-	void GetSamples(s16 *outSamples, int numSamples);
+	// If reads is set, the memory read is recorded there instead of notified.
+	void GetSamples(s16 *outSamples, int numSamples, SasReadLog *reads = nullptr);
 
-	void DecodeBlock(const u8 *&readp);
+	// Decodes the next 16 byte block into 28 samples at outSamples, or sets End().
+	void DecodeBlock(const u8 *&readp, s16 *outSamples);
 	bool End() const { return end_; }
 
 	void DoState(PointerWrap &p);
@@ -247,7 +262,7 @@ struct SasVoice {
 
 	void DoState(PointerWrap &p);
 
-	void ReadSamples(s16 *output, int numSamples);
+	void ReadSamples(s16 *output, int numSamples, SasReadLog *reads = nullptr);
 	bool HaveSamplesEnded() const;
 
 	// For debugging.
@@ -317,6 +332,8 @@ class SasInstance {
 
 	void Mix(u32 outAddr, u32 inAddr, int leftVol, int rightVol, bool mute);
 	void MixVoice(SasVoice &voice);
+	// Decodes and resamples the voices on worker threads, then accumulates them in order.
+	void MixVoicesParallel(const int *voiceIndices, int numVoices);
 
 	// Applies reverb to send buffer, according to waveformEffect.
 	void ApplyWaveformEffect();
@@ -334,6 +351,23 @@ class SasInstance {
 	SasReverb reverb_;
 	int grainSize = 0;
 	int16_t mixTemp_[PSP_SAS_MAX_GRAIN * 4 + 2 + 16];  // some extra margin for very high pitches.
+	int16_t resampleTemp_[PSP_SAS_MAX_GRAIN];
+	int envelopeTemp_[PSP_SAS_MAX_GRAIN];
+	// Per voice buffers for MixVoicesParallel.
+	std::vector<int16_t> parallelSamples_;
+	std::vector<int> parallelEnvelope_;
+	std::vector<SasReadLog> parallelReads_;
+
+	// Reads, resamples and walks the envelope of one voice. Only touches the voice and the buffers passed in,
+	// so different voices can be decoded on different threads. Returns how many samples to mix, from *delay on.
+	// Memory reads go to reads if set, for the caller to notify.
+	int DecodeVoice(SasVoice &voice, int16_t *mixTemp, int mixTempSize, int16_t *resampled, int *envelope, int *delay, SasReadLog *reads);
 };
 
+// Resamples count samples from src to out, starting at sampleFrac (in 1/4096ths of a sample) and stepping by pitch.
+// Uses linear interpolation except at unity pitch with no fraction, like the PSP. Returns the new sampleFrac.
+u32 SasResample(s16 *out, const s16 *src, u32 sampleFrac, int pitch, int count);
+// Scales samples by the envelope (already reduced to 15 bits) and adds them to the stereo dry and send buffers.
+void SasMixSamples(int *mixBuffer, int *sendBuffer, const s16 *samples, const int *envelope, int count, int volumeLeft, int volumeRight, int effectLeft, int effectRight);
+
 const char *ADSRCurveModeAsString(SasADSRCurveMode mode);
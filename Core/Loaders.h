@@ -93,6 +93,26 @@ class FileLoader {
 		return ReadAt(absolutePos, 1, bytes, data, flags);
 	}
 
+	struct ReadRequest {
+		s64 absolutePos;
+		size_t bytes;
+		void *data;
+		size_t result;  // Bytes read, filled in by ReadAtBatch.
+	};
+
+	// Reads several independent ranges. Backends may service them concurrently and in any order.
+	virtual void ReadAtBatch(ReadRequest *requests, size_t count, Flags flags = Flags::NONE) {
+		for (size_t i = 0; i < count; ++i) {
+			requests[i].result = ReadAt(requests[i].absolutePos, requests[i].bytes, requests[i].data, flags);
+		}
+	}
+
+	// Maps the whole file read-only, if the backend can. The mapping lives as long as the loader.
+	// Returns nullptr if not possible, then ReadAt has to be used.
+	virtual const u8 *MapReadOnly() {
+		return nullptr;
+	}
+
 	// Cancel any operations that might block, if possible.
 	virtual void Cancel() {}
 
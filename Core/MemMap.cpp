@@ -37,6 +37,7 @@
 #include "Core/HLE/ReplaceTables.h"
 #include "Core/MemMap.h"
 #include "Core/MemFault.h"
+#include "Core/MemWriteTracker.h"
 #include "Core/MIPS/MIPS.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Common/Thread/ParallelLoop.h"
@@ -309,6 +310,7 @@ bool Init() {
 		base, m_pPhysicalRAM, m_pUncachedRAM);
 
 	MemFault_Init();
+	WriteTracker_Reset();
 	return true;
 }
 
@@ -384,6 +386,10 @@ void DoState(PointerWrap &p) {
 
 	DoMemoryVoid(p, PSP_GetKernelMemoryBase(), g_MemorySize);
 	p.DoMarker("RAM");
+	if (p.mode == PointerWrap::MODE_READ) {
+		// All of RAM was just replaced behind the back of any write tracking.
+		WriteTracker_Reset();
+	}
 
 	DoMemoryVoid(p, PSP_GetVidMemBase(), VRAM_SIZE);
 	p.DoMarker("VRAM");
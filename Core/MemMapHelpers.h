@@ -23,6 +23,7 @@
 #include "Common/StringUtils.h"
 #include "Core/Debugger/MemBlockInfo.h"
 #include "Core/MemMap.h"
+#include "Core/MemWriteTracker.h"
 #include "Core/MIPS/MIPS.h"
 
 // To avoid pulling in the entire HLE.h.
@@ -67,6 +68,9 @@ inline void Memcpy(const u32 to_address, const u32 from_address, const u32 len,
 		return;
 
 	memcpy(to, from, len);
+	// The notifications below are skipped for small copies, but we always want to track writes.
+	if (WriteTracker_Enabled())
+		WriteTracker_Notify(to_address, len);
 
 	if (MemBlockInfoDetailed(len)) {
 		if (!tag) {
@@ -0,0 +1,91 @@
+// Copyright (c) 2025- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <atomic>
+
+#include "Core/MemWriteTracker.h"
+
+namespace Memory {
+
+// We track the main RAM area only, including the extra memory of the remasters.
+// VRAM is written by rendering as well, which we don't see here, so it's always considered dirty.
+static constexpr uint32_t TRACKED_BASE = 0x08000000;
+static constexpr uint32_t TRACKED_SIZE = 0x04000000;
+static constexpr uint32_t TRACKED_PAGES = TRACKED_SIZE >> WRITE_TRACKER_PAGE_SHIFT;
+
+std::atomic<bool> g_writeTrackerEnabled;
+
+static std::atomic<uint32_t> writeSeq;
+static std::atomic<uint32_t> pageSeq[TRACKED_PAGES];
+
+static inline uint32_t NormalizeAddress(uint32_t addr) {
+	// Clear the uncached and kernel bits.
+	return addr & 0x3FFFFFFF;
+}
+
+void WriteTracker_SetEnabled(bool enabled) {
+	if (enabled && !WriteTracker_Enabled()) {
+		WriteTracker_Reset();
+	}
+	g_writeTrackerEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void WriteTracker_Reset() {
+	uint32_t seq = writeSeq.fetch_add(1, std::memory_order_relaxed) + 1;
+	for (uint32_t i = 0; i < TRACKED_PAGES; ++i) {
+		pageSeq[i].store(seq, std::memory_order_relaxed);
+	}
+}
+
+void WriteTracker_Notify(uint32_t start, uint32_t size) {
+	if (size == 0 || !WriteTracker_Enabled())
+		return;
+	start = NormalizeAddress(start);
+	if (start + size <= TRACKED_BASE || start >= TRACKED_BASE + TRACKED_SIZE)
+		return;
+
+	uint32_t first = start < TRACKED_BASE ? 0 : (start - TRACKED_BASE) >> WRITE_TRACKER_PAGE_SHIFT;
+	uint32_t end = std::min(start + size - TRACKED_BASE, TRACKED_SIZE);
+	uint32_t last = (end - 1) >> WRITE_TRACKER_PAGE_SHIFT;
+
+	uint32_t seq = writeSeq.fetch_add(1, std::memory_order_relaxed) + 1;
+	for (uint32_t i = first; i <= last; ++i) {
+		pageSeq[i].store(seq, std::memory_order_relaxed);
+	}
+}
+
+uint32_t WriteTracker_CurrentSeq() {
+	return writeSeq.load(std::memory_order_relaxed);
+}
+
+bool WriteTracker_WrittenSince(uint32_t start, uint32_t size, uint32_t seq) {
+	start = NormalizeAddress(start);
+	if (start < TRACKED_BASE || size == 0 || start - TRACKED_BASE + size > TRACKED_SIZE)
+		return true;
+
+	uint32_t first = (start - TRACKED_BASE) >> WRITE_TRACKER_PAGE_SHIFT;
+	uint32_t last = (start - TRACKED_BASE + size - 1) >> WRITE_TRACKER_PAGE_SHIFT;
+	for (uint32_t i = first; i <= last; ++i) {
+		// Using a difference handles the (unlikely) wraparound of the sequence counter.
+		if ((int32_t)(pageSeq[i].load(std::memory_order_relaxed) - seq) > 0)
+			return true;
+	}
+	return false;
+}
+
+}  // namespace Memory
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Page-granular tracking of writes to PSP RAM that go through the emulator's own notification
+// paths: Memcpy/Memset, HLE and DMA writes (NotifyMemInfo), GE block transfers and cache invalidations.
+// Each write bumps a global sequence number and stamps the touched pages with it, so consumers
+// like the texture cache can cheaply ask "has anything in this range been written since I looked?"
+//
+// NOTE: Plain CPU stores from the interpreter/JIT are NOT tracked, so a "not written" answer is only
+// a strong hint. Only use it where that's acceptable (like the optional lazy texture hash skipping.)
+
+namespace Memory {
+
+// Page size is 4KB, which keeps the table small while matching typical texture granularity.
+static constexpr uint32_t WRITE_TRACKER_PAGE_SHIFT = 12;
+
+// Off unless something uses the answers, so that writes don't pay for the tracking.
+extern std::atomic<bool> g_writeTrackerEnabled;
+
+inline bool WriteTracker_Enabled() {
+	return g_writeTrackerEnabled.load(std::memory_order_relaxed);
+}
+// Turning it on marks all of memory as written, since nothing was tracked while it was off.
+void WriteTracker_SetEnabled(bool enabled);
+
+// Marks all of memory as written. Used on init and when loading save states.
+void WriteTracker_Reset();
+// Callers on hot paths should check WriteTracker_Enabled() first.
+void WriteTracker_Notify(uint32_t start, uint32_t size);
+
+// Sequence number to store alongside cached data, to later pass to WriteTracker_WrittenSince().
+uint32_t WriteTracker_CurrentSeq();
+// Returns true if any page in the range was written after seq, or if the range isn't tracked (VRAM etc.)
+bool WriteTracker_WrittenSince(uint32_t start, uint32_t size, uint32_t seq);
+
+}  // namespace Memory
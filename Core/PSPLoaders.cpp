@@ -61,11 +61,15 @@ static void UseLargeMem(int memsize) {
 }
 
 bool MountGameISO(FileLoader *fileLoader, std::string *errorString) {
+	return MountGameISO(&pspFileSystem, fileLoader, errorString);
+}
+
+bool MountGameISO(MetaFileSystem *target, FileLoader *fileLoader, std::string *errorString) {
 	std::shared_ptr<IFileSystem> fileSystem;
 	std::shared_ptr<IFileSystem> blockSystem;
 
 	if (fileLoader->IsDirectory()) {
-		fileSystem = std::make_shared<VirtualDiscFileSystem>(&pspFileSystem, fileLoader->GetPath());
+		fileSystem = std::make_shared<VirtualDiscFileSystem>(target, fileLoader->GetPath());
 		blockSystem = fileSystem;
 	} else {
 		auto bd = ConstructBlockDevice(fileLoader, errorString);
@@ -74,15 +78,17 @@ bool MountGameISO(FileLoader *fileLoader, std::string *errorString) {
 			return false;
 		}
 
-		auto iso = std::make_shared<ISOFileSystem>(&pspFileSystem, bd);
+		auto iso = std::make_shared<ISOFileSystem>(target, bd);
+		if (g_Config.bScanIsoDirectoriesOnMount)
+			iso->ScanAllDirectories();
 		fileSystem = iso;
 		blockSystem = std::make_shared<ISOBlockSystem>(iso);
 	}
 
-	pspFileSystem.Mount("umd0:", blockSystem);
-	pspFileSystem.Mount("umd1:", blockSystem);
-	pspFileSystem.Mount("umd:", blockSystem);
-	pspFileSystem.Mount("disc0:", fileSystem);
+	target->Mount("umd0:", blockSystem);
+	target->Mount("umd1:", blockSystem);
+	target->Mount("umd:", blockSystem);
+	target->Mount("disc0:", fileSystem);
 	return true;
 }
 
@@ -34,6 +34,7 @@
 #include "Core/Util/RecentFiles.h"
 #include "Core/Config.h"
 #include "Core/Debugger/WebSocket.h"
+#include "Core/HLE/proAdhocServer.h"
 #include "Core/WebServer.h"
 
 enum class ServerStatus {
@@ -347,6 +348,20 @@ static void RedirectToDebugger(const http::ServerRequest &request) {
 	request.Out()->Push(payload);
 }
 
+// Status of the built-in adhoc server, same contents as its status.xml.
+static void HandleAdhocServerStatus(const http::ServerRequest &request) {
+	std::string json = GetAdhocServerStatusJson();
+	if (json.empty()) {
+		static const std::string payload = "Adhoc server not running\r\n";
+		request.WriteHttpResponseHeader("1.0", 404, payload.size(), "text/plain");
+		request.Out()->Push(payload);
+		return;
+	}
+
+	request.WriteHttpResponseHeader("1.0", 200, json.size(), "application/json");
+	request.Out()->Push(json);
+}
+
 static void HandleFallback(const http::ServerRequest &request) {
 	SetCurrentThreadName("HandleFallback");
 
@@ -418,6 +433,7 @@ static void ExecuteWebServer() {
 	// This lists all the (current) recent ISOs. It also handles the debugger, which is very ugly.
 	http->SetFallbackHandler(&HandleFallback);
 	http->RegisterHandler("/debugger", &ForwardDebuggerRequest);
+	http->RegisterHandler("/adhoc/status.json", &HandleAdhocServerStatus);
 
 	if (!http->Listen(g_Config.iRemoteISOPort, "debugger-webserver")) {
 		if (!http->Listen(0, "debugger-webserver")) {
@@ -22,6 +22,7 @@
 #include "Common/GPU/thin3d.h"
 #include "Common/Data/Collections/TinySet.h"
 #include "Common/Data/Convert/ColorConv.h"
+#include "Common/Data/Hash/WideHash.h"
 #include "Common/LogReporting.h"
 #include "Common/System/Display.h"
 #include "Common/VR/PPSSPPVR.h"
@@ -1346,7 +1347,7 @@ Draw::Texture *FramebufferManagerCommon::MakePixelTexture(const u8 *srcPixels, G
 	// Compute hash of contents.
 	uint64_t imageHash;
 	if (widthInBytes == srcStrideInBytes) {
-		imageHash = XXH3_64bits(srcPixels, widthInBytes * height);
+		imageHash = hash::WideHash64(srcPixels, widthInBytes * height);
 	} else {
 		XXH3_state_t *hashState = XXH3_createState();
 		XXH3_64bits_reset(hashState);
@@ -465,14 +465,19 @@ ReplacedTexture::LoadLevelResult ReplacedTexture::LoadLevelData(VFSFileReference
 	level.fileRef = fileRef;
 
 	if (imageType == ReplacedImageType::KTX2) {
-		// Just slurp the whole file in one go and feed to the decoder.
+		// Just slurp the whole file in one go and feed to the decoder, unless it's already mapped.
 		std::vector<uint8_t> buffer;
-		buffer.resize(fileSize);
-		buffer.resize(vfs_->Read(openFile, &buffer[0], buffer.size()));
+		const uint8_t *fileData = vfs_->GetMappedData(openFile);
+		if (!fileData) {
+			buffer.resize(fileSize);
+			buffer.resize(vfs_->Read(openFile, &buffer[0], buffer.size()));
+			fileData = buffer.data();
+			fileSize = buffer.size();
+		}
 		vfs_->CloseFile(openFile);
 
 		basist::ktx2_transcoder transcoder;
-		if (!transcoder.init(buffer.data(), (int)buffer.size())) {
+		if (!transcoder.init(fileData, (int)fileSize)) {
 			WARN_LOG(Log::TexReplacement, "Error reading KTX file");
 			return LoadLevelResult::LOAD_ERROR;
 		}
@@ -605,17 +610,22 @@ ReplacedTexture::LoadLevelResult ReplacedTexture::LoadLevelData(VFSFileReference
 
 	} else if (imageType == ReplacedImageType::ZIM) {
 
-		auto zim = std::make_unique<uint8_t[]>(fileSize);
-		if (!zim) {
-			ERROR_LOG(Log::TexReplacement, "Failed to allocate memory for texture replacement");
-			vfs_->CloseFile(openFile);
-			return LoadLevelResult::LOAD_ERROR;
-		}
+		std::unique_ptr<uint8_t[]> zim;
+		const uint8_t *zimData = vfs_->GetMappedData(openFile);
+		if (!zimData) {
+			zim = std::make_unique<uint8_t[]>(fileSize);
+			if (!zim) {
+				ERROR_LOG(Log::TexReplacement, "Failed to allocate memory for texture replacement");
+				vfs_->CloseFile(openFile);
+				return LoadLevelResult::LOAD_ERROR;
+			}
 
-		if (vfs_->Read(openFile, &zim[0], fileSize) != fileSize) {
-			ERROR_LOG(Log::TexReplacement, "Could not load texture replacement: %s - failed to read ZIM", filename.c_str());
-			vfs_->CloseFile(openFile);
-			return LoadLevelResult::LOAD_ERROR;
+			if (vfs_->Read(openFile, &zim[0], fileSize) != fileSize) {
+				ERROR_LOG(Log::TexReplacement, "Could not load texture replacement: %s - failed to read ZIM", filename.c_str());
+				vfs_->CloseFile(openFile);
+				return LoadLevelResult::LOAD_ERROR;
+			}
+			zimData = &zim[0];
 		}
 		vfs_->CloseFile(openFile);
 
@@ -623,7 +633,7 @@ ReplacedTexture::LoadLevelResult ReplacedTexture::LoadLevelData(VFSFileReference
 		uint8_t *image;
 		std::vector<uint8_t> &out = data_[mipLevel];
 		// TODO: Zim files can actually hold mipmaps (although no tool has ever been made to create them :P)
-		if (LoadZIMPtr(&zim[0], fileSize, &w, &h, &f, &image)) {
+		if (LoadZIMPtr(zimData, fileSize, &w, &h, &f, &image)) {
 			if (w > level.w || h > level.h) {
 				ERROR_LOG(Log::TexReplacement, "Texture replacement changed since header read: %s", filename.c_str());
 				return LoadLevelResult::LOAD_ERROR;
@@ -654,11 +664,17 @@ ReplacedTexture::LoadLevelResult ReplacedTexture::LoadLevelData(VFSFileReference
 		png_image png = {};
 		png.version = PNG_IMAGE_VERSION;
 
+		// Decode straight from the file if it's mapped (see PackFileReader), otherwise read it in first.
 		std::string pngdata;
-		pngdata.resize(fileSize);
-		pngdata.resize(vfs_->Read(openFile, &pngdata[0], fileSize));
+		const uint8_t *pngPtr = vfs_->GetMappedData(openFile);
+		if (!pngPtr) {
+			pngdata.resize(fileSize);
+			pngdata.resize(vfs_->Read(openFile, &pngdata[0], fileSize));
+			pngPtr = (const uint8_t *)pngdata.data();
+			fileSize = pngdata.size();
+		}
 		vfs_->CloseFile(openFile);
-		if (!png_image_begin_read_from_memory(&png, &pngdata[0], pngdata.size())) {
+		if (!png_image_begin_read_from_memory(&png, pngPtr, fileSize)) {
 			ERROR_LOG(Log::TexReplacement, "Could not load texture replacement info: %s - %s (zip)", filename.c_str(), png.message);
 			return LoadLevelResult::LOAD_ERROR;
 		}
@@ -38,6 +38,7 @@ enum class ReplacedTextureHash {
 	QUICK,
 	XXH32,
 	XXH64,
+	XXH3,
 };
 
 enum class ReplacedImageType {
@@ -33,6 +33,7 @@
 #include "Core/HDRemaster.h"
 #include "Core/Config.h"
 #include "Core/Debugger/MemBlockInfo.h"
+#include "Core/MemWriteTracker.h"
 #include "Core/System.h"
 #include "Core/HW/Display.h"
 #include "GPU/Common/FramebufferManagerCommon.h"
@@ -63,6 +64,12 @@
 #define TEXCACHE_MIN_PRESSURE 16 * 1024 * 1024  // Total in VRAM
 #define TEXCACHE_SECOND_MIN_PRESSURE 4 * 1024 * 1024
 
+// Used when iTextureCacheBudgetMB is 0. Both caches together.
+#define TEXCACHE_DEFAULT_BUDGET 512 * 1024 * 1024
+#define TEXCACHE_DEFAULT_BUDGET_LOWMEM 128 * 1024 * 1024
+// Textures used this recently are never evicted for the budget, to avoid thrashing within a frame.
+#define TEXCACHE_BUDGET_MIN_AGE 2
+
 // Just for reference
 
 // PSP Color formats:
@@ -120,6 +127,8 @@ TextureCacheCommon::~TextureCacheCommon() {
 
 void TextureCacheCommon::StartFrame() {
 	ForgetLastTexture();
+	// Only the texture cache uses the write tracker.
+	Memory::WriteTracker_SetEnabled(g_Config.bTextureWriteTracking);
 	textureShaderCache_->Decimate();
 	timesInvalidatedAllThisFrame_ = 0;
 	replacementTimeThisFrame_ = 0.0;
@@ -152,6 +161,11 @@ void TextureCacheCommon::StartFrame() {
 	if ((DebugOverlay)g_Config.iDebugOverlay == DebugOverlay::DEBUG_STATS) {
 		gpuStats.numReplacerTrackedTex = replacer_.GetNumTrackedTextures();
 		gpuStats.numCachedReplacedTextures = replacer_.GetNumCachedReplacedTextures();
+		TextureScalerStats scalerStats = scaler_.GetStats();
+		gpuStats.numScaledTexturesCached = scalerStats.cachedTextures;
+		gpuStats.numScaledTextureCacheKB = (int)(scalerStats.cachedBytes / 1024);
+		gpuStats.numScaledTexturesPending = scalerStats.pending;
+		gpuStats.numScaledTextureCacheHits = scalerStats.cacheHits;
 	}
 
 	if (texelsScaledThisFrame_) {
@@ -165,6 +179,12 @@ void TextureCacheCommon::StartFrame() {
 	} else {
 		Decimate(nullptr, false);
 	}
+
+	// Cheap, so always kept up to date (the debugger reads these too.)
+	gpuStats.numTexturesCached = (int)(cache_.size() + secondCache_.size());
+	gpuStats.textureCacheKB = (int)(((u64)cacheSizeEstimate_ + secondCacheSizeEstimate_) / 1024);
+	gpuStats.textureCacheBudgetKB = (int)(CacheBudget() / 1024);
+	gpuStats.numTextureCacheEvictions = texturesEvicted_;
 }
 
 // Produces a signed 1.23.8 value.
@@ -524,7 +544,13 @@ TexCacheEntry *TextureCacheCommon::SetTexture() {
 					} else {
 						entry->framesUntilNextFullHash = entry->numFrames;
 					}
-					rehash = true;
+					// If nothing we know of has written to the texture since we last hashed it, we can skip
+					// the periodic check. CPU stores aren't tracked, which is why this is optional.
+					if (g_Config.bTextureWriteTracking && entry->GetHashStatus() == TexCacheEntry::STATUS_HASHING && !Memory::WriteTracker_WrittenSince(entry->addr, entry->SizeInRAM(), entry->hashWriteSeq)) {
+						gpuStats.numTextureHashesSkipped++;
+					} else {
+						rehash = true;
+					}
 				} else {
 					entry->framesUntilNextFullHash -= diff;
 				}
@@ -544,8 +570,16 @@ TexCacheEntry *TextureCacheCommon::SetTexture() {
 			}
 		}
 
-		if (match && (entry->status & TexCacheEntry::STATUS_TO_SCALE) && standardScaleFactor_ != 1 && texelsScaledThisFrame_ < TEXCACHE_MAX_TEXELS_SCALED) {
-			if ((entry->status & TexCacheEntry::STATUS_CHANGE_FREQUENT) == 0) {
+		if (match && (entry->status & TexCacheEntry::STATUS_TO_SCALE) && standardScaleFactor_ != 1 && (entry->status & TexCacheEntry::STATUS_CHANGE_FREQUENT) == 0) {
+			if (UseAsyncScaling()) {
+				// Wait for the background scaler, then reload to pick the result up from its cache.
+				// Without a result, the reload scales here, so that has to fit in this frame's budget.
+				const ScaledTextureKey key = ScaledKeyFor(*entry, standardScaleFactor_);
+				if (!scaler_.IsPending(key) && (scaler_.IsCached(key) || texelsScaledThisFrame_ < TEXCACHE_MAX_TEXELS_SCALED)) {
+					match = false;
+					reason = "scaling";
+				}
+			} else if (texelsScaledThisFrame_ < TEXCACHE_MAX_TEXELS_SCALED) {
 				// INFO_LOG(Log::G3D, "Reloading texture to do the scaling we skipped..");
 				match = false;
 				reason = "scaling";
@@ -846,7 +880,7 @@ void TextureCacheCommon::Decimate(TexCacheEntry *exceptThisOne, bool forcePressu
 			// In low memory mode, we kill them all since secondary cache is disabled.
 			if (lowMemoryMode_ || iter->second->lastFrame + TEXTURE_SECOND_KILL_AGE < gpuStats.numFlips) {
 				ReleaseTexture(iter->second.get(), true);
-				secondCacheSizeEstimate_ -= EstimateTexMemoryUsage(iter->second.get());
+				secondCacheSizeEstimate_ -= iter->second->sizeInBytes;
 				iter = secondCache_.erase(iter);
 			} else {
 				++iter;
@@ -856,10 +890,78 @@ void TextureCacheCommon::Decimate(TexCacheEntry *exceptThisOne, bool forcePressu
 		VERBOSE_LOG(Log::G3D, "Decimated second texture cache, saved %d estimated bytes - now %d bytes", had - secondCacheSizeEstimate_, secondCacheSizeEstimate_);
 	}
 
+	DecimateToBudget(exceptThisOne);
+
 	DecimateVideos();
 	replacer_.Decimate(forcePressure ? ReplacerDecimateMode::FORCE_PRESSURE : ReplacerDecimateMode::NEW_FRAME);
 }
 
+size_t TextureCacheCommon::CacheBudget() const {
+	if (g_Config.iTextureCacheBudgetMB > 0) {
+		return (size_t)g_Config.iTextureCacheBudgetMB * 1024 * 1024;
+	}
+	return lowMemoryMode_ ? TEXCACHE_DEFAULT_BUDGET_LOWMEM : TEXCACHE_DEFAULT_BUDGET;
+}
+
+// Evicts the least recently used textures from both caches until we're comfortably under budget.
+void TextureCacheCommon::DecimateToBudget(TexCacheEntry *exceptThisOne) {
+	const size_t budget = CacheBudget();
+	const size_t had = (size_t)cacheSizeEstimate_ + secondCacheSizeEstimate_;
+	if (had <= budget) {
+		return;
+	}
+
+	struct Candidate {
+		int lastFrame;
+		bool second;
+		u64 key;
+	};
+	std::vector<Candidate> candidates;
+	candidates.reserve(cache_.size() + secondCache_.size());
+	auto addCandidates = [&](const TexCache &cache, bool second) {
+		for (const auto &iter : cache) {
+			const TexCacheEntry *entry = iter.second.get();
+			if (entry != exceptThisOne && entry->lastFrame + TEXCACHE_BUDGET_MIN_AGE <= gpuStats.numFlips) {
+				candidates.push_back(Candidate{ entry->lastFrame, second, iter.first });
+			}
+		}
+	};
+	addCandidates(cache_, false);
+	addCandidates(secondCache_, true);
+	// Oldest first. Prefer the secondary cache when tied, it's only there speculatively.
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+		if (a.lastFrame != b.lastFrame)
+			return a.lastFrame < b.lastFrame;
+		return a.second > b.second;
+	});
+
+	// Go a bit further than the budget, so we don't end up doing this every time.
+	const size_t target = budget - budget / 8;
+	int evicted = 0;
+	for (const Candidate &candidate : candidates) {
+		if ((size_t)cacheSizeEstimate_ + secondCacheSizeEstimate_ <= target) {
+			break;
+		}
+		if (candidate.second) {
+			auto iter = secondCache_.find(candidate.key);
+			ReleaseTexture(iter->second.get(), true);
+			secondCacheSizeEstimate_ -= iter->second->sizeInBytes;
+			secondCache_.erase(iter);
+		} else {
+			DeleteTexture(cache_.find(candidate.key));
+		}
+		evicted++;
+	}
+	if (evicted == 0) {
+		return;
+	}
+	// Only forget the bound texture if we actually released something, it might have been it.
+	ForgetLastTexture();
+	texturesEvicted_ += evicted;
+
+	DEBUG_LOG(Log::G3D, "Texture cache over budget (%d kB of %d kB), evicted %d textures - now %d kB", (int)(had / 1024), (int)(budget / 1024), evicted, (int)(((size_t)cacheSizeEstimate_ + secondCacheSizeEstimate_) / 1024));
+}
+
 void TextureCacheCommon::DecimateVideos() {
 	for (auto iter = videos_.begin(); iter != videos_.end(); ) {
 		if (iter->flips + VIDEO_DECIMATE_AGE < gpuStats.numFlips) {
@@ -884,7 +986,8 @@ bool TextureCacheCommon::IsVideo(u32 texaddr) const {
 }
 
 void TextureCacheCommon::HandleTextureChange(TexCacheEntry *const entry, const char *reason, bool initialMatch, bool doDelete) {
-	cacheSizeEstimate_ -= EstimateTexMemoryUsage(entry);
+	cacheSizeEstimate_ -= entry->sizeInBytes;
+	entry->sizeInBytes = 0;
 	entry->numInvalidated++;
 	gpuStats.numTextureInvalidations++;
 	DEBUG_LOG(Log::G3D, "Texture different or overwritten, reloading at %08x: %s", entry->addr, reason);
@@ -893,6 +996,9 @@ void TextureCacheCommon::HandleTextureChange(TexCacheEntry *const entry, const c
 		ReleaseTexture(entry, true);
 		entry->status &= ~(TexCacheEntry::STATUS_IS_SCALED_OR_REPLACED | TexCacheEntry::STATUS_TO_REPLACE);
 	}
+	// A background scale of the old contents no longer matters. It's keyed by the old hash, so it
+	// can't be picked up by mistake, and the new contents get queued on their own when built.
+	entry->status &= ~TexCacheEntry::STATUS_SCALE_QUEUED;
 
 	// Mark as hashing, if marked as reliable.
 	if (entry->GetHashStatus() == TexCacheEntry::STATUS_RELIABLE) {
@@ -1528,15 +1634,9 @@ bool TextureCacheCommon::GetCurrentClutBuffer(GPUDebugBuffer &buffer) {
 	return true;
 }
 
-// Host memory usage, not PSP memory usage.
-u32 TextureCacheCommon::EstimateTexMemoryUsage(const TexCacheEntry *entry) {
-	const u16 dim = entry->dim;
-	// TODO: This does not take into account the HD remaster's larger textures.
-	const u8 dimW = ((dim >> 0) & 0xf);
-	const u8 dimH = ((dim >> 8) & 0xf);
-
+static u32 EstimatePixelSize(u8 format) {
 	u32 pixelSize = 2;
-	switch (entry->format) {
+	switch (format) {
 	case GE_TFMT_CLUT4:
 	case GE_TFMT_CLUT8:
 	case GE_TFMT_CLUT16:
@@ -1557,9 +1657,37 @@ u32 TextureCacheCommon::EstimateTexMemoryUsage(const TexCacheEntry *entry) {
 		pixelSize = 4;
 		break;
 	}
+	return pixelSize;
+}
+
+// Host memory usage, not PSP memory usage.
+u32 TextureCacheCommon::EstimateTexMemoryUsage(const TexCacheEntry *entry) {
+	const u16 dim = entry->dim;
+	const u8 dimW = ((dim >> 0) & 0xf);
+	const u8 dimH = ((dim >> 8) & 0xf);
 
 	// This in other words multiplies by w and h.
-	return pixelSize << (dimW + dimH);
+	return EstimatePixelSize(entry->format) << (dimW + dimH);
+}
+
+// Same, but for the texture the plan will actually create, which can be much larger than the PSP one.
+u32 TextureCacheCommon::EstimateBuiltTexMemoryUsage(const TexCacheEntry *entry, const BuildTexturePlan &plan) {
+	u32 pixelSize;
+	if (plan.decodeToClut8) {
+		pixelSize = 1;
+	} else if (plan.doReplace || plan.scaleFactor > 1) {
+		// Scaled and replaced textures are always 8888 (or compressed, but let's be conservative.)
+		pixelSize = 4;
+	} else {
+		pixelSize = EstimatePixelSize(entry->format);
+	}
+
+	u64 bytes = (u64)plan.createW * plan.createH * plan.depth * pixelSize;
+	if (plan.levelsToCreate > 1) {
+		// A full mip chain adds a third.
+		bytes += bytes / 3;
+	}
+	return (u32)std::min(bytes, (u64)0x7FFFFFFF);
 }
 
 ReplacedTexture *TextureCacheCommon::FindReplacement(TexCacheEntry *entry, int *w, int *h, int *d) {
@@ -2149,6 +2277,7 @@ void TextureCacheCommon::ApplyTexture(bool doBind) {
 			int w = gstate.getTextureWidth(0);
 			int h = gstate.getTextureHeight(0);
 			bool swizzled = gstate.isTextureSwizzled();
+			entry->hashWriteSeq = Memory::WriteTracker_CurrentSeq();
 			entry->fullhash = QuickTexHash(replacer_, entry->addr, entry->bufw, w, h, swizzled, GETextureFormat(entry->format), entry);
 
 			// TODO: Here we could check the secondary cache; maybe the texture is in there?
@@ -2561,7 +2690,7 @@ void TextureCacheCommon::Clear(bool delete_them) {
 
 void TextureCacheCommon::DeleteTexture(TexCache::iterator it) {
 	ReleaseTexture(it->second.get(), true);
-	cacheSizeEstimate_ -= EstimateTexMemoryUsage(it->second.get());
+	cacheSizeEstimate_ -= it->second->sizeInBytes;
 	cache_.erase(it);
 }
 
@@ -2579,12 +2708,14 @@ bool TextureCacheCommon::CheckFullHash(TexCacheEntry *entry, bool &doDelete) {
 	}
 
 	u32 fullhash;
+	u32 hashWriteSeq = Memory::WriteTracker_CurrentSeq();
 	{
 		PROFILE_THIS_SCOPE("texhash");
 		fullhash = QuickTexHash(replacer_, entry->addr, entry->bufw, w, h, swizzled, GETextureFormat(entry->format), entry);
 	}
 
 	if (fullhash == entry->fullhash) {
+		entry->hashWriteSeq = hashWriteSeq;
 		if (g_Config.bTextureBackoffCache && !isVideo) {
 			if (entry->GetHashStatus() != TexCacheEntry::STATUS_HASHING && entry->numFrames > TexCacheEntry::FRAMES_REGAIN_TRUST) {
 				// Reset to STATUS_HASHING.
@@ -2626,12 +2757,13 @@ bool TextureCacheCommon::CheckFullHash(TexCacheEntry *entry, bool &doDelete) {
 				// It wasn't found, so we're about to throw away the entry and rebuild a texture.
 				// Let's save this in the secondary cache in case it gets used again.
 				secondKey = entry->fullhash | ((u64)entry->cluthash << 32);
-				secondCacheSizeEstimate_ += EstimateTexMemoryUsage(entry);
+				secondCacheSizeEstimate_ += entry->sizeInBytes;
 
 				// If the entry already exists in the secondary texture cache, drop it nicely.
 				auto oldIter = secondCache_.find(secondKey);
 				if (oldIter != secondCache_.end()) {
 					ReleaseTexture(oldIter->second.get(), true);
+					secondCacheSizeEstimate_ -= oldIter->second->sizeInBytes;
 				}
 
 				// Archive the entire texture entry as is, since we'll use its params if it is seen again.
@@ -2647,6 +2779,7 @@ bool TextureCacheCommon::CheckFullHash(TexCacheEntry *entry, bool &doDelete) {
 
 	// We know it failed, so update the full hash right away.
 	entry->fullhash = fullhash;
+	entry->hashWriteSeq = hashWriteSeq;
 	return false;
 }
 
@@ -2660,6 +2793,11 @@ void TextureCacheCommon::Invalidate(u32 addr, int size, GPUInvalidationType type
 	addr &= 0x3FFFFFFF;
 	const u32 addr_end = addr + size;
 
+	if (type != GPU_INVALIDATE_ALL && Memory::WriteTracker_Enabled()) {
+		// This covers GE transfers and dcache writebacks, which may not have gone through Memcpy.
+		Memory::WriteTracker_Notify(addr, size);
+	}
+
 	if (type == GPU_INVALIDATE_ALL) {
 		// This is an active signal from the game that something in the texture cache may have changed.
 		gstate_c.Dirty(DIRTY_TEXTURE_IMAGE);
@@ -2724,6 +2862,12 @@ void TextureCacheCommon::InvalidateAll(GPUInvalidationType /*unused*/) {
 		return;
 	}
 
+	// The game is telling us the CPU wrote memory, and CPU stores are exactly what the tracker can't see.
+	// So everything counts as written, even when the rest is skipped below.
+	if (Memory::WriteTracker_Enabled()) {
+		Memory::WriteTracker_Reset();
+	}
+
 	if (timesInvalidatedAllThisFrame_ > 5) {
 		return;
 	}
@@ -2755,7 +2899,10 @@ bool TextureCacheCommon::PrepareBuildTexture(BuildTexturePlan &plan, TexCacheEnt
 	gpuStats.numTexturesDecoded++;
 
 	// For the estimate, we assume cluts always point to 8888 for simplicity.
-	cacheSizeEstimate_ += EstimateTexMemoryUsage(entry);
+	// This is refined at the end, once we know what we're actually creating.
+	cacheSizeEstimate_ -= entry->sizeInBytes;
+	entry->sizeInBytes = EstimateTexMemoryUsage(entry);
+	cacheSizeEstimate_ += entry->sizeInBytes;
 
 	plan.badMipSizes = false;
 	// maxLevel here is the max level to upload. Not the count.
@@ -2876,7 +3023,11 @@ bool TextureCacheCommon::PrepareBuildTexture(BuildTexturePlan &plan, TexCacheEnt
 	}
 
 	if (plan.scaleFactor != 1) {
-		if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED && plan.slowScaler) {
+		if (plan.slowScaler && UseAsyncScaling()) {
+			// No per-frame budget, the scaling happens in the background. See below.
+			entry->status &= ~TexCacheEntry::STATUS_TO_SCALE;
+			entry->status |= TexCacheEntry::STATUS_IS_SCALED_OR_REPLACED;
+		} else if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED && plan.slowScaler) {
 			entry->status |= TexCacheEntry::STATUS_TO_SCALE;
 			plan.scaleFactor = 1;
 		} else {
@@ -2939,6 +3090,29 @@ bool TextureCacheCommon::PrepareBuildTexture(BuildTexturePlan &plan, TexCacheEnt
 		// But, we still need to create the texture at a larger size.
 		plan.replaced->GetSize(0, &plan.createW, &plan.createH);
 	} else {
+		if (plan.scaleFactor > 1 && plan.slowScaler && UseAsyncScaling() && !scaler_.IsCached(ScaledKeyFor(*entry, plan.scaleFactor))) {
+			if ((entry->status & TexCacheEntry::STATUS_SCALE_QUEUED) || !TextureScalerCommon::FitsInCache(plan.w, plan.h, plan.scaleFactor)) {
+				// The background result didn't stick (too large for the cache, evicted, or dropped
+				// by a settings change), so just scale it here rather than queueing it up forever.
+				// That's on this thread, so it has the same per-frame budget as synchronous scaling.
+				if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED) {
+					entry->status |= TexCacheEntry::STATUS_TO_SCALE;
+					entry->status &= ~TexCacheEntry::STATUS_IS_SCALED_OR_REPLACED;
+					plan.scaleFactor = 1;
+				} else {
+					entry->status &= ~TexCacheEntry::STATUS_SCALE_QUEUED;
+					texelsScaledThisFrame_ += plan.w * plan.h;
+				}
+			} else {
+				// Build it unscaled for now, and queue up the scaling when we decode. SetTexture reloads it when done.
+				entry->status |= TexCacheEntry::STATUS_TO_SCALE | TexCacheEntry::STATUS_SCALE_QUEUED;
+				entry->status &= ~TexCacheEntry::STATUS_IS_SCALED_OR_REPLACED;
+				plan.asyncScaleFactor = plan.scaleFactor;
+				plan.scaleFactor = 1;
+			}
+		} else {
+			entry->status &= ~TexCacheEntry::STATUS_SCALE_QUEUED;
+		}
 		if (replacer_.SaveEnabled() && !plan.doReplace && plan.depth == 1 && canReplace) {
 			ReplacedTextureDecodeInfo replacedInfo;
 			// TODO: Do we handle the race where a replacement becomes valid AFTER this but before we save?
@@ -2985,6 +3159,10 @@ bool TextureCacheCommon::PrepareBuildTexture(BuildTexturePlan &plan, TexCacheEnt
 		entry->status &= ~TexCacheEntry::STATUS_NO_MIPS;
 	}
 
+	cacheSizeEstimate_ -= entry->sizeInBytes;
+	entry->sizeInBytes = EstimateBuiltTexMemoryUsage(entry, plan);
+	cacheSizeEstimate_ += entry->sizeInBytes;
+
 	// Will be filled in again during decode.
 	entry->status &= ~TexCacheEntry::STATUS_ALPHA_MASK;
 	return true;
@@ -3029,10 +3207,14 @@ void TextureCacheCommon::LoadTextureLevel(TexCacheEntry &entry, uint8_t *data, s
 		CheckAlphaResult alphaResult = DecodeTextureLevel((u8 *)pixelData, decPitch, tfmt, clutformat, texaddr, srcLevel, bufw, texDecFlags);
 		entry.SetAlphaStatus(alphaResult, srcLevel);
 
+		if (plan.asyncScaleFactor > 1 && srcLevel == plan.baseLevelSrc) {
+			QueueAsyncScale(entry, srcLevel, plan.asyncScaleFactor, texDecFlags);
+		}
+
 		int scaledW = w, scaledH = h;
 		if (plan.scaleFactor > 1) {
 			// Note that this updates w and h!
-			scaler_.ScaleAlways((u32 *)data, pixelData, w, h, &scaledW, &scaledH, plan.scaleFactor);
+			scaler_.ScaleCached(ScaledKeyFor(entry, plan.scaleFactor), (u32 *)data, pixelData, w, h, &scaledW, &scaledH, plan.scaleFactor);
 			pixelData = (u32 *)data;
 
 			decPitch = scaledW * sizeof(u32);
@@ -3063,6 +3245,33 @@ void TextureCacheCommon::LoadTextureLevel(TexCacheEntry &entry, uint8_t *data, s
 	}
 }
 
+bool TextureCacheCommon::UseAsyncScaling() const {
+	// In low memory mode, we'd rather not keep extra copies of scaled textures around.
+	// Without a cache, there's nowhere for the background results to go.
+	return g_Config.bTexScalingAsync && g_Config.iTexScalingCacheSizeMB > 0 && !lowMemoryMode_;
+}
+
+ScaledTextureKey TextureCacheCommon::ScaledKeyFor(const TexCacheEntry &entry, int factor) {
+	ScaledTextureKey key{};
+	key.hash = (u64)entry.fullhash | ((u64)entry.cluthash << 32);
+	key.dim = entry.dim;
+	key.format = entry.format;
+	key.factor = (u8)factor;
+	return key;
+}
+
+void TextureCacheCommon::QueueAsyncScale(TexCacheEntry &entry, int level, int factor, TexDecodeFlags texDecFlags) {
+	// Decode again, packed and in 8888 like the synchronous scaling path does.
+	int w = gstate.getTextureWidth(level);
+	int h = gstate.getTextureHeight(level);
+	GETextureFormat tfmt = (GETextureFormat)entry.format;
+	u32 texaddr = gstate.getTextureAddress(level);
+	const int bufw = GetTextureBufw(level, texaddr, tfmt);
+	tmpTexBufRearrange_.resize(std::max(bufw, w) * h);
+	DecodeTextureLevel((u8 *)tmpTexBufRearrange_.data(), w * 4, tfmt, gstate.getClutPaletteFormat(), texaddr, level, bufw, texDecFlags | TexDecodeFlags::EXPAND32);
+	scaler_.ScaleAsync(ScaledKeyFor(entry, factor), tmpTexBufRearrange_.data(), w, h, factor);
+}
+
 CheckAlphaResult TextureCacheCommon::CheckCLUTAlpha(const uint8_t *pixelData, GEPaletteFormat clutFormat, int w) {
 	switch (clutFormat) {
 	case GE_CMODE_16BIT_ABGR4444:
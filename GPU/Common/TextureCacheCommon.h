@@ -172,6 +172,8 @@ struct TexCacheEntry {
 
 		STATUS_VIDEO = 0x10000,
 		STATUS_BGRA = 0x20000,
+
+		STATUS_SCALE_QUEUED = 0x40000,  // Was handed to the background scaler, see BuildTexture.
 	};
 
 	// TexStatus enum flag combination.
@@ -198,7 +200,12 @@ struct TexCacheEntry {
 	u32 framesUntilNextFullHash;
 	u32 fullhash;
 	u32 cluthash;
+	// Memory::WriteTracker_CurrentSeq() when fullhash was last computed.
+	u32 hashWriteSeq;
 	u16 maxSeenV;
+	// Host memory used by the texture as built (scaled or replaced size, mips.)
+	// Counted in cacheSizeEstimate_ or secondCacheSizeEstimate_, whichever cache owns the entry.
+	u32 sizeInBytes;
 	ReplacedTexture *replacedTexture;
 
 	TexStatus GetHashStatus() {
@@ -293,6 +300,9 @@ struct BuildTexturePlan {
 	// The scale factor of the final texture.
 	int scaleFactor;
 
+	// If > 1, the texture is built unscaled while it's scaled by this factor in the background.
+	int asyncScaleFactor = 1;
+
 	// Whether it's a video texture or not. Some decisions might depend on this.
 	bool isVideo;
 
@@ -392,6 +402,7 @@ class TextureCacheCommon {
 
 	const size_t CacheSizeEstimate() const { return cacheSizeEstimate_; }
 	const size_t SecondCacheSizeEstimate() const { return secondCacheSizeEstimate_; }
+	size_t CacheBudget() const;
 
 	struct VideoInfo {
 		u32 addr;
@@ -411,6 +422,7 @@ class TextureCacheCommon {
 	virtual void ReleaseTexture(TexCacheEntry *entry, bool delete_them) = 0;
 	void DeleteTexture(TexCache::iterator it);
 	void Decimate(TexCacheEntry *exceptThisOne, bool forcePressure);  // forcePressure defaults to false.
+	void DecimateToBudget(TexCacheEntry *exceptThisOne);
 
 	void ApplyTextureFramebuffer(VirtualFramebuffer *framebuffer, GETextureFormat texFormat, RasterChannel channel);
 	void ApplyTextureDepal(TexCacheEntry *entry);
@@ -430,6 +442,9 @@ class TextureCacheCommon {
 
 	// Return value is mapData normally, but could be another buffer allocated with AllocateAlignedMemory.
 	void LoadTextureLevel(TexCacheEntry &entry, uint8_t *mapData, size_t dataSize, int mapRowPitch, BuildTexturePlan &plan, int srcLevel, Draw::DataFormat dstFmt, TexDecodeFlags texDecFlags);
+	void QueueAsyncScale(TexCacheEntry &entry, int level, int factor, TexDecodeFlags texDecFlags);
+	bool UseAsyncScaling() const;
+	static ScaledTextureKey ScaledKeyFor(const TexCacheEntry &entry, int factor);
 
 	template <typename T>
 	inline const T *GetCurrentClut() {
@@ -442,6 +457,7 @@ class TextureCacheCommon {
 	}
 
 	static u32 EstimateTexMemoryUsage(const TexCacheEntry *entry);
+	static u32 EstimateBuiltTexMemoryUsage(const TexCacheEntry *entry, const BuildTexturePlan &plan);
 
 	SamplerCacheKey GetSamplingParams(int maxLevel, const TexCacheEntry *entry);
 	SamplerCacheKey GetFramebufferSamplingParams(u16 bufferWidth, u16 bufferHeight);
@@ -483,6 +499,7 @@ class TextureCacheCommon {
 		}
 		const u32 *checkp = (const u32 *)Memory::GetPointer(addr);
 
+		gpuStats.numTexturesHashed++;
 		gpuStats.numTextureDataBytesHashed += sizeInRAM;
 
 		if (Memory::IsValidAddress(addr + sizeInRAM)) {
@@ -521,6 +538,8 @@ class TextureCacheCommon {
 	TexCache secondCache_;
 	u32 secondCacheSizeEstimate_ = 0;
 
+	int texturesEvicted_ = 0;
+
 	std::vector<VideoInfo> videos_;
 
 	AlignedVector<u32, 16> tmpTexBuf32_;
@@ -25,10 +25,12 @@
 #include "ext/xxhash.h"
 
 #include "Common/Data/Format/IniFile.h"
+#include "Common/Data/Hash/WideHash.h"
 #include "Common/Data/Format/PNGLoad.h"
 #include "Common/Data/Text/I18n.h"
 #include "Common/Data/Text/Parsers.h"
 #include "Common/File/VFS/DirectoryReader.h"
+#include "Common/File/VFS/PackFileReader.h"
 #include "Common/File/VFS/ZipFileReader.h"
 #include "Common/File/FileUtil.h"
 #include "Common/File/VFS/VFS.h"
@@ -44,6 +46,7 @@
 
 static const std::string INI_FILENAME = "textures.ini";
 static const std::string ZIP_FILENAME = "textures.zip";
+static const std::string PACK_FILENAME = "textures.pak";
 static const std::string NEW_TEXTURE_DIR = "new/";
 static const int VERSION = 1;
 static const double MAX_CACHE_SIZE = 4.0;
@@ -112,6 +115,28 @@ void TextureReplacer::NotifyConfigChanged() {
 	}
 }
 
+// Leaves out the packs themselves (and a pack being written), and newly dumped textures.
+static bool IncludeInPack(const std::string &name) {
+	return !equalsNoCase(name, ZIP_FILENAME) && !startsWithNoCase(name, PACK_FILENAME) && !startsWithNoCase(name, NEW_TEXTURE_DIR);
+}
+
+// Whether any file that would go into the pack was changed after it was made.
+static bool HasFilesNewerThan(const Path &directory, const std::string &prefix, uint64_t mtime) {
+	std::vector<File::FileInfo> listing;
+	File::GetFilesInDir(directory, &listing);
+	for (const auto &file : listing) {
+		if (file.name.empty() || file.name[0] == '.' || !IncludeInPack(prefix + file.name + (file.isDirectory ? "/" : "")))
+			continue;
+		if (file.isDirectory) {
+			if (HasFilesNewerThan(file.fullName, prefix + file.name + "/", mtime))
+				return true;
+		} else if (file.mtime > mtime) {
+			return true;
+		}
+	}
+	return false;
+}
+
 bool TextureReplacer::LoadIni(std::string *error, bool notify) {
 	hash_ = ReplacedTextureHash::QUICK;
 	aliases_.clear();
@@ -131,8 +156,22 @@ bool TextureReplacer::LoadIni(std::string *error, bool notify) {
 
 	Path zipPath = basePath_ / ZIP_FILENAME;
 
-	// First, check for textures.zip, which is used to reduce IO.
-	VFSBackend *dir = ZipFileReader::Create(zipPath, "", false);
+	// First, check for textures.pak, which is mapped and needs no scanning, then textures.zip. Both are used to reduce IO.
+	// A pack older than the loose files would hide edits made after packing, so those win then.
+	VFSBackend *dir = nullptr;
+	File::FileInfo packInfo;
+	if (File::GetFileInfo(basePath_ / PACK_FILENAME, &packInfo) && packInfo.exists) {
+		if (HasFilesNewerThan(basePath_, "", packInfo.mtime)) {
+			WARN_LOG(Log::TexReplacement, "%s is older than some of the files in %s, ignoring it", PACK_FILENAME.c_str(), basePath_.c_str());
+			auto gr = GetI18NCategory(I18NCat::GRAPHICS);
+			g_OSD.Show(OSDType::MESSAGE_WARNING, gr->T("textures.pak is out of date, using the texture folder instead"), 5.0f);
+		} else {
+			dir = PackFileReader::Create(basePath_ / PACK_FILENAME, false);
+		}
+	}
+	if (!dir) {
+		dir = ZipFileReader::Create(zipPath, "", false);
+	}
 	if (!dir) {
 		INFO_LOG(Log::TexReplacement, "%s wasn't a zip file - opening the directory %s instead.", zipPath.c_str(), basePath_.c_str());
 		vfsIsZip_ = false;
@@ -216,11 +255,7 @@ bool TextureReplacer::LoadIni(std::string *error, bool notify) {
 	}
 
 	if (replaceEnabled_) {
-		if (vfsIsZip_) {
-			INFO_LOG(Log::TexReplacement, "Texture pack activated from '%s'", (basePath_ / ZIP_FILENAME).c_str());
-		} else {
-			INFO_LOG(Log::TexReplacement, "Texture pack activated from '%s'", basePath_.c_str());
-		}
+		INFO_LOG(Log::TexReplacement, "Texture pack activated from '%s'", vfs_->toString().c_str());
 	}
 
 	// The ini doesn't have to exist for the texture directory or zip to be valid.
@@ -297,6 +332,8 @@ bool TextureReplacer::LoadIniValues(IniFile &ini, VFSBackend *dir, bool isOverri
 		hash_ = ReplacedTextureHash::XXH32;
 	} else if (strcasecmp(hash.c_str(), "xxh64") == 0) {
 		hash_ = ReplacedTextureHash::XXH64;
+	} else if (strcasecmp(hash.c_str(), "xxh3") == 0) {
+		hash_ = ReplacedTextureHash::XXH3;
 	} else if (!isOverride || !hash.empty()) {
 		*error = "textures.ini: Unsupported hash type: " + hash;
 		return false;
@@ -547,6 +584,8 @@ u32 TextureReplacer::ComputeHash(u32 addr, int bufw, int w, int h, bool swizzled
 			return XXH32(checkp, sizeInRAM, 0xBACD7814);
 		case ReplacedTextureHash::XXH64:
 			return XXH64(checkp, sizeInRAM, 0xBACD7814);
+		case ReplacedTextureHash::XXH3:
+			return hash::WideHash64(checkp, sizeInRAM);
 		default:
 			return 0;
 		}
@@ -581,6 +620,14 @@ u32 TextureReplacer::ComputeHash(u32 addr, int bufw, int w, int h, bool swizzled
 			}
 			break;
 
+		case ReplacedTextureHash::XXH3:
+			for (int y = 0; y < h; ++y) {
+				u32 rowHash = hash::WideHash64(checkp, bytesPerLine);
+				result = (result * 11) ^ rowHash;
+				checkp += stride;
+			}
+			break;
+
 		default:
 			break;
 		}
@@ -1008,6 +1055,21 @@ bool TextureReplacer::IniExists(const std::string &gameID) {
 	return File::Exists(generatedFilename);
 }
 
+bool TextureReplacer::PackExists(const std::string &gameID) {
+	if (gameID.empty())
+		return false;
+	return File::Exists(GetSysDirectory(DIRECTORY_TEXTURES) / gameID / PACK_FILENAME);
+}
+
+bool TextureReplacer::GeneratePack(const std::string &gameID, Path &generatedFilename, std::string *error, const std::function<void(size_t done, size_t total)> &progress) {
+	if (gameID.empty())
+		return false;
+
+	Path texturesDirectory = GetSysDirectory(DIRECTORY_TEXTURES) / gameID;
+	generatedFilename = texturesDirectory / PACK_FILENAME;
+	return CreatePackFile(texturesDirectory, generatedFilename, error, &IncludeInPack, progress);
+}
+
 bool TextureReplacer::GenerateIni(const std::string &gameID, Path &generatedFilename) {
 	if (gameID.empty())
 		return false;
@@ -1033,7 +1095,7 @@ bool TextureReplacer::GenerateIni(const std::string &gameID, Path &generatedFile
 
 [options]
 version = 1
-hash = quick             # options available: "quick", "xxh32" - more accurate, but slower, "xxh64" - more accurate and quite fast, but slower than xxh32 on 32 bit cpu's
+hash = quick             # options available: "quick", "xxh32" - more accurate, but slower, "xxh64" - more accurate and quite fast, but slower than xxh32 on 32 bit cpu's, "xxh3" - as accurate as xxh64 and fastest on modern cpu's
 ignoreMipmap = true      # Usually, can just generate them with basisu, no need to dump.
 reduceHash = false       # Unsafe and can cause glitches in some cases, but allows to skip garbage data in some textures reducing endless duplicates as a side effect speeds up hashing as well, requires stronger hash like xxh32 or xxh64
 ignoreAddress = false    # Reduces duplicates at the cost of making hash less reliable, requires stronger hash like xxh32 or xxh64. Basically automatically sets the address to 0 in the dumped filenames.
@@ -19,6 +19,7 @@
 
 #include "ppsspp_config.h"
 
+#include <functional>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -121,7 +122,11 @@ class TextureReplacer {
 	void Decimate(ReplacerDecimateMode mode);
 
 	static bool GenerateIni(const std::string &gameID, Path &generatedFilename);
+	// Packs the game's texture directory into textures.pak, which then takes precedence over it (unless
+	// loose files are edited later.) Reads every texture, so call it on a background thread.
+	static bool GeneratePack(const std::string &gameID, Path &generatedFilename, std::string *error, const std::function<void(size_t done, size_t total)> &progress = nullptr);
 	static bool IniExists(const std::string &gameID);
+	static bool PackExists(const std::string &gameID);
 
 	int GetNumTrackedTextures() const { return (int)cache_.size(); }
 	int GetNumCachedReplacedTextures() const { return (int)levelCache_.size(); }
@@ -160,6 +165,7 @@ class TextureReplacer {
 	ReplacedTextureHash hash_ = ReplacedTextureHash::QUICK;
 
 	VFSBackend *vfs_ = nullptr;
+	// Also set for pack files. Both are read-only and can't be checked against the ini.
 	bool vfsIsZip_ = false;
 
 	GPUFormatSupport formatSupport_{};
@@ -27,6 +27,7 @@
 #include "Common/Log.h"
 #include "Common/Math/SIMDHeaders.h"
 #include "Common/Thread/ParallelLoop.h"
+#include "Common/Thread/ThreadManager.h"
 #include "ext/xbrz/xbrz.h"
 
 // Report the time and throughput for each larger scaling operation in the log
@@ -545,6 +546,173 @@ TextureScalerCommon::TextureScalerCommon() {
 }
 
 TextureScalerCommon::~TextureScalerCommon() {
+	std::unique_lock<std::mutex> guard(cacheLock_);
+	asyncQueue_.clear();
+	asyncDone_.wait(guard, [&] { return !asyncRunning_; });
+}
+
+class TextureScalerAsyncTask : public Task {
+public:
+	TextureScalerAsyncTask(TextureScalerCommon *scaler) : scaler_(scaler) {}
+
+	// The scalers use parallel loops internally, so stay off the compute threads they wait on.
+	TaskType Type() const override { return TaskType::DEDICATED_THREAD; }
+	TaskPriority Priority() const override { return TaskPriority::LOW; }
+
+	void Run() override {
+		scaler_->RunAsyncQueue();
+	}
+
+private:
+	TextureScalerCommon *scaler_;
+};
+
+ScaledTextureKey TextureScalerCommon::WithSettings(const ScaledTextureKey &key) {
+	ScaledTextureKey k = key;
+	k.settings = (u8)((g_Config.iTexScalingType & 0x7F) | (g_Config.bTexDeposterize ? 0x80 : 0));
+	return k;
+}
+
+static size_t ScalingCacheBudget() {
+	return (size_t)std::max(g_Config.iTexScalingCacheSizeMB, 0) * 1024 * 1024;
+}
+
+bool TextureScalerCommon::FitsInCache(int width, int height, int factor) {
+	return (size_t)width * height * factor * factor * sizeof(u32) <= ScalingCacheBudget();
+}
+
+void TextureScalerCommon::StoreResult(const ScaledTextureKey &key, std::vector<u32> &&data) {
+	// Caller holds cacheLock_.
+	const size_t budget = ScalingCacheBudget();
+	const size_t bytes = data.size() * sizeof(u32);
+	if (bytes > budget) {
+		return;
+	}
+
+	auto existing = cache_.find(key);
+	if (existing != cache_.end()) {
+		cacheBytes_ -= existing->second.data.size() * sizeof(u32);
+		cacheLRU_.erase(existing->second.lruPos);
+		cache_.erase(existing);
+	}
+
+	// Evict least recently used until the new result fits.
+	while (cacheBytes_ + bytes > budget && !cacheLRU_.empty()) {
+		auto oldest = cache_.find(cacheLRU_.back());
+		cacheBytes_ -= oldest->second.data.size() * sizeof(u32);
+		cache_.erase(oldest);
+		cacheLRU_.pop_back();
+	}
+
+	CachedResult &result = cache_[key];
+	result.data = std::move(data);
+	result.lruPos = cacheLRU_.insert(cacheLRU_.begin(), key);
+	cacheBytes_ += bytes;
+}
+
+void TextureScalerCommon::ScaleCached(const ScaledTextureKey &k, u32 *out, u32 *src, int width, int height, int *scaledWidth, int *scaledHeight, int factor) {
+	const ScaledTextureKey key = WithSettings(k);
+	const size_t pixelCount = (size_t)width * height * factor * factor;
+	{
+		std::lock_guard<std::mutex> guard(cacheLock_);
+		auto iter = cache_.find(key);
+		if (iter != cache_.end() && iter->second.data.size() == pixelCount) {
+			memcpy(out, iter->second.data.data(), pixelCount * sizeof(u32));
+			cacheLRU_.splice(cacheLRU_.begin(), cacheLRU_, iter->second.lruPos);
+			cacheHits_++;
+			*scaledWidth = width * factor;
+			*scaledHeight = height * factor;
+			return;
+		}
+	}
+
+	ScaleAlways(out, src, width, height, scaledWidth, scaledHeight, factor);
+
+	std::lock_guard<std::mutex> guard(cacheLock_);
+	StoreResult(key, std::vector<u32>(out, out + pixelCount));
+}
+
+void TextureScalerCommon::ScaleAsync(const ScaledTextureKey &k, const u32 *src, int width, int height, int factor) {
+	const ScaledTextureKey key = WithSettings(k);
+	std::lock_guard<std::mutex> guard(cacheLock_);
+	if (asyncPending_.count(key) || cache_.count(key)) {
+		return;
+	}
+
+	AsyncRequest request;
+	request.key = key;
+	request.src.assign(src, src + width * height);
+	request.width = width;
+	request.height = height;
+	request.factor = factor;
+	request.generation = generation_;
+	asyncQueue_.push_back(std::move(request));
+	asyncPending_.insert(key);
+
+	// A single worker drains the queue, the scalers themselves already spread out over all cores.
+	if (!asyncRunning_) {
+		asyncRunning_ = true;
+		g_threadManager.EnqueueTask(new TextureScalerAsyncTask(this));
+	}
+}
+
+void TextureScalerCommon::RunAsyncQueue() {
+	std::unique_lock<std::mutex> guard(cacheLock_);
+	if (!asyncScaler_) {
+		asyncScaler_.reset(new TextureScalerCommon());
+	}
+
+	while (!asyncQueue_.empty()) {
+		AsyncRequest request = std::move(asyncQueue_.front());
+		asyncQueue_.pop_front();
+		guard.unlock();
+
+		std::vector<u32> result((size_t)request.width * request.height * request.factor * request.factor);
+		int scaledWidth, scaledHeight;
+		asyncScaler_->ScaleAlways(result.data(), request.src.data(), request.width, request.height, &scaledWidth, &scaledHeight, request.factor);
+
+		guard.lock();
+		asyncPending_.erase(request.key);
+		if (request.generation == generation_) {
+			StoreResult(request.key, std::move(result));
+		}
+	}
+
+	asyncRunning_ = false;
+	asyncDone_.notify_all();
+}
+
+bool TextureScalerCommon::IsCached(const ScaledTextureKey &key) {
+	std::lock_guard<std::mutex> guard(cacheLock_);
+	return cache_.count(WithSettings(key)) != 0;
+}
+
+bool TextureScalerCommon::IsPending(const ScaledTextureKey &key) {
+	std::lock_guard<std::mutex> guard(cacheLock_);
+	return asyncPending_.count(WithSettings(key)) != 0;
+}
+
+void TextureScalerCommon::ClearCache() {
+	std::lock_guard<std::mutex> guard(cacheLock_);
+	for (const AsyncRequest &request : asyncQueue_) {
+		asyncPending_.erase(request.key);
+	}
+	asyncQueue_.clear();
+	cache_.clear();
+	cacheLRU_.clear();
+	cacheBytes_ = 0;
+	generation_++;
+}
+
+TextureScalerStats TextureScalerCommon::GetStats() {
+	std::lock_guard<std::mutex> guard(cacheLock_);
+	TextureScalerStats stats;
+	stats.cachedTextures = (int)cache_.size();
+	stats.cachedBytes = cacheBytes_;
+	stats.pending = (int)asyncPending_.size();
+	stats.cacheHits = cacheHits_;
+	cacheHits_ = 0;
+	return stats;
 }
 
 bool TextureScalerCommon::IsEmptyOrFlat(const u32 *data, int pixels) {
@@ -17,11 +17,50 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <set>
+#include <vector>
+
 #include "Common/CommonTypes.h"
 #include "Common/MemoryUtil.h"
 
 static const int MIN_TEXSCALE_LINES_PER_THREAD = 4;
 
+// Identifies a scaled texture in the scaler's result cache. Built from the texture (and CLUT) hash
+// rather than the address, so a texture that comes back after eviction, or shows up elsewhere, hits.
+struct ScaledTextureKey {
+	u64 hash;
+	u32 dim;
+	u8 format;
+	u8 factor;
+	// Scaling type and deposterize, filled in by the scaler so setting changes don't return stale results.
+	u8 settings;
+
+	bool operator <(const ScaledTextureKey &other) const {
+		if (hash != other.hash)
+			return hash < other.hash;
+		if (dim != other.dim)
+			return dim < other.dim;
+		if (format != other.format)
+			return format < other.format;
+		if (factor != other.factor)
+			return factor < other.factor;
+		return settings < other.settings;
+	}
+};
+
+struct TextureScalerStats {
+	int cachedTextures;
+	size_t cachedBytes;
+	int pending;
+	int cacheHits;
+};
+
 // The texture scaler requires input to be in R8G8B8A8.
 // (It's OK if you flip R and B as they are not treated very differently from each other.
 // They will of course not unflip during the operation so be aware of that).
@@ -34,9 +73,40 @@ class TextureScalerCommon {
 	bool Scale(u32 *&data, int width, int height, int *scaledWidth, int *scaledHeight, int factor);
 	bool ScaleInto(u32 *out, u32 *src, int width, int height, int *scaledWidth, int *scaledHeight, int factor);
 
+	// Like ScaleAlways, but goes through the result cache. out must fit the packed scaled texture.
+	void ScaleCached(const ScaledTextureKey &key, u32 *out, u32 *src, int width, int height, int *scaledWidth, int *scaledHeight, int factor);
+	// Queues src (packed, width x height) to be scaled on a background thread. The result ends up in the cache.
+	void ScaleAsync(const ScaledTextureKey &key, const u32 *src, int width, int height, int factor);
+	bool IsCached(const ScaledTextureKey &key);
+	bool IsPending(const ScaledTextureKey &key);
+	// Whether a result of this size can be kept in the cache at all, with the current budget.
+	static bool FitsInCache(int width, int height, int factor);
+	// Drops all cached results and queued work. Work already in progress is discarded when it finishes.
+	void ClearCache();
+	TextureScalerStats GetStats();
+
 	enum { XBRZ = 0, HYBRID = 1, BICUBIC = 2, HYBRID_BICUBIC = 3 };
 
 protected:
+	friend class TextureScalerAsyncTask;
+
+	struct CachedResult {
+		std::vector<u32> data;
+		std::list<ScaledTextureKey>::iterator lruPos;
+	};
+	struct AsyncRequest {
+		ScaledTextureKey key;
+		std::vector<u32> src;
+		int width;
+		int height;
+		int factor;
+		int generation;
+	};
+
+	static ScaledTextureKey WithSettings(const ScaledTextureKey &key);
+	void StoreResult(const ScaledTextureKey &key, std::vector<u32> &&data);
+	void RunAsyncQueue();
+
 	static void ScaleXBRZ(int factor, u32* source, u32* dest, int width, int height);
 	void ScaleBilinear(int factor, u32* source, u32* dest, int width, int height);
 	static void ScaleBicubicBSpline(int factor, u32* source, u32* dest, int width, int height);
@@ -51,4 +121,20 @@ class TextureScalerCommon {
 	// maximum is (100 MB total for a 512 by 512 texture with scaling factor 5 and hybrid scaling)
 	// of course, scaling factor 5 is totally silly anyway
 	AlignedVector<u32, 16> bufDeposter, bufOutput, bufTmp1, bufTmp2, bufTmp3;
+
+	// Everything below is protected by cacheLock_. The worker has its own scaler, since the buffers above aren't shared.
+	std::mutex cacheLock_;
+	std::map<ScaledTextureKey, CachedResult> cache_;
+	// Most recently used first.
+	std::list<ScaledTextureKey> cacheLRU_;
+	size_t cacheBytes_ = 0;
+	int cacheHits_ = 0;
+
+	std::deque<AsyncRequest> asyncQueue_;
+	// Queued or currently being scaled.
+	std::set<ScaledTextureKey> asyncPending_;
+	std::unique_ptr<TextureScalerCommon> asyncScaler_;
+	std::condition_variable asyncDone_;
+	bool asyncRunning_ = false;
+	int generation_ = 0;
 };
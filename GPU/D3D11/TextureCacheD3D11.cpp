@@ -32,6 +32,7 @@
 #include "Core/Config.h"
 
 #include "ext/xxhash.h"
+#include "Common/Data/Hash/WideHash.h"
 
 using namespace Microsoft::WRL;
 
@@ -221,7 +222,7 @@ void TextureCacheD3D11::UpdateCurrentClut(GEPaletteFormat clutFormat, u32 clutBa
 	if (replacer_.Enabled())
 		clutHash_ = XXH32((const char *)clutBufRaw_, clutExtendedBytes, 0xC0108888);
 	else
-		clutHash_ = XXH3_64bits((const char *)clutBufRaw_, clutExtendedBytes) & 0xFFFFFFFF;
+		clutHash_ = hash::WideHash64(clutBufRaw_, clutExtendedBytes) & 0xFFFFFFFF;
 	clutBuf_ = clutBufRaw_;
 
 	// Special optimization: fonts typically draw clut4 with just alpha values in a single color.
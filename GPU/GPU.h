@@ -72,6 +72,10 @@ inline unsigned int toFloat24(float f) {
 struct GPUStatistics {
 	void Reset() {
 		ResetFrame();
+		numTexturesCached = 0;
+		textureCacheKB = 0;
+		textureCacheBudgetKB = 0;
+		numTextureCacheEvictions = 0;
 		numFlips = 0;
 	}
 
@@ -87,6 +91,7 @@ struct GPUStatistics {
 		numTextureInvalidations = 0;
 		numTextureInvalidationsByFramebuffer = 0;
 		numTexturesHashed = 0;
+		numTextureHashesSkipped = 0;
 		numTextureDataBytesHashed = 0;
 		numFlushes = 0;
 		numBBOXJumps = 0;
@@ -108,6 +113,10 @@ struct GPUStatistics {
 		numBlockTransfers = 0;
 		numReplacerTrackedTex = 0;
 		numCachedReplacedTextures = 0;
+		numScaledTexturesCached = 0;
+		numScaledTextureCacheKB = 0;
+		numScaledTexturesPending = 0;
+		numScaledTextureCacheHits = 0;
 		numClutTextures = 0;
 		msProcessingDisplayLists = 0;
 		msPrepareDepth = 0.0;
@@ -139,6 +148,7 @@ struct GPUStatistics {
 	int numTextureInvalidations;
 	int numTextureInvalidationsByFramebuffer;
 	int numTexturesHashed;
+	int numTextureHashesSkipped;
 	int numTextureDataBytesHashed;
 	int numTexturesDecoded;
 	int numFramebufferEvaluations;
@@ -157,6 +167,10 @@ struct GPUStatistics {
 	int numBlockTransfers;
 	int numReplacerTrackedTex;
 	int numCachedReplacedTextures;
+	int numScaledTexturesCached;
+	int numScaledTextureCacheKB;
+	int numScaledTexturesPending;
+	int numScaledTextureCacheHits;
 	int numClutTextures;
 	double msProcessingDisplayLists;
 	double msPrepareDepth;
@@ -171,6 +185,11 @@ struct GPUStatistics {
 	int numDepthRasterTooSmall;
 	int numDepthRasterZCulled;
 	int numDepthEarlyBoxCulled;
+	// Texture cache memory, updated by the texture cache every frame rather than reset.
+	int numTexturesCached;
+	int textureCacheKB;
+	int textureCacheBudgetKB;
+	int numTextureCacheEvictions;  // Total, due to the budget.
 	// Flip count. Doesn't really belong here.
 	int numFlips;
 };
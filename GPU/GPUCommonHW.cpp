@@ -1811,9 +1811,12 @@ size_t GPUCommonHW::FormatGPUStatsCommon(char *buffer, size_t size) {
 		"Vertices: %d dec: %d drawn: %d\n"
 		"FBOs active: %d (evaluations: %d, created %d)\n"
 		"Textures: %d, dec: %d, invalidated: %d, hashed: %d kB, clut %d\n"
+		"Texture memory: %d kB in %d textures (budget %d kB), %d evicted\n"
+		"Texture hashes: %d (%d skipped, unwritten)\n"
 		"readbacks %d (%d non-block), upload %d (cached %d), depal %d\n"
 		"block transfers: %d\n"
 		"replacer: tracks %d references, %d unique textures\n"
+		"scaler: %d cached (%d kB), %d pending, %d hits\n"
 		"Cpy: depth %d, color %d, reint %d, blend %d, self %d\n"
 		"GPU cycles: %d (%0.1f per vertex)\n"
 		"Z-rast: %0.2f+%0.2f+%0.2f (total %0.2f/%0.2f) ms\n"
@@ -1839,6 +1842,12 @@ size_t GPUCommonHW::FormatGPUStatsCommon(char *buffer, size_t size) {
 		gpuStats.numTextureInvalidations,
 		gpuStats.numTextureDataBytesHashed / 1024,
 		gpuStats.numClutTextures,
+		gpuStats.textureCacheKB,
+		gpuStats.numTexturesCached,
+		gpuStats.textureCacheBudgetKB,
+		gpuStats.numTextureCacheEvictions,
+		gpuStats.numTexturesHashed,
+		gpuStats.numTextureHashesSkipped,
 		gpuStats.numBlockingReadbacks,
 		gpuStats.numReadbacks,
 		gpuStats.numUploads,
@@ -1847,6 +1856,10 @@ size_t GPUCommonHW::FormatGPUStatsCommon(char *buffer, size_t size) {
 		gpuStats.numBlockTransfers,
 		gpuStats.numReplacerTrackedTex,
 		gpuStats.numCachedReplacedTextures,
+		gpuStats.numScaledTexturesCached,
+		gpuStats.numScaledTextureCacheKB,
+		gpuStats.numScaledTexturesPending,
+		gpuStats.numScaledTextureCacheHits,
 		gpuStats.numDepthCopies,
 		gpuStats.numColorCopies,
 		gpuStats.numReinterpretCopies,
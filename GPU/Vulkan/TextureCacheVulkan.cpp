@@ -20,6 +20,7 @@
 
 #include "ext/xxhash.h"
 
+#include "Common/Data/Hash/WideHash.h"
 #include "Common/File/VFS/VFS.h"
 #include "Common/Data/Text/I18n.h"
 #include "Common/LogReporting.h"
@@ -351,7 +352,7 @@ void TextureCacheVulkan::UpdateCurrentClut(GEPaletteFormat clutFormat, u32 clutB
 	if (replacer_.Enabled())
 		clutHash_ = XXH32((const char *)clutBufRaw_, clutExtendedBytes, 0xC0108888);
 	else
-		clutHash_ = XXH3_64bits((const char *)clutBufRaw_, clutExtendedBytes) & 0xFFFFFFFF;
+		clutHash_ = hash::WideHash64(clutBufRaw_, clutExtendedBytes) & 0xFFFFFFFF;
 	clutBuf_ = clutBufRaw_;
 
 	// Special optimization: fonts typically draw clut4 with just alpha values in a single color.
@@ -522,6 +523,7 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 		WARN_LOG_REPORT(Log::G3D, "Texture cache ran out of GPU memory; switching to low memory mode");
 		lowMemoryMode_ = true;
 		decimationCounter_ = 0;
+		scaler_.ClearCache();
 		Decimate(entry, true);
 
 		// TODO: We should stall the GPU here and wipe things out of memory.
@@ -651,6 +653,9 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 				VK_PROFILE_END(vulkan, cmdInit, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 				vulkan->Delete().QueueDeleteImageView(view);
 			} else {
+				if (i == 0 && plan.asyncScaleFactor > 1) {
+					QueueAsyncScale(*entry, plan.baseLevelSrc, plan.asyncScaleFactor, TexDecodeFlags{});
+				}
 				loadLevel(uploadSize, i == 0 ? plan.baseLevelSrc : i, byteStride, plan.scaleFactor);
 				entry->vkTex->CopyBufferToMipLevel(cmdInit, &copyBatch, i, mipWidth, mipHeight, 0, texBuf, bufferOffset, pixelStride);
 			}
@@ -775,7 +780,7 @@ void TextureCacheVulkan::LoadVulkanTextureLevel(TexCacheEntry &entry, uint8_t *w
 		uint8_t *scaleBuf = (uint8_t *)AllocateAlignedMemory(allocBytes, 16);
 		_assert_msg_(scaleBuf, "Failed to allocate %d aligned bytes for texture scaler", (int)allocBytes);
 
-		scaler_.ScaleAlways((u32 *)scaleBuf, pixelData, w, h, &w, &h, scaleFactor);
+		scaler_.ScaleCached(ScaledKeyFor(entry, scaleFactor), (u32 *)scaleBuf, pixelData, w, h, &w, &h, scaleFactor);
 		pixelData = (u32 *)writePtr;
 
 		// We always end up at 8888.  Other parts assume this.
@@ -15,6 +15,7 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <atomic>
 #include <string>
 
 #include "Common/UI/View.h"
@@ -26,6 +27,7 @@
 #include "Common/File/FileUtil.h"
 #include "Common/Render/Text/draw_text.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ThreadManager.h"
 #include "GPU/Common/TextureReplacer.h"
 #include "GPU/Common/PostShader.h"
 #include "Core/MIPS/MIPSTracer.h"
@@ -68,6 +70,35 @@ static bool SupportsCustomDriver() {
 
 #endif
 
+static std::atomic<bool> g_texturePackRunning;
+
+// Reads every texture of the game, which can take a while for large packs.
+class GenerateTexturePackTask : public Task {
+public:
+	GenerateTexturePackTask(const std::string &gameID) : gameID_(gameID) {}
+	TaskType Type() const override { return TaskType::IO_BLOCKING; }
+	TaskPriority Priority() const override { return TaskPriority::NORMAL; }
+
+	void Run() override {
+		auto dev = GetI18NCategory(I18NCat::DEVELOPER);
+		Path generatedFilename;
+		std::string error;
+		bool success = TextureReplacer::GeneratePack(gameID_, generatedFilename, &error, [&](size_t done, size_t total) {
+			g_OSD.SetProgressBar("texturepack", dev->T("Pack texture folder into textures.pak"), 0.0f, (float)total, (float)done, 0.1f);
+		});
+		g_OSD.RemoveProgressBar("texturepack", success, 0.5f);
+		if (success) {
+			g_OSD.Show(OSDType::MESSAGE_SUCCESS, generatedFilename.ToVisualString(), 3.0f);
+		} else {
+			g_OSD.Show(OSDType::MESSAGE_ERROR, error, 5.0f);
+		}
+		g_texturePackRunning = false;
+	}
+
+private:
+	std::string gameID_;
+};
+
 static std::string PostShaderTranslateName(std::string_view value) {
 	const ShaderInfo *info = GetPostShaderInfo(value);
 	if (info) {
@@ -102,6 +133,17 @@ void DeveloperToolsScreen::CreateTextureReplacementTab(UI::LinearLayout *list) {
 		return true;
 	});
 
+	Choice *createTexturePack = list->Add(new Choice(dev->T("Pack texture folder into textures.pak")));
+	createTexturePack->OnClick.Add([=](UI::EventParams &) {
+		g_texturePackRunning = true;
+		g_threadManager.EnqueueTask(new GenerateTexturePackTask(g_paramSFO.GetDiscID()));
+	});
+	const bool packExists = PSP_IsInited() && TextureReplacer::PackExists(g_paramSFO.GetDiscID());
+	createTexturePack->SetEnabledFunc([packExists] {
+		// The running game might have the old pack mapped, and can't switch to a new one anyway.
+		return PSP_IsInited() && !g_texturePackRunning && !(g_Config.bReplaceTextures && packExists);
+	});
+
 	if (System_GetPropertyBool(SYSPROP_CAN_SHOW_FILE)) {
 		// Best string we have
 		list->Add(new Choice(di->T("Show in folder")))->OnClick.Add([=](UI::EventParams &) {
@@ -238,6 +280,7 @@ void DeveloperToolsScreen::CreateDumpFileTab(UI::LinearLayout *list) {
 	list->Add(new BitCheckBox(&g_Config.iDumpFileTypes, (int)DumpFileType::EBOOT, dev->T("Dump Decrypted Eboot", "Dump Decrypted EBOOT.BIN (If Encrypted) When Booting Game")));
 	list->Add(new BitCheckBox(&g_Config.iDumpFileTypes, (int)DumpFileType::PRX, dev->T("PRX")));
 	list->Add(new BitCheckBox(&g_Config.iDumpFileTypes, (int)DumpFileType::Atrac3, dev->T("Atrac3/3+")));
+	list->Add(new CheckBox(&g_Config.bRecordIoTrace, dev->T("Record file access trace", "Record file access trace (from next game start)")));
 }
 
 void DeveloperToolsScreen::CreateHLETab(UI::LinearLayout *list) {
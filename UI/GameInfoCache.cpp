@@ -27,6 +27,7 @@
 #include "Common/Thread/ThreadManager.h"
 #include "Common/File/VFS/VFS.h"
 #include "Common/File/VFS/ZipFileReader.h"
+#include "Common/File/DirListing.h"
 #include "Common/File/FileUtil.h"
 #include "Common/File/Path.h"
 #include "Common/Render/ManagedTexture.h"
@@ -45,6 +46,7 @@
 #include "Core/Util/RecentFiles.h"
 #include "Core/Config.h"
 #include "UI/GameInfoCache.h"
+#include "UI/GameInfoDB.h"
 
 GameInfoCache *g_gameInfoCache;
 
@@ -494,13 +496,74 @@ static bool LoadReplacementImage(GameInfo *info, GameInfoTex *tex, const char *f
 	}
 }
 
+// Don't rewrite the database more often than this just because the game list caught up.
+static const double DB_IDLE_SAVE_INTERVAL = 30.0;
+
+// Work items in flight. When the last one is done, the game list has what it asked for.
+static std::atomic<int> g_pendingWorkItems;
+static std::atomic<bool> g_dbSaveQueued;
+static std::atomic<double> g_lastDBSaveTime;
+
+class GameInfoDBSaveTask : public Task {
+public:
+	GameInfoDBSaveTask(const std::shared_ptr<GameInfoDB> &db) : db_(db) {}
+
+	TaskType Type() const override {
+		return TaskType::IO_BLOCKING;
+	}
+
+	TaskPriority Priority() const override {
+		return TaskPriority::LOW;
+	}
+
+	void Run() override {
+		db_->Save();
+		g_lastDBSaveTime = time_now_d();
+		g_dbSaveQueued = false;
+	}
+
+private:
+	std::shared_ptr<GameInfoDB> db_;
+};
+
+static void SaveDBInBackground(const std::shared_ptr<GameInfoDB> &db, bool onlyIfDue) {
+	if (onlyIfDue && time_now_d() < g_lastDBSaveTime + DB_IDLE_SAVE_INTERVAL) {
+		return;
+	}
+	// Saving does nothing if nothing changed, and one in the queue is enough.
+	if (!g_dbSaveQueued.exchange(true)) {
+		g_threadManager.EnqueueTask(new GameInfoDBSaveTask(db));
+	}
+}
+
+// Screenshots of the game if there are any, otherwise the standard icon.
+static bool LoadFallbackIcon(GameInfo *info, const std::string &id) {
+	Path screenshot_jpg = GetSysDirectory(DIRECTORY_SCREENSHOT) / (id + "_00000.jpg");
+	Path screenshot_png = GetSysDirectory(DIRECTORY_SCREENSHOT) / (id + "_00000.png");
+	// Try using png/jpg screenshots first
+	if (File::Exists(screenshot_png)) {
+		return ReadLocalFileToString(screenshot_png, &info->icon.data, &info->lock);
+	} else if (File::Exists(screenshot_jpg)) {
+		return ReadLocalFileToString(screenshot_jpg, &info->icon.data, &info->lock);
+	} else {
+		DEBUG_LOG(Log::Loader, "Loading unknown.png because no icon was found");
+		return ReadVFSToString("unknown.png", &info->icon.data, &info->lock);
+	}
+}
+
 class GameInfoWorkItem : public Task {
 public:
-	GameInfoWorkItem(const Path &gamePath, std::shared_ptr<GameInfo> &info, GameInfoFlags flags)
-		: gamePath_(gamePath), info_(info), flags_(flags) {}
+	GameInfoWorkItem(const Path &gamePath, std::shared_ptr<GameInfo> &info, GameInfoFlags flags, const std::shared_ptr<GameInfoDB> &db)
+		: gamePath_(gamePath), info_(info), flags_(flags), db_(db) {
+		g_pendingWorkItems++;
+	}
 
 	~GameInfoWorkItem() {
 		info_->DisposeFileLoader();
+		// Save what we learned once the game list is idle, in case we never get to shut down cleanly.
+		if (--g_pendingWorkItems == 0 && db_) {
+			SaveDBInBackground(db_, true);
+		}
 	}
 
 	TaskType Type() const override {
@@ -520,6 +583,126 @@ class GameInfoWorkItem : public Task {
 	}
 
 	void Run() override {
+		if (db_ && LoadFromDB()) {
+			return;
+		}
+		Load();
+		if (storeRecord_) {
+			StoreToDB();
+		}
+	}
+
+private:
+	// Fills in what the database knows about the game, if the file hasn't changed, and leaves
+	// the rest in flags_. Returns true if that was everything, so the file doesn't need to be opened.
+	bool LoadFromDB() {
+		switch (gamePath_.Type()) {
+		case PathType::NATIVE:
+		case PathType::CONTENT_URI:
+			break;
+		default:
+			// No cheap way to tell if it changed.
+			return false;
+		}
+		if (!File::GetFileInfo(gamePath_, &fileInfo_) || !fileInfo_.exists || fileInfo_.isDirectory) {
+			return false;
+		}
+		useDB_ = true;
+
+		int wantImages = 0;
+		if (flags_ & GameInfoFlags::ICON)
+			wantImages |= 1 << GAMEINFODB_ICON;
+		if (flags_ & GameInfoFlags::PIC0)
+			wantImages |= 1 << GAMEINFODB_PIC0;
+		if (flags_ & GameInfoFlags::PIC1)
+			wantImages |= 1 << GAMEINFODB_PIC1;
+		GameInfoDBRecord record;
+		if (!db_->Lookup(gamePath_.ToString(), fileInfo_.size, fileInfo_.mtime, wantImages, &record)) {
+			return false;
+		}
+
+		GameInfoFlags done = GameInfoFlags::FILE_TYPE;
+		{
+			std::lock_guard<std::mutex> lock(info_->lock);
+			info_->fileType = record.fileType;
+			info_->MarkReadyNoLock(GameInfoFlags::FILE_TYPE);
+			if ((flags_ & GameInfoFlags::PARAM_SFO) && record.paramSFOState != GameInfoDBState::UNKNOWN) {
+				if (record.paramSFOState == GameInfoDBState::PRESENT) {
+					info_->paramSFO.ReadSFO((const u8 *)record.paramSFO.data(), record.paramSFO.size());
+					info_->ParseParamSFO();
+				}
+				info_->MarkReadyNoLock(GameInfoFlags::PARAM_SFO);
+				done |= GameInfoFlags::PARAM_SFO;
+			}
+			if ((flags_ & GameInfoFlags::UNCOMPRESSED_SIZE) && record.sizeUncompressed != 0) {
+				info_->gameSizeUncompressed = record.sizeUncompressed;
+				done |= GameInfoFlags::UNCOMPRESSED_SIZE;
+			}
+			if ((flags_ & GameInfoFlags::PIC0) && record.imageState[GAMEINFODB_PIC0] != GameInfoDBState::UNKNOWN) {
+				if (record.imageState[GAMEINFODB_PIC0] == GameInfoDBState::PRESENT) {
+					info_->pic0.data = std::move(record.imageData[GAMEINFODB_PIC0]);
+					info_->pic0.dataLoaded = true;
+				}
+				done |= GameInfoFlags::PIC0;
+			}
+			if ((flags_ & GameInfoFlags::PIC1) && record.imageState[GAMEINFODB_PIC1] != GameInfoDBState::UNKNOWN) {
+				if (record.imageState[GAMEINFODB_PIC1] == GameInfoDBState::PRESENT) {
+					info_->pic1.data = std::move(record.imageData[GAMEINFODB_PIC1]);
+					info_->pic1.dataLoaded = true;
+				}
+				done |= GameInfoFlags::PIC1;
+			}
+		}
+
+		if (done & GameInfoFlags::PARAM_SFO) {
+			info_->hasConfig = g_Config.hasGameConfig(info_->id);
+		}
+
+		// Same order as when loading from the game: a replacement icon wins.
+		if ((flags_ & GameInfoFlags::ICON) && record.imageState[GAMEINFODB_ICON] != GameInfoDBState::UNKNOWN) {
+			if (LoadReplacementImage(info_.get(), &info_->icon, "icon.png")) {
+				// Nothing more to do
+			} else if (record.imageState[GAMEINFODB_ICON] == GameInfoDBState::PRESENT) {
+				std::lock_guard<std::mutex> lock(info_->lock);
+				info_->icon.data = std::move(record.imageData[GAMEINFODB_ICON]);
+				info_->icon.dataLoaded = true;
+			} else {
+				info_->icon.dataLoaded = LoadFallbackIcon(info_.get(), info_->id);
+			}
+			done |= GameInfoFlags::ICON;
+		}
+
+		if (flags_ & GameInfoFlags::SIZE) {
+			std::lock_guard<std::mutex> lock(info_->lock);
+			// The savedata sizes need the ID.
+			if (info_->hasFlags & GameInfoFlags::PARAM_SFO) {
+				info_->gameSizeOnDisk = fileInfo_.size;
+				info_->saveDataSize = info_->GetGameSavedataSizeInBytes();
+				info_->installDataSize = info_->GetInstallDataSizeInBytes();
+				done |= GameInfoFlags::SIZE;
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(info_->lock);
+		info_->MarkReadyNoLock(done);
+		flags_ &= ~done;
+		return flags_ == GameInfoFlags::EMPTY;
+	}
+
+	void StoreToDB() {
+		record_.fileSize = fileInfo_.size;
+		record_.mtime = fileInfo_.mtime;
+		std::lock_guard<std::mutex> lock(info_->lock);
+		record_.fileType = info_->fileType;
+		const GameInfoTex *images[GAMEINFODB_IMAGE_COUNT] = { &info_->icon, &info_->pic0, &info_->pic1 };
+		for (int i = 0; i < GAMEINFODB_IMAGE_COUNT; i++) {
+			if (record_.imageState[i] == GameInfoDBState::PRESENT)
+				record_.imageData[i] = images[i]->data;
+		}
+		db_->Store(gamePath_.ToString(), record_);
+	}
+
+	void Load() {
 		// An early-return will result in the destructor running, where we can set
 		// flags like working and pending.
 		if (!info_->CreateLoader() || !info_->GetFileLoader() || !info_->GetFileLoader()->Exists()) {
@@ -560,11 +743,16 @@ class GameInfoWorkItem : public Task {
 					info_->MarkReadyNoLock(flags_);
 					return;
 				}
+				// A directory's contents can change without the directory changing, so only plain files.
+				storeRecord_ = useDB_ && info_->fileType == IdentifiedFileType::PSP_PBP;
 
 				// First, PARAM.SFO.
 				if (flags_ & GameInfoFlags::PARAM_SFO) {
 					std::vector<u8> sfoData;
+					record_.paramSFOState = GameInfoDBState::MISSING;
 					if (pbp.GetSubFile(PBP_PARAM_SFO, &sfoData)) {
+						record_.paramSFOState = GameInfoDBState::PRESENT;
+						record_.paramSFO.assign((const char *)sfoData.data(), sfoData.size());
 						std::lock_guard<std::mutex> lock(info_->lock);
 						info_->paramSFO.ReadSFO(sfoData);
 						info_->ParseParamSFO();
@@ -586,9 +774,11 @@ class GameInfoWorkItem : public Task {
 					if (LoadReplacementImage(info_.get(), &info_->icon, "icon.png")) {
 						// Nothing more to do
 					} else if (pbp.GetSubFileSize(PBP_ICON0_PNG) > 0) {
+						record_.imageState[GAMEINFODB_ICON] = GameInfoDBState::PRESENT;
 						std::lock_guard<std::mutex> lock(info_->lock);
 						pbp.GetSubFileAsString(PBP_ICON0_PNG, &info_->icon.data);
 					} else {
+						record_.imageState[GAMEINFODB_ICON] = GameInfoDBState::MISSING;
 						Path screenshot_jpg = GetSysDirectory(DIRECTORY_SCREENSHOT) / (info_->id + "_00000.jpg");
 						Path screenshot_png = GetSysDirectory(DIRECTORY_SCREENSHOT) / (info_->id + "_00000.png");
 						// Try using png/jpg screenshots first
@@ -605,7 +795,9 @@ class GameInfoWorkItem : public Task {
 				}
 
 				if (flags_ & GameInfoFlags::PIC0) {
+					record_.imageState[GAMEINFODB_PIC0] = GameInfoDBState::MISSING;
 					if (pbp.GetSubFileSize(PBP_PIC0_PNG) > 0) {
+						record_.imageState[GAMEINFODB_PIC0] = GameInfoDBState::PRESENT;
 						std::string data;
 						pbp.GetSubFileAsString(PBP_PIC0_PNG, &data);
 						std::lock_guard<std::mutex> lock(info_->lock);
@@ -614,7 +806,9 @@ class GameInfoWorkItem : public Task {
 					}
 				}
 				if (flags_ & GameInfoFlags::PIC1) {
+					record_.imageState[GAMEINFODB_PIC1] = GameInfoDBState::MISSING;
 					if (pbp.GetSubFileSize(PBP_PIC1_PNG) > 0) {
+						record_.imageState[GAMEINFODB_PIC1] = GameInfoDBState::PRESENT;
 						std::string data;
 						pbp.GetSubFileAsString(PBP_PIC1_PNG, &data);
 						std::lock_guard<std::mutex> lock(info_->lock);
@@ -775,11 +969,15 @@ class GameInfoWorkItem : public Task {
 					return;
 				}
 				ISOFileSystem umd(&handles, bd);
+				storeRecord_ = useDB_;
 
 				// Alright, let's fetch the PARAM.SFO.
 				if (flags_ & GameInfoFlags::PARAM_SFO) {
 					std::string paramSFOcontents;
+					record_.paramSFOState = GameInfoDBState::MISSING;
 					if (ReadFileToString(&umd, "/PSP_GAME/PARAM.SFO", &paramSFOcontents, nullptr)) {
+						record_.paramSFOState = GameInfoDBState::PRESENT;
+						record_.paramSFO = paramSFOcontents;
 						{
 							std::lock_guard<std::mutex> lock(info_->lock);
 							info_->paramSFO.ReadSFO((const u8 *)paramSFOcontents.data(), paramSFOcontents.size());
@@ -793,10 +991,12 @@ class GameInfoWorkItem : public Task {
 
 				if (flags_ & GameInfoFlags::PIC0) {
 					info_->pic0.dataLoaded = ReadFileToString(&umd, "/PSP_GAME/PIC0.PNG", &info_->pic0.data, &info_->lock);
+					record_.imageState[GAMEINFODB_PIC0] = info_->pic0.dataLoaded ? GameInfoDBState::PRESENT : GameInfoDBState::MISSING;
 				}
 
 				if (flags_ & GameInfoFlags::PIC1) {
 					info_->pic1.dataLoaded = ReadFileToString(&umd, "/PSP_GAME/PIC1.PNG", &info_->pic1.data, &info_->lock);
+					record_.imageState[GAMEINFODB_PIC1] = info_->pic1.dataLoaded ? GameInfoDBState::PRESENT : GameInfoDBState::MISSING;
 				}
 
 				if (flags_ & GameInfoFlags::SND) {
@@ -809,19 +1009,11 @@ class GameInfoWorkItem : public Task {
 					if (LoadReplacementImage(info_.get(), &info_->icon, "icon.png")) {
 						// Nothing more to do
 					} else if (ReadFileToString(&umd, "/PSP_GAME/ICON0.PNG", &info_->icon.data, &info_->lock)) {
+						record_.imageState[GAMEINFODB_ICON] = GameInfoDBState::PRESENT;
 						info_->icon.dataLoaded = true;
 					} else {
-						Path screenshot_jpg = GetSysDirectory(DIRECTORY_SCREENSHOT) / (info_->id + "_00000.jpg");
-						Path screenshot_png = GetSysDirectory(DIRECTORY_SCREENSHOT) / (info_->id + "_00000.png");
-						// Try using png/jpg screenshots first
-						if (File::Exists(screenshot_png))
-							info_->icon.dataLoaded = ReadLocalFileToString(screenshot_png, &info_->icon.data, &info_->lock);
-						else if (File::Exists(screenshot_jpg))
-							info_->icon.dataLoaded = ReadLocalFileToString(screenshot_jpg, &info_->icon.data, &info_->lock);
-						else {
-							DEBUG_LOG(Log::Loader, "Loading unknown.png because no icon was found");
-							info_->icon.dataLoaded = ReadVFSToString("unknown.png", &info_->icon.data, &info_->lock);
-						}
+						record_.imageState[GAMEINFODB_ICON] = GameInfoDBState::MISSING;
+						info_->icon.dataLoaded = LoadFallbackIcon(info_.get(), info_->id);
 					}
 				}
 				break;
@@ -878,6 +1070,7 @@ class GameInfoWorkItem : public Task {
 		}
 		if (flags_ & GameInfoFlags::UNCOMPRESSED_SIZE) {
 			info_->gameSizeUncompressed = info_->GetSizeUncompressedInBytes();
+			record_.sizeUncompressed = info_->gameSizeUncompressed;
 		}
 
 		// Time to update the flags.
@@ -891,10 +1084,19 @@ class GameInfoWorkItem : public Task {
 	std::shared_ptr<GameInfo> info_;
 	GameInfoFlags flags_{};
 
+	std::shared_ptr<GameInfoDB> db_;
+	File::FileInfo fileInfo_;
+	// Set once the file has been checked, and it's the kind of file the database can keep.
+	bool useDB_ = false;
+	bool storeRecord_ = false;
+	GameInfoDBRecord record_;
+
 	DISALLOW_COPY_AND_ASSIGN(GameInfoWorkItem);
 };
 
 GameInfoCache::GameInfoCache() {
+	db_ = std::make_shared<GameInfoDB>(GetSysDirectory(DIRECTORY_CACHE) / "gameinfo.db");
+	db_->Load();
 }
 
 GameInfoCache::~GameInfoCache() {
@@ -904,6 +1106,11 @@ GameInfoCache::~GameInfoCache() {
 
 void GameInfoCache::Shutdown() {
 	CancelAll();
+	db_->Save();
+}
+
+void GameInfoCache::SaveDatabase() {
+	SaveDBInBackground(db_, false);
 }
 
 void GameInfoCache::Clear() {
@@ -1012,7 +1219,7 @@ std::shared_ptr<GameInfo> GameInfoCache::GetInfo(Draw::DrawContext *draw, const
 		}
 		if (wanted != (GameInfoFlags)0) {
 			// We're missing info that we want. Go get it!
-			GameInfoWorkItem *item = new GameInfoWorkItem(gamePath, info, wanted);
+			GameInfoWorkItem *item = new GameInfoWorkItem(gamePath, info, wanted, db_);
 			g_threadManager.EnqueueTask(item);
 		}
 		return info;
@@ -1028,7 +1235,7 @@ std::shared_ptr<GameInfo> GameInfoCache::GetInfo(Draw::DrawContext *draw, const
 	mapLock_.unlock();
 
 	// Just get all the stuff we wanted.
-	GameInfoWorkItem *item = new GameInfoWorkItem(gamePath, info, wantFlags);
+	GameInfoWorkItem *item = new GameInfoWorkItem(gamePath, info, wantFlags, db_);
 	g_threadManager.EnqueueTask(item);
 	return info;
 }
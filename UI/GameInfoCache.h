@@ -52,6 +52,7 @@ enum class GameInfoFlags {
 ENUM_CLASS_BITOPS(GameInfoFlags);
 
 class FileLoader;
+class GameInfoDB;
 enum class IdentifiedFileType;
 
 struct GameInfoTex {
@@ -199,10 +200,15 @@ class GameInfoCache {
 	void FlushBGs();  // Gets rid of all BG textures. Also gets rid of bg sounds.
 
 	void CancelAll();
+	// Writes out the database in the background, if anything changed. For when the app might get killed.
+	void SaveDatabase();
 
 private:
 	void Shutdown();
 
+	// What we found out about games in previous runs. Shared with the work items.
+	std::shared_ptr<GameInfoDB> db_;
+
 	// Maps ISO path to info. Need to use shared_ptr as we can return these pointers - 
 	// and if they get destructed while being in use, that's bad.
 	std::map<std::string, std::shared_ptr<GameInfo> > info_;
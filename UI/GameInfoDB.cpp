@@ -0,0 +1,317 @@
+// Copyright (c) 2013- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <vector>
+
+#include "Common/File/FileUtil.h"
+#include "Common/Log.h"
+#include "Common/TimeUtil.h"
+#include "Core/Loaders.h"
+#include "UI/GameInfoDB.h"
+
+#define MK_FOURCC(str) (str[0] | ((uint8_t)str[1] << 8) | ((uint8_t)str[2] << 16) | ((uint8_t)str[3] << 24))
+
+static const u32 GAMEINFODB_MAGIC = MK_FOURCC("pGDB");
+static const u32 GAMEINFODB_VERSION = 1;
+
+// Icons are usually around 10-30KB, backgrounds a lot more, but those are only stored once viewed.
+static const u64 MAX_SAVED_DB_SIZE = 48 * 1024 * 1024;
+static const size_t MAX_SAVED_DB_ENTRIES = 20000;
+// Don't rewrite the whole file just to bump timestamps more often than this.
+static const double LAST_USED_RESOLUTION = 24 * 60 * 60;
+
+struct DiskDBHeader {
+	u32 magic;
+	u32 version;
+	u32 entryCount;
+};
+
+// Followed by the key, the PARAM.SFO data, and then the images in order.
+struct DiskDBEntry {
+	u32 keyLen;
+	u32 paramSFOLen;
+	u64 fileSize;
+	u64 mtime;
+	u64 sizeUncompressed;
+	double lastUsed;
+	u32 fileType;
+	u8 paramSFOState;
+	u8 imageState[GAMEINFODB_IMAGE_COUNT];
+	u32 imageSize[GAMEINFODB_IMAGE_COUNT];
+};
+
+GameInfoDB::GameInfoDB(const Path &filename) : filename_(filename) {}
+
+GameInfoDB::~GameInfoDB() {
+	CloseFile();
+}
+
+void GameInfoDB::CloseFile() {
+	if (file_) {
+		fclose(file_);
+		file_ = nullptr;
+	}
+}
+
+bool GameInfoDB::Load() {
+	std::lock_guard<std::mutex> guard(lock_);
+	CloseFile();
+	entries_.clear();
+	dirty_ = false;
+
+	file_ = File::OpenCFile(filename_, "rb");
+	if (!file_) {
+		return false;
+	}
+
+	DiskDBHeader header{};
+	if (fread(&header, 1, sizeof(header), file_) != sizeof(header) || header.magic != GAMEINFODB_MAGIC || header.version != GAMEINFODB_VERSION) {
+		INFO_LOG(Log::Loader, "Ignoring game info database %s, wrong version", filename_.c_str());
+		CloseFile();
+		return false;
+	}
+
+	u64 pos = sizeof(header);
+	for (u32 i = 0; i < header.entryCount; i++) {
+		DiskDBEntry diskEntry{};
+		if (fread(&diskEntry, 1, sizeof(diskEntry), file_) != sizeof(diskEntry)) {
+			break;
+		}
+		if (diskEntry.keyLen == 0 || diskEntry.keyLen > 0x1000 || diskEntry.paramSFOLen > 0x10000) {
+			// Probably a corrupted file, keep what we have so far.
+			break;
+		}
+		pos += sizeof(diskEntry);
+
+		std::string key;
+		key.resize(diskEntry.keyLen);
+		Entry entry;
+		entry.info.paramSFO.resize(diskEntry.paramSFOLen);
+		if (fread(&key[0], 1, key.size(), file_) != key.size()) {
+			break;
+		}
+		if (!entry.info.paramSFO.empty() && fread(&entry.info.paramSFO[0], 1, entry.info.paramSFO.size(), file_) != entry.info.paramSFO.size()) {
+			break;
+		}
+		pos += diskEntry.keyLen + diskEntry.paramSFOLen;
+
+		entry.info.fileSize = diskEntry.fileSize;
+		entry.info.mtime = diskEntry.mtime;
+		entry.info.sizeUncompressed = diskEntry.sizeUncompressed;
+		entry.info.fileType = (IdentifiedFileType)diskEntry.fileType;
+		entry.info.paramSFOState = (GameInfoDBState)diskEntry.paramSFOState;
+		entry.lastUsed = diskEntry.lastUsed;
+		for (int j = 0; j < GAMEINFODB_IMAGE_COUNT; j++) {
+			Image &image = entry.images[j];
+			image.state = (GameInfoDBState)diskEntry.imageState[j];
+			image.size = diskEntry.imageSize[j];
+			image.offset = pos;
+			pos += image.size;
+		}
+		// Skip the images, they're read when needed.
+		if (fseek(file_, (long)pos, SEEK_SET) != 0) {
+			break;
+		}
+		entries_[key] = std::move(entry);
+	}
+
+	INFO_LOG(Log::Loader, "Loaded %d game info database entries", (int)entries_.size());
+	return true;
+}
+
+bool GameInfoDB::ReadImage(Image &image, std::string *data) {
+	if (image.inMemory) {
+		*data = image.data;
+		return true;
+	}
+	if (!file_ || fseek(file_, (long)image.offset, SEEK_SET) != 0) {
+		return false;
+	}
+	data->resize(image.size);
+	if (image.size != 0 && fread(&(*data)[0], 1, image.size, file_) != image.size) {
+		data->clear();
+		return false;
+	}
+	return true;
+}
+
+bool GameInfoDB::Lookup(const std::string &key, u64 fileSize, u64 mtime, int wantImages, GameInfoDBRecord *record) {
+	std::lock_guard<std::mutex> guard(lock_);
+	auto iter = entries_.find(key);
+	if (iter == entries_.end()) {
+		return false;
+	}
+	Entry &entry = iter->second;
+	if (entry.info.fileSize != fileSize || entry.info.mtime != mtime) {
+		// Changed since. The caller will reload it and store it again.
+		return false;
+	}
+
+	*record = entry.info;
+	for (int i = 0; i < GAMEINFODB_IMAGE_COUNT; i++) {
+		Image &image = entry.images[i];
+		record->imageState[i] = image.state;
+		if (image.state != GameInfoDBState::PRESENT || (wantImages & (1 << i)) == 0) {
+			continue;
+		}
+		if (!ReadImage(image, &record->imageData[i])) {
+			// Just load it from the game again.
+			record->imageState[i] = GameInfoDBState::UNKNOWN;
+		}
+	}
+
+	double now = time_now_unix_utc();
+	if (now - entry.lastUsed > LAST_USED_RESOLUTION) {
+		entry.lastUsed = now;
+		dirty_ = true;
+	}
+	return true;
+}
+
+void GameInfoDB::Store(const std::string &key, const GameInfoDBRecord &record) {
+	std::lock_guard<std::mutex> guard(lock_);
+	Entry &entry = entries_[key];
+	if (entry.info.fileSize != record.fileSize || entry.info.mtime != record.mtime) {
+		// New, or a different version of the file. Forget everything.
+		entry = Entry();
+		entry.info.fileSize = record.fileSize;
+		entry.info.mtime = record.mtime;
+	}
+
+	entry.info.fileType = record.fileType;
+	if (record.paramSFOState != GameInfoDBState::UNKNOWN) {
+		entry.info.paramSFOState = record.paramSFOState;
+		entry.info.paramSFO = record.paramSFO;
+	}
+	if (record.sizeUncompressed != 0) {
+		entry.info.sizeUncompressed = record.sizeUncompressed;
+	}
+	for (int i = 0; i < GAMEINFODB_IMAGE_COUNT; i++) {
+		if (record.imageState[i] == GameInfoDBState::UNKNOWN) {
+			continue;
+		}
+		Image &image = entry.images[i];
+		image.state = record.imageState[i];
+		image.data = record.imageState[i] == GameInfoDBState::PRESENT ? record.imageData[i] : std::string();
+		image.size = (u32)image.data.size();
+		image.inMemory = true;
+	}
+	entry.lastUsed = time_now_unix_utc();
+	dirty_ = true;
+}
+
+size_t GameInfoDB::Size() {
+	std::lock_guard<std::mutex> guard(lock_);
+	return entries_.size();
+}
+
+void GameInfoDB::Save() {
+	std::unique_lock<std::mutex> guard(lock_);
+	if (!dirty_) {
+		return;
+	}
+
+	// Keep the most recently used entries that fit.
+	std::vector<std::pair<const std::string *, Entry *>> order;
+	order.reserve(entries_.size());
+	for (auto &iter : entries_) {
+		order.emplace_back(&iter.first, &iter.second);
+	}
+	std::sort(order.begin(), order.end(), [](const std::pair<const std::string *, Entry *> &a, const std::pair<const std::string *, Entry *> &b) {
+		return a.second->lastUsed > b.second->lastUsed;
+	});
+	u64 totalSize = sizeof(DiskDBHeader);
+	size_t count = 0;
+	for (; count < order.size() && count < MAX_SAVED_DB_ENTRIES; count++) {
+		const Entry &entry = *order[count].second;
+		u64 size = sizeof(DiskDBEntry) + order[count].first->size() + entry.info.paramSFO.size();
+		for (const Image &image : entry.images)
+			size += image.size;
+		if (totalSize + size > MAX_SAVED_DB_SIZE)
+			break;
+		totalSize += size;
+	}
+
+	const Path tempFilename = filename_.WithExtraExtension(".tmp");
+	FILE *out = File::OpenCFile(tempFilename, "wb");
+	if (!out) {
+		ERROR_LOG(Log::Loader, "Could not write game info database %s", tempFilename.c_str());
+		return;
+	}
+
+	DiskDBHeader header{};
+	header.magic = GAMEINFODB_MAGIC;
+	header.version = GAMEINFODB_VERSION;
+	header.entryCount = (u32)count;
+	bool success = fwrite(&header, 1, sizeof(header), out) == sizeof(header);
+
+	std::string data[GAMEINFODB_IMAGE_COUNT];
+	for (size_t i = 0; i < count && success; i++) {
+		const std::string &key = *order[i].first;
+		Entry &entry = *order[i].second;
+
+		DiskDBEntry diskEntry{};
+		for (int j = 0; j < GAMEINFODB_IMAGE_COUNT; j++) {
+			Image &image = entry.images[j];
+			data[j].clear();
+			if (image.state == GameInfoDBState::PRESENT && !ReadImage(image, &data[j])) {
+				// Lost somehow, it'll be loaded from the game again.
+				diskEntry.imageState[j] = (u8)GameInfoDBState::UNKNOWN;
+			} else {
+				diskEntry.imageState[j] = (u8)image.state;
+			}
+			diskEntry.imageSize[j] = (u32)data[j].size();
+		}
+		diskEntry.keyLen = (u32)key.size();
+		diskEntry.paramSFOLen = (u32)entry.info.paramSFO.size();
+		diskEntry.fileSize = entry.info.fileSize;
+		diskEntry.mtime = entry.info.mtime;
+		diskEntry.sizeUncompressed = entry.info.sizeUncompressed;
+		diskEntry.lastUsed = entry.lastUsed;
+		diskEntry.fileType = (u32)entry.info.fileType;
+		diskEntry.paramSFOState = (u8)entry.info.paramSFOState;
+
+		success = fwrite(&diskEntry, 1, sizeof(diskEntry), out) == sizeof(diskEntry);
+		success = success && fwrite(key.data(), 1, key.size(), out) == key.size();
+		success = success && fwrite(entry.info.paramSFO.data(), 1, entry.info.paramSFO.size(), out) == entry.info.paramSFO.size();
+		for (int j = 0; j < GAMEINFODB_IMAGE_COUNT; j++) {
+			success = success && fwrite(data[j].data(), 1, data[j].size(), out) == data[j].size();
+		}
+	}
+	success = fclose(out) == 0 && success;
+
+	if (!success) {
+		ERROR_LOG(Log::Loader, "Failed writing game info database %s", tempFilename.c_str());
+		File::Delete(tempFilename);
+		return;
+	}
+
+	// Replace the old file only once the new one is complete.
+	CloseFile();
+	if (!File::Rename(tempFilename, filename_)) {
+		File::Delete(filename_);
+		if (!File::Rename(tempFilename, filename_)) {
+			File::Delete(tempFilename);
+		}
+	}
+	INFO_LOG(Log::Loader, "Saved %d of %d game info database entries", (int)count, (int)entries_.size());
+
+	// The image offsets all moved, simplest to start over from the new file.
+	guard.unlock();
+	Load();
+}
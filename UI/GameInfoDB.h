@@ -0,0 +1,101 @@
+// Copyright (c) 2013- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "Common/CommonTypes.h"
+#include "Common/File/Path.h"
+
+// Remembers what GameInfoCache found inside game images (PARAM.SFO, icons, sizes) between runs,
+// so the game browser doesn't have to open every ISO again. Entries are keyed by path and
+// only used while the file's size and modification time still match.
+// Images are only read from the database file when they're actually asked for.
+
+enum class IdentifiedFileType;
+
+enum class GameInfoDBState : u8 {
+	UNKNOWN = 0,  // Never looked for.
+	MISSING = 1,  // Not in the game image.
+	PRESENT = 2,
+};
+
+enum GameInfoDBImage {
+	GAMEINFODB_ICON,
+	GAMEINFODB_PIC0,
+	GAMEINFODB_PIC1,
+	GAMEINFODB_IMAGE_COUNT,
+};
+
+struct GameInfoDBRecord {
+	u64 fileSize = 0;
+	u64 mtime = 0;
+	IdentifiedFileType fileType{};
+	GameInfoDBState paramSFOState = GameInfoDBState::UNKNOWN;
+	std::string paramSFO;
+	u64 sizeUncompressed = 0;  // 0 if unknown.
+	GameInfoDBState imageState[GAMEINFODB_IMAGE_COUNT]{};
+	std::string imageData[GAMEINFODB_IMAGE_COUNT];
+};
+
+class GameInfoDB {
+public:
+	GameInfoDB(const Path &filename);
+	~GameInfoDB();
+
+	// Reads the index. Image data stays on disk until looked up.
+	bool Load();
+	// Writes everything out if anything changed, dropping the least recently used entries over the budget.
+	void Save();
+
+	// Fills out the record if the file hasn't changed since it was stored. Image data
+	// is only read for the images in wantImages (bitmask of 1 << GameInfoDBImage).
+	bool Lookup(const std::string &key, u64 fileSize, u64 mtime, int wantImages, GameInfoDBRecord *record);
+	// Merges with what's already known about the same version of the file.
+	void Store(const std::string &key, const GameInfoDBRecord &record);
+
+	size_t Size();
+
+private:
+	struct Image {
+		GameInfoDBState state = GameInfoDBState::UNKNOWN;
+		u32 size = 0;
+		// Where in file_ the data is, if it hasn't been loaded or replaced.
+		u64 offset = 0;
+		bool inMemory = false;
+		std::string data;
+	};
+
+	struct Entry {
+		GameInfoDBRecord info;  // Without image data, that's in images.
+		Image images[GAMEINFODB_IMAGE_COUNT];
+		double lastUsed = 0.0;
+	};
+
+	bool ReadImage(Image &image, std::string *data);
+	void CloseFile();
+
+	Path filename_;
+	FILE *file_ = nullptr;
+	std::map<std::string, Entry> entries_;
+	bool dirty_ = false;
+	std::mutex lock_;
+};
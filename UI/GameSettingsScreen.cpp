@@ -489,6 +489,11 @@ void GameSettingsScreen::CreateGraphicsSettings(UI::ViewGroup *graphicsSettings)
 		settingInfo_->Show(gr->T("Lazy texture caching Tip", "Faster, but can cause text problems in a few games"), e.v);
 	});
 
+	CheckBox *texWriteTracking = graphicsSettings->Add(new CheckBox(&g_Config.bTextureWriteTracking, gr->T("Skip rehashing unmodified textures")));
+	texWriteTracking->SetEnabledFunc([] {
+		return !g_Config.bSoftwareRendering && g_Config.bTextureBackoffCache;
+	});
+
 	static const char *quality[] = { "Low", "Medium", "High" };
 	PopupMultiChoice *beziersChoice = graphicsSettings->Add(new PopupMultiChoice(&g_Config.iSplineBezierQuality, gr->T("LowCurves", "Spline/Bezier curves quality"), quality, 0, ARRAY_SIZE(quality), I18NCat::GRAPHICS, screenManager()));
 	beziersChoice->OnChoice.Add([=](EventParams &e) {
@@ -22,6 +22,7 @@
 #include "Core/MIPS/MIPSDebugInterface.h"
 #include "Core/MIPS/MIPSTables.h"
 #include "Core/HW/SimpleAudioDec.h"
+#include "Core/FileLoaders/DiskCachingFileLoader.h"
 #include "Core/FileSystems/MetaFileSystem.h"
 #include "Core/Debugger/SymbolMap.h"
 #include "Core/MemMap.h"
@@ -644,6 +645,19 @@ static void DrawFilesystemBrowser(ImConfig &cfg) {
 		return;
 	}
 
+	for (const auto &cache : DiskCachingFileLoader::GetCacheStats()) {
+		const DiskCacheStats &stats = cache.second;
+		if (ImGui::TreeNode(cache.first.c_str(), "Disk cache - %s", cache.first.GetFilename().c_str())) {
+			ImGui::Text("Blocks read: %llu (%0.1f%% from cache)", (unsigned long long)stats.blocksRead,
+				stats.blocksRead ? 100.0 * (double)stats.blocksFromCache / (double)stats.blocksRead : 0.0);
+			ImGui::Text("Prefetched: %llu (%llu used), from a history of %u blocks",
+				(unsigned long long)stats.blocksPrefetched, (unsigned long long)stats.prefetchedUsed, stats.historyLength);
+			ImGui::Text("Stored %0.1f MB as %0.1f MB, disk use %0.1f / %0.1f MB",
+				stats.bytesUncompressed / 1048576.0, stats.bytesStored / 1048576.0, stats.diskUsed / 1048576.0, stats.diskBudget / 1048576.0);
+			ImGui::TreePop();
+		}
+	}
+
 	for (auto &fs : pspFileSystem.GetMounts()) {
 		std::string path;
 		char desc[256];
@@ -652,6 +666,22 @@ static void DrawFilesystemBrowser(ImConfig &cfg) {
 		snprintf(fsTitle, sizeof(fsTitle), "%s - %s", fs.prefix.c_str(), desc);
 		if (ImGui::TreeNode(fsTitle)) {
 			auto system = fs.system;
+			if (const FileSystemLookupStats *stats = system->LookupStats()) {
+				ImGui::Text("Lookups: %llu (%llu from index, %llu tree walks, %llu not found)",
+					(unsigned long long)stats->lookups, (unsigned long long)stats->indexHits, (unsigned long long)stats->treeWalks, (unsigned long long)stats->notFound);
+				ImGui::Text("Directories read: %d, indexed paths: %d", stats->directoriesRead, stats->indexedPaths);
+				if (stats->scanSeconds > 0.0) {
+					ImGui::Text("Scanned at mount in %0.1f ms", stats->scanSeconds * 1000.0);
+				}
+			}
+			if (const FileSystemReadStats *stats = system->ReadStats()) {
+				ImGui::Text("Reads: %llu, %0.2f MB (%0.2f MB copied through sector buffers)",
+					(unsigned long long)stats->reads, stats->bytesRead / 1048576.0, stats->bytesCopied / 1048576.0);
+			}
+			if (const FileSystemWriteStats *stats = system->WriteStats()) {
+				ImGui::Text("Writes: %llu, %llu buffered, %llu host writes (%llu atomic savedata replaces)",
+					(unsigned long long)stats->writes, (unsigned long long)stats->writesBuffered, (unsigned long long)stats->hostWrites, (unsigned long long)stats->atomicReplaces);
+			}
 			RecurseFileSystem(system.get(), path, cfg.requesterToken);
 			ImGui::TreePop();
 		}
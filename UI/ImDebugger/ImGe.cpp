@@ -196,7 +196,7 @@ void DrawTexturesWindow(ImConfig &cfg, TextureCacheCommon *textureCache) {
 	}
 
 	if (ImGui::CollapsingHeader("Texture Cache State", nullptr, ImGuiTreeNodeFlags_DefaultOpen)) {
-		ImGui::Text("Cache: %d textures, size est %d", (int)textureCache->Cache().size(), (int)textureCache->CacheSizeEstimate());
+		ImGui::Text("Cache: %d textures, size est %d (budget %d)", (int)textureCache->Cache().size(), (int)textureCache->CacheSizeEstimate(), (int)textureCache->CacheBudget());
 		if (!textureCache->SecondCache().empty()) {
 			ImGui::Text("Second: %d textures, size est %d", (int)textureCache->SecondCache().size(), (int)textureCache->SecondCacheSizeEstimate());
 		}
@@ -1317,6 +1317,11 @@ bool HandleGlobalMessage(UIMessage message, const std::string &value) {
 		// Assume that the user may have modified things.
 		MemoryStick_NotifyWrite();
 		return true;
+	} else if (message == UIMessage::LOST_FOCUS) {
+		// We might not come back.
+		if (g_gameInfoCache)
+			g_gameInfoCache->SaveDatabase();
+		return true;
 	} else if (message == UIMessage::SAVE_FRAME_DUMP) {
 		SaveFrameDump();
 		return true;
@@ -885,6 +885,9 @@ extern "C" void Java_org_ppsspp_ppsspp_NativeApp_resume(JNIEnv *, jclass) {
 extern "C" void Java_org_ppsspp_ppsspp_NativeApp_pause(JNIEnv *, jclass) {
 	INFO_LOG(Log::System, "NativeApp.pause() - begin");
 	AndroidAudio_Pause(g_audioState);
+	// The app may be killed in the background without a shutdown.
+	if (g_gameInfoCache)
+		g_gameInfoCache->SaveDatabase();
 	INFO_LOG(Log::System, "NativeApp.pause() - end");
 }
 
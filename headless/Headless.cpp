@@ -40,8 +40,13 @@
 #include "Core/ConfigValues.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
+#include "Core/Loaders.h"
+#include "Core/PSPLoaders.h"
 #include "Core/System.h"
 #include "Core/WebServer.h"
+#include "Core/FileSystems/BlockDevices.h"
+#include "Core/FileSystems/IoTrace.h"
+#include "Core/FileSystems/MetaFileSystem.h"
 #include "Core/HLE/sceUtility.h"
 #include "Core/SaveState.h"
 #include "GPU/Common/FramebufferManagerCommon.h"
@@ -151,6 +156,11 @@ int printUsage(const char *progname, const char *reason)
 	fprintf(stderr, "  -j                    use jit (default)\n");
 	fprintf(stderr, "  -c, --compare         compare with output in file.expected\n");
 	fprintf(stderr, "  --bench               run multiple times and output speed\n");
+	fprintf(stderr, "  --replay-io-trace=FILE  replay a recorded file access trace against the -m image\n");
+	fprintf(stderr, "  --io-queue-depth=N    concurrent reads for split local file reads (default 1, off)\n");
+	fprintf(stderr, "  --compress-cso=FILE   compress the -m image to a CSO, verify it, and report speed\n");
+	fprintf(stderr, "  --cso-level=N         deflate level 1-9 for --compress-cso (default 9)\n");
+	fprintf(stderr, "  --cso-block-size=N    uncompressed bytes per CSO frame (default 2048)\n");
 	fprintf(stderr, "\nSee headless.txt for details.\n");
 
 	return 1;
@@ -310,6 +320,94 @@ std::vector<std::string> ReadFromListFile(const std::string &listFilename) {
 	return testFilenames;
 }
 
+static void PrintLatencyHistogram(const char *title, const u64 *buckets) {
+	printf("%s latency:\n", title);
+	for (int i = 0; i < IoTrace::LATENCY_BUCKETS; ++i) {
+		if (buckets[i] == 0)
+			continue;
+		u64 low = i == 0 ? 0 : (1ULL << (i - 1));
+		printf("  %8llu - %8llu us: %llu\n", (unsigned long long)low, (unsigned long long)(1ULL << i), (unsigned long long)buckets[i]);
+	}
+}
+
+static int ReplayIoTrace(const char *tracePath, const char *mountIso) {
+	if (!mountIso) {
+		fprintf(stderr, "--replay-io-trace needs an image to replay against, use -m\n");
+		return 1;
+	}
+
+	std::vector<IoTrace::Entry> entries;
+	std::string error;
+	if (!IoTrace::Load(Path(tracePath), &entries, &error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	FileLoader *loader = ConstructFileLoader(Path(mountIso));
+	MetaFileSystem fs;
+	if (!loader->Exists() || !MountGameISO(&fs, loader, &error)) {
+		fprintf(stderr, "Unable to mount %s: %s\n", mountIso, error.c_str());
+		delete loader;
+		return 1;
+	}
+
+	IoTrace::ReplayStats stats;
+	IoTrace::Replay(&fs, entries, &stats);
+	// The same file system is usually mounted under several names.
+	const FileSystemReadStats *readStats = nullptr;
+	for (auto &mount : fs.GetMounts()) {
+		if (mount.system->ReadStats())
+			readStats = mount.system->ReadStats();
+	}
+	FileSystemReadStats fsStats = readStats ? *readStats : FileSystemReadStats();
+	fs.Shutdown();
+	delete loader;
+
+	printf("Replayed %d operations from %s\n", (int)entries.size(), tracePath);
+	printf("  %d opens (%d failed), %d reads, %d seeks, %d closes, %d skipped\n", stats.opens, stats.failedOpens, stats.reads, stats.seeks, stats.closes, stats.skipped);
+	double mb = (double)stats.bytesRead / (1024.0 * 1024.0);
+	printf("  %0.2f MB read in %0.3f seconds (%0.1f MB/s), %0.3f seconds total\n", mb, stats.readSeconds, stats.readSeconds > 0.0 ? mb / stats.readSeconds : 0.0, stats.totalSeconds);
+	if (readStats) {
+		printf("  %llu bytes copied through sector buffers (%0.1f per read)\n", (unsigned long long)fsStats.bytesCopied, fsStats.reads ? (double)fsStats.bytesCopied / (double)fsStats.reads : 0.0);
+	}
+	PrintLatencyHistogram("Open", stats.openLatency);
+	PrintLatencyHistogram("Read", stats.readLatency);
+	return 0;
+}
+
+static int CompressToCSO(const char *outPath, const char *mountIso, const CISOWriteOptions &options) {
+	if (!mountIso) {
+		fprintf(stderr, "--compress-cso needs an image to compress, use -m\n");
+		return 1;
+	}
+
+	std::string error;
+	FileLoader *loader = ConstructFileLoader(Path(mountIso));
+	BlockDevice *device = loader->Exists() ? ConstructBlockDevice(loader, &error) : nullptr;
+	if (!device) {
+		fprintf(stderr, "Unable to open %s: %s\n", mountIso, error.c_str());
+		delete loader;
+		return 1;
+	}
+
+	CISOWriteStats stats;
+	bool success = WriteCISOFile(device, Path(outPath), options, &stats, &error);
+	delete device;
+	delete loader;
+	if (!success) {
+		fprintf(stderr, "Compressing %s failed: %s\n", mountIso, error.c_str());
+		return 1;
+	}
+
+	double mb = (double)stats.inputBytes / (1024.0 * 1024.0);
+	printf("Wrote %s: %0.2f MB -> %0.2f MB (%0.1f%%), %d frames, %d stored uncompressed\n", outPath, mb, (double)stats.outputBytes / (1024.0 * 1024.0), stats.inputBytes ? 100.0 * (double)stats.outputBytes / (double)stats.inputBytes : 0.0, stats.frames, stats.plainFrames);
+	printf("  read %0.3f s, compress %0.3f s (%0.1f MB/s on %d threads), verify %0.3f s (%0.1f MB/s)\n",
+		stats.readSeconds, stats.compressSeconds, stats.compressSeconds > 0.0 ? mb / stats.compressSeconds : 0.0, g_threadManager.GetNumLooperThreads(),
+		stats.verifySeconds, stats.verifySeconds > 0.0 ? mb / stats.verifySeconds : 0.0);
+	printf("  %0.3f seconds total (%0.1f MB/s)\n", stats.totalSeconds, stats.totalSeconds > 0.0 ? mb / stats.totalSeconds : 0.0);
+	return 0;
+}
+
 static void AddRecursively(std::vector<std::string> *tests, Path actualPath) {
 	// TODO: Some file systems can optimize this.
 	std::vector<File::FileInfo> fileInfo;
@@ -370,6 +468,10 @@ int main(int argc, const char* argv[])
 	std::vector<std::string> testFilenames;
 	std::vector<std::string> ignoredTests;
 	const char *mountIso = nullptr;
+	const char *ioTraceToReplay = nullptr;
+	int ioQueueDepth = 1;
+	const char *csoToWrite = nullptr;
+	CISOWriteOptions csoOptions;
 	const char *mountRoot = nullptr;
 	const char *screenshotFilename = nullptr;
 
@@ -441,6 +543,20 @@ int main(int argc, const char* argv[])
 			teamCityMode = true;
 		else if (!strncmp(argv[i], "--state=", strlen("--state=")) && strlen(argv[i]) > strlen("--state="))
 			stateToLoad = argv[i] + strlen("--state=");
+		else if (!strncmp(argv[i], "--replay-io-trace=", strlen("--replay-io-trace=")) && strlen(argv[i]) > strlen("--replay-io-trace="))
+			ioTraceToReplay = argv[i] + strlen("--replay-io-trace=");
+		else if (!strncmp(argv[i], "--io-queue-depth=", strlen("--io-queue-depth=")) && strlen(argv[i]) > strlen("--io-queue-depth="))
+			ioQueueDepth = (int)strtol(argv[i] + strlen("--io-queue-depth="), NULL, 10);
+		else if (!strncmp(argv[i], "--compress-cso=", strlen("--compress-cso=")) && strlen(argv[i]) > strlen("--compress-cso="))
+			csoToWrite = argv[i] + strlen("--compress-cso=");
+		else if (!strncmp(argv[i], "--cso-level=", strlen("--cso-level=")) && strlen(argv[i]) > strlen("--cso-level=")) {
+			char *end = nullptr;
+			csoOptions.level = (int)strtol(argv[i] + strlen("--cso-level="), &end, 10);
+			if (*end != '\0' || csoOptions.level < 1 || csoOptions.level > 9)
+				return printUsage(argv[0], "--cso-level must be 1-9");
+		}
+		else if (!strncmp(argv[i], "--cso-block-size=", strlen("--cso-block-size=")) && strlen(argv[i]) > strlen("--cso-block-size="))
+			csoOptions.frameSize = (u32)strtoul(argv[i] + strlen("--cso-block-size="), NULL, 10);
 		else if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
 			return printUsage(argv[0], NULL);
 		else if (!strcmp(argv[i], "--ignore")) {
@@ -465,7 +581,7 @@ int main(int argc, const char* argv[])
 		testFilenames.end()
 	);
 
-	if (testFilenames.empty())
+	if (testFilenames.empty() && !ioTraceToReplay && !csoToWrite)
 		return printUsage(argv[0], argc <= 1 ? NULL : "No executables specified");
 
 	g_Config.bEnableLogging = (fullLog || outputDebugStringLog);
@@ -484,6 +600,22 @@ int main(int argc, const char* argv[])
 	// Needs to be after log so we don't interfere with test output.
 	g_threadManager.Init(cpu_info.num_cores, cpu_info.logical_cpu_count);
 
+	if (ioTraceToReplay) {
+		g_Config.iFileReadQueueDepth = ioQueueDepth;
+		g_Config.bScanIsoDirectoriesOnMount = false;
+		int result = ReplayIoTrace(ioTraceToReplay, mountIso);
+		g_logManager.Shutdown();
+		g_threadManager.Teardown();
+		return result;
+	}
+
+	if (csoToWrite) {
+		int result = CompressToCSO(csoToWrite, mountIso, csoOptions);
+		g_logManager.Shutdown();
+		g_threadManager.Teardown();
+		return result;
+	}
+
 	HeadlessHost *headlessHost = getHost(gpuCore);
 	g_headlessHost = headlessHost;
 
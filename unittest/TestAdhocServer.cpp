@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "Common/Net/SocketCompat.h"
+#include "Common/Net/Resolve.h"
+#include "Common/Log.h"
+#include "Common/TimeUtil.h"
+#include "Core/Config.h"
+#include "Core/HLE/proAdhocServer.h"
+
+#include "UnitTest.h"
+
+// TestAdhocServer is a quick check with a single client, which works anywhere.
+// TestAdhocServerLoad (not part of "all") simulates lots of clients over loopback, all playing the
+// same game in groups of four, and checks that everyone hears about their group mates.
+// Then benchmarks chat relaying across lots of games, on a single thread and with shards.
+// Each client needs its own loopback IP, which needs all of 127.0.0.0/8 (so, not on macOS.)
+// Set PPSSPP_ADHOC_LOAD_CLIENTS to change the client count (up to SERVER_USER_MAXIMUM, mind ulimit -n.)
+
+static const int LOAD_TEST_GROUP_SIZE = 4;
+static const int RELAY_BENCH_GAMES = 16;
+static const int RELAY_BENCH_ROUNDS = 50;
+static const int RELAY_BENCH_DRIVERS = 4;
+static const int RELAY_BENCH_SHARDS = 4;
+
+static bool SendAll(int fd, const void *data, size_t size) {
+	return send(fd, (const char *)data, (int)size, MSG_NOSIGNAL) == (int)size;
+}
+
+static bool RecvAll(int fd, uint8_t *data, size_t size) {
+	size_t pos = 0;
+	while (pos < size) {
+		int result = (int)recv(fd, (char *)data + pos, (int)(size - pos), 0);
+		if (result <= 0)
+			return false;
+		pos += result;
+	}
+	return true;
+}
+
+static void SetRecvTimeout(int fd, int seconds) {
+#if PPSSPP_PLATFORM(WINDOWS)
+	DWORD timeout = seconds * 1000;
+#else
+	timeval timeout{ seconds, 0 };
+#endif
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+}
+
+// Lets the OS pick a free port for the server, rather than hoping a fixed one is free.
+static uint16_t FindFreePort() {
+	int fd = (int)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (fd < 0)
+		return 0;
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof(addr);
+	uint16_t port = 0;
+	if (bind(fd, (sockaddr *)&addr, sizeof(addr)) == 0 && getsockname(fd, (sockaddr *)&addr, &len) == 0)
+		port = ntohs(addr.sin_port);
+	closesocket(fd);
+	return port;
+}
+
+// Each client needs its own IP, since the server refuses duplicates. The first one uses 127.0.0.1,
+// the rest other loopback addresses, which not all platforms have.
+static int ConnectClient(int index, uint16_t port) {
+	int fd = (int)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (fd < 0)
+		return -1;
+
+	sockaddr_in local{};
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = index == 0 ? htonl(INADDR_LOOPBACK) : htonl(0x7F010001 + (((index - 1) / 250) << 8) + ((index - 1) % 250));
+	sockaddr_in server{};
+	server.sin_family = AF_INET;
+	server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	server.sin_port = htons(port);
+	if (bind(fd, (sockaddr *)&local, sizeof(local)) != 0 || connect(fd, (sockaddr *)&server, sizeof(server)) != 0) {
+		closesocket(fd);
+		return -1;
+	}
+	SetRecvTimeout(fd, 10);
+	return fd;
+}
+
+static SceNetAdhocctlGroupName LoadTestGroupName(int group) {
+	// Group names use all 8 characters, without a terminator.
+	char temp[16];
+	snprintf(temp, sizeof(temp), "G%07d", group);
+	SceNetAdhocctlGroupName name;
+	memcpy(name.data, temp, sizeof(name.data));
+	return name;
+}
+
+static bool ConnectClients(std::vector<int> &clients, int numClients, uint16_t port) {
+	// Wait for the server to start listening.
+	int first = -1;
+	for (int tries = 0; tries < 100 && first < 0; tries++) {
+		first = ConnectClient(0, port);
+		if (first < 0)
+			sleep_ms(10, "adhoc-load-wait");
+	}
+	EXPECT_TRUE(first >= 0);
+	clients.push_back(first);
+
+	for (int i = 1; i < numClients; i++) {
+		int fd = ConnectClient(i, port);
+		EXPECT_TRUE(fd >= 0);
+		clients.push_back(fd);
+	}
+	return true;
+}
+
+// Client i is in group i / LOAD_TEST_GROUP_SIZE, and that group plays game group % numGames.
+static bool LoginClients(const std::vector<int> &clients, int numGames) {
+	for (int i = 0; i < (int)clients.size(); i++) {
+		SceNetAdhocctlLoginPacketC2S login{};
+		login.base.opcode = OPCODE_LOGIN;
+		login.mac.data[0] = 0x02;
+		login.mac.data[4] = (uint8_t)(i >> 8);
+		login.mac.data[5] = (uint8_t)i;
+		snprintf((char *)login.name.data, sizeof(login.name.data), "Load%d", i);
+		char game[16];
+		snprintf(game, sizeof(game), "ULUS9%04d", (i / LOAD_TEST_GROUP_SIZE) % numGames);
+		memcpy(login.game.data, game, PRODUCT_CODE_LENGTH);
+		EXPECT_TRUE(SendAll(clients[i], &login, sizeof(login)));
+	}
+	return true;
+}
+
+static bool SendJoin(int fd, int group) {
+	SceNetAdhocctlConnectPacketC2S join{};
+	join.base.opcode = OPCODE_CONNECT;
+	join.group = LoadTestGroupName(group);
+	return SendAll(fd, &join, sizeof(join));
+}
+
+static bool JoinGroups(const std::vector<int> &clients) {
+	// Separate streams can be handled in any order, so let the founders in first, they get their BSSID right away.
+	SceNetAdhocctlConnectBSSIDPacketS2C founderBssid;
+	for (int i = 0; i < (int)clients.size(); i += LOAD_TEST_GROUP_SIZE)
+		EXPECT_TRUE(SendJoin(clients[i], i / LOAD_TEST_GROUP_SIZE));
+	for (int i = 0; i < (int)clients.size(); i += LOAD_TEST_GROUP_SIZE) {
+		EXPECT_TRUE(RecvAll(clients[i], (uint8_t *)&founderBssid, sizeof(founderBssid)));
+		EXPECT_EQ_INT(founderBssid.base.opcode, OPCODE_CONNECT_BSSID);
+		EXPECT_EQ_INT(founderBssid.mac.data[5], (uint8_t)i);
+	}
+	for (int i = 0; i < (int)clients.size(); i++) {
+		if (i % LOAD_TEST_GROUP_SIZE != 0)
+			EXPECT_TRUE(SendJoin(clients[i], i / LOAD_TEST_GROUP_SIZE));
+	}
+
+	// Everyone should get a connect for each group mate, and the others the BSSID of the founder.
+	std::vector<uint8_t> buffer(LOAD_TEST_GROUP_SIZE * sizeof(SceNetAdhocctlConnectPacketS2C));
+	for (int i = 0; i < (int)clients.size(); i++) {
+		size_t expected = (LOAD_TEST_GROUP_SIZE - 1) * sizeof(SceNetAdhocctlConnectPacketS2C);
+		if (i % LOAD_TEST_GROUP_SIZE != 0)
+			expected += sizeof(SceNetAdhocctlConnectBSSIDPacketS2C);
+		EXPECT_TRUE(RecvAll(clients[i], buffer.data(), expected));
+		int connects = 0;
+		size_t pos = 0;
+		while (pos < expected) {
+			if (buffer[pos] == OPCODE_CONNECT) {
+				connects++;
+				pos += sizeof(SceNetAdhocctlConnectPacketS2C);
+			} else {
+				EXPECT_EQ_INT(buffer[pos], OPCODE_CONNECT_BSSID);
+				const SceNetAdhocctlConnectBSSIDPacketS2C *bssid = (const SceNetAdhocctlConnectBSSIDPacketS2C *)&buffer[pos];
+				int founder = i - i % LOAD_TEST_GROUP_SIZE;
+				EXPECT_EQ_INT(bssid->mac.data[5], (uint8_t)founder);
+				pos += sizeof(SceNetAdhocctlConnectBSSIDPacketS2C);
+			}
+		}
+		EXPECT_EQ_INT(connects, LOAD_TEST_GROUP_SIZE - 1);
+	}
+	return true;
+}
+
+static bool RunAdhocServerLoad(std::vector<int> &clients, int numClients, uint16_t port) {
+	const int numGroups = numClients / LOAD_TEST_GROUP_SIZE;
+
+	double start = time_now_d();
+	EXPECT_TRUE(ConnectClients(clients, numClients, port));
+	EXPECT_TRUE(LoginClients(clients, 1));
+	double loggedIn = time_now_d();
+
+	EXPECT_TRUE(JoinGroups(clients));
+	double joined = time_now_d();
+
+	// Have the last client leave its group and scan, it should see every group.
+	int scanner = clients[numClients - 1];
+	uint8_t opcode = OPCODE_DISCONNECT;
+	EXPECT_TRUE(SendAll(scanner, &opcode, 1));
+	opcode = OPCODE_SCAN;
+	EXPECT_TRUE(SendAll(scanner, &opcode, 1));
+	int groupsSeen = 0;
+	while (true) {
+		EXPECT_TRUE(RecvAll(scanner, &opcode, 1));
+		if (opcode == OPCODE_SCAN_COMPLETE)
+			break;
+		EXPECT_EQ_INT(opcode, OPCODE_SCAN);
+		SceNetAdhocctlScanPacketS2C scan;
+		EXPECT_TRUE(RecvAll(scanner, (uint8_t *)&scan + 1, sizeof(scan) - 1));
+		groupsSeen++;
+	}
+	EXPECT_EQ_INT(groupsSeen, numGroups);
+	double scanned = time_now_d();
+
+	printf("Adhoc server: %d clients, connect+login %0.1f ms, join %0.1f ms, scan %0.2f ms\n",
+		numClients, (loggedIn - start) * 1000.0, (joined - loggedIn) * 1000.0, (scanned - joined) * 1000.0);
+	return true;
+}
+
+struct RelayBenchResult {
+	double messagesPerSecond;
+	double p99LatencyMs;
+};
+
+// The first member of each group sends chat messages, and the rest of the group waits for them.
+// Groups are spread over a few driver threads, so that the clients aren't the bottleneck.
+static bool RunRelayBenchmark(std::vector<int> &clients, int numClients, uint16_t port, RelayBenchResult *result) {
+	EXPECT_TRUE(ConnectClients(clients, numClients, port));
+	EXPECT_TRUE(LoginClients(clients, RELAY_BENCH_GAMES));
+	EXPECT_TRUE(JoinGroups(clients));
+
+	const int numGroups = numClients / LOAD_TEST_GROUP_SIZE;
+	std::vector<std::vector<double>> latencies(RELAY_BENCH_DRIVERS);
+	std::atomic<bool> failed(false);
+
+	double start = time_now_d();
+	std::vector<std::thread> drivers;
+	for (int d = 0; d < RELAY_BENCH_DRIVERS; d++) {
+		drivers.emplace_back([&, d] {
+			std::vector<double> sent(numGroups);
+			for (int round = 0; round < RELAY_BENCH_ROUNDS && !failed; round++) {
+				for (int g = d; g < numGroups; g += RELAY_BENCH_DRIVERS) {
+					SceNetAdhocctlChatPacketC2S chat{};
+					chat.base.opcode = OPCODE_CHAT;
+					snprintf(chat.message, sizeof(chat.message), "Round %d", round);
+					sent[g] = time_now_d();
+					if (!SendAll(clients[g * LOAD_TEST_GROUP_SIZE], &chat, sizeof(chat)))
+						failed = true;
+				}
+				for (int g = d; g < numGroups; g += RELAY_BENCH_DRIVERS) {
+					for (int m = 1; m < LOAD_TEST_GROUP_SIZE; m++) {
+						SceNetAdhocctlChatPacketS2C chat;
+						if (!RecvAll(clients[g * LOAD_TEST_GROUP_SIZE + m], (uint8_t *)&chat, sizeof(chat)) || chat.base.base.opcode != OPCODE_CHAT) {
+							failed = true;
+							return;
+						}
+						latencies[d].push_back((time_now_d() - sent[g]) * 1000.0);
+					}
+				}
+			}
+		});
+	}
+	for (std::thread &driver : drivers)
+		driver.join();
+	double elapsed = time_now_d() - start;
+	EXPECT_FALSE(failed);
+
+	std::vector<double> all;
+	for (const auto &driverLatencies : latencies)
+		all.insert(all.end(), driverLatencies.begin(), driverLatencies.end());
+	std::sort(all.begin(), all.end());
+	EXPECT_EQ_INT((int)all.size(), numGroups * (LOAD_TEST_GROUP_SIZE - 1) * RELAY_BENCH_ROUNDS);
+	result->messagesPerSecond = all.size() / elapsed;
+	result->p99LatencyMs = all[all.size() * 99 / 100];
+	return true;
+}
+
+// Runs the server on a thread for the duration of func, and closes whatever clients func left open.
+static bool RunWithServer(uint16_t port, const std::function<bool(std::vector<int> &)> &func) {
+	std::atomic<bool> serverDone(false);
+	std::thread server([&] {
+		proAdhocServerThread(port);
+		serverDone = true;
+	});
+
+	std::vector<int> clients;
+	bool success = func(clients);
+
+	for (int fd : clients)
+		closesocket(fd);
+	// Keep asking, in case we failed before the server loop even started.
+	while (!serverDone) {
+		adhocServerRunning = false;
+		sleep_ms(10, "adhoc-load-stop");
+	}
+	server.join();
+	return success;
+}
+
+// A single client logs in, founds a group, and leaves again.
+static bool RunAdhocServerSingle(std::vector<int> &clients, uint16_t port) {
+	EXPECT_TRUE(ConnectClients(clients, 1, port));
+	EXPECT_TRUE(LoginClients(clients, 1));
+	EXPECT_TRUE(SendJoin(clients[0], 0));
+	SceNetAdhocctlConnectBSSIDPacketS2C bssid;
+	EXPECT_TRUE(RecvAll(clients[0], (uint8_t *)&bssid, sizeof(bssid)));
+	EXPECT_EQ_INT(bssid.base.opcode, OPCODE_CONNECT_BSSID);
+	EXPECT_EQ_INT(bssid.mac.data[0], 0x02);
+
+	// With the group gone, a scan comes back empty.
+	uint8_t opcode = OPCODE_DISCONNECT;
+	EXPECT_TRUE(SendAll(clients[0], &opcode, 1));
+	opcode = OPCODE_SCAN;
+	EXPECT_TRUE(SendAll(clients[0], &opcode, 1));
+	EXPECT_TRUE(RecvAll(clients[0], &opcode, 1));
+	EXPECT_EQ_INT(opcode, OPCODE_SCAN_COMPLETE);
+	return true;
+}
+
+bool TestAdhocServer() {
+	const uint16_t port = FindFreePort();
+	EXPECT_TRUE(port != 0);
+
+	net::Init();
+	__AdhocServerInit();
+	int oldShards = g_Config.iAdhocServerShards;
+	int oldTickMs = g_Config.iAdhocServerTickMs;
+	g_Config.iAdhocServerTickMs = 100;
+	g_Config.iAdhocServerShards = 0;
+	bool success = RunWithServer(port, [&](std::vector<int> &clients) {
+		return RunAdhocServerSingle(clients, port);
+	});
+	g_Config.iAdhocServerShards = oldShards;
+	g_Config.iAdhocServerTickMs = oldTickMs;
+
+	AdhocServerStats stats = GetAdhocServerStats();
+	std::string status = GetAdhocServerStatusJson();
+	net::Shutdown();
+
+	EXPECT_TRUE(success);
+	EXPECT_EQ_INT((int)stats.connectionsAccepted, 1);
+	EXPECT_TRUE(status.find("\"usercount\":0") != std::string::npos);
+	return true;
+}
+
+bool TestAdhocServerLoad() {
+	int numClients = 256;
+	if (getenv("PPSSPP_ADHOC_LOAD_CLIENTS"))
+		numClients = atoi(getenv("PPSSPP_ADHOC_LOAD_CLIENTS"));
+	numClients = std::max(LOAD_TEST_GROUP_SIZE, std::min(numClients, SERVER_USER_MAXIMUM));
+	numClients -= numClients % LOAD_TEST_GROUP_SIZE;
+
+	net::Init();
+	__AdhocServerInit();
+	// The config isn't loaded in unit tests, use the usual tick.
+	int oldShards = g_Config.iAdhocServerShards;
+	int oldTickMs = g_Config.iAdhocServerTickMs;
+	g_Config.iAdhocServerTickMs = 100;
+
+	g_Config.iAdhocServerShards = 0;
+	uint16_t port = FindFreePort();
+	bool success = port != 0 && RunWithServer(port, [&](std::vector<int> &clients) {
+		return RunAdhocServerLoad(clients, numClients, port);
+	});
+
+	AdhocServerStats stats = GetAdhocServerStats();
+	printf("Adhoc server: %llu events in %llu busy iterations, max latency %0.3f ms\n",
+		(unsigned long long)stats.eventsProcessed, (unsigned long long)stats.busyIterations, stats.maxLatencyMs);
+	// At least the initial and the final status should have been taken, whatever the interval.
+	bool statsOK = (int)stats.connectionsAccepted == numClients && stats.statusSnapshots >= 2;
+	std::string status = GetAdhocServerStatusJson();
+	bool statusOK = status.find("\"usercount\":0") != std::string::npos;
+
+	// Relay benchmark, everything on the main loop versus spread over shards.
+	RelayBenchResult single{}, sharded{};
+	if (success) {
+		port = FindFreePort();
+		success = port != 0 && RunWithServer(port, [&](std::vector<int> &clients) {
+			return RunRelayBenchmark(clients, numClients, port, &single);
+		});
+	}
+	g_Config.iAdhocServerShards = RELAY_BENCH_SHARDS;
+	if (success) {
+		port = FindFreePort();
+		success = port != 0 && RunWithServer(port, [&](std::vector<int> &clients) {
+			return RunRelayBenchmark(clients, numClients, port, &sharded);
+		});
+	}
+	g_Config.iAdhocServerShards = oldShards;
+	g_Config.iAdhocServerTickMs = oldTickMs;
+	AdhocServerStats shardStats = GetAdhocServerStats();
+	net::Shutdown();
+
+	EXPECT_TRUE(success);
+	EXPECT_TRUE(statsOK);
+	EXPECT_TRUE(statusOK);
+	printf("Adhoc relay: %d clients in %d games, single loop %0.0f msg/s (p99 %0.2f ms), %d shards %0.0f msg/s (p99 %0.2f ms)\n",
+		numClients, RELAY_BENCH_GAMES, single.messagesPerSecond, single.p99LatencyMs,
+		RELAY_BENCH_SHARDS, sharded.messagesPerSecond, sharded.p99LatencyMs);
+	EXPECT_EQ_INT((int)shardStats.shards, RELAY_BENCH_SHARDS);
+	EXPECT_EQ_INT((int)shardStats.handoffs, numClients);
+	return true;
+}
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "Common/Log.h"
+#include "Common/TimeUtil.h"
+#include "Common/Thread/ThreadUtil.h"
+#include "Core/HW/DecodeAheadQueue.h"
+
+#include "UnitTest.h"
+
+// Stands in for the MediaEngine decoder: each item consumes up to 4 bytes of input, which is added by the
+// consumer over time, like the game feeding the ringbuffer.
+struct TestDecodeAheadState {
+	DecodeAheadQueue<int> queue;
+	int input = 0;
+	int consumed = 0;
+	int produced = 0;
+
+	void Produce(int *item) {
+		std::unique_lock<std::mutex> guard = queue.Lock();
+		if (!queue.WaitForInput(guard, [&] { return input - consumed >= 4; })) {
+			*item = -1;
+			return;
+		}
+		int avail = std::min(input - consumed, 4);
+		consumed += avail;
+		// Encode the order and how much input it got.
+		*item = produced++ * 10 + avail;
+	}
+
+	void Start(int maxDepth) {
+		queue.Start("TestDecodeAhead", [this](int *item) { Produce(item); }, maxDepth);
+	}
+
+	void AddInput(int bytes) {
+		std::unique_lock<std::mutex> guard = queue.Lock();
+		input += bytes;
+		queue.NotifyInput();
+	}
+};
+
+static bool TestDecodeAheadOrder() {
+	TestDecodeAheadState state;
+	state.AddInput(4 * 8);
+	state.Start(3);
+
+	for (int i = 0; i < 8; ++i) {
+		int item = -1;
+		bool stalled;
+		EXPECT_TRUE(state.queue.Take(&item, &stalled));
+		EXPECT_EQ_INT(item, i * 10 + 4);
+	}
+	state.queue.Stop(false);
+	// Never runs further ahead than asked.
+	EXPECT_TRUE(state.queue.MaxDepthSeen() <= 3);
+
+	int item;
+	while (state.queue.TryTake(&item)) {
+		// Interrupted items are still queued, but there was no input left for them.
+		EXPECT_EQ_INT(item, -1);
+	}
+	return true;
+}
+
+static bool TestDecodeAheadDemand() {
+	TestDecodeAheadState state;
+	state.AddInput(6);
+	state.Start(2);
+
+	int item = -1;
+	bool stalled;
+	EXPECT_TRUE(state.queue.Take(&item, &stalled));
+	EXPECT_EQ_INT(item, 4);
+	// Only 2 bytes left, so the producer waits for more until the item is demanded, then makes do.
+	sleep_ms(20, "test-decode-ahead");
+	EXPECT_TRUE(state.queue.Empty());
+	EXPECT_TRUE(state.queue.Take(&item, &stalled));
+	EXPECT_TRUE(stalled);
+	EXPECT_EQ_INT(item, 12);
+
+	// Now it's waiting again, and more input should wake it up without any demand.
+	state.AddInput(4);
+	for (int i = 0; i < 100 && state.queue.Empty(); ++i)
+		sleep_ms(5, "test-decode-ahead");
+	EXPECT_TRUE(state.queue.TryTake(&item));
+	EXPECT_EQ_INT(item, 24);
+
+	state.queue.Stop(false);
+	while (state.queue.TryTake(&item))
+		EXPECT_EQ_INT(item, -1);
+	return true;
+}
+
+static bool TestDecodeAheadStop() {
+	// Finishing keeps everything that was produced, and completes the item in progress with what's there.
+	TestDecodeAheadState state;
+	state.AddInput(4 + 3);
+	state.Start(4);
+	for (int i = 0; i < 100 && state.queue.Size() < 1; ++i)
+		sleep_ms(5, "test-decode-ahead");
+	state.queue.Stop(true);
+	EXPECT_FALSE(state.queue.IsRunning());
+
+	int item = -1;
+	bool stalled;
+	EXPECT_TRUE(state.queue.Take(&item, &stalled));
+	EXPECT_FALSE(stalled);
+	EXPECT_EQ_INT(item, 4);
+	EXPECT_TRUE(state.queue.Take(&item, &stalled));
+	EXPECT_EQ_INT(item, 13);
+	// Not running, so this doesn't wait.
+	EXPECT_FALSE(state.queue.Take(&item, &stalled));
+	EXPECT_EQ_INT(state.consumed, 7);
+
+	// Restarting continues where it left off.
+	state.AddInput(4);
+	state.Start(4);
+	EXPECT_TRUE(state.queue.Take(&item, &stalled));
+	EXPECT_EQ_INT(item, 24);
+
+	// Without finishing, the item in progress is interrupted without consuming anything.
+	state.queue.Stop(false);
+	while (state.queue.TryTake(&item))
+		EXPECT_EQ_INT(item, -1);
+	EXPECT_EQ_INT(state.consumed, 11);
+	EXPECT_FALSE(state.queue.Take(&item, &stalled));
+	return true;
+}
+
+bool TestDecodeAheadQueue() {
+	EXPECT_TRUE(TestDecodeAheadOrder());
+	EXPECT_TRUE(TestDecodeAheadDemand());
+	EXPECT_TRUE(TestDecodeAheadStop());
+	return true;
+}
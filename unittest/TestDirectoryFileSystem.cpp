@@ -0,0 +1,209 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/File/FileUtil.h"
+#include "Core/Config.h"
+#include "Core/FileSystems/DirectoryFileSystem.h"
+
+#include "UnitTest.h"
+
+static std::string ReadHostFile(const Path &path) {
+	std::string data;
+	File::ReadBinaryFileToString(path, &data);
+	return data;
+}
+
+static bool TestWriteBackCoalescing(DirectoryFileSystem &fs, const Path &dir) {
+	const FileSystemWriteStats *stats = fs.WriteStats();
+	u64 hostWrites = stats->hostWrites;
+
+	std::string expected;
+	int h = fs.OpenFile("/DATA.BIN", (FileAccess)(FILEACCESS_WRITE | FILEACCESS_CREATE | FILEACCESS_TRUNCATE));
+	EXPECT_TRUE(h > 0);
+	for (int i = 0; i < 1000; i++) {
+		char chunk[100];
+		memset(chunk, 'a' + i % 26, sizeof(chunk));
+		EXPECT_EQ_INT(fs.WriteFile(h, (const u8 *)chunk, sizeof(chunk)), sizeof(chunk));
+		expected.append(chunk, sizeof(chunk));
+	}
+	// Nothing reached the disk yet, and all of it goes out in one go.
+	EXPECT_EQ_INT((int)ReadHostFile(dir / "DATA.BIN").size(), 0);
+	EXPECT_EQ_INT(fs.SeekFile(h, 50, FILEMOVE_BEGIN), 50);
+	EXPECT_EQ_INT((int)(stats->hostWrites - hostWrites), 1);
+
+	// Writes after a seek land in the right place.
+	EXPECT_EQ_INT(fs.WriteFile(h, (const u8 *)"0123456789", 10), 10);
+	memcpy(&expected[50], "0123456789", 10);
+	fs.CloseFile(h);
+	EXPECT_TRUE(ReadHostFile(dir / "DATA.BIN") == expected);
+	EXPECT_EQ_INT((int)(stats->hostWrites - hostWrites), 2);
+	EXPECT_TRUE(stats->writesBuffered >= 1001);
+
+	// Reads see what was just written.
+	h = fs.OpenFile("/DATA.BIN", (FileAccess)(FILEACCESS_READ | FILEACCESS_WRITE));
+	EXPECT_TRUE(h > 0);
+	EXPECT_EQ_INT(fs.WriteFile(h, (const u8 *)"XYZ", 3), 3);
+	// Looking at other files leaves it alone.
+	fs.GetFileInfo("/OTHER.BIN");
+	fs.GetDirListing("/PSP");
+	EXPECT_EQ_INT(ReadHostFile(dir / "DATA.BIN")[0], 'a');
+	// Looking at the file from outside writes it out first.
+	EXPECT_EQ_INT(fs.GetFileInfo("/DATA.BIN").size, (s64)expected.size());
+	EXPECT_EQ_INT(ReadHostFile(dir / "DATA.BIN").compare(0, 3, "XYZ"), 0);
+	char buf[8]{};
+	EXPECT_EQ_INT(fs.SeekFile(h, 0, FILEMOVE_BEGIN), 0);
+	EXPECT_EQ_INT(fs.ReadFile(h, (u8 *)buf, 5), 5);
+	EXPECT_EQ_INT(memcmp(buf, "XYZaa", 5), 0);
+
+	// Flushed on request, without closing.
+	EXPECT_EQ_INT(fs.WriteFile(h, (const u8 *)"!", 1), 1);
+	fs.FlushWrites(true);
+	EXPECT_EQ_INT(ReadHostFile(dir / "DATA.BIN")[5], 'a');
+	fs.FlushWrites(false);
+	EXPECT_EQ_INT(ReadHostFile(dir / "DATA.BIN")[5], '!');
+	// And when listing its directory.
+	EXPECT_EQ_INT(fs.WriteFile(h, (const u8 *)"?", 1), 1);
+	fs.GetDirListing("/");
+	EXPECT_EQ_INT(ReadHostFile(dir / "DATA.BIN")[6], '?');
+	fs.CloseFile(h);
+	return true;
+}
+
+static bool TestWriteBackSavedata(DirectoryFileSystem &fs, const Path &dir) {
+	const FileSystemWriteStats *stats = fs.WriteStats();
+	EXPECT_TRUE(File::CreateDir(dir / "PSP"));
+	EXPECT_TRUE(File::CreateDir(dir / "PSP/SAVEDATA"));
+	EXPECT_TRUE(File::CreateDir(dir / "PSP/SAVEDATA/TEST00001"));
+	const Path hostPath = dir / "PSP/SAVEDATA/TEST00001/SAVE.BIN";
+	const std::string oldData(5000, 'o');
+	EXPECT_TRUE(File::WriteStringToFile(false, oldData, hostPath));
+
+	u64 replaces = stats->atomicReplaces;
+	int h = fs.OpenFile("/PSP/SAVEDATA/TEST00001/SAVE.BIN", (FileAccess)(FILEACCESS_WRITE | FILEACCESS_CREATE | FILEACCESS_TRUNCATE));
+	EXPECT_TRUE(h > 0);
+	const std::string newData(3000, 'n');
+	for (size_t i = 0; i < newData.size(); i += 500) {
+		EXPECT_EQ_INT(fs.WriteFile(h, (const u8 *)newData.data() + i, 500), 500);
+	}
+	// Until it's closed, the old save is untouched.
+	EXPECT_TRUE(ReadHostFile(hostPath) == oldData);
+	EXPECT_EQ_INT(fs.SeekFile(h, 0, FILEMOVE_END), (int)newData.size());
+	fs.FlushWrites(true);
+	fs.GetFileInfo("/PSP/SAVEDATA/TEST00001/SAVE.BIN");
+	fs.GetDirListing("/PSP/SAVEDATA/TEST00001");
+	EXPECT_TRUE(ReadHostFile(hostPath) == oldData);
+	fs.CloseFile(h);
+
+	EXPECT_TRUE(ReadHostFile(hostPath) == newData);
+	EXPECT_EQ_INT((int)(stats->atomicReplaces - replaces), 1);
+	EXPECT_FALSE(File::Exists(hostPath.WithExtraExtension(".ppssppwrite")));
+
+	// Going far past what fits in memory writes out what's there, then continues in the file itself.
+	const s32 limit = 16 * 1024 * 1024;
+	for (bool bySeek : { true, false }) {
+		h = fs.OpenFile("/PSP/SAVEDATA/TEST00001/SAVE.BIN", (FileAccess)(FILEACCESS_WRITE | FILEACCESS_TRUNCATE));
+		EXPECT_TRUE(h > 0);
+		EXPECT_EQ_INT(fs.WriteFile(h, (const u8 *)"NEW", 3), 3);
+		EXPECT_TRUE(ReadHostFile(hostPath) == newData);
+		const s32 pos = bySeek ? limit + 100 : limit - 1;
+		EXPECT_EQ_INT(fs.SeekFile(h, pos, FILEMOVE_BEGIN), pos);
+		if (bySeek) {
+			EXPECT_TRUE(ReadHostFile(hostPath) == "NEW");
+		}
+		EXPECT_EQ_INT(fs.WriteFile(h, (const u8 *)"END", 3), 3);
+		EXPECT_EQ_INT(ReadHostFile(hostPath).compare(0, 3, "NEW"), 0);
+		fs.CloseFile(h);
+		EXPECT_EQ_INT((s64)File::GetFileSize(hostPath), (s64)pos + 3);
+		EXPECT_TRUE(File::WriteStringToFile(false, newData, hostPath));
+	}
+	return true;
+}
+
+static bool TestWriteBackTwoHandles(DirectoryFileSystem &fs, const Path &dir) {
+	const FileSystemWriteStats *stats = fs.WriteStats();
+	char buf[16]{};
+
+	int writer = fs.OpenFile("/SHARED.BIN", (FileAccess)(FILEACCESS_WRITE | FILEACCESS_CREATE | FILEACCESS_TRUNCATE));
+	EXPECT_TRUE(writer > 0);
+	EXPECT_EQ_INT(fs.WriteFile(writer, (const u8 *)"hello", 5), 5);
+	// Opening the file again writes out what the first handle has.
+	int reader = fs.OpenFile("/SHARED.BIN", FILEACCESS_READ);
+	EXPECT_TRUE(reader > 0);
+	EXPECT_EQ_INT(fs.ReadFile(reader, (u8 *)buf, 5), 5);
+	EXPECT_EQ_INT(memcmp(buf, "hello", 5), 0);
+
+	// Later writes are still buffered, but show up for reads through the other handle.
+	u64 buffered = stats->writesBuffered;
+	EXPECT_EQ_INT(fs.WriteFile(writer, (const u8 *)" world", 6), 6);
+	EXPECT_EQ_INT((int)(stats->writesBuffered - buffered), 1);
+	EXPECT_EQ_INT(fs.ReadFile(reader, (u8 *)buf, 6), 6);
+	EXPECT_EQ_INT(memcmp(buf, " world", 6), 0);
+
+	// And the order of writes through both is kept.
+	EXPECT_EQ_INT(fs.WriteFile(writer, (const u8 *)"!!", 2), 2);
+	int other = fs.OpenFile("/SHARED.BIN", (FileAccess)(FILEACCESS_READ | FILEACCESS_WRITE));
+	EXPECT_TRUE(other > 0);
+	EXPECT_EQ_INT(fs.WriteFile(writer, (const u8 *)"??", 2), 2);
+	EXPECT_EQ_INT(fs.SeekFile(other, -2, FILEMOVE_END), 13);
+	EXPECT_EQ_INT(fs.WriteFile(other, (const u8 *)"..", 2), 2);
+	fs.CloseFile(writer);
+	fs.CloseFile(reader);
+	fs.CloseFile(other);
+	EXPECT_TRUE(ReadHostFile(dir / "SHARED.BIN") == "hello world!!..");
+
+	// Savedata kept in memory is written out for the second handle, then written directly.
+	const Path hostPath = dir / "PSP/SAVEDATA/TEST00001/SHARED.BIN";
+	EXPECT_TRUE(File::WriteStringToFile(false, "old data", hostPath));
+	writer = fs.OpenFile("/PSP/SAVEDATA/TEST00001/SHARED.BIN", (FileAccess)(FILEACCESS_WRITE | FILEACCESS_TRUNCATE));
+	EXPECT_TRUE(writer > 0);
+	EXPECT_EQ_INT(fs.WriteFile(writer, (const u8 *)"new", 3), 3);
+	EXPECT_TRUE(ReadHostFile(hostPath) == "old data");
+	reader = fs.OpenFile("/PSP/SAVEDATA/TEST00001/SHARED.BIN", FILEACCESS_READ);
+	EXPECT_TRUE(reader > 0);
+	EXPECT_EQ_INT(fs.ReadFile(reader, (u8 *)buf, sizeof(buf)), 3);
+	EXPECT_EQ_INT(memcmp(buf, "new", 3), 0);
+	EXPECT_EQ_INT(fs.WriteFile(writer, (const u8 *)"er", 2), 2);
+	EXPECT_EQ_INT(fs.ReadFile(reader, (u8 *)buf, sizeof(buf)), 2);
+	EXPECT_EQ_INT(memcmp(buf, "er", 2), 0);
+	fs.CloseFile(reader);
+	fs.CloseFile(writer);
+	EXPECT_TRUE(ReadHostFile(hostPath) == "newer");
+	EXPECT_FALSE(File::Exists(hostPath.WithExtraExtension(".ppssppwrite")));
+
+	// Appending on one handle doesn't turn off buffering for the next.
+	int appender = fs.OpenFile("/SHARED.BIN", (FileAccess)(FILEACCESS_WRITE | FILEACCESS_APPEND));
+	EXPECT_TRUE(appender > 0);
+	buffered = stats->writesBuffered;
+	EXPECT_EQ_INT(fs.WriteFile(appender, (const u8 *)"+", 1), 1);
+	EXPECT_EQ_INT((int)(stats->writesBuffered - buffered), 0);
+	fs.CloseFile(appender);
+	writer = fs.OpenFile("/SHARED.BIN", FILEACCESS_WRITE);
+	EXPECT_TRUE(writer > 0);
+	EXPECT_EQ_INT(fs.WriteFile(writer, (const u8 *)"H", 1), 1);
+	EXPECT_EQ_INT((int)(stats->writesBuffered - buffered), 1);
+	fs.CloseFile(writer);
+	EXPECT_TRUE(ReadHostFile(dir / "SHARED.BIN") == "Hello world!!..+");
+	return true;
+}
+
+bool TestDirectoryFileSystem() {
+	Path dir = Path("dirfstest");
+	File::DeleteDirRecursively(dir);
+	EXPECT_TRUE(File::CreateDir(dir));
+
+	const bool oldWriteBack = g_Config.bMemStickWriteBack;
+	g_Config.bMemStickWriteBack = true;
+	bool success;
+	{
+		SequentialHandleAllocator handles;
+		DirectoryFileSystem fs(&handles, dir, FileSystemFlags::SIMULATE_FAT32 | FileSystemFlags::CARD);
+		success = TestWriteBackCoalescing(fs, dir) && TestWriteBackSavedata(fs, dir) && TestWriteBackTwoHandles(fs, dir);
+	}
+	g_Config.bMemStickWriteBack = oldWriteBack;
+
+	File::DeleteDirRecursively(dir);
+	return success;
+}
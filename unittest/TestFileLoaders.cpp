@@ -0,0 +1,245 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/CPUDetect.h"
+#include "Common/File/FileUtil.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Common/TimeUtil.h"
+#include "Core/Config.h"
+#include "Core/FileLoaders/DiskCachingFileLoader.h"
+#include "Core/FileLoaders/LocalFileLoader.h"
+#include "Core/FileLoaders/ZipFileLoader.h"
+
+#include "UnitTest.h"
+
+static std::vector<u8> MakeLoaderTestData(size_t size) {
+	std::vector<u8> data(size);
+	u32 state = 12345;
+	for (size_t i = 0; i < size; i++) {
+		state = state * 1664525 + 1013904223;
+		data[i] = (u8)(state >> 24);
+	}
+	return data;
+}
+
+static bool CheckLoaderRead(FileLoader &loader, const std::vector<u8> &expected, s64 pos, size_t bytes, size_t count) {
+	std::vector<u8> buf(bytes * count + 1, 0xCC);
+	size_t available = pos >= (s64)expected.size() ? 0 : expected.size() - (size_t)pos;
+	size_t expectedCount = std::min(count, available / bytes);
+	size_t result = loader.ReadAt(pos, bytes, count, buf.data());
+	EXPECT_EQ_INT(result, expectedCount);
+	EXPECT_EQ_INT(memcmp(buf.data(), expected.data() + pos, expectedCount * bytes), 0);
+	// Nothing past the end of the request was touched.
+	EXPECT_EQ_INT(buf[bytes * count], 0xCC);
+	return true;
+}
+
+static bool TestLocalFileLoaderReads(const Path &path, const std::vector<u8> &expected) {
+	LocalFileLoader loader(path);
+	EXPECT_TRUE(loader.Exists());
+	EXPECT_EQ_INT(loader.FileSize(), (int)expected.size());
+
+	const int depths[] = { 1, 2, 4, 7 };
+	for (int depth : depths) {
+		g_Config.iFileReadQueueDepth = depth;
+		// Small, large (split), unaligned, and past the end of the file.
+		if (!CheckLoaderRead(loader, expected, 0, 2048, 16))
+			return false;
+		if (!CheckLoaderRead(loader, expected, 2048 * 3, 2048, 600))
+			return false;
+		if (!CheckLoaderRead(loader, expected, 777, 1, 1024 * 1024 + 5))
+			return false;
+		if (!CheckLoaderRead(loader, expected, (s64)expected.size() - 300000, 2048, 512))
+			return false;
+		if (!CheckLoaderRead(loader, expected, (s64)expected.size() - 100000, 1, 700000))
+			return false;
+
+		std::vector<FileLoader::ReadRequest> requests;
+		std::vector<std::vector<u8>> buffers(40);
+		for (size_t i = 0; i < buffers.size(); i++) {
+			buffers[i].resize(4096 + i * 13);
+			s64 pos = (s64)((i * 104729) % expected.size());
+			requests.push_back({ pos, buffers[i].size(), buffers[i].data(), 0 });
+		}
+		loader.ReadAtBatch(requests.data(), requests.size());
+		for (size_t i = 0; i < requests.size(); i++) {
+			size_t want = std::min(requests[i].bytes, expected.size() - (size_t)requests[i].absolutePos);
+			EXPECT_EQ_INT(requests[i].result, want);
+			EXPECT_EQ_INT(memcmp(buffers[i].data(), expected.data() + requests[i].absolutePos, want), 0);
+		}
+	}
+	return true;
+}
+
+static bool CheckCachedReads(FileLoader &loader, const std::vector<u8> &expected) {
+	// Unaligned, across blocks, and running off the end.
+	const s64 positions[] = { 0, 100, 65536 - 10, 65536 * 5 + 333, 65536 * 20, (s64)expected.size() - 3000 };
+	std::vector<u8> buf(70000);
+	for (s64 pos : positions) {
+		size_t want = std::min(buf.size(), expected.size() - (size_t)pos);
+		EXPECT_EQ_INT(loader.ReadAt(pos, buf.size(), buf.data()), want);
+		EXPECT_EQ_INT(memcmp(buf.data(), expected.data() + pos, want), 0);
+	}
+	return true;
+}
+
+static bool TestDiskCachingFileLoader(const Path &dir) {
+	// Every other block compresses well.
+	std::vector<u8> data = MakeLoaderTestData(65536 * 32 + 1234);
+	static const char pattern[] = "PPSSPP disk cache ";
+	for (size_t i = 65536; i < data.size(); i += 65536 * 2) {
+		for (size_t j = 0; j < 65536 && i + j < data.size(); j++)
+			data[i + j] = pattern[j % (sizeof(pattern) - 1)];
+	}
+	const Path path = dir / "diskcache.iso";
+	EXPECT_TRUE(File::WriteDataToFile(false, data.data(), data.size(), path));
+	const Path cacheDir = dir / "cache";
+	EXPECT_TRUE(File::CreateDir(cacheDir));
+	DiskCachingFileLoaderCache::SetCacheDir(cacheDir);
+
+	const bool oldCompression = g_Config.bDiskCacheCompression;
+	const bool oldPrefetch = g_Config.bDiskCachePrefetch;
+	g_Config.bDiskCacheCompression = true;
+	g_Config.bDiskCachePrefetch = true;
+
+	bool success = true;
+	u64 blocksFirstSession = 0;
+	for (int session = 0; session < 2 && success; session++) {
+		DiskCachingFileLoader loader(new LocalFileLoader(path));
+		EXPECT_EQ_INT(loader.FileSize(), (int)data.size());
+		// The second time around, it all comes from the cache, twice over.
+		success = CheckCachedReads(loader, data) && CheckCachedReads(loader, data);
+
+		std::vector<std::pair<Path, DiskCacheStats>> stats = DiskCachingFileLoader::GetCacheStats();
+		EXPECT_EQ_INT((int)stats.size(), 1);
+		const DiskCacheStats &s = stats[0].second;
+		if (s.diskBudget == 0) {
+			printf("Not enough free disk space for the disk cache, skipping\n");
+			break;
+		}
+		if (session == 0) {
+			EXPECT_TRUE(s.blocksFromCache * 2 >= s.blocksRead);
+			EXPECT_TRUE(s.bytesStored < s.bytesUncompressed);
+			EXPECT_EQ_INT(s.historyLength, 0);
+			blocksFirstSession = s.bytesUncompressed / 65536;
+		} else {
+			EXPECT_EQ_INT((int)s.blocksFromCache, (int)s.blocksRead);
+			EXPECT_EQ_INT(s.historyLength, (u32)blocksFirstSession);
+		}
+	}
+
+	g_Config.bDiskCacheCompression = oldCompression;
+	g_Config.bDiskCachePrefetch = oldPrefetch;
+	DiskCachingFileLoaderCache::SetCacheDir(Path());
+	return success;
+}
+
+static bool WriteTestZip(const Path &path, const std::vector<u8> &data, zip_int32_t method) {
+	int error = 0;
+	zip_t *z = zip_open(path.c_str(), ZIP_CREATE | ZIP_TRUNCATE, &error);
+	if (!z)
+		return false;
+	zip_source_t *source = zip_source_buffer(z, data.data(), data.size(), 0);
+	zip_int64_t index = source ? zip_file_add(z, "game.iso", source, 0) : -1;
+	if (index < 0 || zip_set_file_compression(z, index, method, 1) != 0) {
+		zip_discard(z);
+		return false;
+	}
+	return zip_close(z) == 0;
+}
+
+static bool TestZipFileLoader(const Path &dir) {
+	// Some of it compresses, some of it doesn't.
+	std::vector<u8> data = MakeLoaderTestData(65536 * 160 + 4321);
+	for (size_t i = 0; i < data.size(); i += 3000)
+		memset(&data[i], (int)(i & 0xFF), std::min((size_t)1500, data.size() - i));
+
+	for (zip_int32_t method : { ZIP_CM_DEFLATE, ZIP_CM_STORE }) {
+		const Path path = dir / "test.zip";
+		EXPECT_TRUE(WriteTestZip(path, data, method));
+		ZipFileLoader loader(new LocalFileLoader(path));
+		EXPECT_TRUE(loader.GetZip() != nullptr);
+		EXPECT_TRUE(loader.Initialize(0));
+		EXPECT_EQ_INT(loader.FileSize(), (int)data.size());
+
+		// Jump around, backwards, and past the end.
+		std::vector<u8> buf(200000);
+		u32 state = 777;
+		for (int i = 0; i < 60; i++) {
+			state = state * 1664525 + 1013904223;
+			s64 pos = (s64)(state % (u32)(data.size() + 1000));
+			size_t bytes = (state >> 8) % buf.size() + 1;
+			size_t want = pos >= (s64)data.size() ? 0 : std::min(bytes, data.size() - (size_t)pos);
+			EXPECT_EQ_INT(loader.ReadAt(pos, bytes, buf.data()), want);
+			EXPECT_EQ_INT(memcmp(buf.data(), data.data() + pos, want), 0);
+		}
+		// All of it in one go.
+		std::vector<u8> all(data.size());
+		EXPECT_EQ_INT(loader.ReadAt(0, all.size(), all.data()), all.size());
+		EXPECT_TRUE(all == data);
+	}
+	return true;
+}
+
+static void BenchmarkLocalFileLoader(const Path &path, size_t fileSize) {
+	LocalFileLoader loader(path);
+	const int oldDepth = g_Config.iFileReadQueueDepth;
+	std::vector<u8> buf(1024 * 1024);
+	const int iterations = 20;
+
+	for (int depth : { 1, 4 }) {
+		g_Config.iFileReadQueueDepth = depth;
+		double start = time_now_d();
+		for (int n = 0; n < iterations; n++) {
+			for (size_t pos = 0; pos < fileSize; pos += buf.size())
+				loader.ReadAt(pos, 1, buf.size(), buf.data());
+		}
+		double elapsed = time_now_d() - start;
+		printf("Local file reads, queue depth %d: %0.1f MB/s (cached)\n", depth, (double)fileSize * iterations / (1024.0 * 1024.0) / elapsed);
+	}
+	g_Config.iFileReadQueueDepth = oldDepth;
+}
+
+bool TestFileLoaders() {
+	// Split reads go out on the I/O threads.
+	if (!g_threadManager.IsInitialized())
+		g_threadManager.Init(cpu_info.num_cores, cpu_info.logical_cpu_count);
+
+	Path dir = Path("fileloadertest");
+	File::DeleteDirRecursively(dir);
+	EXPECT_TRUE(File::CreateDir(dir));
+	const std::vector<u8> data = MakeLoaderTestData(3 * 1024 * 1024 + 12345);
+	const Path path = dir / "test.iso";
+	EXPECT_TRUE(File::WriteDataToFile(false, data.data(), data.size(), path));
+
+	const int oldDepth = g_Config.iFileReadQueueDepth;
+	bool success = TestLocalFileLoaderReads(path, data);
+	if (success)
+		success = TestDiskCachingFileLoader(dir);
+	if (success)
+		success = TestZipFileLoader(dir);
+	g_Config.iFileReadQueueDepth = oldDepth;
+
+	File::DeleteDirRecursively(dir);
+	return success;
+}
+
+// Not part of the default run, it only prints timings and needs a scratch file.
+bool TestFileLoadersBenchmark() {
+	if (!g_threadManager.IsInitialized())
+		g_threadManager.Init(cpu_info.num_cores, cpu_info.logical_cpu_count);
+
+	Path dir = Path("fileloaderbench");
+	File::DeleteDirRecursively(dir);
+	EXPECT_TRUE(File::CreateDir(dir));
+	const std::vector<u8> data = MakeLoaderTestData(3 * 1024 * 1024 + 12345);
+	const Path path = dir / "test.iso";
+	EXPECT_TRUE(File::WriteDataToFile(false, data.data(), data.size(), path));
+
+	BenchmarkLocalFileLoader(path, data.size());
+
+	File::DeleteDirRecursively(dir);
+	return true;
+}
@@ -0,0 +1,374 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/CPUDetect.h"
+#include "Common/File/FileUtil.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Common/TimeUtil.h"
+#include "Core/Config.h"
+#include "Core/FileLoaders/LocalFileLoader.h"
+#include "Core/FileSystems/BlockDevices.h"
+#include "Core/FileSystems/ISOFileSystem.h"
+
+#include "UnitTest.h"
+
+class MemoryBlockDevice : public BlockDevice {
+public:
+	MemoryBlockDevice(const std::vector<u8> &data) : BlockDevice(nullptr), data_(data) {}
+	bool ReadBlock(int blockNumber, u8 *outPtr, bool uncached = false) override {
+		if (blockNumber < 0 || (u32)blockNumber >= GetNumBlocks())
+			return false;
+		memcpy(outPtr, &data_[blockNumber * 2048], 2048);
+		return true;
+	}
+	u32 GetNumBlocks() const override { return (u32)(data_.size() / 2048); }
+	bool IsDisc() const override { return true; }
+
+private:
+	std::vector<u8> data_;
+};
+
+// Just enough ISO 9660 to build a directory tree in memory.
+class TestISOBuilder {
+public:
+	struct Entry {
+		std::string name;
+		bool isDirectory;
+		u32 sector;
+		u32 size;
+	};
+
+	TestISOBuilder() : data_(18 * 2048) {}
+
+	u32 AddFile(u32 size) {
+		u32 sector = NumSectors();
+		data_.resize(data_.size() + ((size + 2047) / 2048) * 2048);
+		return sector;
+	}
+
+	// Returns the size in bytes, which is what the parent's entry needs.
+	u32 AddDirectory(u32 self, u32 parent, const std::vector<Entry> &entries, u32 *sectorOut) {
+		std::vector<u8> dir(2048);
+		size_t pos = 0;
+		auto append = [&](const std::string &name, bool isDirectory, u32 sector, u32 size) {
+			size_t len = 33 + name.size();
+			len += len & 1;
+			// Entries never cross sectors.
+			if ((pos % 2048) + len > 2048) {
+				pos = (pos + 2047) & ~2047;
+				dir.resize(pos + 2048);
+			}
+			WriteEntry(&dir[pos], name, isDirectory, sector, size);
+			pos += len;
+		};
+		u32 sector = NumSectors();
+		u32 numSectors = 0;
+		// The directory's own size isn't known until it's laid out, so lay it out twice.
+		for (int pass = 0; pass < 2; pass++) {
+			std::fill(dir.begin(), dir.end(), 0);
+			dir.resize(2048);
+			pos = 0;
+			u32 dirSize = numSectors * 2048;
+			append(std::string(1, '\0'), true, self ? self : sector, dirSize);
+			append(std::string(1, '\1'), true, parent ? parent : sector, dirSize);
+			for (const Entry &e : entries)
+				append(e.name, e.isDirectory, e.sector, e.size);
+			numSectors = (u32)(dir.size() / 2048);
+		}
+		data_.insert(data_.end(), dir.begin(), dir.end());
+		*sectorOut = sector;
+		return numSectors * 2048;
+	}
+
+	std::vector<u8> Finish(u32 rootSector, u32 rootSize) {
+		u8 *desc = &data_[16 * 2048];
+		desc[0] = 1;
+		memcpy(desc + 1, "CD001", 5);
+		desc[6] = 1;
+		WriteEntry(desc + 156, std::string(1, '\0'), true, rootSector, rootSize);
+		return data_;
+	}
+
+	u32 NumSectors() const { return (u32)(data_.size() / 2048); }
+
+private:
+	static void WriteBoth32(u8 *p, u32 v) {
+		for (int i = 0; i < 4; i++) {
+			p[i] = (u8)(v >> (i * 8));
+			p[7 - i] = (u8)(v >> (i * 8));
+		}
+	}
+
+	static void WriteEntry(u8 *p, const std::string &name, bool isDirectory, u32 sector, u32 size) {
+		size_t len = 33 + name.size();
+		len += len & 1;
+		p[0] = (u8)len;
+		WriteBoth32(p + 2, sector);
+		WriteBoth32(p + 10, size);
+		p[25] = isDirectory ? 2 : 0;
+		p[32] = (u8)name.size();
+		memcpy(p + 33, name.data(), name.size());
+	}
+
+	std::vector<u8> data_;
+};
+
+static const int BIGDIR_FILES = 3000;
+
+static std::vector<u8> BuildTestISO() {
+	TestISOBuilder iso;
+	u32 eboot = iso.AddFile(5000);
+
+	std::vector<TestISOBuilder::Entry> bigEntries;
+	for (int i = 0; i < BIGDIR_FILES; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "FILE%04d.BIN;1", i);
+		bigEntries.push_back({ name, false, eboot, (u32)(i * 3) });
+	}
+
+	// Parents are only used for "..", which lookups skip, so they don't need to be right.
+	u32 cSector, bSector, aSector, bigSector, rootSector;
+	u32 cSize = iso.AddDirectory(0, 0, { { "DEEP.DAT", false, eboot, 1234 } }, &cSector);
+	u32 bSize = iso.AddDirectory(0, 0, { { "C", true, cSector, cSize } }, &bSector);
+	u32 aSize = iso.AddDirectory(0, 0, { { "B", true, bSector, bSize } }, &aSector);
+	u32 bigSize = iso.AddDirectory(0, 0, bigEntries, &bigSector);
+	u32 rootSize = iso.AddDirectory(0, 0, {
+		{ "EBOOT.BIN", false, eboot, 5000 },
+		{ "A", true, aSector, aSize },
+		{ "BIGDIR", true, bigSector, bigSize },
+	}, &rootSector);
+	return iso.Finish(rootSector, rootSize);
+}
+
+static bool CheckLookups(ISOFileSystem &fs) {
+	PSPFileInfo info = fs.GetFileInfo("/EBOOT.BIN");
+	EXPECT_TRUE(info.exists);
+	EXPECT_EQ_INT(info.size, 5000);
+	EXPECT_FALSE(fs.GetFileInfo("/eboot.bin").exists);
+
+	info = fs.GetFileInfo("/A/B/C/DEEP.DAT");
+	EXPECT_TRUE(info.exists);
+	EXPECT_EQ_INT(info.size, 1234);
+	EXPECT_TRUE(fs.GetFileInfo("./A/B/C/DEEP.DAT").exists);
+	EXPECT_TRUE(fs.GetFileInfo("A/B/C/DEEP.DAT").exists);
+	EXPECT_FALSE(fs.GetFileInfo("/A/B/C/MISSING.DAT").exists);
+	EXPECT_FALSE(fs.GetFileInfo("/A/X/C/DEEP.DAT").exists);
+
+	info = fs.GetFileInfo("/A/B/");
+	EXPECT_TRUE(info.exists);
+	EXPECT_EQ_INT(info.type, FILETYPE_DIRECTORY);
+
+	info = fs.GetFileInfo("/BIGDIR/FILE2999.BIN;1");
+	EXPECT_TRUE(info.exists);
+	EXPECT_EQ_INT(info.size, 2999 * 3);
+	info = fs.GetFileInfo("/BIGDIR/FILE0000.BIN;1");
+	EXPECT_TRUE(info.exists);
+	EXPECT_EQ_INT(info.size, 0);
+
+	std::vector<PSPFileInfo> listing = fs.GetDirListing("/BIGDIR");
+	EXPECT_EQ_INT((int)listing.size(), BIGDIR_FILES);
+	return true;
+}
+
+static bool TestISOLazyIndex() {
+	SequentialHandleAllocator handles;
+	ISOFileSystem fs(&handles, new MemoryBlockDevice(BuildTestISO()));
+	const FileSystemLookupStats *stats = fs.LookupStats();
+
+	if (!CheckLookups(fs))
+		return false;
+
+	// Once a directory has been read, its contents don't need a walk.
+	u64 walks = stats->treeWalks;
+	EXPECT_TRUE(fs.GetFileInfo("/BIGDIR/FILE1500.BIN;1").exists);
+	EXPECT_TRUE(fs.GetFileInfo("/A/B/C/DEEP.DAT").exists);
+	EXPECT_EQ_INT((int)(stats->treeWalks - walks), 0);
+	EXPECT_TRUE(stats->indexHits >= 2);
+
+	// Directories read before the scan shouldn't stop it from reaching further down.
+	SequentialHandleAllocator handles2;
+	ISOFileSystem fs2(&handles2, new MemoryBlockDevice(BuildTestISO()));
+	fs2.GetFileInfo("/EBOOT.BIN");
+	fs2.ScanAllDirectories();
+	walks = fs2.LookupStats()->treeWalks;
+	EXPECT_TRUE(fs2.GetFileInfo("/A/B/C/DEEP.DAT").exists);
+	EXPECT_EQ_INT((int)(fs2.LookupStats()->treeWalks - walks), 0);
+	return true;
+}
+
+static bool TestISOScanAllDirectories() {
+	SequentialHandleAllocator handles;
+	ISOFileSystem fs(&handles, new MemoryBlockDevice(BuildTestISO()));
+	fs.ScanAllDirectories();
+	const FileSystemLookupStats *stats = fs.LookupStats();
+	EXPECT_EQ_INT(stats->directoriesRead, 5);
+
+	if (!CheckLookups(fs))
+		return false;
+
+	// Everything that exists was found without walking the tree.
+	EXPECT_EQ_INT((int)(stats->treeWalks - stats->notFound), 0);
+	return true;
+}
+
+static bool TestISOFileBlockDevice() {
+	Path dir = Path("isofstest");
+	File::DeleteDirRecursively(dir);
+	EXPECT_TRUE(File::CreateDir(dir));
+	const std::vector<u8> data = BuildTestISO();
+	const Path path = dir / "test.iso";
+	EXPECT_TRUE(File::WriteDataToFile(false, data.data(), data.size(), path));
+
+	const bool oldMap = g_Config.bMemoryMapIsoFiles;
+	bool success = true;
+	// Mapped where the platform allows, and the plain read path, should behave the same.
+	for (bool map : { true, false }) {
+		g_Config.bMemoryMapIsoFiles = map;
+		LocalFileLoader loader(path);
+		FileBlockDevice *device = new FileBlockDevice(&loader);
+		if (!map && device->GetBlockPointer(0, 1) != nullptr)
+			success = false;
+
+		std::vector<u8> blocks(2048 * 5);
+		success = success && device->ReadBlocks(16, 5, blocks.data());
+		success = success && memcmp(blocks.data(), &data[16 * 2048], blocks.size()) == 0;
+		success = success && !device->ReadBlocks(device->GetNumBlocks() - 1, 2, blocks.data());
+		success = success && !device->ReadBlock(device->GetNumBlocks(), blocks.data());
+
+		SequentialHandleAllocator handles;
+		ISOFileSystem fs(&handles, device);
+		fs.ScanAllDirectories();
+		success = success && CheckLookups(fs);
+
+		// Partial sectors at both ends only need a temporary buffer when the image isn't mapped.
+		const bool mapped = device->GetBlockPointer(0, 1) != nullptr;
+		u32 h = fs.OpenFile("/EBOOT.BIN", FILEACCESS_READ);
+		std::vector<u8> file(4000, 0xCC);
+		fs.SeekFile(h, 100, FILEMOVE_BEGIN);
+		success = success && fs.ReadFile(h, file.data(), (s64)file.size()) == file.size();
+		success = success && file == std::vector<u8>(file.size(), 0);
+		fs.CloseFile(h);
+		const FileSystemReadStats *stats = fs.ReadStats();
+		success = success && stats->reads == 1 && stats->bytesRead == file.size();
+		success = success && stats->bytesCopied == (mapped ? 0 : 2048 - 100 + 4);
+		if (!success)
+			break;
+	}
+	g_Config.bMemoryMapIsoFiles = oldMap;
+
+	File::DeleteDirRecursively(dir);
+	EXPECT_TRUE(success);
+	return true;
+}
+
+static bool TestWriteCISOFile() {
+	Path dir = Path("isofstest");
+	File::DeleteDirRecursively(dir);
+	EXPECT_TRUE(File::CreateDir(dir));
+
+	// The test ISO is mostly zeroes, so add some noise that won't compress, and an odd number of blocks.
+	std::vector<u8> data = BuildTestISO();
+	u32 state = 4321;
+	for (int i = 0; i < 2048 * 7; i++) {
+		state = state * 1664525 + 1013904223;
+		data.push_back((u8)(state >> 24));
+	}
+	data.resize(data.size() + 2048 * 3);
+
+	const Path path = dir / "test.cso";
+	bool success = true;
+	for (u32 frameSize : { 0x800, 0x2000 }) {
+		CISOWriteOptions options;
+		options.frameSize = frameSize;
+		CISOWriteStats stats;
+		std::string error;
+		MemoryBlockDevice source(data);
+		success = WriteCISOFile(&source, path, options, &stats, &error);
+		if (!success) {
+			printf("%s\n", error.c_str());
+			break;
+		}
+		success = stats.inputBytes == data.size() && stats.outputBytes < data.size() / 2 && stats.plainFrames != 0;
+		success = success && (u64)File::GetFileSize(path) == stats.outputBytes;
+
+		LocalFileLoader loader(path);
+		CISOFileBlockDevice *device = new CISOFileBlockDevice(&loader);
+		success = success && device->IsOK() && device->GetNumBlocks() == data.size() / 2048;
+		std::vector<u8> blocks(data.size());
+		success = success && device->ReadBlocks(0, device->GetNumBlocks(), blocks.data()) && blocks == data;
+
+		SequentialHandleAllocator handles;
+		ISOFileSystem fs(&handles, device);
+		success = success && CheckLookups(fs);
+		if (!success)
+			break;
+	}
+
+	// Levels zlib doesn't have are refused up front, rather than storing everything uncompressed.
+	for (int level : { 0, 10, -1 }) {
+		if (!success)
+			break;
+		CISOWriteOptions options;
+		options.level = level;
+		CISOWriteStats stats;
+		std::string error;
+		MemoryBlockDevice source(data);
+		File::Delete(path);
+		success = !WriteCISOFile(&source, path, options, &stats, &error) && !error.empty() && !File::Exists(path);
+	}
+
+	File::DeleteDirRecursively(dir);
+	EXPECT_TRUE(success);
+	return true;
+}
+
+static void BenchmarkISOLookups() {
+	if (!g_threadManager.IsInitialized())
+		g_threadManager.Init(cpu_info.num_cores, cpu_info.logical_cpu_count);
+
+	SequentialHandleAllocator handles;
+	ISOFileSystem fs(&handles, new MemoryBlockDevice(BuildTestISO()));
+	fs.ScanAllDirectories();
+
+	std::vector<std::string> paths;
+	for (int i = 0; i < BIGDIR_FILES; i += 7) {
+		char name[64];
+		snprintf(name, sizeof(name), "/BIGDIR/FILE%04d.BIN;1", i);
+		paths.push_back(name);
+	}
+
+	const int iterations = 50;
+	int found = 0;
+	double start = time_now_d();
+	for (int n = 0; n < iterations; n++) {
+		for (const std::string &path : paths)
+			found += fs.GetFileInfo(path).exists ? 1 : 0;
+	}
+	double elapsed = time_now_d() - start;
+	printf("ISO path lookups: %0.2f us per lookup (%d found)\n", elapsed * 1000000.0 / (double)(iterations * paths.size()), found);
+}
+
+bool TestISOFileSystem() {
+	// The directory scan spreads out parsing over threads.
+	if (!g_threadManager.IsInitialized())
+		g_threadManager.Init(cpu_info.num_cores, cpu_info.logical_cpu_count);
+
+	if (!TestISOLazyIndex())
+		return false;
+	if (!TestISOScanAllDirectories())
+		return false;
+	if (!TestISOFileBlockDevice())
+		return false;
+	if (!TestWriteCISOFile())
+		return false;
+	return true;
+}
+
+// Not part of the default run, only useful when comparing timings by hand.
+bool TestISOFileSystemBenchmark() {
+	BenchmarkISOLookups();
+	return true;
+}
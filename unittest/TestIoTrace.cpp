@@ -0,0 +1,116 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Common/File/FileUtil.h"
+#include "Core/FileSystems/IoTrace.h"
+
+#include "UnitTest.h"
+
+static bool RecordTestIoTrace(const Path &path) {
+	EXPECT_TRUE(IoTrace::Start(path));
+	EXPECT_TRUE(IoTrace::IsRecording());
+	IoTrace::RecordOpen(7, "disc0:/PSP_GAME/USRDIR/DATA.BIN", 1, 7);
+	IoTrace::RecordRead(7, 0, 2048);
+	IoTrace::RecordSeek(7, -16, 2, 0x123456789LL);
+	IoTrace::RecordRead(7, 0x7FFFFFFF, 100);
+	IoTrace::RecordClose(7);
+	IoTrace::Stop();
+	EXPECT_FALSE(IoTrace::IsRecording());
+	return true;
+}
+
+static bool TestIoTraceRoundTrip(const Path &path) {
+	std::vector<IoTrace::Entry> entries;
+	std::string error;
+	EXPECT_TRUE(IoTrace::Load(path, &entries, &error));
+	EXPECT_EQ_INT(entries.size(), 5);
+
+	const IoTraceRecord &open = entries[0].record;
+	EXPECT_EQ_INT(open.op, (u8)IoTraceOp::OPEN);
+	EXPECT_EQ_INT(open.handle, 7);
+	EXPECT_EQ_INT(open.size, 1);
+	EXPECT_EQ_INT(open.result, 7);
+	EXPECT_EQ_STR(entries[0].path, std::string("disc0:/PSP_GAME/USRDIR/DATA.BIN"));
+
+	const IoTraceRecord &read = entries[1].record;
+	EXPECT_EQ_INT(read.op, (u8)IoTraceOp::READ);
+	EXPECT_EQ_INT(read.handle, 7);
+	EXPECT_EQ_INT((s64)read.offset, 0);
+	EXPECT_EQ_INT(read.size, 2048);
+	EXPECT_TRUE(entries[1].path.empty());
+
+	const IoTraceRecord &seek = entries[2].record;
+	EXPECT_EQ_INT(seek.op, (u8)IoTraceOp::SEEK);
+	EXPECT_EQ_INT(seek.whence, 2);
+	EXPECT_EQ_INT((s64)seek.offset, -16);
+	// Positions past 2GB are clamped to fit.
+	EXPECT_EQ_INT(seek.result, 0x7FFFFFFF);
+
+	EXPECT_EQ_INT(entries[3].record.op, (u8)IoTraceOp::READ);
+	EXPECT_EQ_INT((s64)entries[3].record.offset, 0x7FFFFFFF);
+	EXPECT_EQ_INT(entries[3].record.size, 100);
+
+	EXPECT_EQ_INT(entries[4].record.op, (u8)IoTraceOp::CLOSE);
+	EXPECT_EQ_INT(entries[4].record.handle, 7);
+	// Host time only goes forward.
+	for (size_t i = 1; i < entries.size(); ++i)
+		EXPECT_TRUE(entries[i].record.hostTimeUs >= entries[i - 1].record.hostTimeUs);
+	return true;
+}
+
+static bool TestIoTraceTruncated(const Path &path, const Path &cutPath) {
+	std::string data;
+	EXPECT_TRUE(File::ReadBinaryFileToString(path, &data));
+	const size_t openSize = sizeof(IoTraceHeader) + sizeof(IoTraceRecord) + strlen("disc0:/PSP_GAME/USRDIR/DATA.BIN");
+	EXPECT_EQ_INT(data.size(), openSize + 4 * sizeof(IoTraceRecord));
+
+	std::vector<IoTrace::Entry> entries;
+	std::string error;
+
+	// Cut off in the middle of the last record, like after a crash. Everything before it survives.
+	std::string cut = data.substr(0, data.size() - sizeof(IoTraceRecord) / 2);
+	EXPECT_TRUE(File::WriteStringToFile(false, cut, cutPath));
+	EXPECT_TRUE(IoTrace::Load(cutPath, &entries, &error));
+	EXPECT_EQ_INT(entries.size(), 4);
+	EXPECT_EQ_INT(entries[3].record.op, (u8)IoTraceOp::READ);
+
+	// Cut inside the path of the open, so not even that one is complete.
+	cut = data.substr(0, openSize - 4);
+	EXPECT_TRUE(File::WriteStringToFile(false, cut, cutPath));
+	EXPECT_TRUE(IoTrace::Load(cutPath, &entries, &error));
+	EXPECT_EQ_INT(entries.size(), 0);
+
+	// Just the header is an empty trace.
+	cut = data.substr(0, sizeof(IoTraceHeader));
+	EXPECT_TRUE(File::WriteStringToFile(false, cut, cutPath));
+	EXPECT_TRUE(IoTrace::Load(cutPath, &entries, &error));
+	EXPECT_EQ_INT(entries.size(), 0);
+
+	// Not even that, or not a trace at all.
+	cut = data.substr(0, sizeof(IoTraceHeader) - 1);
+	EXPECT_TRUE(File::WriteStringToFile(false, cut, cutPath));
+	EXPECT_FALSE(IoTrace::Load(cutPath, &entries, &error));
+	cut = data;
+	cut[0] = 'X';
+	EXPECT_TRUE(File::WriteStringToFile(false, cut, cutPath));
+	EXPECT_FALSE(IoTrace::Load(cutPath, &entries, &error));
+	EXPECT_FALSE(IoTrace::Load(cutPath / "missing", &entries, &error));
+	return true;
+}
+
+bool TestIoTrace() {
+	Path dir = Path("iotracetest");
+	File::DeleteDirRecursively(dir);
+	EXPECT_TRUE(File::CreateDir(dir));
+	const Path path = dir / "test.iotrace";
+
+	bool success = RecordTestIoTrace(path);
+	if (success)
+		success = TestIoTraceRoundTrip(path);
+	if (success)
+		success = TestIoTraceTruncated(path, dir / "cut.iotrace");
+
+	File::DeleteDirRecursively(dir);
+	return success;
+}
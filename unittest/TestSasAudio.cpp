@@ -0,0 +1,409 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/CPUDetect.h"
+#include "Common/TimeUtil.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Core/Debugger/Breakpoints.h"
+#include "Core/HW/SasAudio.h"
+#include "Core/MemMap.h"
+#include "Core/MIPS/MIPS.h"
+#include "Core/Util/AudioFormat.h"
+
+#include "UnitTest.h"
+
+// Deterministic, so failures are reproducible.
+static u32 SasTestRandom(u32 &state) {
+	state = state * 1664525 + 1013904223;
+	return state >> 8;
+}
+
+struct SasTestVoice {
+	std::vector<s16> source;
+	std::vector<int> envelope;
+	u32 sampleFrac;
+	int pitch;
+	int volumeLeft;
+	int volumeRight;
+	int effectLeft;
+	int effectRight;
+};
+
+// The per-sample loop SasInstance::MixVoice used before it was split into passes, kept as the reference.
+static u32 ReferenceMixVoice(const SasTestVoice &voice, int *mixBuffer, int *sendBuffer, int grainSize) {
+	u32 sampleFrac = voice.sampleFrac;
+	const int voicePitch = voice.pitch;
+	const bool needsInterp = voicePitch != PSP_SAS_PITCH_BASE || (sampleFrac & PSP_SAS_PITCH_MASK) != 0;
+	for (int i = 0; i < grainSize; i++) {
+		const int16_t *s = voice.source.data() + (sampleFrac >> PSP_SAS_PITCH_BASE_SHIFT);
+
+		int sample = s[0];
+		if (needsInterp) {
+			int f = sampleFrac & PSP_SAS_PITCH_MASK;
+			sample = (s[0] * (PSP_SAS_PITCH_MASK - f) + s[1] * f) >> PSP_SAS_PITCH_BASE_SHIFT;
+		}
+		sampleFrac += voicePitch;
+
+		int envelopeValue = voice.envelope[i];
+		sample = ((sample * envelopeValue) + (1 << 14)) >> 15;
+
+		mixBuffer[i * 2] += (sample * voice.volumeLeft) >> 12;
+		mixBuffer[i * 2 + 1] += (sample * voice.volumeRight) >> 12;
+		sendBuffer[i * 2] += sample * voice.effectLeft >> 12;
+		sendBuffer[i * 2 + 1] += sample * voice.effectRight >> 12;
+	}
+	return sampleFrac;
+}
+
+static u32 OptimizedMixVoice(const SasTestVoice &voice, int *mixBuffer, int *sendBuffer, s16 *resampled, int grainSize) {
+	u32 sampleFrac = SasResample(resampled, voice.source.data(), voice.sampleFrac, voice.pitch, grainSize);
+	SasMixSamples(mixBuffer, sendBuffer, resampled, voice.envelope.data(), grainSize, voice.volumeLeft, voice.volumeRight, voice.effectLeft, voice.effectRight);
+	return sampleFrac;
+}
+
+static void MakeSasTestVoices(std::vector<SasTestVoice> &voices, int grainSize, u32 seed) {
+	// The special cased pitches, plus some that go through the generic path.
+	static const int pitches[] = {
+		PSP_SAS_PITCH_BASE, PSP_SAS_PITCH_BASE, PSP_SAS_PITCH_BASE * 2, PSP_SAS_PITCH_BASE / 2,
+		PSP_SAS_PITCH_MAX, 0x0C00, 0x1234, 0x0001,
+	};
+
+	u32 state = seed;
+	voices.resize(PSP_SAS_VOICES_MAX);
+	for (int v = 0; v < PSP_SAS_VOICES_MAX; v++) {
+		SasTestVoice &voice = voices[v];
+		voice.pitch = pitches[v % ARRAY_SIZE(pitches)];
+		// Every other unity pitch voice starts exactly on a sample, taking the no interpolation path.
+		voice.sampleFrac = (v % ARRAY_SIZE(pitches)) == 0 ? (SasTestRandom(state) & 3) << PSP_SAS_PITCH_BASE_SHIFT : SasTestRandom(state) & 0x3FFF;
+
+		// Including extremes, which is where clamping or overflow differences would show.
+		voice.source.resize(grainSize * 4 + 16);
+		for (auto &s : voice.source) {
+			u32 r = SasTestRandom(state);
+			s = (r & 0xF) == 0 ? -32768 : ((r & 0xF) == 1 ? 32767 : (s16)r);
+		}
+
+		voice.envelope.resize(grainSize);
+		for (int i = 0; i < grainSize; i++) {
+			u32 r = SasTestRandom(state);
+			int height = (r & 7) == 0 ? PSP_SAS_ENVELOPE_HEIGHT_MAX : (int)(r & (PSP_SAS_ENVELOPE_HEIGHT_MAX - 1));
+			voice.envelope[i] = (height + (1 << 14)) >> 15;
+		}
+
+		auto randomVolume = [&]() {
+			u32 r = SasTestRandom(state);
+			if ((r & 7) == 0)
+				return (r & 8) ? PSP_SAS_VOL_MAX : -PSP_SAS_VOL_MAX;
+			return (int)(r % (PSP_SAS_VOL_MAX * 2 + 1)) - PSP_SAS_VOL_MAX;
+		};
+		voice.volumeLeft = randomVolume();
+		voice.volumeRight = randomVolume();
+		voice.effectLeft = randomVolume();
+		voice.effectRight = randomVolume();
+	}
+}
+
+static bool TestSasMixVoices() {
+	// Odd sizes check the scalar tails.
+	static const int grainSizes[] = { 64, 256, 1023, PSP_SAS_MAX_GRAIN };
+	for (int grainSize : grainSizes) {
+		std::vector<SasTestVoice> voices;
+		MakeSasTestVoices(voices, grainSize, 1234 + grainSize);
+
+		std::vector<int> refMix(grainSize * 2), refSend(grainSize * 2);
+		std::vector<int> mix(grainSize * 2), send(grainSize * 2);
+		std::vector<s16> resampled(grainSize);
+		for (int v = 0; v < PSP_SAS_VOICES_MAX; v++) {
+			u32 refFrac = ReferenceMixVoice(voices[v], refMix.data(), refSend.data(), grainSize);
+			u32 frac = OptimizedMixVoice(voices[v], mix.data(), send.data(), resampled.data(), grainSize);
+			EXPECT_EQ_INT(frac, refFrac);
+		}
+		for (int i = 0; i < grainSize * 2; i++) {
+			EXPECT_EQ_INT(mix[i], refMix[i]);
+			EXPECT_EQ_INT(send[i], refSend[i]);
+		}
+	}
+	return true;
+}
+
+static bool TestSasWriteMixedOutput() {
+	const int grainSize = 255;
+	SasInstance sas;
+	sas.SetGrainSize(grainSize);
+	sas.waveformEffect.isDryOn = 1;
+	sas.waveformEffect.isWetOn = 0;
+
+	u32 state = 42;
+	for (int i = 0; i < grainSize * 2; i++) {
+		sas.mixBuffer[i] = (int)SasTestRandom(state) - (1 << 23);
+	}
+	std::vector<s16> out(grainSize * 2);
+	sas.WriteMixedOutput(out.data(), nullptr, 0, 0);
+	for (int i = 0; i < grainSize * 2; i++) {
+		EXPECT_EQ_INT(out[i], clamp_s16(sas.mixBuffer[i]));
+	}
+	return true;
+}
+
+static void SetupSasTestVoices(SasInstance &sas, int grainSize, u32 baseAddr) {
+	sas.SetGrainSize(grainSize);
+	u32 state = 99;
+	for (int v = 0; v < PSP_SAS_VOICES_MAX; v++) {
+		SasVoice &voice = sas.voices[v];
+		const u32 addr = baseAddr + v * 0x8000;
+		u8 *data = Memory::GetPointerWriteUnchecked(addr);
+		if (v % 3 == 0) {
+			voice.type = VOICETYPE_PCM;
+			voice.pcmAddr = addr;
+			voice.pcmSize = 0x2000;
+			voice.pcmLoopPos = 0x100;
+			voice.loop = true;
+			for (int i = 0; i < 0x4000; i++)
+				data[i] = (u8)SasTestRandom(state);
+		} else {
+			voice.type = VOICETYPE_VAG;
+			voice.vagAddr = addr;
+			voice.vagSize = 0x8000;
+			voice.loop = (v & 1) != 0;
+			for (int b = 0; b < 0x800; b++) {
+				u8 *block = &data[b * 16];
+				block[0] = (u8)(((SasTestRandom(state) % 5) << 4) | (SasTestRandom(state) % 13));
+				// A loop start early, a loop end later, and the end of data.
+				block[1] = b == 0x7FF ? 7 : (b == 3 ? 6 : (b == 0x700 ? 3 : 0));
+				for (int i = 2; i < 16; i++)
+					block[i] = (u8)SasTestRandom(state);
+			}
+		}
+		static const int pitches[] = { 0x1000, 0x2000, 0x800, 0x1234, 0x4000, 0x0C00 };
+		voice.pitch = pitches[v % ARRAY_SIZE(pitches)];
+		voice.volumeLeft = (int)(SasTestRandom(state) % 0x2001) - 0x1000;
+		voice.volumeRight = (int)(SasTestRandom(state) % 0x2001) - 0x1000;
+		voice.effectLeft = (int)(SasTestRandom(state) % 0x2001) - 0x1000;
+		voice.effectRight = (int)(SasTestRandom(state) % 0x2001) - 0x1000;
+		voice.envelope.SetSimpleEnvelope(0x000F, 0x1FC0 | (v & 7));
+		voice.KeyOn();
+	}
+}
+
+// Decoding voices on worker threads has to give the same output, and report the same reads, as mixing one by one.
+static bool TestSasParallelMix() {
+	if (!g_threadManager.IsInitialized())
+		g_threadManager.Init(cpu_info.num_cores, cpu_info.logical_cpu_count);
+	MIPSState *oldMIPS = currentMIPS;
+	currentMIPS = &mipsr4k;
+	Memory::g_MemorySize = Memory::RAM_NORMAL_SIZE;
+	EXPECT_TRUE(Memory::Init());
+
+	const u32 baseAddr = 0x08800000;
+	const u32 dataSize = PSP_SAS_VOICES_MAX * 0x8000;
+	bool success = true;
+	for (int grainSize : { 64, 256, 1024 }) {
+		SasInstance *serial = new SasInstance();
+		SasInstance *parallel = new SasInstance();
+		SetupSasTestVoices(*serial, grainSize, baseAddr);
+		SetupSasTestVoices(*parallel, grainSize, baseAddr);
+
+		for (int grain = 0; grain < 100 && success; grain++) {
+			if (grain == 60) {
+				for (int v = 0; v < PSP_SAS_VOICES_MAX; v += 5) {
+					serial->voices[v].KeyOff();
+					parallel->voices[v].KeyOff();
+				}
+			}
+
+			int voiceIndices[PSP_SAS_VOICES_MAX];
+			int numVoices = 0;
+			for (int v = 0; v < PSP_SAS_VOICES_MAX; v++) {
+				if (serial->voices[v].playing)
+					voiceIndices[numVoices++] = v;
+			}
+
+			// The memcheck counts every read that got reported.
+			g_breakpoints.AddMemCheck(baseAddr, baseAddr + dataSize, MEMCHECK_READ, BREAK_ACTION_IGNORE);
+			for (int i = 0; i < numVoices; i++)
+				serial->MixVoice(serial->voices[voiceIndices[i]]);
+			MemCheck check;
+			g_breakpoints.GetMemCheck(baseAddr, baseAddr + dataSize, &check);
+			const u32 serialHits = check.numHits;
+			g_breakpoints.RemoveMemCheck(baseAddr, baseAddr + dataSize);
+
+			g_breakpoints.AddMemCheck(baseAddr, baseAddr + dataSize, MEMCHECK_READ, BREAK_ACTION_IGNORE);
+			parallel->MixVoicesParallel(voiceIndices, numVoices);
+			g_breakpoints.GetMemCheck(baseAddr, baseAddr + dataSize, &check);
+			const u32 parallelHits = check.numHits;
+			g_breakpoints.RemoveMemCheck(baseAddr, baseAddr + dataSize);
+
+			success = serialHits == parallelHits && (numVoices == 0 || serialHits != 0);
+			success = success && memcmp(serial->mixBuffer, parallel->mixBuffer, grainSize * 2 * sizeof(int)) == 0;
+			success = success && memcmp(serial->sendBuffer, parallel->sendBuffer, grainSize * 2 * sizeof(int)) == 0;
+			for (int v = 0; v < PSP_SAS_VOICES_MAX; v++)
+				success = success && serial->voices[v].playing == parallel->voices[v].playing;
+			if (!success)
+				printf("SAS parallel mix mismatch: grain size %d, grain %d, %d voices, %d vs %d reads\n", grainSize, grain, numVoices, serialHits, parallelHits);
+
+			memset(serial->mixBuffer, 0, grainSize * 2 * sizeof(int));
+			memset(serial->sendBuffer, 0, grainSize * 2 * sizeof(int));
+			memset(parallel->mixBuffer, 0, grainSize * 2 * sizeof(int));
+			memset(parallel->sendBuffer, 0, grainSize * 2 * sizeof(int));
+		}
+		delete serial;
+		delete parallel;
+	}
+
+	Memory::Shutdown();
+	currentMIPS = oldMIPS;
+	return success;
+}
+
+static void BenchmarkSasMix() {
+	const int grainSize = 256;
+	const int iterations = 2000;
+	std::vector<SasTestVoice> voices;
+	MakeSasTestVoices(voices, grainSize, 5678);
+
+	std::vector<int> mix(grainSize * 2), send(grainSize * 2);
+	std::vector<s16> resampled(grainSize);
+
+	double start = time_now_d();
+	for (int n = 0; n < iterations; n++) {
+		for (int v = 0; v < PSP_SAS_VOICES_MAX; v++)
+			ReferenceMixVoice(voices[v], mix.data(), send.data(), grainSize);
+	}
+	double reference = time_now_d() - start;
+
+	start = time_now_d();
+	for (int n = 0; n < iterations; n++) {
+		for (int v = 0; v < PSP_SAS_VOICES_MAX; v++)
+			OptimizedMixVoice(voices[v], mix.data(), send.data(), resampled.data(), grainSize);
+	}
+	double optimized = time_now_d() - start;
+
+	printf("SAS mix: %d voices x %d grains of %d: scalar %0.2f ms, optimized %0.2f ms (%0.2fx)\n",
+		PSP_SAS_VOICES_MAX, iterations, grainSize, reference * 1000.0, optimized * 1000.0, optimized > 0.0 ? reference / optimized : 0.0);
+}
+
+// The block decoder from before unpacking was split from prediction, kept as the reference.
+static void ReferenceDecodeVagBlock(const u8 *readp, s16 *samples, int &s_1, int &s_2) {
+	static const u8 f[16][2] = {
+		{ 0, 0 }, { 60, 0 }, { 115, 52 }, { 98, 55 }, { 122, 60 }, { 0, 0 }, { 0, 0 }, { 52, 0 },
+		{ 55, 2 }, { 60, 125 }, { 0, 0 }, { 0, 91 }, { 0, 0 }, { 2, 216 }, { 125, 6 }, { 0, 151 },
+	};
+	int predict_nr = *readp++;
+	int shift_factor = predict_nr & 0xf;
+	predict_nr >>= 4;
+	readp++;
+
+	int s1 = s_1;
+	int s2 = s_2;
+	int coef1 = f[predict_nr][0];
+	int coef2 = -f[predict_nr][1];
+	for (int i = 0; i < 28; i += 2) {
+		u8 d = *readp++;
+		int sample1 = (short)((d & 0xf) << 12) >> shift_factor;
+		int sample2 = (short)((d & 0xf0) << 8) >> shift_factor;
+		s2 = clamp_s16(sample1 + ((s1 * coef1 + s2 * coef2) >> 6));
+		s1 = clamp_s16(sample2 + ((s2 * coef1 + s1 * coef2) >> 6));
+		samples[i] = s2;
+		samples[i + 1] = s1;
+	}
+	s_1 = s1;
+	s_2 = s2;
+}
+
+static void MakeVagCorpus(std::vector<u8> &data, int numBlocks, u32 seed) {
+	u32 state = seed;
+	data.resize(numBlocks * 16);
+	for (int b = 0; b < numBlocks; b++) {
+		u8 *block = &data[b * 16];
+		// Mostly the usual filters and shifts (real encoders rarely need the full range), but any value is valid input.
+		u32 r = SasTestRandom(state);
+		int predict = (r & 0x30) == 0 ? (r >> 8) & 15 : (r >> 8) % 5;
+		int shift = (r & 0xC0) == 0 ? (r >> 12) & 15 : 4 + (r >> 12) % 9;
+		block[0] = (u8)((predict << 4) | shift);
+		// Loop start and end markers, but no end of data flag until the very end.
+		static const u8 flags[] = { 0, 0, 0, 0, 1, 2, 3, 6 };
+		block[1] = b == numBlocks - 1 ? 7 : flags[(r >> 16) & 7];
+		for (int i = 2; i < 16; i++)
+			block[i] = (u8)SasTestRandom(state);
+	}
+}
+
+static bool TestVagDecodeBlock() {
+	const int numBlocks = 65536;
+	std::vector<u8> corpus;
+	MakeVagCorpus(corpus, numBlocks, 777);
+
+	// The last block is the end marker, so it's not decoded.
+	std::vector<s16> expected((numBlocks - 1) * 28);
+	int s_1 = 0, s_2 = 0;
+	for (int b = 0; b < numBlocks - 1; b++)
+		ReferenceDecodeVagBlock(&corpus[b * 16], &expected[b * 28], s_1, s_2);
+
+	std::vector<s16> decoded((numBlocks - 1) * 28);
+	VagDecoder vag;
+	vag.Start(0, numBlocks * 16, false);
+	const u8 *readp = corpus.data();
+	for (int b = 0; b < numBlocks - 1; b++) {
+		vag.DecodeBlock(readp, &decoded[b * 28]);
+		EXPECT_FALSE(vag.End());
+	}
+	EXPECT_TRUE(readp == corpus.data() + (numBlocks - 1) * 16);
+	s16 tail[28];
+	vag.DecodeBlock(readp, tail);
+	EXPECT_TRUE(vag.End());
+
+	for (size_t i = 0; i < decoded.size(); i++) {
+		EXPECT_EQ_INT(decoded[i], expected[i]);
+	}
+	return true;
+}
+
+static void BenchmarkVagDecode() {
+	const int numBlocks = 65536;
+	const int iterations = 20;
+	std::vector<u8> corpus;
+	MakeVagCorpus(corpus, numBlocks, 888);
+	s16 out[28];
+
+	double start = time_now_d();
+	for (int n = 0; n < iterations; n++) {
+		int s_1 = 0, s_2 = 0;
+		for (int b = 0; b < numBlocks - 1; b++)
+			ReferenceDecodeVagBlock(&corpus[b * 16], out, s_1, s_2);
+	}
+	double reference = time_now_d() - start;
+
+	start = time_now_d();
+	for (int n = 0; n < iterations; n++) {
+		VagDecoder vag;
+		vag.Start(0, numBlocks * 16, false);
+		const u8 *readp = corpus.data();
+		for (int b = 0; b < numBlocks - 1; b++)
+			vag.DecodeBlock(readp, out);
+	}
+	double optimized = time_now_d() - start;
+
+	double megabytes = (double)numBlocks * 16 * iterations / (1024.0 * 1024.0);
+	printf("VAG decode: scalar %0.1f MB/s, optimized %0.1f MB/s\n", megabytes / reference, megabytes / optimized);
+}
+
+bool TestSasAudio() {
+	if (!TestVagDecodeBlock())
+		return false;
+	if (!TestSasMixVoices())
+		return false;
+	if (!TestSasWriteMixedOutput())
+		return false;
+	if (!TestSasParallelMix())
+		return false;
+	return true;
+}
+
+// Not part of the default run, timings are only interesting when comparing by hand.
+bool TestSasAudioBenchmark() {
+	BenchmarkVagDecode();
+	BenchmarkSasMix();
+	return true;
+}
@@ -1,8 +1,12 @@
+#include <atomic>
+#include <cstring>
 #include <thread>
 #include <vector>
 
 #include "Common/Log.h"
+#include "Common/File/VFS/PackFileReader.h"
 #include "Common/File/VFS/ZipFileReader.h"
+#include "Common/File/FileUtil.h"
 
 #include "UnitTest.h"
 
@@ -82,13 +86,114 @@ bool TestZipFile() {
 	EXPECT_TRUE(dir->GetFileListing("b", &listing, nullptr));
 	EXPECT_TRUE(CheckContainsFile(listing, "in_b.txt"));
 	EXPECT_EQ_INT(listing.size(), 1);
+	EXPECT_FALSE(dir->GetFileListing("c", &listing, nullptr));
+
+	// Lookups ignore case.
+	File::FileInfo info{};
+	EXPECT_TRUE(dir->GetFileInfo("A/IN_A.TXT", &info));
+	EXPECT_FALSE(info.isDirectory);
+	EXPECT_FALSE(dir->GetFileInfo("a/missing.txt", &info));
+
+	// Reads can happen on several threads at once.
+	size_t bigSize = 0;
+	uint8_t *big = dir->ReadFile("big.txt", &bigSize);
+	EXPECT_TRUE(big != nullptr);
+	EXPECT_TRUE(dir->GetFileInfo("big.txt", &info));
+	EXPECT_EQ_INT(info.size, bigSize);
+	std::atomic<int> failures{};
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; t++) {
+		threads.emplace_back([&]() {
+			for (int i = 0; i < 20; i++) {
+				size_t size = 0;
+				uint8_t *data = dir->ReadFile("big.txt", &size);
+				if (!data || size != bigSize || memcmp(data, big, size) != 0)
+					failures++;
+				delete[] data;
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	delete[] big;
+	EXPECT_EQ_INT(failures, 0);
 	delete dir;
 
 	return true;
 }
 
+bool TestPackFile() {
+	Path srcDir = Path("packtest");
+	Path packPath = srcDir / "test.pak";
+	File::DeleteDirRecursively(srcDir);
+	EXPECT_TRUE(File::CreateDir(srcDir));
+	EXPECT_TRUE(File::CreateDir(srcDir / "sub"));
+	EXPECT_TRUE(File::WriteStringToFile(false, "hello", srcDir / "0000000012345678.png"));
+	EXPECT_TRUE(File::WriteStringToFile(false, "", srcDir / "empty.txt"));
+	EXPECT_TRUE(File::WriteStringToFile(false, "in sub", srcDir / "sub" / "Mixed.Case"));
+
+	std::string error;
+	EXPECT_TRUE(CreatePackFile(srcDir, packPath, &error));
+
+	PackFileReader *pack = PackFileReader::Create(packPath, true);
+	EXPECT_TRUE(pack != nullptr);
+
+	std::vector<File::FileInfo> listing;
+	EXPECT_TRUE(pack->GetFileListing("", &listing, nullptr));
+	EXPECT_EQ_INT(listing.size(), 3);
+	EXPECT_TRUE(CheckContainsFile(listing, "0000000012345678.png"));
+	EXPECT_TRUE(CheckContainsFile(listing, "empty.txt"));
+	EXPECT_TRUE(CheckContainsDir(listing, "sub"));
+	EXPECT_TRUE(pack->GetFileListing("", &listing, "png"));
+	EXPECT_EQ_INT(listing.size(), 2);
+
+	// Lookups are case insensitive, like in zips.
+	size_t size = 0;
+	uint8_t *data = pack->ReadFile("SUB/mixed.case", &size);
+	EXPECT_TRUE(data != nullptr);
+	EXPECT_EQ_INT(size, 6);
+	EXPECT_EQ_INT(memcmp(data, "in sub", 6), 0);
+	delete[] data;
+	EXPECT_TRUE(pack->GetFile("missing.png") == nullptr);
+
+	VFSFileReference *ref = pack->GetFile("0000000012345678.png");
+	EXPECT_TRUE(ref != nullptr);
+	VFSOpenFile *openFile = pack->OpenFileForRead(ref, &size);
+	EXPECT_EQ_INT(size, 5);
+	char buf[8]{};
+	EXPECT_EQ_INT(pack->Read(openFile, buf, 3), 3);
+	EXPECT_EQ_INT(pack->Read(openFile, buf + 3, 8), 2);
+	EXPECT_EQ_INT(memcmp(buf, "hello", 5), 0);
+	EXPECT_EQ_INT(memcmp(pack->GetMappedData(openFile), "hello", 5), 0);
+	pack->CloseFile(openFile);
+	pack->ReleaseFile(ref);
+	delete pack;
+
+	// Packing again replaces the old pack as a whole.
+	EXPECT_TRUE(File::WriteStringToFile(false, "new", srcDir / "new.txt"));
+	size_t progressDone = 0, progressTotal = 0;
+	EXPECT_TRUE(CreatePackFile(srcDir, packPath, &error, nullptr, [&](size_t done, size_t total) {
+		progressDone = done;
+		progressTotal = total;
+	}));
+	EXPECT_EQ_INT(progressDone, 4);
+	EXPECT_EQ_INT(progressTotal, 4);
+	EXPECT_FALSE(File::Exists(packPath.WithExtraExtension(".tmp")));
+	pack = PackFileReader::Create(packPath, true);
+	EXPECT_TRUE(pack != nullptr);
+	EXPECT_TRUE(pack->GetFileListing("", &listing, nullptr));
+	EXPECT_EQ_INT(listing.size(), 4);
+	delete pack;
+
+	File::DeleteDirRecursively(srcDir);
+	return true;
+}
+
 bool TestVFS() {
 	if (!TestZipFile())
 		return false;
+	if (!TestPackFile())
+		return false;
 	return true;
 }
@@ -38,6 +38,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <functional>
 #include <vector>
 #include <string>
 #include <sstream>
@@ -46,10 +47,13 @@
 #include <jni.h>
 #endif
 
+#include "ext/xxhash.h"
+
 #include "Common/Data/Collections/TinySet.h"
 #include "Common/Data/Collections/FastVec.h"
 #include "Common/Data/Collections/CharQueue.h"
 #include "Common/Data/Convert/SmallDataConvert.h"
+#include "Common/Data/Random/Rng.h"
 #include "Common/Data/Text/Parsers.h"
 #include "Common/Data/Text/WrapText.h"
 #include "Common/Data/Encoding/Utf8.h"
@@ -70,6 +74,7 @@
 #include "Common/System/System.h"
 #include "Common/Thread/ThreadUtil.h"
 #include "Common/Data/Format/IniFile.h"
+#include "Common/Data/Hash/WideHash.h"
 #include "Common/TimeUtil.h"
 
 #include "Common/ArmEmitter.h"
@@ -83,6 +88,7 @@
 #include "Common/File/VFS/DirectoryReader.h"
 #include "Core/FileSystems/ISOFileSystem.h"
 #include "Core/MemMap.h"
+#include "Core/MemWriteTracker.h"
 #include "Core/KeyMap.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
 #include "GPU/Common/TextureDecoder.h"
@@ -627,6 +633,81 @@ bool TestQuickTexHash() {
 	return true;
 }
 
+static const hash::WideHashBackend wideHashBackends[] = {
+	hash::WideHashBackend::DEFAULT,
+	hash::WideHashBackend::AVX2,
+};
+
+static void FillWideHashTestData(u8 *p, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		p[i] = (u8)(i * 7 + (i >> 9));
+	}
+}
+
+static bool TestWideHash() {
+	static const size_t BUF_SIZE = 1024 * 1024;
+	AlignedMem buf(BUF_SIZE, 16);
+	u8 *p = (u8 *)(char *)buf;
+	FillWideHashTestData(p, BUF_SIZE);
+
+	// All backends must produce the exact same values, since these end up in texture replacement packs.
+	for (auto backend : wideHashBackends) {
+		if (!hash::WideHashBackendSupported(backend))
+			continue;
+		hash::SetWideHashBackend(backend);
+		EXPECT_EQ_INT(hash::WideHash64(p, BUF_SIZE), 0xf041a2ac5c4b8e22ULL);
+		EXPECT_EQ_INT(hash::WideHash64(p, 1000), 0x94c1659c8f6e39f4ULL);
+	}
+
+	hash::SetWideHashBackend(hash::WideHashBackend::AUTO);
+	return true;
+}
+
+// Compares against the other hashes the texture cache can use. Only run when asked for.
+static bool TestWideHashBenchmark() {
+	static const size_t BUF_SIZE = 1024 * 1024;
+	AlignedMem buf(BUF_SIZE, 16);
+	u8 *p = (u8 *)(char *)buf;
+	FillWideHashTestData(p, BUF_SIZE);
+
+	auto bench = [&](const char *name, size_t size, const std::function<u64(const u8 *, size_t)> &func) {
+		int total = 0;
+		u64 sum = 0;
+		double st = time_now_d();
+		do {
+			for (int j = 0; j < 16; ++j) {
+				sum += func(p, size);
+				++total;
+			}
+		} while (time_now_d() - st < 0.05);
+		double elapsed = time_now_d() - st;
+		printf("%-12s %8d bytes: %8.1f MB/s (%llx)\n", name, (int)size, (double)size * total / elapsed / (1024.0 * 1024.0), (unsigned long long)(sum & 0xF));
+	};
+
+	for (size_t size = 64; size <= BUF_SIZE; size *= 4) {
+		for (auto backend : wideHashBackends) {
+			if (!hash::WideHashBackendSupported(backend))
+				continue;
+			hash::SetWideHashBackend(backend);
+			bench(hash::WideHashBackendToString(backend), size, [](const u8 *data, size_t sz) -> u64 {
+				return hash::WideHash64(data, sz);
+			});
+		}
+		bench("quicktexhash", size, [](const u8 *data, size_t sz) -> u64 {
+			return StableQuickTexHash(data, (u32)sz);
+		});
+		bench("xxh32", size, [](const u8 *data, size_t sz) -> u64 {
+			return XXH32(data, sz, 0xBACD7814);
+		});
+		bench("xxh64", size, [](const u8 *data, size_t sz) -> u64 {
+			return XXH64(data, sz, 0xBACD7814);
+		});
+	}
+
+	hash::SetWideHashBackend(hash::WideHashBackend::AUTO);
+	return true;
+}
+
 bool TestCLZ() {
 	static const uint32_t input[] = {
 		0xFFFFFFFF,
@@ -650,6 +731,36 @@ bool TestCLZ() {
 	return true;
 }
 
+static bool TestMemWriteTracker() {
+	Memory::WriteTracker_SetEnabled(true);
+	Memory::WriteTracker_Reset();
+	uint32_t seq = Memory::WriteTracker_CurrentSeq();
+	EXPECT_FALSE(Memory::WriteTracker_WrittenSince(0x08800000, 0x10000, seq));
+	// Untracked areas are always considered written.
+	EXPECT_TRUE(Memory::WriteTracker_WrittenSince(0x04000000, 0x1000, seq));
+
+	Memory::WriteTracker_Notify(0x48810004, 4);
+	EXPECT_TRUE(Memory::WriteTracker_WrittenSince(0x08800000, 0x10008, seq));
+	EXPECT_TRUE(Memory::WriteTracker_WrittenSince(0x08810000, 0x1000, seq));
+	EXPECT_FALSE(Memory::WriteTracker_WrittenSince(0x08800000, 0x10000, seq));
+	EXPECT_FALSE(Memory::WriteTracker_WrittenSince(0x08811000, 0x1000, seq));
+
+	seq = Memory::WriteTracker_CurrentSeq();
+	EXPECT_FALSE(Memory::WriteTracker_WrittenSince(0x08810000, 0x1000, seq));
+	Memory::WriteTracker_Reset();
+	EXPECT_TRUE(Memory::WriteTracker_WrittenSince(0x08810000, 0x1000, seq));
+
+	// While off, writes aren't tracked, so turning it back on counts everything as written.
+	Memory::WriteTracker_SetEnabled(false);
+	seq = Memory::WriteTracker_CurrentSeq();
+	Memory::WriteTracker_Notify(0x08820000, 4);
+	EXPECT_FALSE(Memory::WriteTracker_WrittenSince(0x08820000, 0x1000, seq));
+	Memory::WriteTracker_SetEnabled(true);
+	EXPECT_TRUE(Memory::WriteTracker_WrittenSince(0x08830000, 0x1000, seq));
+	Memory::WriteTracker_SetEnabled(false);
+	return true;
+}
+
 static bool TestMemMap() {
 	Memory::g_MemorySize = Memory::RAM_DOUBLE_SIZE;
 
@@ -1043,6 +1154,102 @@ bool TestColorConv() {
 	return true;
 }
 
+// Floating point BT.601, limited range, which is what the video decoder's conversion approximates.
+static u32 ReferenceYUVToRGBA8888(u8 y, u8 u, u8 v) {
+	float yf = 1.164f * (y - 16);
+	float r = yf + 1.596f * (v - 128);
+	float g = yf - 0.391f * (u - 128) - 0.813f * (v - 128);
+	float b = yf + 2.018f * (u - 128);
+	auto toByte = [](float c) -> u32 {
+		return (u32)std::clamp((int)floorf(c + 0.5f), 0, 255);
+	};
+	return toByte(r) | (toByte(g) << 8) | (toByte(b) << 16);
+}
+
+// Throughput of each output format against the scalar reference. Only run when asked for.
+static bool TestYUVConvBenchmark() {
+	// A full PSP sized video frame.
+	const int width = 480, height = 272;
+	std::vector<u32> out(width);
+
+	u8 y[width], u[width / 2], v[width / 2];
+	GMRng rng;
+	for (int i = 0; i < width; i++)
+		y[i] = rng.R32();
+	for (int i = 0; i < width / 2; i++) {
+		u[i] = rng.R32();
+		v[i] = rng.R32();
+	}
+
+	auto bench = [&](const char *name, const std::function<void(int row)> &func) {
+		int frames = 0;
+		double st = time_now_d();
+		do {
+			for (int row = 0; row < height; row++)
+				func(row);
+			frames++;
+		} while (time_now_d() - st < 0.05);
+		double elapsed = time_now_d() - st;
+		printf("YUV420 %-10s %dx%d: %8.1f frames/s\n", name, width, height, frames / elapsed);
+	};
+
+	// Every row converts the same input, it's only the throughput that matters.
+	bench("reference", [&](int row) {
+		for (int x = 0; x < width; x++)
+			out[x] = ReferenceYUVToRGBA8888(y[x], u[x / 2], v[x / 2]);
+	});
+	bench("RGBA8888", [&](int row) { ConvertYUV420ToRGBA8888(out.data(), y, u, v, width); });
+	bench("RGB565", [&](int row) { ConvertYUV420ToRGB565((u16 *)out.data(), y, u, v, width); });
+	bench("RGBA5551", [&](int row) { ConvertYUV420ToRGBA5551((u16 *)out.data(), y, u, v, width); });
+	bench("RGBA4444", [&](int row) { ConvertYUV420ToRGBA4444((u16 *)out.data(), y, u, v, width); });
+	return true;
+}
+
+bool TestYUVConv() {
+	const int maxWidth = 512;
+	u8 y[maxWidth], u[maxWidth / 2], v[maxWidth / 2];
+	u32 rgba[maxWidth];
+	u16 rgb565[maxWidth], rgba5551[maxWidth], rgba4444[maxWidth];
+
+	GMRng rng;
+	for (int pass = 0; pass < 64; pass++) {
+		for (int i = 0; i < maxWidth; i++)
+			y[i] = rng.R32();
+		for (int i = 0; i < maxWidth / 2; i++) {
+			u[i] = rng.R32();
+			v[i] = rng.R32();
+		}
+		// Include the extremes, where clamping kicks in.
+		y[0] = 0; u[0] = 0; v[0] = 255;
+		y[2] = 255; u[1] = 255; v[1] = 0;
+
+		// Odd widths to cover the scalar tail after the SIMD loop.
+		const int width = pass == 0 ? maxWidth : 1 + (rng.R32() % maxWidth);
+		ConvertYUV420ToRGBA8888(rgba, y, u, v, width);
+		ConvertYUV420ToRGB565(rgb565, y, u, v, width);
+		ConvertYUV420ToRGBA5551(rgba5551, y, u, v, width);
+		ConvertYUV420ToRGBA4444(rgba4444, y, u, v, width);
+
+		for (int x = 0; x < width; x++) {
+			u32 reference = ReferenceYUVToRGBA8888(y[x], u[x / 2], v[x / 2]);
+			for (int shift = 0; shift < 32; shift += 8) {
+				int diff = (int)((rgba[x] >> shift) & 0xFF) - (int)((reference >> shift) & 0xFF);
+				if (diff < -1 || diff > 1) {
+					printf("YUV %d,%d,%d: got %08x, expected %08x\n", y[x], u[x / 2], v[x / 2], rgba[x], reference);
+					return false;
+				}
+			}
+
+			// The 16-bit formats should just be truncations of the same color.
+			u32 r = rgba[x] & 0xFF, g = (rgba[x] >> 8) & 0xFF, b = (rgba[x] >> 16) & 0xFF;
+			EXPECT_EQ_INT(rgb565[x], (r >> 3) | ((g >> 2) << 5) | ((b >> 3) << 11));
+			EXPECT_EQ_INT(rgba5551[x], (r >> 3) | ((g >> 3) << 5) | ((b >> 3) << 10));
+			EXPECT_EQ_INT(rgba4444[x], (r >> 4) | ((g >> 4) << 4) | ((b >> 4) << 8));
+		}
+	}
+	return true;
+}
+
 CharQueue GetQueue() {
 	CharQueue queue(5);
 	return queue;
@@ -1236,9 +1443,12 @@ typedef bool (*TestFunc)();
 struct TestItem {
 	const char *name;
 	TestFunc func;
+	// Heavy or platform specific tests only run when asked for by name.
+	bool inAll;
 };
 
-#define TEST_ITEM(name) { #name, &Test ##name, }
+#define TEST_ITEM(name) { #name, &Test ##name, true }
+#define TEST_ITEM_MANUAL(name) { #name, &Test ##name, false }
 
 bool TestArmEmitter();
 bool TestArm64Emitter();
@@ -1250,6 +1460,17 @@ bool TestSoftwareGPUJit();
 bool TestIRPassSimplify();
 bool TestThreadManager();
 bool TestVFS();
+bool TestAdhocServer();
+bool TestAdhocServerLoad();
+bool TestSasAudio();
+bool TestSasAudioBenchmark();
+bool TestDecodeAheadQueue();
+bool TestIoTrace();
+bool TestISOFileSystem();
+bool TestISOFileSystemBenchmark();
+bool TestDirectoryFileSystem();
+bool TestFileLoaders();
+bool TestFileLoadersBenchmark();
 
 TestItem availableTests[] = {
 #if PPSSPP_ARCH(ARM64) || PPSSPP_ARCH(AMD64) || PPSSPP_ARCH(X86)
@@ -1278,8 +1499,11 @@ TestItem availableTests[] = {
 	TEST_ITEM(VFPUMatrixTranspose),
 	TEST_ITEM(ParseLBN),
 	TEST_ITEM(QuickTexHash),
+	TEST_ITEM(WideHash),
+	TEST_ITEM_MANUAL(WideHashBenchmark),
 	TEST_ITEM(CLZ),
 	TEST_ITEM(MemMap),
+	TEST_ITEM(MemWriteTracker),
 	TEST_ITEM(ShaderGenerators),
 	TEST_ITEM(SoftwareGPUJit),
 	TEST_ITEM(Path),
@@ -1293,9 +1517,22 @@ TestItem availableTests[] = {
 	TEST_ITEM(InputMapping),
 	TEST_ITEM(EscapeMenuString),
 	TEST_ITEM(VFS),
+	TEST_ITEM(AdhocServer),
+	TEST_ITEM_MANUAL(AdhocServerLoad),
+	TEST_ITEM(SasAudio),
+	TEST_ITEM_MANUAL(SasAudioBenchmark),
+	TEST_ITEM(DecodeAheadQueue),
+	TEST_ITEM(IoTrace),
+	TEST_ITEM(ISOFileSystem),
+	TEST_ITEM_MANUAL(ISOFileSystemBenchmark),
+	TEST_ITEM(FileLoaders),
+	TEST_ITEM_MANUAL(FileLoadersBenchmark),
+	TEST_ITEM(DirectoryFileSystem),
 	TEST_ITEM(Substitutions),
 	TEST_ITEM(IniFile),
 	TEST_ITEM(ColorConv),
+	TEST_ITEM(YUVConv),
+	TEST_ITEM_MANUAL(YUVConvBenchmark),
 	TEST_ITEM(CharQueue),
 	TEST_ITEM(Buffer),
 	TEST_ITEM(SIMD),
@@ -1336,6 +1573,8 @@ int main(int argc, const char *argv[]) {
 		int passes = 0;
 		int fails = 0;
 		for (const auto &f : availableTests) {
+			if (!f.inAll)
+				continue;
 			printf("\n**** Running test %s ****\n", f.name);
 			if (f.func()) {
 				++passes;
@@ -1356,7 +1595,7 @@ int main(int argc, const char *argv[]) {
 		fprintf(stderr, "\n");
 		fprintf(stderr, "Available tests:\n");
 		for (auto f : availableTests) {
-			fprintf(stderr, "  * %s\n", f.name);
+			fprintf(stderr, "  * %s%s\n", f.name, f.inAll ? "" : " (not in all)");
 		}
 		return 1;
 	} else {